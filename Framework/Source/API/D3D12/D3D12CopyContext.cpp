@@ -180,7 +180,7 @@ namespace Falcor
 
         //Get buffer data
         std::vector<uint8> result;
-        uint32_t actualRowSize = footprint.Footprint.Width * getFormatBytesPerBlock(mTextureFormat);
+        uint32_t actualRowSize = (footprint.Footprint.Width / getFormatWidthCompressionRatio(mTextureFormat)) * getFormatBytesPerBlock(mTextureFormat);
         result.resize(mRowCount * actualRowSize);
         uint8* pData = reinterpret_cast<uint8*>(mpBuffer->map(Buffer::MapType::Read));
 
@@ -201,6 +201,9 @@ namespace Falcor
             pProg->removeDefine("HAS_COLORS");
             pProg->removeDefine("HAS_LIGHTMAP_UV");
             pProg->removeDefine("HAS_PREV_POSITION");
+            pProg->removeDefine("COMPRESSED_POSITION");
+            pProg->removeDefine("COMPRESSED_NORMAL");
+            pProg->removeDefine("COMPRESSED_BITANGENT");
 
             for (const auto& l : mpBufferLayouts)
             {
@@ -208,13 +211,19 @@ namespace Falcor
                 {
                     for (uint32_t i = 0; i < l->getElementCount(); i++)
                     {
+                        if (l->getElementShaderLocation(i) == VERTEX_POSITION_LOC && l->getElementFormat(i) == ResourceFormat::RGBA16Unorm)
+                        {
+                            pProg->addDefine("COMPRESSED_POSITION");
+                        }
                         if (l->getElementShaderLocation(i) == VERTEX_NORMAL_LOC)
                         {
                             pProg->addDefine("HAS_NORMAL");
+                            if (l->getElementFormat(i) == ResourceFormat::RG16Snorm) pProg->addDefine("COMPRESSED_NORMAL");
                         }
                         if (l->getElementShaderLocation(i) == VERTEX_BITANGENT_LOC)
                         {
                             pProg->addDefine("HAS_BITANGENT");
+                            if (l->getElementFormat(i) == ResourceFormat::RG16Snorm) pProg->addDefine("COMPRESSED_BITANGENT");
                         }
                         if (l->getElementShaderLocation(i) == VERTEX_TEXCOORD_LOC)
                         {
@@ -393,6 +393,23 @@ struct DispatchArguments
     uint threadGroupCountZ;
 };
 
+/** Bounds of a mesh cluster (meshlet), see MeshletBuilder. All values are in the mesh's object space.
+    A meshlet is entirely back-facing for a viewer when dot(normalize(coneApex - viewerPos), coneAxis) >= coneCutoff.
+*/
+struct MeshletData
+{
+    float3      center          DEFAULTS(float3(0));        ///< Bounding sphere center
+    float       radius          DEFAULTS(0.f);              ///< Bounding sphere radius
+    float3      coneApex        DEFAULTS(float3(0));        ///< Apex of the normal cone
+    float       coneCutoff      DEFAULTS(1.f);              ///< Sine of the normal cone's half angle. 1 if the cone can't be used for culling.
+    float3      coneAxis        DEFAULTS(float3(0, 0, 1));  ///< Axis of the normal cone
+    uint        indexOffset     DEFAULTS(0);                ///< First index of the meshlet in the mesh's index buffer
+    uint        triangleCount   DEFAULTS(0);                ///< Number of triangles, stored contiguously from indexOffset
+    uint        vertexCount     DEFAULTS(0);                ///< Number of distinct vertices used by the triangles
+    uint        pad0            DEFAULTS(0);
+    uint        pad1            DEFAULTS(0);
+};
+
 #ifdef HOST_CODE
 #undef SamplerState
 #undef Texture2D
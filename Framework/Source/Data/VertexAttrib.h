@@ -50,3 +50,10 @@
 #define VERTEX_BONE_ID_NAME         "BONE_IDS"
 #define VERTEX_DIFFUSE_COLOR_NAME   "DIFFUSE_COLOR"
 #define VERTEX_PREV_POSITION_NAME   "PREV_POSITION"
+
+/** Compressed vertex layouts (Model::LoadFlags::CompressVertices). The program defines are set by VertexLayout::addVertexAttribDclToProg()
+    COMPRESSED_POSITION  - RGBA16Unorm, relative to the mesh quantization box. Dequantized using gPositionDequantScale/gPositionDequantOffset
+    COMPRESSED_NORMAL    - RG16Snorm, octahedral encoding
+    COMPRESSED_BITANGENT - RG16Snorm, octahedral encoding
+    Texture coordinates are stored as RG16Float and don't need any decoding
+*/
@@ -92,6 +92,8 @@ namespace Falcor
             mBindLocations.alphaMapSampler = alphaMapSamplerLoc;
 
             toggleMeshCulling(false); 
+            // The cascades are rendered in a single pass, the camera doesn't match any of them
+            toggleMeshletCulling(false);
             Sampler::Desc desc;
             desc.setFilterMode(Sampler::Filter::Linear, Sampler::Filter::Linear, Sampler::Filter::Linear);
             mpAlphaSampler = Sampler::create(desc);
@@ -312,6 +314,7 @@ namespace Falcor
 
     void CascadedShadowMaps::createShadowPassResources(uint32_t mapWidth, uint32_t mapHeight)
     {
+        mCachedShadow.valid = false;
         mShadowPass.mapSize = glm::vec2(float(mapWidth), float(mapHeight));
         const ResourceFormat depthFormat = ResourceFormat::D32Float;
         mCsmData.depthBias = 0.005f;
@@ -822,15 +825,39 @@ namespace Falcor
         return getVisibilityBuffer();
     }
 
-    void CascadedShadowMaps::executeInternal(RenderContext* pRenderCtx, const Camera* pCamera, const Texture::SharedPtr& pSceneDepthBuffer)
+    void CascadedShadowMaps::setCachedShadowBounds(const BoundingBox& bounds)
     {
-        if (!mpLight || !mpSceneRenderer) return;
+        bool enable = glm::any(glm::greaterThan(bounds.extent, glm::vec3(0)));
+        if (enable != mCachedShadow.enabled || (enable && !(mCachedShadow.bounds == bounds)))
+        {
+            mCachedShadow.valid = false;
+        }
+        mCachedShadow.enabled = enable;
+        mCachedShadow.bounds = bounds;
+    }
+
+    void CascadedShadowMaps::fitCachedShadowMap()
+    {
+        const BoundingBox& bounds = mCachedShadow.bounds;
+        createShadowMatrix(mpLight.get(), bounds.center, glm::length(bounds.extent), mShadowPass.fboAspectRatio, mCsmData.globalMat);
 
+        // The region is usually much smaller than the camera frustum, all cascades use the same projection so the cascade selection doesn't matter
+        for (int32_t c = 0; c < mCsmData.cascadeCount; c++)
+        {
+            mCsmData.cascadeScale[c] = glm::vec4(1);
+            mCsmData.cascadeOffset[c] = glm::vec4(0);
+            mCsmData.cascadeRange[c].x = 0;
+            mCsmData.cascadeRange[c].y = 1;
+        }
+    }
+
+    void CascadedShadowMaps::renderShadowMap(RenderContext* pRenderCtx, const Camera* pCamera, const Texture::SharedPtr& pSceneDepthBuffer)
+    {
         const glm::vec4 clearColor(0);
         pRenderCtx->clearFbo(mShadowPass.pFbo.get(), clearColor, 1, 0, FboAttachmentType::All);
 
         // Calc the bounds
-        glm::vec2 distanceRange = calcDistanceRange(pRenderCtx, pCamera, pSceneDepthBuffer);
+        glm::vec2 distanceRange = mCachedShadow.enabled ? glm::vec2(0, 1) : calcDistanceRange(pRenderCtx, pCamera, pSceneDepthBuffer);
 
         GraphicsState::Viewport VP;
         VP.originX = 0;
@@ -844,7 +871,14 @@ namespace Falcor
         mShadowPass.pState->setViewport(0, VP);
         mpCsmSceneRenderer->setDepthClamp(mControls.depthClamp);
         pRenderCtx->pushGraphicsState(mShadowPass.pState);
-        partitionCascades(pCamera, distanceRange);
+        if (mCachedShadow.enabled)
+        {
+            fitCachedShadowMap();
+        }
+        else
+        {
+            partitionCascades(pCamera, distanceRange);
+        }
         renderScene(pRenderCtx);
         
         if(mCsmData.filterMode == CsmFilterVsm || mCsmData.filterMode == CsmFilterEvsm2 || mCsmData.filterMode == CsmFilterEvsm4)
@@ -859,7 +893,31 @@ namespace Falcor
             }
         }
         pRenderCtx->popGraphicsState();
+    }
+
+    void CascadedShadowMaps::executeInternal(RenderContext* pRenderCtx, const Camera* pCamera, const Texture::SharedPtr& pSceneDepthBuffer)
+    {
+        if (!mpLight || !mpSceneRenderer) return;
 
+        if (mCachedShadow.enabled)
+        {
+            // Light changes are detected here, geometry changes have to be reported through invalidateCachedShadowMap().
+            // Only the placement of the light matters, changing its color or intensity keeps the shadow map.
+            const LightData& lightData = mpLight->getData();
+            const LightData& cachedData = mCachedShadow.lightData;
+            const bool lightMoved = lightData.type != cachedData.type || lightData.posW != cachedData.posW || lightData.dirW != cachedData.dirW;
+            if (!mCachedShadow.valid || lightMoved)
+            {
+                renderShadowMap(pRenderCtx, pCamera, pSceneDepthBuffer);
+                mCachedShadow.lightData = lightData;
+                mCachedShadow.valid = true;
+                mCachedShadow.renderCount++;
+            }
+        }
+        else
+        {
+            renderShadowMap(pRenderCtx, pCamera, pSceneDepthBuffer);
+        }
 
         GPU_EVENT(pRenderCtx, "visibilityBuffer");
 
@@ -183,6 +183,26 @@ namespace Falcor
         /** Resize callback
         */
         virtual void onResize(uint32_t width, uint32_t height) override;
+
+        /** Fit a single shadow map to a fixed world-space region instead of the camera frustum and reuse it across calls.
+            The shadow map is rendered once and only re-rendered when the light's type, position or direction changes or invalidateCachedShadowMap() is called,
+            so generating visibility buffers for many views inside the region, such as the faces of light probes, only costs the visibility pass.
+            The whole region shares the shadow map's resolution, use resizeShadowMap() to match it to the region's size.
+            Pass an empty box to go back to per-camera cascades.
+        */
+        void setCachedShadowBounds(const BoundingBox& bounds);
+
+        /** Check if the shadow map is fitted to a fixed region
+        */
+        bool isShadowMapCached() const { return mCachedShadow.enabled; }
+
+        /** Re-render the cached shadow map on the next call. Call this when static geometry inside the region changed.
+        */
+        void invalidateCachedShadowMap() { mCachedShadow.valid = false; }
+
+        /** Get the number of times the cached shadow map was rendered
+        */
+        uint32_t getCachedShadowMapRenderCount() const { return mCachedShadow.renderCount; }
     private:
         CascadedShadowMaps(uint32_t mapWidth = 2048, uint32_t mapHeight = 2048);
         Light::SharedConstPtr mpLight;
@@ -198,6 +218,18 @@ namespace Falcor
         void createVisibilityPassResources();
         void partitionCascades(const Camera* pCamera, const glm::vec2& distanceRange);
         void renderScene(RenderContext* pCtx);
+        void renderShadowMap(RenderContext* pRenderCtx, const Camera* pCamera, const Texture::SharedPtr& pSceneDepthBuffer);
+        void fitCachedShadowMap();
+
+        // Cached shadow-map fitted to a fixed region
+        struct
+        {
+            bool enabled = false;
+            bool valid = false;
+            BoundingBox bounds;
+            LightData lightData;        // The light parameters the shadow map was rendered with
+            uint32_t renderCount = 0;
+        } mCachedShadow;
 
         // Shadow-pass
         struct
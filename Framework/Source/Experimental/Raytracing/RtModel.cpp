@@ -255,6 +255,12 @@ namespace Falcor
 
     RtModel::SharedPtr RtModel::createFromFile(const char* filename, RtBuildFlags buildFlags, Model::LoadFlags flags)
     {
+        if (is_set(flags, Model::LoadFlags::CompressVertices))
+        {
+            logWarning("RtModel::createFromFile() - the raytracing shaders don't support compressed vertices, ignoring Model::LoadFlags::CompressVertices");
+            flags &= ~Model::LoadFlags::CompressVertices;
+        }
+
         Model::SharedPtr pModel = Model::createFromFile(filename, flags);
         if (!pModel) return nullptr;
 
@@ -35,6 +35,12 @@ namespace Falcor
 {
     RtScene::SharedPtr RtScene::loadFromFile(const std::string& filename, RtBuildFlags rtFlags, Model::LoadFlags modelLoadFlags, Scene::LoadFlags sceneLoadFlags)
     {
+        if (is_set(modelLoadFlags, Model::LoadFlags::CompressVertices))
+        {
+            logWarning("RtScene::loadFromFile() - the raytracing shaders don't support compressed vertices, ignoring Model::LoadFlags::CompressVertices");
+            modelLoadFlags &= ~Model::LoadFlags::CompressVertices;
+        }
+
         RtScene::SharedPtr pRtScene = create(rtFlags);
         if (SceneImporter::loadScene(*pRtScene, filename, modelLoadFlags | Model::LoadFlags::BuffersAsShaderResource, sceneLoadFlags) == false)
         {
@@ -32,8 +32,70 @@
 namespace
 {
     const char kFileRasterPrimary[] = "RenderPasses\\GBufferRaster.slang";
+    const char kCubeFaceCbName[] = "CubeFaceCB";
+    const uint32_t kAllFacesMask = (1u << GBufferRaster::kCubeFaceCount) - 1;
 }
 
+/** Scene renderer of the layered cube path. Mesh instances are culled against the six face frusta in the same traversal,
+    the faces they overlap are passed to the geometry shader as a bit mask per draw instance.
+*/
+class GBufferRaster::CubeSceneRenderer : public SceneRenderer
+{
+public:
+    using SharedPtr = std::shared_ptr<CubeSceneRenderer>;
+
+    static SharedPtr create(const Scene::SharedPtr& pScene) { return SharedPtr(new CubeSceneRenderer(pScene)); }
+
+    void renderCube(RenderContext* pContext, const CubeFaceCameras& faceCameras, size_t faceMasksOffset)
+    {
+        mpFaceCameras = &faceCameras;
+        mFaceMasksOffset = faceMasksOffset;
+        // Face 0 provides the camera position and the lights, these are the same for all faces
+        renderScene(pContext, faceCameras[0].get());
+        mpFaceCameras = nullptr;
+    }
+
+protected:
+    CubeSceneRenderer(const Scene::SharedPtr& pScene) : SceneRenderer(pScene)
+    {
+        // The meshlets would only be culled against face 0
+        toggleMeshletCulling(false);
+    }
+
+    bool cullMeshInstance(const CurrentWorkingData& currentData, const Scene::ModelInstance* pModelInstance, const Model::MeshInstance* pMeshInstance) override
+    {
+        BoundingBox box = pMeshInstance->getBoundingBox().transform(pModelInstance->getTransformMatrix());
+        mCurrentFaceMask = 0;
+        for (uint32_t face = 0; face < kCubeFaceCount; ++face)
+        {
+            if (!(*mpFaceCameras)[face]->isObjectCulled(box))
+            {
+                mCurrentFaceMask |= 1u << face;
+            }
+        }
+        return mCurrentFaceMask == 0;
+    }
+
+    bool setPerMeshInstanceData(const CurrentWorkingData& currentData, const Scene::ModelInstance* pModelInstance, const Model::MeshInstance* pMeshInstance, uint32_t drawInstanceID) override
+    {
+        assert(drawInstanceID < MAX_INSTANCES);
+        mFaceMasks[drawInstanceID / 4][drawInstanceID % 4] = mCullEnabled ? mCurrentFaceMask : kAllFacesMask;
+        return SceneRenderer::setPerMeshInstanceData(currentData, pModelInstance, pMeshInstance, drawInstanceID);
+    }
+
+    void executeDraw(const CurrentWorkingData& currentData, uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex) override
+    {
+        ConstantBuffer* pCB = currentData.pVars->getConstantBuffer(kCubeFaceCbName).get();
+        pCB->setBlob(mFaceMasks, mFaceMasksOffset, sizeof(glm::uvec4) * ((instanceCount + 3) / 4));
+        SceneRenderer::executeDraw(currentData, indexCount, instanceCount, startIndex);
+    }
+
+    const CubeFaceCameras* mpFaceCameras = nullptr;
+    size_t mFaceMasksOffset = 0;
+    uint32_t mCurrentFaceMask = kAllFacesMask;
+    glm::uvec4 mFaceMasks[MAX_INSTANCES / 4];
+};
+
 RenderPassReflection GBufferRaster::reflect() const
 {
     RenderPassReflection r;
@@ -74,7 +136,7 @@ GBufferRaster::SharedPtr GBufferRaster::create(RasterizerState::CullMode cullMod
     return pPass;
 }
 
-Fbo::SharedPtr GBufferRaster::createGBufferFbo(int32_t w, int32_t h, bool hasDepthStencil)
+Fbo::SharedPtr GBufferRaster::createGBufferFbo(int32_t w, int32_t h, bool hasDepthStencil, uint32_t arraySize)
 {
     Fbo::Desc desc;
     RenderPassReflection r;
@@ -86,7 +148,7 @@ Fbo::SharedPtr GBufferRaster::createGBufferFbo(int32_t w, int32_t h, bool hasDep
     {
         desc.setDepthStencilTarget(ResourceFormat::D32Float);
     }
-    return FboHelper::create2D(w, h, desc);
+    return FboHelper::create2D(w, h, desc, arraySize);
 }
 
 Dictionary GBufferRaster::getScriptingDictionary() const
@@ -117,6 +179,26 @@ void GBufferRaster::onResize(uint32_t width, uint32_t height)
 void GBufferRaster::setScene(const Scene::SharedPtr& pScene)
 {
     mpSceneRenderer = (pScene == nullptr) ? nullptr : SceneRenderer::create(pScene);
+    mpCubeSceneRenderer = (pScene == nullptr) ? nullptr : CubeSceneRenderer::create(pScene);
+}
+
+void GBufferRaster::createCubeResources()
+{
+    GraphicsProgram::Desc desc;
+    desc.addShaderLibrary(kFileRasterPrimary).vsEntry("vsCube").gsEntry("gsCube").psEntry("ps");
+    Program::DefineList defines;
+    defines.add("_LAYERED_CUBE");
+    mCube.pProgram = GraphicsProgram::create(desc, defines);
+
+    mCube.pState = GraphicsState::create();
+    mCube.pState->setProgram(mCube.pProgram);
+    mCube.pState->setRasterizerState(mRaster.pState->getRasterizerState());
+    mCube.pState->setDepthStencilState(mRaster.pState->getDepthStencilState());
+
+    mCube.pVars = GraphicsVars::create(mCube.pProgram->getReflector());
+    ConstantBuffer::SharedPtr pCB = mCube.pVars->getConstantBuffer(kCubeFaceCbName);
+    mCube.faceViewProjOffset = pCB->getVariableOffset("gFaceViewProj[0]");
+    mCube.faceMasksOffset = pCB->getVariableOffset("gFaceMasks[0]");
 }
 
 void GBufferRaster::renderUI(Gui* pGui, const char* uiGroup)
@@ -139,6 +221,12 @@ void GBufferRaster::setCullMode(RasterizerState::CullMode mode)
     DepthStencilState::Desc dsDesc;
     dsDesc.setDepthFunc(DepthStencilState::Func::LessEqual);
     mRaster.pState->setDepthStencilState(DepthStencilState::create(dsDesc));
+
+    if (mCube.pState)
+    {
+        mCube.pState->setRasterizerState(mRaster.pState->getRasterizerState());
+        mCube.pState->setDepthStencilState(mRaster.pState->getDepthStencilState());
+    }
 }
 
 void GBufferRaster::execute(RenderContext* pContext, Fbo::SharedPtr pGBufferFbo, Camera::SharedConstPtr pCamera)
@@ -163,6 +251,39 @@ void GBufferRaster::execute(RenderContext* pContext, Fbo::SharedPtr pGBufferFbo,
     mRaster.pState->popFbo();    
 }
 
+void GBufferRaster::executeCube(RenderContext* pContext, const Fbo::SharedPtr& pGBufferFbo, const CubeFaceCameras& faceCameras)
+{
+    if (mpCubeSceneRenderer == nullptr)
+    {
+        logWarning("Invalid SceneRenderer in GBufferRaster::executeCube()");
+        return;
+    }
+    assert(pGBufferFbo->getColorTexture(0)->getArraySize() >= kCubeFaceCount);
+
+    if (mCube.pProgram == nullptr)
+    {
+        createCubeResources();
+    }
+
+    glm::mat4 faceViewProj[kCubeFaceCount];
+    for (uint32_t face = 0; face < kCubeFaceCount; ++face)
+    {
+        faceViewProj[face] = faceCameras[face]->getViewProjMatrix();
+    }
+    mCube.pVars->getConstantBuffer(kCubeFaceCbName)->setBlob(faceViewProj, mCube.faceViewProjOffset, sizeof(faceViewProj));
+    mCube.pVars["PerFrameCB"]["gRenderTargetDim"] = vec2(pGBufferFbo->getWidth(), pGBufferFbo->getHeight());
+
+    mCube.pState->pushFbo(pGBufferFbo);
+
+    pContext->pushGraphicsState(mCube.pState);
+    pContext->pushGraphicsVars(mCube.pVars);
+    mpCubeSceneRenderer->renderCube(pContext, faceCameras, mCube.faceMasksOffset);
+    pContext->popGraphicsVars();
+    pContext->popGraphicsState();
+
+    mCube.pState->popFbo();
+}
+
 void GBufferRaster::execute(RenderContext* pContext, const RenderData* pRenderData)
 {
     Fbo::SharedPtr pFbo = Fbo::create();
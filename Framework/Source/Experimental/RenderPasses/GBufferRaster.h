@@ -26,6 +26,7 @@
 # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ***************************************************************************/
 #pragma once
+#include <array>
 #include "Falcor.h"
 
 using namespace Falcor;
@@ -35,12 +36,26 @@ class GBufferRaster : public RenderPass, inherit_shared_from_this<RenderPass, GB
 public:
     using SharedPtr = std::shared_ptr<GBufferRaster>;
 
+    static const uint32_t kCubeFaceCount = 6;
+    using CubeFaceCameras = std::array<Camera::SharedPtr, kCubeFaceCount>;
+
     static SharedPtr create(const Dictionary& dict = {});
     static SharedPtr create(RasterizerState::CullMode cullMode);
-    static Fbo::SharedPtr createGBufferFbo(int32_t w, int32_t h, bool hasDepthStencil = true);
+
+    /** Create an FBO for the G-buffer channels. Use arraySize = kCubeFaceCount for executeCube().
+    */
+    static Fbo::SharedPtr createGBufferFbo(int32_t w, int32_t h, bool hasDepthStencil = true, uint32_t arraySize = 1);
 
     void execute(RenderContext* pContext, Fbo::SharedPtr pGBufferFbo, Camera::SharedConstPtr pCamera);
 
+    /** Render the six faces of a cube map in a single scene traversal.
+        Each mesh instance is culled against all face frusta at once and drawn in one instanced call per mesh, a geometry
+        shader replicates the triangles into the array layers of the faces they overlap.
+        \param[in] pGBufferFbo FBO whose attachments have kCubeFaceCount array slices, face i is written to slice i
+        \param[in] faceCameras One camera per face, they must share the same position
+    */
+    void executeCube(RenderContext* pContext, const Fbo::SharedPtr& pGBufferFbo, const CubeFaceCameras& faceCameras);
+
     RenderPassReflection reflect() const override;
     void execute(RenderContext* pContext, const RenderData* pRenderData) override;
     void renderUI(Gui* pGui, const char* uiGroup) override;
@@ -49,11 +64,15 @@ public:
     void setScene(const Scene::SharedPtr& pScene) override;
     std::string getDesc(void) override { return "Raster GBuffer generation"; }
 private:
+    class CubeSceneRenderer;
+
     GBufferRaster();
     void setCullMode(RasterizerState::CullMode mode);
     bool parseDictionary(const Dictionary& dict);
+    void createCubeResources();
 
     SceneRenderer::SharedPtr                mpSceneRenderer;
+    std::shared_ptr<CubeSceneRenderer>      mpCubeSceneRenderer;
     RasterizerState::CullMode               mCullMode = RasterizerState::CullMode::Back;
 
     // Rasterization resources
@@ -63,4 +82,14 @@ private:
         GraphicsProgram::SharedPtr pProgram;
         GraphicsVars::SharedPtr pVars;
     } mRaster;
+
+    // Layered cube rendering resources, created on first use
+    struct
+    {
+        GraphicsState::SharedPtr pState;
+        GraphicsProgram::SharedPtr pProgram;
+        GraphicsVars::SharedPtr pVars;
+        size_t faceViewProjOffset = ConstantBuffer::kInvalidOffset;
+        size_t faceMasksOffset = ConstantBuffer::kInvalidOffset;
+    } mCube;
 };
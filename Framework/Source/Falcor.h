@@ -95,6 +95,9 @@
 
 // Model
 #include "Graphics/Model/Mesh.h"
+#include "Graphics/Model/MeshOptimizer.h"
+#include "Graphics/Model/VertexCompression.h"
+#include "Graphics/Model/Meshlets.h"
 #include "Graphics/Model/Model.h"
 #include "Graphics/Model/ModelRenderer.h"
 
@@ -120,12 +123,14 @@
 #include "Utils/Profiler.h"
 #include "Utils/StringUtils.h"
 #include "Utils/BinaryFileStream.h"
+#include "Utils/MemoryMappedFile.h"
+#include "Utils/MemoryMappedStream.h"
 #include "Utils/Video/VideoEncoder.h"
 #include "Utils/Video/VideoEncoderUI.h"
 #include "Utils/Video/VideoDecoder.h"
 #include "Utils/Platform/OS.h"
 #include "Utils/Platform/ProgressBar.h"
-#include "Utils/ThreadPool.h"
+#include "Utils/TaskScheduler.h"
 #include "Utils/PatternGenerators/DxSamplePattern.h"
 #include "Utils/PatternGenerators/HaltonSamplePattern.h"
 
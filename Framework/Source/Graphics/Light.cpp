@@ -512,6 +512,13 @@ namespace Falcor
         {
             const Mesh::SharedPtr& pMesh = pModel->getMesh(meshId);
 
+            // The area light shaders read full precision positions and 32-bit indices
+            if (pMesh->hasQuantizedPositions() || pMesh->getVao()->getIndexBufferFormat() != ResourceFormat::R32Uint)
+            {
+                if (pMesh->getMaterial() && pMesh->getMaterial()->isEmissive()) logWarning("createAreaLightsForModel() - area lights don't support compressed vertices, skipping an emissive mesh of " + pModel->getName());
+                continue;
+            }
+
             // Obtain mesh instances for this mesh
             for (uint32_t instanceId = 0; instanceId < pModel->getMeshInstanceCount(meshId); ++instanceId)
             {
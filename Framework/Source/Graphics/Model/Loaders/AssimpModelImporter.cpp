@@ -35,6 +35,9 @@
 #include "Graphics/Model/Animation.h"
 #include "Graphics/Model/Mesh.h"
 #include "Graphics/Model/AnimationController.h"
+#include "Graphics/Model/MeshOptimizer.h"
+#include "Graphics/Model/VertexCompression.h"
+#include "Graphics/Model/Meshlets.h"
 #include "API/Texture.h"
 #include "API/Buffer.h"
 #include "Utils/Platform/OS.h"
@@ -42,6 +45,7 @@
 #include "API/VertexLayout.h"
 #include "Data/VertexAttrib.h"
 #include "Utils/StringUtils.h"
+#include "Utils/TaskScheduler.h"
 #include "API/Device.h"
 
 namespace Falcor
@@ -267,7 +271,7 @@ namespace Falcor
         }
     }
 
-    void AssimpModelImporter::loadTextures(const aiMaterial* pAiMaterial, const std::string& folder, Material* pMaterial, bool isObjFile, bool useSrgb)
+    void AssimpModelImporter::requestTextures(const aiMaterial* pAiMaterial, const std::string& folder, Material* pMaterial, bool useSrgb)
     {
         for (int i = 0; i < AI_TEXTURE_TYPE_MAX; ++i)
         {
@@ -287,7 +291,6 @@ namespace Falcor
                 aiString path;
                 pAiMaterial->GetTexture(aiType, 0, &path);
                 std::string s(path.data);
-                Texture::SharedPtr pTex = nullptr;
 
                 if (s.empty())
                 {
@@ -295,31 +298,81 @@ namespace Falcor
                     continue;
                 }
 
-                // Check if the texture was already loaded
-                const auto& a = mTextureCache.find(s);
-                if (a != mTextureCache.end())
+                // Each file is requested once, later materials share the texture
+                auto a = mTextureRequestIndices.find(s);
+                if (a == mTextureRequestIndices.end())
                 {
-                    pTex = a->second;
+                    TextureRequest request;
+                    request.name = s;
+                    request.fullpath = replaceSubstring(folder + '/' + s, "\\", "/");
+                    request.loadAsSrgb = isSrgbRequired(aiType, useSrgb, pMaterial->getShadingModel());
+                    a = mTextureRequestIndices.insert({ s, (uint32_t)mTextureRequests.size() }).first;
+                    mTextureRequests.push_back(request);
                 }
-                else
+
+                mTextureBindings.push_back({ pMaterial, (uint32_t)aiType, a->second });
+            }
+        }
+    }
+
+    void AssimpModelImporter::loadRequestedTextures(bool isObjFile)
+    {
+        // Decoded images are large, so only two batches are in flight: one being uploaded while the next one decodes
+        TaskScheduler& scheduler = TaskScheduler::instance();
+        const uint32_t requestCount = (uint32_t)mTextureRequests.size();
+        const uint32_t batchSize = 2 * scheduler.getConcurrency();
+
+        auto decodeBatch = [this, requestCount, batchSize](TaskGroup& group, uint32_t batchStart)
+        {
+            const uint32_t batchEnd = std::min(batchStart + batchSize, requestCount);
+            for (uint32_t i = batchStart; i < batchEnd; i++)
+            {
+                group.run([this, i]() { mTextureRequests[i].pData = loadTextureFileData(mTextureRequests[i].fullpath, mTextureRequests[i].error); });
+            }
+        };
+
+        TaskGroup decodeGroup(scheduler);
+        decodeBatch(decodeGroup, 0);
+        for (uint32_t batchStart = 0; batchStart < requestCount; batchStart += batchSize)
+        {
+            decodeGroup.wait();
+            decodeBatch(decodeGroup, batchStart + batchSize);
+
+            // Texture creation records GPU work and has to stay on this thread
+            const uint32_t batchEnd = std::min(batchStart + batchSize, requestCount);
+            for (uint32_t i = batchStart; i < batchEnd; i++)
+            {
+                TextureRequest& request = mTextureRequests[i];
+                if (request.pData)
                 {
-                    // create a new texture
-                    std::string fullpath = folder + '/' + s;
-                    fullpath = replaceSubstring(fullpath, "\\", "/");
-                    pTex = createTextureFromFile(fullpath, true, isSrgbRequired(aiType, useSrgb, pMaterial->getShadingModel()));
+                    Texture::SharedPtr pTex = createTextureFromFileData(*request.pData, true, request.loadAsSrgb);
                     if (pTex)
                     {
-                        mTextureCache[s] = pTex;
+                        mTextureCache[request.name] = pTex;
                     }
+                    request.pData = nullptr;
+                }
+                else
+                {
+                    logError(request.error);
                 }
-
-                assert(pTex != nullptr);
-                setTexture(aiType, isObjFile, pMaterial, pTex);
             }
+
+            // Flush the upload heap after every batch so we don't accumulate a ton of memory usage when loading a model with a lot of textures
+            gpDevice->flushAndSync();
+        }
+
+        for (const TextureBinding& binding : mTextureBindings)
+        {
+            const auto& a = mTextureCache.find(mTextureRequests[binding.requestIndex].name);
+            Texture::SharedPtr pTex = (a != mTextureCache.end()) ? a->second : nullptr;
+            assert(pTex != nullptr);
+            setTexture((aiTextureType)binding.aiType, isObjFile, binding.pMaterial, pTex);
         }
 
-        // Flush upload heap after every material so we don't accumulate a ton of memory usage when loading a model with a lot of textures
-        gpDevice->flushAndSync();
+        mTextureRequests.clear();
+        mTextureRequestIndices.clear();
+        mTextureBindings.clear();
     }
 
     Material::SharedPtr AssimpModelImporter::createMaterial(const aiMaterial* pAiMaterial, const std::string& folder, bool isObjFile, bool useSrgb)
@@ -341,8 +394,8 @@ namespace Falcor
             pMaterial->setShadingModel(ShadingModelSpecGloss);
         }
 
-        // Load textures. Note that loading is affected by the current shading model.
-        loadTextures(pAiMaterial, folder, pMaterial.get(), isObjFile, useSrgb);
+        // Request textures. Note that loading is affected by the current shading model.
+        requestTextures(pAiMaterial, folder, pMaterial.get(), useSrgb);
 
         // Opacity
         float opacity;
@@ -440,15 +493,24 @@ namespace Falcor
 
     bool AssimpModelImporter::createAllMaterials(const aiScene* pScene, const std::string& modelFolder, bool isObjFile, bool useSrgb)
     {
+        std::vector<Material::SharedPtr> materials(pScene->mNumMaterials);
         for (uint32_t i = 0; i < pScene->mNumMaterials; i++)
         {
             const aiMaterial* pAiMaterial = pScene->mMaterials[i];
-            auto pMaterial = createMaterial(pAiMaterial, modelFolder, isObjFile, useSrgb);
-            if (pMaterial == nullptr)
+            materials[i] = createMaterial(pAiMaterial, modelFolder, isObjFile, useSrgb);
+            if (materials[i] == nullptr)
             {
                 logError("Can't allocate memory for material");
                 return false;
             }
+        }
+
+        loadRequestedTextures(isObjFile);
+
+        // Materials compare equal by their textures too, so duplicates can only be found once the textures are bound
+        for (uint32_t i = 0; i < pScene->mNumMaterials; i++)
+        {
+            auto pMaterial = materials[i];
             auto pAdded = checkForExistingMaterial(pMaterial);
             if (pMaterial != pAdded)
             {
@@ -558,6 +620,11 @@ namespace Falcor
             return false;
         }
 
+        if (is_set(mFlags, Model::LoadFlags::OptimizeMeshes))
+        {
+            logInfo("AssimpModelImporter: Optimized meshes of '" + filename + "': " + to_string(mOptimizerReport));
+        }
+
         return true;
     }
 
@@ -771,8 +838,7 @@ namespace Falcor
     Mesh::SharedPtr AssimpModelImporter::createMesh(aiMesh* pAiMesh)
     {
         uint32_t vertexCount = pAiMesh->mNumVertices;
-        uint32_t indexCount = pAiMesh->mNumFaces * pAiMesh->mFaces[0].mNumIndices;
-        auto pIB = createIndexBuffer(pAiMesh);
+        std::vector<uint32_t> indices = createIndexBufferData(pAiMesh);
         BoundingBox boundingBox = createMeshBbox(pAiMesh);
 
         const bool generateTangentSpace = (pAiMesh->HasTangentsAndBitangents() == false) && (is_set(mFlags, Model::LoadFlags::DontGenerateTangentSpace) == false);
@@ -788,23 +854,6 @@ namespace Falcor
             return nullptr;
         }
 
-        std::vector<Buffer::SharedPtr> pVBs(pLayout->getBufferCount());
-
-        // Initialize the bones data
-        VertexWeightsVec weights;
-        VertexIdsVec ids;
-        if (pAiMesh->HasBones())
-        {
-            loadBones(pAiMesh, weights, ids, vertexCount, mBoneNameToIdMap);
-        }
-
-        // Create corresponding vertex buffers
-        for (uint32_t i = 0; i < pLayout->getBufferCount(); i++)
-        {
-            const VertexBufferLayout* pVbLayout = pLayout->getBufferLayout(i).get();
-            pVBs[i] = createVertexBuffer(pAiMesh, pVbLayout, (uint8_t*)ids.data(), weights.data());
-        }
-
         Vao::Topology topology = Vao::Topology::TriangleList;
         switch (pAiMesh->mFaces[0].mNumIndices)
         {
@@ -822,10 +871,83 @@ namespace Falcor
             assert(0);
         }
 
+        // Initialize the bones data
+        VertexWeightsVec weights;
+        VertexIdsVec ids;
+        if (pAiMesh->HasBones())
+        {
+            loadBones(pAiMesh, weights, ids, vertexCount, mBoneNameToIdMap);
+        }
+
+        // Fill the vertex data, one stream per vertex buffer. The data is in the full precision format until all the processing is done.
+        std::vector<std::vector<uint8_t>> vbData(pLayout->getBufferCount());
+        std::vector<MeshOptimizer::VertexStream> streams(pLayout->getBufferCount());
+        uint32_t positionStream = 0;
+        for (uint32_t i = 0; i < pLayout->getBufferCount(); i++)
+        {
+            const uint32_t location = pLayout->getBufferLayout(i)->getElementShaderLocation(0);
+            VertexBufferLayout::SharedPtr pVbLayout = VertexBufferLayout::create();
+            pVbLayout->addElement(kLayoutData[location].name, 0, kLayoutData[location].format, 1, location);
+            vbData[i] = createVertexBufferData(pAiMesh, pVbLayout.get(), (uint8_t*)ids.data(), weights.data());
+            streams[i] = { &vbData[i], pVbLayout->getStride() };
+            if (location == VERTEX_POSITION_LOC) positionStream = i;
+        }
+
+        // Split the triangles into meshlets. Skinned meshes move away from the meshlet bounds, they are drawn whole.
+        const bool optimize = is_set(mFlags, Model::LoadFlags::OptimizeMeshes) && topology == Vao::Topology::TriangleList;
+        const bool buildMeshlets = is_set(mFlags, Model::LoadFlags::GenerateMeshlets) && topology == Vao::Topology::TriangleList && pAiMesh->HasBones() == false;
+        std::vector<MeshletData> meshlets;
+        if (buildMeshlets && optimize)
+        {
+            MeshOptimizer::Report report;
+            meshlets = MeshletBuilder::buildOptimized(streams, vertexCount, indices, {}, positionStream, report)[0];
+            mOptimizerReport += report;
+        }
+        else if (buildMeshlets)
+        {
+            meshlets = MeshletBuilder::build(vbData[positionStream].data(), streams[positionStream].stride, vertexCount, indices.data(), (uint32_t)indices.size());
+        }
+        else if (optimize)
+        {
+            mOptimizerReport += MeshOptimizer::optimize(streams, vertexCount, indices, {}, positionStream);
+        }
+
+        ResourceFormat indexFormat = ResourceFormat::R32Uint;
+        bool quantizedPositions = false;
+        BoundingBox quantizationBox;
+        if (is_set(mFlags, Model::LoadFlags::CompressVertices))
+        {
+            quantizationBox = VertexCompression::calcQuantizationBox(vbData[positionStream].data(), kLayoutData[VERTEX_POSITION_LOC].format, vertexCount);
+            for (uint32_t i = 0; i < pLayout->getBufferCount(); i++)
+            {
+                const VertexBufferLayout* pVbLayout = pLayout->getBufferLayout(i).get();
+                const uint32_t location = pVbLayout->getElementShaderLocation(0);
+                if (pVbLayout->getElementFormat(0) != kLayoutData[location].format)
+                {
+                    vbData[i] = VertexCompression::compressAttribute(location, kLayoutData[location].format, vbData[i].data(), vertexCount, quantizationBox);
+                    if (location == VERTEX_POSITION_LOC) quantizedPositions = true;
+                }
+            }
+            indexFormat = VertexCompression::getIndexFormat(vertexCount);
+        }
+
+        // Create corresponding buffers
+        auto pIB = createIndexBuffer(indices, indexFormat);
+        std::vector<Buffer::SharedPtr> pVBs(pLayout->getBufferCount());
+        for (uint32_t i = 0; i < pLayout->getBufferCount(); i++)
+        {
+            pVBs[i] = createVertexBuffer(vbData[i]);
+        }
+
         auto pMaterial = mAiMaterialToFalcor[pAiMesh->mMaterialIndex];
         assert(pMaterial);
 
-        Mesh::SharedPtr pMesh = Mesh::create(pVBs, vertexCount, pIB, indexCount, pLayout, topology, pMaterial, boundingBox, pAiMesh->HasBones());
+        Mesh::SharedPtr pMesh = Mesh::create(pVBs, vertexCount, pIB, (uint32_t)indices.size(), pLayout, topology, pMaterial, boundingBox, pAiMesh->HasBones(), indexFormat);
+        if (quantizedPositions)
+        {
+            pMesh->setPositionQuantizationBox(quantizationBox);
+        }
+        pMesh->setMeshlets(std::move(meshlets));
 
         if (generateTangentSpace)
         {
@@ -835,16 +957,15 @@ namespace Falcor
         return pMesh;
     }
 
-    Buffer::SharedPtr AssimpModelImporter::createIndexBuffer(const aiMesh* pAiMesh)
+    Buffer::SharedPtr AssimpModelImporter::createIndexBuffer(const std::vector<uint32_t>& indices, ResourceFormat format)
     {
-        std::vector<uint32_t> indices = createIndexBufferData(pAiMesh);
-        const uint32_t size = (uint32_t)(sizeof(uint32_t) * indices.size());
+        std::vector<uint8_t> data = VertexCompression::convertIndices(indices.data(), indices.size(), format);
         Buffer::BindFlags bindFlags = Buffer::BindFlags::Index;
         if (is_set(mFlags, Model::LoadFlags::BuffersAsShaderResource))
         {
             bindFlags |= Buffer::BindFlags::ShaderResource;
         }
-        return Buffer::create(size, bindFlags, Buffer::CpuAccess::None, indices.data());;
+        return Buffer::create((uint32_t)data.size(), bindFlags, Buffer::CpuAccess::None, data.data());
     }
 
 
@@ -900,6 +1021,7 @@ namespace Falcor
         }
 
         VertexLayout::SharedPtr pLayout = VertexLayout::create();
+        const bool compress = is_set(mFlags, Model::LoadFlags::CompressVertices) && (pAiMesh->HasBones() == false);
 
         uint32_t bufferCount = 0;
         for (uint32_t location = 0; location < VERTEX_LOCATION_COUNT; ++location)
@@ -907,7 +1029,8 @@ namespace Falcor
             if (isElementUsed(pAiMesh, location))
             {
                 VertexBufferLayout::SharedPtr pVbLayout = VertexBufferLayout::create();
-                pVbLayout->addElement(kLayoutData[location].name, 0, kLayoutData[location].format, 1, location);
+                ResourceFormat format = compress ? VertexCompression::getCompressedFormat(location, kLayoutData[location].format) : kLayoutData[location].format;
+                pVbLayout->addElement(kLayoutData[location].name, 0, format, 1, location);
                 pLayout->addBufferLayout(bufferCount, pVbLayout);
                 bufferCount++;
             }
@@ -916,7 +1039,7 @@ namespace Falcor
         return pLayout;
     }
 
-    Buffer::SharedPtr AssimpModelImporter::createVertexBuffer(const aiMesh* pAiMesh, const VertexBufferLayout* pLayout, const uint8_t* pBoneIds, const vec4* pBoneWeights)
+    std::vector<uint8_t> AssimpModelImporter::createVertexBufferData(const aiMesh* pAiMesh, const VertexBufferLayout* pLayout, const uint8_t* pBoneIds, const vec4* pBoneWeights)
     {
         const uint32_t vertexStride = pLayout->getStride();
         std::vector<uint8_t> initData(vertexStride * pAiMesh->mNumVertices, 0);
@@ -954,7 +1077,7 @@ namespace Falcor
                 case VERTEX_TEXCOORD_LOC:
                     if (pAiMesh->mTextureCoords[0][vertexID].z != 0.f)
                     {
-                        Falcor::logErrorAndExit("AssimpModelImporter::createVertexBuffer: Texcoord[0].z != 0.0");
+                        Falcor::logErrorAndExit("AssimpModelImporter::createVertexBufferData: Texcoord[0].z != 0.0");
                     }
                     pSrc = (uint8_t*)(&pAiMesh->mTextureCoords[0][vertexID]);
                     size = sizeof(pAiMesh->mTextureCoords[0][vertexID]);
@@ -962,7 +1085,7 @@ namespace Falcor
                 case VERTEX_LIGHTMAP_UV_LOC:
                     if (pAiMesh->mTextureCoords[1][vertexID].z != 0.f)
                     {
-                        Falcor::logErrorAndExit("AssimpModelImporter::createVertexBuffer: Texcoord[1].z != 0.0");
+                        Falcor::logErrorAndExit("AssimpModelImporter::createVertexBufferData: Texcoord[1].z != 0.0");
                     }
                     pSrc = (uint8_t*)(&pAiMesh->mTextureCoords[1][vertexID]);
                     size = sizeof(pAiMesh->mTextureCoords[1][vertexID]);
@@ -983,12 +1106,17 @@ namespace Falcor
                 memcpy(pDst, pSrc, size);
             }
         }
+        return initData;
+    }
+
+    Buffer::SharedPtr AssimpModelImporter::createVertexBuffer(const std::vector<uint8_t>& data)
+    {
         Buffer::BindFlags bindFlags = Buffer::BindFlags::Vertex;
         if (is_set(mFlags, Model::LoadFlags::BuffersAsShaderResource))
         {
             bindFlags |= Buffer::BindFlags::ShaderResource;
         }
 
-        return Buffer::create(vertexStride * pAiMesh->mNumVertices, bindFlags, Buffer::CpuAccess::None, initData.data());;
+        return Buffer::create((uint32_t)data.size(), bindFlags, Buffer::CpuAccess::None, data.data());
     }
 }
\ No newline at end of file
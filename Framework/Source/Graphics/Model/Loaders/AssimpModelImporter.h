@@ -33,6 +33,7 @@
 #include "../AnimationController.h"
 #include "../Mesh.h"
 #include "../Model.h"
+#include "../MeshOptimizer.h"
 
 struct aiScene;
 struct aiNode;
@@ -50,6 +51,7 @@ namespace Falcor
     class Buffer;
     class VertexBufferLayout;
     class Texture;
+    struct TextureFileData;
 
     /** Implements model import functionality through ASSIMP.
         Typically, the user should use Model::createFromFile() to load a model instead of this class.
@@ -87,9 +89,11 @@ namespace Falcor
 
         Mesh::SharedPtr createMesh(aiMesh* pAiMesh);
         VertexLayout::SharedPtr createVertexLayout(const aiMesh* pAiMesh);
-        Buffer::SharedPtr createIndexBuffer(const aiMesh* pAiMesh);
-        Buffer::SharedPtr createVertexBuffer(const aiMesh* pAiMesh, const VertexBufferLayout* pLayout, const uint8_t* pBoneIds, const vec4* pBoneWeights);
-        void loadTextures(const aiMaterial* pAiMaterial, const std::string& folder, Material* pMaterial, bool isObjFile, bool useSrgb);
+        Buffer::SharedPtr createIndexBuffer(const std::vector<uint32_t>& indices, ResourceFormat format);
+        Buffer::SharedPtr createVertexBuffer(const std::vector<uint8_t>& data);
+        std::vector<uint8_t> createVertexBufferData(const aiMesh* pAiMesh, const VertexBufferLayout* pLayout, const uint8_t* pBoneIds, const vec4* pBoneWeights);
+        void requestTextures(const aiMaterial* pAiMaterial, const std::string& folder, Material* pMaterial, bool useSrgb);
+        void loadRequestedTextures(bool isObjFile);
         Material::SharedPtr createMaterial(const aiMaterial* pAiMaterial, const std::string& folder, bool isObjFile, bool useSrgb);
 
         // Checks whether a node or its name corresponds to a used bone or node in the skeleton hierarchy
@@ -105,6 +109,28 @@ namespace Falcor
 
         std::vector<Bone> mBones;
         Model::LoadFlags mFlags;
+        MeshOptimizer::Report mOptimizerReport;
         std::map<const std::string, Texture::SharedPtr> mTextureCache;
+
+        // Textures are loaded in two phases. Materials first record which files they use, then all unique files are decoded in parallel and uploaded in batches.
+        struct TextureRequest
+        {
+            std::string name;                           // Path as written in the model file, the key of mTextureCache
+            std::string fullpath;
+            bool loadAsSrgb = false;                    // Decided by the first material that references the file
+            std::shared_ptr<TextureFileData> pData;     // Decoded file, released once the texture is created
+            std::string error;                          // Set by the worker when the file can't be decoded, logged from the loading thread
+        };
+
+        struct TextureBinding
+        {
+            Material* pMaterial;
+            uint32_t aiType;
+            uint32_t requestIndex;
+        };
+
+        std::vector<TextureRequest> mTextureRequests;
+        std::map<std::string, uint32_t> mTextureRequestIndices;
+        std::vector<TextureBinding> mTextureBindings;
     };
 }
@@ -183,6 +183,16 @@ namespace Falcor
             return;
         }
 
+        for(uint32_t i = 0; i < mpModel->getMeshCount(); i++)
+        {
+            const Mesh* pMesh = mpModel->getMesh(i).get();
+            if(pMesh->hasQuantizedPositions() || pMesh->getVao()->getIndexBufferFormat() != ResourceFormat::R32Uint)
+            {
+                error("Binary format doesn't support models loaded with compressed vertices");
+                return;
+            }
+        }
+
         if(prepareSubmeshes() == false) return;
         if(writeHeader()      == false) return;
         if(writeTextures()    == false) return;
@@ -30,6 +30,9 @@
 #include "BinaryModelSpec.h"
 #include "../Model.h"
 #include "../Mesh.h"
+#include "../MeshOptimizer.h"
+#include "../VertexCompression.h"
+#include "../Meshlets.h"
 #include "Utils/Platform/OS.h"
 #include "API/VertexLayout.h"
 #include "Data/VertexAttrib.h"
@@ -41,6 +44,7 @@
 #include "API/Device.h"
 #include <numeric>
 #include <cstring>
+#include <algorithm>
 
 namespace Falcor
 {
@@ -49,7 +53,8 @@ namespace Falcor
         uint32_t width  = 0;
         uint32_t height = 0;
         ResourceFormat format = ResourceFormat::Unknown;
-        std::vector<uint8_t> data;
+        const uint8_t* pData = nullptr;     // Points into the mapped file, or into expandedData
+        std::vector<uint8_t> expandedData;  // Only used for formats that need to be converted before upload
         std::string name;
     };
 
@@ -82,7 +87,8 @@ namespace Falcor
 
     template<typename posType>
     void generateSubmeshTangentData(
-        const std::vector<uint32_t>& indices,
+        const uint32_t* indices,
+        uint32_t indexCount,
         uint32_t vertexCount,
         const posType* vertexPosData,
         const glm::vec3* vertexNormalData,
@@ -93,7 +99,7 @@ namespace Falcor
         std::memset(bitangentData, 0, vertexCount * sizeof(vec3));
 
         // calculate the tangent and bitangent for every face
-        size_t primCount = indices.size() / 3;
+        size_t primCount = indexCount / 3;
         for(size_t primID = 0; primID < primCount; primID++)
         {
             struct Data
@@ -352,17 +358,24 @@ namespace Falcor
         }
     }
 
-    std::string readString(BinaryFileStream& stream)
+    bool readString(MemoryMappedStream& stream, const std::string& modelName, std::string& str)
     {
-        int32_t length;
+        int32_t length = 0;
         stream >> length;
-        std::vector<char> charVec(length + 1);
-        stream.read(&charVec[0], length);
-        charVec[length] = 0;
-        return std::string(charVec.data());
+        const char* pChars = (length >= 0) ? (const char*)stream.view((size_t)length) : nullptr;
+        if(pChars == nullptr)
+        {
+            std::string msg = "Error when loading model " + modelName + ".\nString length is corrupted.";
+            logError(msg);
+            return false;
+        }
+
+        // Strings may be null-padded inside the file
+        str = std::string(pChars, std::find(pChars, pChars + length, '\0'));
+        return true;
     }
 
-    bool loadBinaryTextureData(BinaryFileStream& stream, const std::string& modelName, TextureData& data)
+    bool loadBinaryTextureData(MemoryMappedStream& stream, const std::string& modelName, TextureData& data)
     {
         // ImageHeader.
         char tag[9];
@@ -448,37 +461,45 @@ namespace Falcor
         {
             dataSize = bpp * texelCount;
         }
-        size_t storageSize = dataSize;
-        if(bpp == 3)
-            storageSize = 4 * texelCount;
 
-        data.data.resize(storageSize);
-        stream.read(data.data.data(), dataSize);
+        // The texels are used in place, straight from the mapped file
+        const uint8_t* pTexels = stream.view(dataSize);
+        if(pTexels == nullptr)
+        {
+            std::string msg = "Error when loading model " + modelName + ".\nCorrupt binary image data (file is truncated).";
+            logError(msg);
+            return false;
+        }
 
         // Convert 3-channel 8-bits RGB formats to 4-channel RGBX by adding padding
         if(bpp == 3)
         {
-            for(int32_t i=texelCount-1;i>=0;--i)
+            data.expandedData.resize(4 * texelCount);
+            for(int32_t i = 0; i < texelCount; i++)
             {
-                data.data[i * 4 + 0] = data.data[i * 3 + 0];
-                data.data[i * 4 + 1] = data.data[i * 3 + 1];
-                data.data[i * 4 + 2] = data.data[i * 3 + 2];
-                data.data[i * 4 + 3] = 0xff;
+                data.expandedData[i * 4 + 0] = pTexels[i * 3 + 0];
+                data.expandedData[i * 4 + 1] = pTexels[i * 3 + 1];
+                data.expandedData[i * 4 + 2] = pTexels[i * 3 + 2];
+                data.expandedData[i * 4 + 3] = 0xff;
             }
+            data.pData = data.expandedData.data();
+        }
+        else
+        {
+            data.pData = pTexels;
         }
 
         return true;
     }
 
-    bool importTextures(std::vector<TextureData>& textures, uint32_t textureCount, BinaryFileStream& stream, const std::string& modelName)
+    bool importTextures(std::vector<TextureData>& textures, uint32_t textureCount, MemoryMappedStream& stream, const std::string& modelName)
     {
         textures.assign(textureCount, TextureData());
 
         bool success = true;
         for(uint32_t i = 0; i < textureCount; i++)
         {
-            textures[i].name = readString(stream);
-            if(loadBinaryTextureData(stream, modelName, textures[i]) == false)
+            if(readString(stream, modelName, textures[i].name) == false || loadBinaryTextureData(stream, modelName, textures[i]) == false)
             {
                 success = false;
                 break;
@@ -490,7 +511,7 @@ namespace Falcor
         return success;
     }
 
-    BinaryModelImporter::BinaryModelImporter(const std::string& fullpath) : mModelName(fullpath), mStream(fullpath.c_str(), BinaryFileStream::Mode::Read)
+    BinaryModelImporter::BinaryModelImporter(const std::string& fullpath) : mModelName(fullpath), mStream(fullpath)
     {
     }
 
@@ -556,6 +577,12 @@ namespace Falcor
     
     bool BinaryModelImporter::importModel(Model& model, Model::LoadFlags flags)
     {
+        if(mStream.isOpen() == false)
+        {
+            logError("Error when loading model " + mModelName + ".\nCan't map the file into memory.");
+            return false;
+        }
+
         // Format ID and version.
         char formatID[9];
         mStream.read(formatID, 8);
@@ -626,7 +653,10 @@ namespace Falcor
 
         if(version >= 6)
         {
-            importTextures(texData, numTextures, mStream, mModelName);
+            if(importTextures(texData, numTextures, mStream, mModelName) == false)
+            {
+                return false;
+            }
         }
 
         // This file format has a concept of sub-meshes, which Falcor model doesn't have - Falcor creates a new mesh for each sub-mesh
@@ -650,6 +680,10 @@ namespace Falcor
         };
         std::map<TexSignature, Texture::SharedPtr> textures;
         bool loadTexAsSrgb = !is_set(flags, Model::LoadFlags::AssumeLinearSpaceTextures);
+        const bool optimizeMeshes = is_set(flags, Model::LoadFlags::OptimizeMeshes);
+        const bool generateMeshlets = is_set(flags, Model::LoadFlags::GenerateMeshlets);
+        const bool compressVertices = is_set(flags, Model::LoadFlags::CompressVertices);
+        MeshOptimizer::Report optimizerReport;
 
         // Load the meshes
         for(int meshIdx = 0; meshIdx < numMeshes; meshIdx++)
@@ -683,8 +717,11 @@ namespace Falcor
             struct BufferData
             {
                 std::vector<uint8_t> vec;
+                const uint8_t* pData = nullptr;     // Either vec.data() or a pointer into the mapped file
                 bool shouldSkip = false;
+                ResourceFormat format = ResourceFormat::Unknown;   // Format of the data, the layout holds the compressed format when compressing vertices
                 uint32_t elementSize = 0;
+                uint32_t fileOffset = 0;            // Offset of the attribute inside an interleaved vertex in the file
             };
 
             std::vector<BufferData> buffers;
@@ -696,6 +733,7 @@ namespace Falcor
             uint32_t normalBufferIndex = kInvalidBufferIndex;
             uint32_t bitangentBufferIndex = kInvalidBufferIndex;
             uint32_t texCoordBufferIndex = kInvalidBufferIndex;
+            uint32_t fileVertexStride = 0;
 
             for(int i = 0; i < numAttribs; i++)
             {
@@ -735,11 +773,14 @@ namespace Falcor
                         break;
                     }
 
+                    buffers[i].format = falcorFormat;
                     buffers[i].elementSize = getFormatBytesPerBlock(falcorFormat);
+                    buffers[i].fileOffset = fileVertexStride;
+                    fileVertexStride += buffers[i].elementSize;
                     if(shaderLocation != kUnusedShaderElement)
                     {
-                        pBufferLayout->addElement(falcorName, 0, falcorFormat, 1, shaderLocation);
-                        buffers[i].vec.resize(buffers[i].elementSize * numVertices);
+                        ResourceFormat layoutFormat = compressVertices ? VertexCompression::getCompressedFormat(shaderLocation, falcorFormat) : falcorFormat;
+                        pBufferLayout->addElement(falcorName, 0, layoutFormat, 1, shaderLocation);
                     }
                     else
                     {
@@ -768,52 +809,73 @@ namespace Falcor
                    
                     auto pBitangentLayout = VertexBufferLayout::create();
                     pLayout->addBufferLayout(bitangentBufferIndex, pBitangentLayout);
-                    pBitangentLayout->addElement(VERTEX_BITANGENT_NAME, 0, ResourceFormat::RGB32Float, 1, VERTEX_BITANGENT_LOC);
+                    ResourceFormat bitangentFormat = compressVertices ? VertexCompression::getCompressedFormat(VERTEX_BITANGENT_LOC, ResourceFormat::RGB32Float) : ResourceFormat::RGB32Float;
+                    pBitangentLayout->addElement(VERTEX_BITANGENT_NAME, 0, bitangentFormat, 1, VERTEX_BITANGENT_LOC);
+                    buffers[bitangentBufferIndex].format = ResourceFormat::RGB32Float;
+                    buffers[bitangentBufferIndex].elementSize = sizeof(glm::vec3);
                     buffers[bitangentBufferIndex].vec.resize(sizeof(glm::vec3) * numVertices);
+                    buffers[bitangentBufferIndex].pData = buffers[bitangentBufferIndex].vec.data();
                 }
             }
             
 
-            // Read the data, one vertex at a time
-            for(int32_t i = 0; i < numVertices; i++)
+            // The file stores the vertices interleaved, while Falcor uses a buffer per attribute. De-interleave straight from the mapped
+            // file. When a vertex only holds a single attribute, the file data already has the right layout and is used in place.
+            const uint8_t* pFileVertices = mStream.view((size_t)fileVertexStride * numVertices);
+            if(pFileVertices == nullptr)
             {
-                for (int32_t attributes = 0; attributes < numAttribs; ++attributes)
-                {
-                    if (buffers[attributes].shouldSkip)
-                    {
-                        mStream.skip(buffers[attributes].elementSize);
-                    }
-                    else
-                    {
-                        uint32_t stride = pLayout->getBufferLayout(attributes)->getStride();
-                        uint8_t* pDest = buffers[attributes].vec.data() + stride * i;
-                        mStream.read(pDest, stride);
-                    }
-                }
+                std::string msg = "Error when loading model " + mModelName + ".\nFile is truncated.";
+                logError(msg);
+                return false;
             }
 
-            Buffer::BindFlags vbBindFlags = Buffer::BindFlags::Vertex;
-            if (is_set(flags, Model::LoadFlags::BuffersAsShaderResource))
+            for (int32_t attributes = 0; attributes < numAttribs; ++attributes)
             {
-                vbBindFlags |= Buffer::BindFlags::ShaderResource;
-            }
+                BufferData& buffer = buffers[attributes];
+                if (buffer.shouldSkip)
+                {
+                    continue;
+                }
 
-            for (int32_t i = 0; i < numAttribs; ++i)
-            {
-                if(buffers[i].shouldSkip == false)
+                if (buffer.elementSize == fileVertexStride)
+                {
+                    buffer.pData = pFileVertices;
+                }
+                else
                 {
-                    pVBs[i] = Buffer::create(buffers[i].vec.size(), vbBindFlags, Buffer::CpuAccess::None, buffers[i].vec.data());
+                    buffer.vec.resize((size_t)buffer.elementSize * numVertices);
+                    const uint8_t* pSrc = pFileVertices + buffer.fileOffset;
+                    uint8_t* pDst = buffer.vec.data();
+                    for(int32_t i = 0; i < numVertices; i++)
+                    {
+                        std::memcpy(pDst, pSrc, buffer.elementSize);
+                        pDst += buffer.elementSize;
+                        pSrc += fileVertexStride;
+                    }
+                    buffer.pData = buffer.vec.data();
                 }
             }
 
             if(version <= 5)
             {
-                importTextures(texData, numTextures, mStream, mModelName);
+                if(importTextures(texData, numTextures, mStream, mModelName) == false)
+                {
+                    return false;
+                }
                 textures.clear();
             }
 
             // Array of Submesh.
-            // Falcor doesn't have a concept of submeshes, just create a new mesh for each submesh
+            // Falcor doesn't have a concept of submeshes, just create a new mesh for each submesh. The submeshes share the mesh's vertices, so read
+            // all of them before creating the vertex buffers, the optimizer needs all the index ranges.
+            struct SubmeshData
+            {
+                Material::SharedPtr pMaterial;
+                const uint32_t* pIndices = nullptr;     // Either a pointer into the mapped file or into optimizedIndices
+                uint32_t indexCount = 0;
+            };
+            std::vector<SubmeshData> submeshes(numSubmeshes);
+
             for(int submesh = 0; submesh < numSubmeshes; submesh++)
             {
                 // create the material
@@ -852,7 +914,7 @@ namespace Falcor
                         // Load the texture
                         TexSignature texSig;
                         texSig.format = getFormatFromMapType(loadTexAsSrgb, texData[texID].format, TextureType(i));
-                        texSig.pData = texData[texID].data.data();
+                        texSig.pData = texData[texID].pData;
                         // Check if we already created a matching texture
                         auto existingTex = textures.find(texSig);
                         if(existingTex != textures.end())
@@ -881,43 +943,173 @@ namespace Falcor
                     return false;
                 }
 
-                // create the index buffer
+                // The indices are used directly from the mapped file
                 uint32_t numIndices = numTriangles * 3;
-                std::vector<uint32_t> indices(numIndices);
-                uint32_t ibSize = 3 * numTriangles * sizeof(uint32_t);
-                mStream.read(&indices[0], ibSize);
+                const uint32_t* indices = (const uint32_t*)mStream.view(numIndices * sizeof(uint32_t));
+                if(indices == nullptr)
+                {
+                    std::string Msg = "Error when loading model " + mModelName + ".\nFile is truncated.";
+                    logError(Msg);
+                    return false;
+                }
+
+                submeshes[submesh].pMaterial = pMaterial;
+                submeshes[submesh].pIndices = indices;
+                submeshes[submesh].indexCount = numIndices;
+            }
+
+            // Optimize all the submeshes together, they share the vertices. The bitangents are generated afterwards, from the final vertices.
+            // Both the optimizer and the meshlets reorder the triangles, they work on a copy of the indices which may point into the mapped file.
+            const bool canReorder = numVertices > 0 && positionBufferIndex != kInvalidBufferIndex;
+            const bool optimize = optimizeMeshes && canReorder;
+            const bool buildMeshlets = generateMeshlets && canReorder;
+            std::vector<uint32_t> optimizedIndices;
+            std::vector<std::vector<MeshletData>> meshlets(numSubmeshes);
+            std::vector<MeshOptimizer::IndexRange> ranges(numSubmeshes);
+            if(optimize || buildMeshlets)
+            {
+                for(int submesh = 0; submesh < numSubmeshes; submesh++)
+                {
+                    ranges[submesh] = { (uint32_t)optimizedIndices.size(), submeshes[submesh].indexCount };
+                    optimizedIndices.insert(optimizedIndices.end(), submeshes[submesh].pIndices, submeshes[submesh].pIndices + submeshes[submesh].indexCount);
+                }
+                for(int submesh = 0; submesh < numSubmeshes; submesh++)
+                {
+                    submeshes[submesh].pIndices = optimizedIndices.data() + ranges[submesh].offset;
+                }
+            }
 
+            if(optimize)
+            {
+                std::vector<MeshOptimizer::VertexStream> streams;
+                uint32_t positionStream = 0;
+                for(int32_t i = 0; i < numAttribs; i++)
+                {
+                    BufferData& buffer = buffers[i];
+                    if(buffer.shouldSkip) continue;
+
+                    // The optimizer works in place, so the attributes used straight from the mapped file need a copy
+                    if(buffer.pData != buffer.vec.data())
+                    {
+                        buffer.vec.assign(buffer.pData, buffer.pData + (size_t)buffer.elementSize * numVertices);
+                    }
+                    if((uint32_t)i == positionBufferIndex) positionStream = (uint32_t)streams.size();
+                    streams.push_back({ &buffer.vec, buffer.elementSize });
+                }
+
+                uint32_t vertexCount = (uint32_t)numVertices;
+                if(buildMeshlets)
+                {
+                    MeshOptimizer::Report report;
+                    meshlets = MeshletBuilder::buildOptimized(streams, vertexCount, optimizedIndices, ranges, positionStream, report);
+                    optimizerReport += report;
+                }
+                else
+                {
+                    optimizerReport += MeshOptimizer::optimize(streams, vertexCount, optimizedIndices, ranges, positionStream);
+                }
+                numVertices = (int32_t)vertexCount;
+
+                for(int32_t i = 0; i < numAttribs; i++)
+                {
+                    buffers[i].pData = buffers[i].vec.data();
+                }
+                if(genTangentForMesh)
+                {
+                    buffers[bitangentBufferIndex].vec.assign(sizeof(glm::vec3) * numVertices, 0);
+                }
+            }
+            else if(buildMeshlets)
+            {
+                for(int submesh = 0; submesh < numSubmeshes; submesh++)
+                {
+                    meshlets[submesh] = MeshletBuilder::build(buffers[positionBufferIndex].pData, buffers[positionBufferIndex].elementSize, numVertices, optimizedIndices.data() + ranges[submesh].offset, ranges[submesh].count);
+                }
+            }
+
+            Buffer::BindFlags vbBindFlags = Buffer::BindFlags::Vertex;
+            if (is_set(flags, Model::LoadFlags::BuffersAsShaderResource))
+            {
+                vbBindFlags |= Buffer::BindFlags::ShaderResource;
+            }
+
+            // The full precision data stays around for the tangent generation and the bounding boxes, only the buffers hold the compressed data
+            bool quantizedPositions = false;
+            BoundingBox quantizationBox;
+            if(compressVertices && positionBufferIndex != kInvalidBufferIndex)
+            {
+                quantizationBox = VertexCompression::calcQuantizationBox(buffers[positionBufferIndex].pData, buffers[positionBufferIndex].format, numVertices);
+                quantizedPositions = true;
+            }
+
+            auto createVertexBuffer = [&](uint32_t bufferIndex, const uint8_t* pData, Buffer::BindFlags bindFlags)
+            {
+                const BufferData& buffer = buffers[bufferIndex];
+                ResourceFormat layoutFormat = pLayout->getBufferLayout(bufferIndex)->getElementFormat(0);
+                if(layoutFormat != buffer.format)
+                {
+                    const uint32_t location = pLayout->getBufferLayout(bufferIndex)->getElementShaderLocation(0);
+                    std::vector<uint8_t> compressed = VertexCompression::compressAttribute(location, buffer.format, pData, numVertices, quantizationBox);
+                    return Buffer::create(compressed.size(), bindFlags, Buffer::CpuAccess::None, compressed.data());
+                }
+                return Buffer::create((size_t)buffer.elementSize * numVertices, bindFlags, Buffer::CpuAccess::None, pData);
+            };
+
+            for (int32_t i = 0; i < numAttribs; ++i)
+            {
+                if(buffers[i].shouldSkip == false)
+                {
+                    pVBs[i] = createVertexBuffer(i, buffers[i].pData, vbBindFlags);
+                }
+            }
+
+            const ResourceFormat indexFormat = compressVertices ? VertexCompression::getIndexFormat(numVertices) : ResourceFormat::R32Uint;
+
+            for(int submesh = 0; submesh < numSubmeshes; submesh++)
+            {
+                const Material::SharedPtr& pMaterial = submeshes[submesh].pMaterial;
+                const uint32_t* indices = submeshes[submesh].pIndices;
+                uint32_t numIndices = submeshes[submesh].indexCount;
 
                 Buffer::BindFlags ibBindFlags = Buffer::BindFlags::Index;
                 if (is_set(flags, Model::LoadFlags::BuffersAsShaderResource))
                 {
                     ibBindFlags |= Buffer::BindFlags::ShaderResource;
                 }
-                auto pIB = Buffer::create(ibSize, ibBindFlags, Buffer::CpuAccess::None, indices.data());
+                Buffer::SharedPtr pIB;
+                if(indexFormat == ResourceFormat::R32Uint)
+                {
+                    pIB = Buffer::create(numIndices * sizeof(uint32_t), ibBindFlags, Buffer::CpuAccess::None, indices);
+                }
+                else
+                {
+                    std::vector<uint8_t> ibData = VertexCompression::convertIndices(indices, numIndices, indexFormat);
+                    pIB = Buffer::create(ibData.size(), ibBindFlags, Buffer::CpuAccess::None, ibData.data());
+                }
 
                 // Generate tangent space data if needed
                 if(genTangentForMesh)
                 {
                     uint32_t texCrdCount = 0;
-                    glm::vec2* texCrd = nullptr;
+                    const glm::vec2* texCrd = nullptr;
                     if(texCoordBufferIndex != kInvalidBufferIndex)
                     {
-                        texCrdCount = pLayout->getBufferLayout(texCoordBufferIndex)->getStride() / sizeof(glm::vec2);
-                        texCrd = (glm::vec2*)buffers[texCoordBufferIndex].vec.data();
+                        texCrdCount = buffers[texCoordBufferIndex].elementSize / sizeof(glm::vec2);
+                        texCrd = (const glm::vec2*)buffers[texCoordBufferIndex].pData;
                     }
 
-                    ResourceFormat posFormat = pLayout->getBufferLayout(positionBufferIndex)->getElementFormat(0);
+                    ResourceFormat posFormat = buffers[positionBufferIndex].format;
 
                     if (posFormat == ResourceFormat::RGB32Float)
                     {
-                        generateSubmeshTangentData<glm::vec3>(indices, numVertices, (glm::vec3*)buffers[positionBufferIndex].vec.data(), (glm::vec3*)buffers[normalBufferIndex].vec.data(), texCrd, texCrdCount, (glm::vec3*)buffers[bitangentBufferIndex].vec.data());
+                        generateSubmeshTangentData<glm::vec3>(indices, numIndices, numVertices, (const glm::vec3*)buffers[positionBufferIndex].pData, (const glm::vec3*)buffers[normalBufferIndex].pData, texCrd, texCrdCount, (glm::vec3*)buffers[bitangentBufferIndex].vec.data());
                     }
                     else if (posFormat == ResourceFormat::RGBA32Float)
                     {
-                        generateSubmeshTangentData<glm::vec4>(indices, numVertices, (glm::vec4*)buffers[positionBufferIndex].vec.data(), (glm::vec3*)buffers[normalBufferIndex].vec.data(), texCrd, texCrdCount, (glm::vec3*)buffers[bitangentBufferIndex].vec.data());
+                        generateSubmeshTangentData<glm::vec4>(indices, numIndices, numVertices, (const glm::vec4*)buffers[positionBufferIndex].pData, (const glm::vec3*)buffers[normalBufferIndex].pData, texCrd, texCrdCount, (glm::vec3*)buffers[bitangentBufferIndex].vec.data());
                     }
 
-                    pVBs[bitangentBufferIndex] = Buffer::create(buffers[bitangentBufferIndex].vec.size(), Buffer::BindFlags::Vertex, Buffer::CpuAccess::None, buffers[bitangentBufferIndex].vec.data());
+                    pVBs[bitangentBufferIndex] = createVertexBuffer(bitangentBufferIndex, buffers[bitangentBufferIndex].vec.data(), Buffer::BindFlags::Vertex);
                 }
                 
 
@@ -926,9 +1118,9 @@ namespace Falcor
                 for(uint32_t i = 0; i < numIndices; i++)
                 {
                     uint32_t vertexID = indices[i];
-                    uint8_t* pVertex = (pLayout->getBufferLayout(positionBufferIndex)->getStride() * vertexID) + buffers[positionBufferIndex].vec.data();
+                    const uint8_t* pVertex = (buffers[positionBufferIndex].elementSize * vertexID) + buffers[positionBufferIndex].pData;
 
-                    float* pPosition = (float*)pVertex;
+                    const float* pPosition = (const float*)pVertex;
 
                     glm::vec3 xyz(pPosition[0], pPosition[1], pPosition[2]);
                     min = glm::min(min, xyz);
@@ -938,7 +1130,12 @@ namespace Falcor
                 BoundingBox box = BoundingBox::fromMinMax(min, max);
 
                 // create the mesh
-                auto pMesh = Mesh::create(pVBs, numVertices, pIB, numIndices, pLayout, Vao::Topology::TriangleList, pMaterial, box, false);
+                auto pMesh = Mesh::create(pVBs, numVertices, pIB, numIndices, pLayout, Vao::Topology::TriangleList, pMaterial, box, false, indexFormat);
+                if(quantizedPositions)
+                {
+                    pMesh->setPositionQuantizationBox(quantizationBox);
+                }
+                pMesh->setMeshlets(std::move(meshlets[submesh]));
 
                 if (version >= 6)
                 {
@@ -962,8 +1159,18 @@ namespace Falcor
 
                 mStream >> meshIdx >> enabled >> transformation;
                 //m_Stream >> inst.name >> inst.metadata;
-                readString(mStream);   // Name
-                readString(mStream);   // Meta-data
+                std::string name, metaData;
+                if(readString(mStream, mModelName, name) == false || readString(mStream, mModelName, metaData) == false)
+                {
+                    return false;
+                }
+
+                if(meshIdx < 0 || meshIdx >= numMeshes)
+                {
+                    std::string msg = "Error when loading model " + mModelName + ".\nInstance mesh index is out of range.";
+                    logError(msg);
+                    return false;
+                }
 
                 if(enabled)
                 {
@@ -974,6 +1181,11 @@ namespace Falcor
                 }
             }
         }
+
+        if(optimizeMeshes)
+        {
+            logInfo("BinaryModelImporter: Optimized meshes of '" + mModelName + "': " + to_string(optimizerReport));
+        }
         
         return true;
     }
@@ -29,6 +29,7 @@
 #include "SimpleModelImporter.h"
 #include "../Model.h"
 #include "../Mesh.h"
+#include "../Meshlets.h"
 #include "Utils/Platform/OS.h"
 #include "API/VertexLayout.h"
 #include "Data/VertexAttrib.h"
@@ -41,7 +42,7 @@ namespace Falcor
 
     Model::SharedPtr SimpleModelImporter::create( VertexFormat vertLayout, uint32_t vboSz, const void *vboData,
                                                   uint32_t idxBufSz, const uint32_t *idxBufData, Texture::SharedPtr diffuseTexture,
-                                                  Vao::Topology geomTopology )
+                                                  Vao::Topology geomTopology, Model::LoadFlags flags )
     {
         // Since SimpleModelImporter is all static, create an instance here to help track materials
         SimpleModelImporter modelImporter;
@@ -53,6 +54,7 @@ namespace Falcor
         VertexBufferLayout::SharedPtr pVertexLayout = VertexBufferLayout::create();
         uint32_t vertexStride = 0;
         uint32_t positionOffset = 0;
+        bool hasFloatPositions = false;
         for ( int i = 0; i < vertLayout.attribs.size(); i++ )
         {
             // Convert the vertex attrib structure into what we need internally in this loop
@@ -65,7 +67,10 @@ namespace Falcor
             // If this is a "position" attribute, remember the offset, since we'll use this later to
             //    compute a bounding box for the entire mesh
             if ( vertLayout.attribs[i].attribType == AttribType::Position )
+            {
                 positionOffset = vertexStride;
+                hasFloatPositions = ( format == AttribFormat::AttribFormat_F32 && length >= 3 );
+            }
 
             // Do some conversions to the format we need data in to set a Falcor vertex attribute entry
             ResourceFormat falcorFormat = getResourceFormat( format, length );
@@ -84,13 +89,23 @@ namespace Falcor
         pLayout->addBufferLayout(0, pVertexLayout);
         Buffer::SharedPtr pBuffer = Buffer::create( vboSz, Buffer::BindFlags::Vertex, Buffer::CpuAccess::None, vboData );
 
-        // Create index buffer and add to the model
-        Buffer::SharedPtr pIB = Buffer::create( idxBufSz, Buffer::BindFlags::Index, Buffer::CpuAccess::None, idxBufData );
-
         // Compute more explicit / traditional counts needed internally
         uint32_t numVertices = vboSz / vertexStride;
         uint32_t numIndicies = idxBufSz / (sizeof( uint32_t ));
 
+        // Split triangle lists into meshlets. This reorders the triangles, so work on a copy of the caller's indices.
+        std::vector<MeshletData> meshlets;
+        std::vector<uint32_t> meshletIndices;
+        if ( is_set( flags, Model::LoadFlags::GenerateMeshlets ) && geomTopology == Vao::Topology::TriangleList && hasFloatPositions )
+        {
+            meshletIndices.assign( idxBufData, idxBufData + numIndicies );
+            meshlets = MeshletBuilder::build( ((const uint8_t*) vboData) + positionOffset, vertexStride, numVertices, meshletIndices.data(), numIndicies );
+            idxBufData = meshletIndices.data();
+        }
+
+        // Create index buffer and add to the model
+        Buffer::SharedPtr pIB = Buffer::create( idxBufSz, Buffer::BindFlags::Index, Buffer::CpuAccess::None, idxBufData );
+
         // Create a really simple, dumb material for this mesh
         Material::SharedPtr pMaterial = Material::create("");
         if ( diffuseTexture )
@@ -117,6 +132,7 @@ namespace Falcor
 
         // create a mesh containing this index & vertex data.
         Mesh::SharedPtr pMesh = Mesh::create({ pBuffer }, numVertices, pIB, numIndicies, pLayout, geomTopology, pMaterial, box, false);
+        pMesh->setMeshlets( std::move( meshlets ) );
         pModel->addMeshInstance(pMesh, glm::mat4()); // Add this mesh to the model
 
         // Do internal computations on model properties
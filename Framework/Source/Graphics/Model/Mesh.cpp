@@ -48,9 +48,10 @@ namespace Falcor
         Vao::Topology topology,
         const Material::SharedPtr& pMaterial,
         const BoundingBox& boundingBox,
-        bool hasBones)
+        bool hasBones,
+        ResourceFormat indexFormat)
     {
-        return SharedPtr(new Mesh(vertexBuffers, vertexCount, pIndexBuffer, indexCount, pLayout, topology, pMaterial, boundingBox, hasBones));
+        return SharedPtr(new Mesh(vertexBuffers, vertexCount, pIndexBuffer, indexCount, pLayout, topology, pMaterial, boundingBox, hasBones, indexFormat));
     }
 
     Mesh::Mesh(const Vao::BufferVec& vertexBuffers,
@@ -61,7 +62,8 @@ namespace Falcor
         Vao::Topology topology,
         const Material::SharedPtr& pMaterial,
         const BoundingBox& boundingBox,
-        bool hasBones) 
+        bool hasBones,
+        ResourceFormat indexFormat)
         : mId(sMeshCounter++)
         , mIndexCount(indexCount)
         , mVertexCount(vertexCount)
@@ -87,7 +89,17 @@ namespace Falcor
 
         mPrimitiveCount = mIndexCount / VertsPerPrim;
 
-        mpVao = Vao::create(topology, pLayout, vertexBuffers, pIndexBuffer, ResourceFormat::R32Uint);
+        mpVao = Vao::create(topology, pLayout, vertexBuffers, pIndexBuffer, indexFormat);
+    }
+
+    void Mesh::setMeshlets(std::vector<MeshletData> meshlets)
+    {
+        mMeshlets = std::move(meshlets);
+        mpMeshletBuffer = nullptr;
+        if (mMeshlets.size())
+        {
+            mpMeshletBuffer = Buffer::create(uint32_t(mMeshlets.size() * sizeof(MeshletData)), Buffer::BindFlags::ShaderResource, Buffer::CpuAccess::None, mMeshlets.data());
+        }
     }
 
     void Mesh::resetGlobalIdCounter()
@@ -35,6 +35,7 @@
 #include "Utils/AABB.h"
 #include "Graphics/Material/Material.h"
 #include "Graphics/Paths/MovableObject.h"
+#include "Data/HostDeviceData.h"
 
 namespace Falcor
 {
@@ -47,6 +48,7 @@ namespace Falcor
     class AssimpModelImporter;
     class BinaryModelImporter;
     class SimpleModelImporter;
+    class BakedScene;
 
     /** Class representing a single mesh
     */
@@ -65,6 +67,7 @@ namespace Falcor
             \param[in] pMaterial The material of the mesh
             \param[in] BoundingBox The mesh's axis-aligned bounding-box
             \param[in] bHasBones Indicates the the mesh uses bones for animation
+            \param[in] indexFormat The format of the index buffer, R32Uint or R16Uint
         */
         static SharedPtr create(const Vao::BufferVec& vertexBuffers,
             uint32_t vertexCount,
@@ -74,7 +77,8 @@ namespace Falcor
             Vao::Topology topology,
             const Material::SharedPtr& pMaterial,
             const BoundingBox& boundingBox,
-            bool hasBones);
+            bool hasBones,
+            ResourceFormat indexFormat = ResourceFormat::R32Uint);
 
         /** Destructor
         */
@@ -104,6 +108,22 @@ namespace Falcor
         */
         bool hasBones() const { return mHasBones; }
 
+        /** Are the positions quantized to a box? See Model::LoadFlags::CompressVertices.
+        */
+        bool hasQuantizedPositions() const { return mHasQuantizedPositions; }
+
+        /** Get the box the positions are quantized to. A position in the vertex buffer is relative to the box's min corner, in units of the box size.
+        */
+        const BoundingBox& getPositionQuantizationBox() const { return mPositionQuantizationBox; }
+
+        /** Get the mesh's meshlets. Empty if the mesh isn't an indexed triangle list. See MeshletBuilder.
+        */
+        const std::vector<MeshletData>& getMeshlets() const { return mMeshlets; }
+
+        /** Get a buffer containing the meshlets, for culling on the GPU. Null if the mesh doesn't have meshlets.
+        */
+        const Buffer::SharedPtr& getMeshletBuffer() const { return mpMeshletBuffer; }
+
         /** Set the mesh's material. Can be used to override the material loaded with the model.
         */
         void setMaterial(const Material::SharedPtr& pMaterial) { mpMaterial = pMaterial; }
@@ -129,6 +149,10 @@ namespace Falcor
         friend AssimpModelImporter;
         friend BinaryModelImporter;
         friend SimpleModelImporter;
+        friend BakedScene;
+
+        void setPositionQuantizationBox(const BoundingBox& box) { mPositionQuantizationBox = box; mHasQuantizedPositions = true; }
+        void setMeshlets(std::vector<MeshletData> meshlets);
 
     private:
         Mesh(const Vao::BufferVec& vertexBuffers,
@@ -139,7 +163,8 @@ namespace Falcor
             Vao::Topology topology,
             const Material::SharedPtr& pMaterial,
             const BoundingBox& boundingBox,
-            bool hasBones);
+            bool hasBones,
+            ResourceFormat indexFormat);
 
         static uint32_t sMeshCounter;
 
@@ -149,6 +174,10 @@ namespace Falcor
         uint32_t mVertexCount = 0;
         uint32_t mPrimitiveCount = 0;
         bool mHasBones = false;
+        bool mHasQuantizedPositions = false;
+        BoundingBox mPositionQuantizationBox;
+        std::vector<MeshletData> mMeshlets;
+        Buffer::SharedPtr mpMeshletBuffer;
         Material::SharedPtr mpMaterial;
         BoundingBox mBoundingBox;
         Vao::SharedPtr mpVao;
@@ -0,0 +1,490 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "MeshOptimizer.h"
+#include "Utils/CpuTimer.h"
+#include "glm/vec3.hpp"
+#include "glm/geometric.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace Falcor
+{
+    namespace
+    {
+        const uint32_t kInvalidIndex = uint32_t(-1);
+
+        // Forsyth's vertex cache optimization parameters, from "Linear-Speed Vertex Cache Optimisation"
+        const uint32_t kForsythCacheSize = 32;
+        const uint32_t kMaxValenceTableSize = 32;
+        const float kCacheDecayPower = 1.5f;
+        const float kLastTriScore = 0.75f;
+        const float kValenceBoostScale = 2.0f;
+        const float kValenceBoostPower = 0.5f;
+
+        struct ScoreTables
+        {
+            float cache[kForsythCacheSize];
+            float valence[kMaxValenceTableSize];
+
+            ScoreTables()
+            {
+                for (uint32_t i = 0; i < kForsythCacheSize; i++)
+                {
+                    // The vertices of the last triangle get a fixed score so that the next triangle isn't chosen to be adjacent to the same edge
+                    cache[i] = (i < 3) ? kLastTriScore : std::pow(1.0f - float(i - 3) / float(kForsythCacheSize - 3), kCacheDecayPower);
+                }
+                for (uint32_t i = 0; i < kMaxValenceTableSize; i++)
+                {
+                    valence[i] = (i == 0) ? 0.0f : kValenceBoostScale * std::pow(float(i), -kValenceBoostPower);
+                }
+            }
+
+            float getVertexScore(int32_t cachePos, uint32_t remainingTriangles) const
+            {
+                // A vertex without remaining triangles doesn't contribute to anything
+                if (remainingTriangles == 0) return -1.0f;
+
+                float score = (cachePos >= 0) ? cache[cachePos] : 0.0f;
+                score += (remainingTriangles < kMaxValenceTableSize) ? valence[remainingTriangles] : kValenceBoostScale * std::pow(float(remainingTriangles), -kValenceBoostPower);
+                return score;
+            }
+        };
+
+        glm::vec3 loadPosition(const uint8_t* pPositions, uint32_t stride, uint32_t index)
+        {
+            glm::vec3 p;
+            std::memcpy(&p, pPositions + size_t(index) * stride, sizeof(p));
+            return p;
+        }
+
+        /** Move the vertices to their new location. remap[] holds the new index of each vertex, or kInvalidIndex to drop it.
+        */
+        void remapVertexStreams(std::vector<MeshOptimizer::VertexStream>& streams, uint32_t vertexCount, const std::vector<uint32_t>& remap, uint32_t newVertexCount)
+        {
+            for (auto& stream : streams)
+            {
+                std::vector<uint8_t> data(size_t(newVertexCount) * stream.stride);
+                for (uint32_t v = 0; v < vertexCount; v++)
+                {
+                    if (remap[v] != kInvalidIndex)
+                    {
+                        std::memcpy(data.data() + size_t(remap[v]) * stream.stride, stream.pData->data() + size_t(v) * stream.stride, stream.stride);
+                    }
+                }
+                stream.pData->swap(data);
+            }
+        }
+    }
+
+    MeshOptimizer::Stats MeshOptimizer::analyzeVertexCache(const uint32_t* pIndices, size_t indexCount, uint32_t vertexCount, uint32_t cacheSize)
+    {
+        Stats stats;
+        stats.triangleCount = indexCount / 3;
+
+        // A vertex is in the FIFO if less than cacheSize misses happened since it was inserted
+        std::vector<uint32_t> timestamps(vertexCount, 0);
+        std::vector<bool> referenced(vertexCount, false);
+        uint32_t timestamp = cacheSize + 1;
+
+        for (size_t i = 0; i < stats.triangleCount * 3; i++)
+        {
+            uint32_t v = pIndices[i];
+            assert(v < vertexCount);
+            if (timestamp - timestamps[v] > cacheSize)
+            {
+                timestamps[v] = timestamp++;
+                stats.transformedVertexCount++;
+            }
+            if (referenced[v] == false)
+            {
+                referenced[v] = true;
+                stats.vertexCount++;
+            }
+        }
+        return stats;
+    }
+
+    uint32_t MeshOptimizer::weldVertices(std::vector<VertexStream>& streams, uint32_t vertexCount, std::vector<uint32_t>& indices)
+    {
+        if (vertexCount == 0) return 0;
+
+        auto hashVertex = [&streams](uint32_t v)
+        {
+            // FNV-1a over the bytes of the vertex in all streams
+            uint64_t hash = 14695981039346656037ull;
+            for (const auto& stream : streams)
+            {
+                const uint8_t* pVertex = stream.pData->data() + size_t(v) * stream.stride;
+                for (uint32_t b = 0; b < stream.stride; b++)
+                {
+                    hash ^= pVertex[b];
+                    hash *= 1099511628211ull;
+                }
+            }
+            return hash;
+        };
+
+        auto isEqual = [&streams](uint32_t a, uint32_t b)
+        {
+            for (const auto& stream : streams)
+            {
+                const uint8_t* pData = stream.pData->data();
+                if (std::memcmp(pData + size_t(a) * stream.stride, pData + size_t(b) * stream.stride, stream.stride) != 0) return false;
+            }
+            return true;
+        };
+
+        // Open addressing hash table, at most half full
+        size_t tableSize = 1;
+        while (tableSize < size_t(vertexCount) * 2) tableSize *= 2;
+        const size_t mask = tableSize - 1;
+        std::vector<uint32_t> table(tableSize, kInvalidIndex);
+
+        // Map each vertex to the new index of the first vertex identical to it
+        std::vector<uint32_t> remap(vertexCount, kInvalidIndex);
+        uint32_t newVertexCount = 0;
+        std::vector<uint32_t> newIndex(vertexCount);
+
+        for (uint32_t v = 0; v < vertexCount; v++)
+        {
+            size_t slot = size_t(hashVertex(v)) & mask;
+            while (table[slot] != kInvalidIndex && isEqual(table[slot], v) == false)
+            {
+                slot = (slot + 1) & mask;
+            }
+
+            if (table[slot] == kInvalidIndex)
+            {
+                table[slot] = v;
+                remap[v] = newVertexCount++;
+            }
+            newIndex[v] = remap[table[slot]];
+        }
+
+        if (newVertexCount == vertexCount) return vertexCount;
+
+        remapVertexStreams(streams, vertexCount, remap, newVertexCount);
+        for (auto& i : indices)
+        {
+            i = newIndex[i];
+        }
+        return newVertexCount;
+    }
+
+    void MeshOptimizer::optimizeVertexCache(uint32_t* pIndices, size_t indexCount, uint32_t vertexCount)
+    {
+        const size_t triangleCount = indexCount / 3;
+        if (triangleCount == 0) return;
+
+        static const ScoreTables kScores;
+
+        // Per-vertex list of the triangles which were not emitted yet
+        std::vector<uint32_t> remainingTriangles(vertexCount, 0);
+        for (size_t i = 0; i < triangleCount * 3; i++)
+        {
+            remainingTriangles[pIndices[i]]++;
+        }
+
+        std::vector<uint32_t> adjacencyOffsets(vertexCount);
+        uint32_t offset = 0;
+        for (uint32_t v = 0; v < vertexCount; v++)
+        {
+            adjacencyOffsets[v] = offset;
+            offset += remainingTriangles[v];
+        }
+
+        std::vector<uint32_t> adjacency(triangleCount * 3);
+        {
+            std::vector<uint32_t> fill(adjacencyOffsets);
+            for (size_t i = 0; i < triangleCount * 3; i++)
+            {
+                adjacency[fill[pIndices[i]]++] = uint32_t(i / 3);
+            }
+        }
+
+        std::vector<int32_t> cachePosition(vertexCount, -1);
+        std::vector<float> vertexScore(vertexCount);
+        for (uint32_t v = 0; v < vertexCount; v++)
+        {
+            vertexScore[v] = kScores.getVertexScore(-1, remainingTriangles[v]);
+        }
+
+        std::vector<float> triangleScore(triangleCount);
+        std::vector<bool> emitted(triangleCount, false);
+        uint32_t bestTriangle = 0;
+        for (size_t t = 0; t < triangleCount; t++)
+        {
+            const uint32_t* pTri = pIndices + t * 3;
+            triangleScore[t] = vertexScore[pTri[0]] + vertexScore[pTri[1]] + vertexScore[pTri[2]];
+            if (triangleScore[t] > triangleScore[bestTriangle]) bestTriangle = uint32_t(t);
+        }
+
+        std::vector<uint32_t> output(triangleCount * 3);
+        std::vector<uint32_t> cache;
+        std::vector<uint32_t> newCache;
+        cache.reserve(kForsythCacheSize + 3);
+        newCache.reserve(kForsythCacheSize + 3);
+        size_t cursor = 0;
+
+        for (size_t outTriangle = 0; outTriangle < triangleCount; outTriangle++)
+        {
+            if (bestTriangle == kInvalidIndex)
+            {
+                // Nothing in the cache is connected to a remaining triangle. Continue with the next triangle in the input order.
+                while (emitted[cursor]) cursor++;
+                bestTriangle = uint32_t(cursor);
+            }
+
+            const uint32_t tri[3] = { pIndices[bestTriangle * 3], pIndices[bestTriangle * 3 + 1], pIndices[bestTriangle * 3 + 2] };
+            std::memcpy(&output[outTriangle * 3], tri, sizeof(tri));
+            emitted[bestTriangle] = true;
+
+            // Remove the triangle from the adjacency lists of its vertices
+            for (uint32_t v : tri)
+            {
+                uint32_t* pList = adjacency.data() + adjacencyOffsets[v];
+                uint32_t& count = remainingTriangles[v];
+                for (uint32_t i = 0; i < count; i++)
+                {
+                    if (pList[i] == bestTriangle)
+                    {
+                        pList[i] = pList[count - 1];
+                        count--;
+                        break;
+                    }
+                }
+            }
+
+            // Move the triangle's vertices to the front of the LRU cache
+            newCache.clear();
+            for (uint32_t v : tri)
+            {
+                if (std::find(newCache.begin(), newCache.end(), v) == newCache.end()) newCache.push_back(v);
+            }
+            for (uint32_t v : cache)
+            {
+                if (v != tri[0] && v != tri[1] && v != tri[2]) newCache.push_back(v);
+            }
+
+            // Update the scores of the vertices in the cache and of the ones which were evicted, and propagate the change to their triangles
+            for (size_t i = 0; i < newCache.size(); i++)
+            {
+                uint32_t v = newCache[i];
+                cachePosition[v] = (i < kForsythCacheSize) ? int32_t(i) : -1;
+                float score = kScores.getVertexScore(cachePosition[v], remainingTriangles[v]);
+                float delta = score - vertexScore[v];
+                vertexScore[v] = score;
+
+                const uint32_t* pList = adjacency.data() + adjacencyOffsets[v];
+                for (uint32_t j = 0; j < remainingTriangles[v]; j++)
+                {
+                    triangleScore[pList[j]] += delta;
+                }
+            }
+
+            if (newCache.size() > kForsythCacheSize) newCache.resize(kForsythCacheSize);
+            cache.swap(newCache);
+
+            // The next triangle is the best one connected to the cache
+            bestTriangle = kInvalidIndex;
+            float bestScore = -1.0f;
+            for (uint32_t v : cache)
+            {
+                const uint32_t* pList = adjacency.data() + adjacencyOffsets[v];
+                for (uint32_t j = 0; j < remainingTriangles[v]; j++)
+                {
+                    uint32_t t = pList[j];
+                    if (triangleScore[t] > bestScore)
+                    {
+                        bestScore = triangleScore[t];
+                        bestTriangle = t;
+                    }
+                }
+            }
+        }
+
+        std::memcpy(pIndices, output.data(), output.size() * sizeof(uint32_t));
+    }
+
+    void MeshOptimizer::optimizeOverdraw(uint32_t* pIndices, size_t indexCount, const uint8_t* pPositions, uint32_t positionStride, uint32_t vertexCount, float threshold)
+    {
+        const size_t triangleCount = indexCount / 3;
+        if (triangleCount < 2) return;
+
+        const Stats original = analyzeVertexCache(pIndices, triangleCount * 3, vertexCount);
+        const float targetAcmr = original.getAcmr() * threshold;
+
+        // Split the triangles into clusters. A hard boundary is a triangle which misses the cache on all its vertices, reordering there is free.
+        // Inside a hard cluster we also split as soon as the cluster reached the target ACMR, which gives more freedom to the sort.
+        std::vector<uint32_t> clusterStart;
+        {
+            std::vector<uint32_t> timestamps(vertexCount, 0);
+            uint32_t timestamp = kDefaultCacheSize + 1;
+            uint32_t clusterMisses = 0;
+            uint32_t clusterTriangles = 0;
+
+            for (size_t t = 0; t < triangleCount; t++)
+            {
+                uint32_t misses = 0;
+                for (uint32_t i = 0; i < 3; i++)
+                {
+                    uint32_t v = pIndices[t * 3 + i];
+                    if (timestamp - timestamps[v] > kDefaultCacheSize)
+                    {
+                        timestamps[v] = timestamp++;
+                        misses++;
+                    }
+                }
+
+                bool softBoundary = clusterTriangles > 0 && float(clusterMisses) / float(clusterTriangles) <= targetAcmr;
+                if (t == 0 || misses == 3 || softBoundary)
+                {
+                    clusterStart.push_back(uint32_t(t));
+                    clusterMisses = 0;
+                    clusterTriangles = 0;
+                }
+                clusterMisses += misses;
+                clusterTriangles++;
+            }
+        }
+        if (clusterStart.size() < 2) return;
+        clusterStart.push_back(uint32_t(triangleCount));
+        const size_t clusterCount = clusterStart.size() - 1;
+
+        // Area weighted centroid and normal of each cluster
+        std::vector<glm::vec3> clusterCentroid(clusterCount, glm::vec3(0));
+        std::vector<glm::vec3> clusterNormal(clusterCount, glm::vec3(0));
+        glm::vec3 meshCentroid(0);
+        float meshArea = 0;
+
+        for (size_t c = 0; c < clusterCount; c++)
+        {
+            float clusterArea = 0;
+            for (uint32_t t = clusterStart[c]; t < clusterStart[c + 1]; t++)
+            {
+                glm::vec3 p0 = loadPosition(pPositions, positionStride, pIndices[t * 3]);
+                glm::vec3 p1 = loadPosition(pPositions, positionStride, pIndices[t * 3 + 1]);
+                glm::vec3 p2 = loadPosition(pPositions, positionStride, pIndices[t * 3 + 2]);
+
+                glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+                float area = glm::length(n);
+                glm::vec3 centroid = (p0 + p1 + p2) / 3.0f;
+
+                clusterCentroid[c] += centroid * area;
+                clusterNormal[c] += n;
+                clusterArea += area;
+            }
+
+            meshCentroid += clusterCentroid[c];
+            meshArea += clusterArea;
+            if (clusterArea > 0) clusterCentroid[c] /= clusterArea;
+        }
+        if (meshArea > 0) meshCentroid /= meshArea;
+
+        // Draw the clusters which face away from the center first. They are the most likely to occlude the rest of the mesh.
+        std::vector<float> sortKey(clusterCount);
+        for (size_t c = 0; c < clusterCount; c++)
+        {
+            float normalLength = glm::length(clusterNormal[c]);
+            sortKey[c] = (normalLength > 0) ? glm::dot(clusterCentroid[c] - meshCentroid, clusterNormal[c] / normalLength) : 0.0f;
+        }
+
+        std::vector<uint32_t> order(clusterCount);
+        for (uint32_t c = 0; c < clusterCount; c++) order[c] = c;
+        std::stable_sort(order.begin(), order.end(), [&sortKey](uint32_t a, uint32_t b) { return sortKey[a] > sortKey[b]; });
+
+        std::vector<uint32_t> output;
+        output.reserve(triangleCount * 3);
+        for (uint32_t c : order)
+        {
+            output.insert(output.end(), pIndices + clusterStart[c] * 3, pIndices + clusterStart[c + 1] * 3);
+        }
+
+        // Keep the input order if the cache efficiency regressed too much
+        const Stats sorted = analyzeVertexCache(output.data(), output.size(), vertexCount);
+        if (sorted.getAcmr() <= targetAcmr)
+        {
+            std::memcpy(pIndices, output.data(), output.size() * sizeof(uint32_t));
+        }
+    }
+
+    uint32_t MeshOptimizer::optimizeVertexFetch(std::vector<VertexStream>& streams, uint32_t vertexCount, std::vector<uint32_t>& indices)
+    {
+        std::vector<uint32_t> remap(vertexCount, kInvalidIndex);
+        uint32_t newVertexCount = 0;
+        for (auto& i : indices)
+        {
+            if (remap[i] == kInvalidIndex) remap[i] = newVertexCount++;
+            i = remap[i];
+        }
+
+        remapVertexStreams(streams, vertexCount, remap, newVertexCount);
+        return newVertexCount;
+    }
+
+    MeshOptimizer::Report MeshOptimizer::optimize(std::vector<VertexStream>& streams, uint32_t& vertexCount, std::vector<uint32_t>& indices, const std::vector<IndexRange>& ranges, uint32_t positionStream)
+    {
+        const CpuTimer::TimePoint startTime = CpuTimer::getCurrentTimePoint();
+        assert(positionStream < streams.size());
+
+        std::vector<IndexRange> drawRanges = ranges;
+        if (drawRanges.empty())
+        {
+            drawRanges.push_back({ 0, uint32_t(indices.size()) });
+        }
+
+        Report report;
+        report.vertexBufferSizeBefore = vertexCount;
+        for (const auto& r : drawRanges)
+        {
+            report.before += analyzeVertexCache(indices.data() + r.offset, r.count, vertexCount);
+        }
+
+        vertexCount = weldVertices(streams, vertexCount, indices);
+
+        const VertexStream& positions = streams[positionStream];
+        for (const auto& r : drawRanges)
+        {
+            optimizeVertexCache(indices.data() + r.offset, r.count, vertexCount);
+            optimizeOverdraw(indices.data() + r.offset, r.count, positions.pData->data(), positions.stride, vertexCount);
+        }
+
+        vertexCount = optimizeVertexFetch(streams, vertexCount, indices);
+
+        for (const auto& r : drawRanges)
+        {
+            report.after += analyzeVertexCache(indices.data() + r.offset, r.count, vertexCount);
+        }
+
+        report.vertexBufferSizeAfter = vertexCount;
+        report.timeInMs = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+        return report;
+    }
+}
@@ -0,0 +1,154 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <vector>
+#include <string>
+
+namespace Falcor
+{
+    /** CPU mesh optimizations applied when importing models with Model::LoadFlags::OptimizeMeshes.
+        All functions work on triangle lists with 32-bit indices. Vertex data is passed as a list of tightly packed streams, one per vertex buffer.
+        A mesh can be made of several index ranges (sub-meshes) sharing the same vertices. Triangles are only reordered inside their range.
+    */
+    class MeshOptimizer
+    {
+    public:
+        /** A tightly packed vertex stream
+        */
+        struct VertexStream
+        {
+            std::vector<uint8_t>* pData = nullptr;  ///< Vertex data. Resized when the vertex count changes.
+            uint32_t stride = 0;                    ///< Size of a vertex in bytes
+        };
+
+        /** A range of the index buffer which is drawn on its own
+        */
+        struct IndexRange
+        {
+            uint32_t offset = 0;
+            uint32_t count = 0;
+        };
+
+        /** Post-transform vertex cache statistics, simulated with a FIFO cache
+        */
+        struct Stats
+        {
+            uint64_t triangleCount = 0;
+            uint64_t vertexCount = 0;               ///< Number of distinct vertices referenced
+            uint64_t transformedVertexCount = 0;    ///< Number of cache misses
+
+            /** Average cache miss ratio, transformed vertices per triangle. 0.5 is the lower bound for a regular grid, 3 is the worst case.
+            */
+            float getAcmr() const { return triangleCount ? float(transformedVertexCount) / float(triangleCount) : 0.0f; }
+
+            /** Average transformed vertex ratio, transformed vertices per vertex. 1 is optimal.
+            */
+            float getAtvr() const { return vertexCount ? float(transformedVertexCount) / float(vertexCount) : 0.0f; }
+
+            Stats& operator+=(const Stats& other)
+            {
+                triangleCount += other.triangleCount;
+                vertexCount += other.vertexCount;
+                transformedVertexCount += other.transformedVertexCount;
+                return *this;
+            }
+        };
+
+        /** Statistics before and after optimizing
+        */
+        struct Report
+        {
+            Stats before;
+            Stats after;
+            uint64_t vertexBufferSizeBefore = 0;    ///< Number of vertices in the streams before optimizing
+            uint64_t vertexBufferSizeAfter = 0;     ///< Number of vertices in the streams after optimizing
+            float timeInMs = 0;
+
+            Report& operator+=(const Report& other)
+            {
+                before += other.before;
+                after += other.after;
+                vertexBufferSizeBefore += other.vertexBufferSizeBefore;
+                vertexBufferSizeAfter += other.vertexBufferSizeAfter;
+                timeInMs += other.timeInMs;
+                return *this;
+            }
+        };
+
+        /** Size of the simulated post-transform cache used for statistics. Matches the effective size on most current GPUs.
+        */
+        static const uint32_t kDefaultCacheSize = 16;
+
+        /** Run all the optimizations: weld duplicate vertices, reorder triangles for vertex cache reuse, then for overdraw, and finally reorder vertices for fetch locality.
+            \param[in,out] streams Vertex streams
+            \param[in,out] vertexCount Number of vertices in each stream
+            \param[in,out] indices Index buffer
+            \param[in] ranges Index ranges drawn separately. If empty, the whole index buffer is treated as a single range.
+            \param[in] positionStream Index of the stream holding float3 or float4 positions, used for the overdraw optimization
+            \return Statistics before and after optimizing
+        */
+        static Report optimize(std::vector<VertexStream>& streams, uint32_t& vertexCount, std::vector<uint32_t>& indices, const std::vector<IndexRange>& ranges, uint32_t positionStream);
+
+        /** Simulate a FIFO post-transform cache
+        */
+        static Stats analyzeVertexCache(const uint32_t* pIndices, size_t indexCount, uint32_t vertexCount, uint32_t cacheSize = kDefaultCacheSize);
+
+        /** Merge vertices which are bitwise identical in all streams and remap the indices. Vertices keep their relative order.
+            \return The new vertex count
+        */
+        static uint32_t weldVertices(std::vector<VertexStream>& streams, uint32_t vertexCount, std::vector<uint32_t>& indices);
+
+        /** Reorder triangles for post-transform cache reuse, using Tom Forsyth's linear-speed algorithm
+        */
+        static void optimizeVertexCache(uint32_t* pIndices, size_t indexCount, uint32_t vertexCount);
+
+        /** Reorder clusters of triangles so that outward facing clusters are drawn first, reducing overdraw. Should run after optimizeVertexCache(), which
+            produces the clusters. The clusters are kept in their original order if sorting would increase the ACMR by more than the threshold.
+            \param[in] pPositions Pointer to the first position
+            \param[in] positionStride Distance between positions in bytes
+            \param[in] threshold Maximum allowed ACMR ratio between the result and the input
+        */
+        static void optimizeOverdraw(uint32_t* pIndices, size_t indexCount, const uint8_t* pPositions, uint32_t positionStride, uint32_t vertexCount, float threshold = 1.05f);
+
+        /** Reorder vertices in the order they are first referenced by the index buffer. Unreferenced vertices are removed.
+            \return The new vertex count
+        */
+        static uint32_t optimizeVertexFetch(std::vector<VertexStream>& streams, uint32_t vertexCount, std::vector<uint32_t>& indices);
+
+    private:
+        MeshOptimizer() = delete;
+    };
+
+    inline std::string to_string(const MeshOptimizer::Report& report)
+    {
+        return "vertices " + std::to_string(report.vertexBufferSizeBefore) + " -> " + std::to_string(report.vertexBufferSizeAfter) +
+            ", ACMR " + std::to_string(report.before.getAcmr()) + " -> " + std::to_string(report.after.getAcmr()) +
+            ", ATVR " + std::to_string(report.before.getAtvr()) + " -> " + std::to_string(report.after.getAtvr()) +
+            ", " + std::to_string(report.timeInMs) + " ms";
+    }
+}
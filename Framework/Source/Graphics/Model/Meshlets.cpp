@@ -0,0 +1,461 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "Meshlets.h"
+#include "glm/geometric.hpp"
+#include "glm/matrix.hpp"
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+#include <numeric>
+
+namespace Falcor
+{
+    namespace
+    {
+        const uint32_t kInvalidIndex = uint32_t(-1);
+
+        // Relative cost of adding a triangle facing away from the meshlet's average normal. Tighter cones cull better, at the cost of larger spheres.
+        const float kConeWeight = 0.5f;
+
+        // Cones wider than acos(kMinConeDot) can't be used for culling, since they are almost never entirely back-facing
+        const float kMinConeDot = 0.1f;
+
+        glm::vec3 loadPosition(const uint8_t* pPositions, uint32_t positionStride, uint32_t index)
+        {
+            glm::vec3 p;
+            std::memcpy(&p, pPositions + size_t(index) * positionStride, sizeof(p));
+            return p;
+        }
+
+        // Spread the lower 10 bits, for 30-bit 3D Morton codes
+        uint32_t expandBits(uint32_t v)
+        {
+            v = (v * 0x00010001u) & 0xFF0000FFu;
+            v = (v * 0x00000101u) & 0x0F00F00Fu;
+            v = (v * 0x00000011u) & 0xC30C30C3u;
+            v = (v * 0x00000005u) & 0x49249249u;
+            return v;
+        }
+    }
+
+    std::vector<MeshletData> MeshletBuilder::build(const uint8_t* pPositions, uint32_t positionStride, uint32_t vertexCount, uint32_t* pIndices, uint32_t indexCount)
+    {
+        std::vector<MeshletData> meshlets;
+        const uint32_t triangleCount = indexCount / 3;
+        if (triangleCount == 0) return meshlets;
+
+        // Triangle centroids and normals
+        std::vector<glm::vec3> centroids(triangleCount);
+        std::vector<glm::vec3> normals(triangleCount);
+        glm::vec3 boxMin(FLT_MAX);
+        glm::vec3 boxMax(-FLT_MAX);
+        for (uint32_t t = 0; t < triangleCount; t++)
+        {
+            glm::vec3 p0 = loadPosition(pPositions, positionStride, pIndices[t * 3 + 0]);
+            glm::vec3 p1 = loadPosition(pPositions, positionStride, pIndices[t * 3 + 1]);
+            glm::vec3 p2 = loadPosition(pPositions, positionStride, pIndices[t * 3 + 2]);
+            centroids[t] = (p0 + p1 + p2) / 3.0f;
+            glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+            float length = glm::length(n);
+            normals[t] = (length > 0) ? n / length : glm::vec3(0);
+            boxMin = glm::min(boxMin, centroids[t]);
+            boxMax = glm::max(boxMax, centroids[t]);
+        }
+
+        // Morton order of the centroids, used to seed the meshlets
+        std::vector<uint32_t> mortonCodes(triangleCount);
+        glm::vec3 boxSize = boxMax - boxMin;
+        float maxSize = std::max(boxSize.x, std::max(boxSize.y, boxSize.z));
+        float scale = (maxSize > 0) ? 1023.0f / maxSize : 0.0f;
+        for (uint32_t t = 0; t < triangleCount; t++)
+        {
+            glm::vec3 q = (centroids[t] - boxMin) * scale;
+            mortonCodes[t] = expandBits(uint32_t(q.x)) | (expandBits(uint32_t(q.y)) << 1) | (expandBits(uint32_t(q.z)) << 2);
+        }
+        std::vector<uint32_t> mortonOrder(triangleCount);
+        std::iota(mortonOrder.begin(), mortonOrder.end(), 0);
+        std::stable_sort(mortonOrder.begin(), mortonOrder.end(), [&mortonCodes](uint32_t a, uint32_t b) { return mortonCodes[a] < mortonCodes[b]; });
+
+        // Vertex to triangle adjacency
+        std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+        for (uint32_t i = 0; i < triangleCount * 3; i++) adjacencyOffsets[pIndices[i] + 1]++;
+        for (uint32_t v = 0; v < vertexCount; v++) adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+        std::vector<uint32_t> adjacency(triangleCount * 3);
+        {
+            std::vector<uint32_t> cursor(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+            for (uint32_t i = 0; i < triangleCount * 3; i++) adjacency[cursor[pIndices[i]]++] = i / 3;
+        }
+
+        std::vector<uint8_t> emitted(triangleCount, 0);
+        std::vector<uint32_t> vertexStamp(vertexCount, 0);     // Equal to the current stamp if the vertex is in the current meshlet
+        std::vector<uint32_t> meshletVertices;
+        std::vector<uint32_t> newIndices;
+        newIndices.reserve(triangleCount * 3);
+        meshletVertices.reserve(kMaxVertices);
+
+        uint32_t stamp = 0;
+        uint32_t mortonCursor = 0;
+        uint32_t emittedCount = 0;
+
+        auto countNewVertices = [&](uint32_t t)
+        {
+            uint32_t count = 0;
+            for (uint32_t k = 0; k < 3; k++) count += (vertexStamp[pIndices[t * 3 + k]] != stamp) ? 1 : 0;
+            return count;
+        };
+
+        while (emittedCount < triangleCount)
+        {
+            stamp++;
+            meshletVertices.clear();
+            const uint32_t indexOffset = (uint32_t)newIndices.size();
+            uint32_t meshletTriangles = 0;
+            glm::vec3 centroidSum(0);
+            glm::vec3 normalSum(0);
+
+            while (emitted[mortonOrder[mortonCursor]]) mortonCursor++;
+            uint32_t triangle = mortonOrder[mortonCursor];
+
+            while (triangle != kInvalidIndex)
+            {
+                emitted[triangle] = 1;
+                emittedCount++;
+                meshletTriangles++;
+                for (uint32_t k = 0; k < 3; k++)
+                {
+                    uint32_t v = pIndices[triangle * 3 + k];
+                    newIndices.push_back(v);
+                    if (vertexStamp[v] != stamp)
+                    {
+                        vertexStamp[v] = stamp;
+                        meshletVertices.push_back(v);
+                    }
+                }
+                centroidSum += centroids[triangle];
+                normalSum += normals[triangle];
+
+                if (meshletTriangles == kMaxTriangles) break;
+
+                const glm::vec3 center = centroidSum / float(meshletTriangles);
+                const float axisLength = glm::length(normalSum);
+                const glm::vec3 axis = (axisLength > 0) ? normalSum / axisLength : glm::vec3(0);
+
+                // Pick the best neighbor of the last triangle: fewest new vertices first, then closest and best aligned with the meshlet
+                uint32_t best = kInvalidIndex;
+                uint32_t bestNewVertices = 4;
+                float bestScore = FLT_MAX;
+                auto consider = [&](uint32_t t)
+                {
+                    if (emitted[t]) return;
+                    uint32_t newVertices = countNewVertices(t);
+                    if (meshletVertices.size() + newVertices > kMaxVertices) return;
+                    glm::vec3 d = centroids[t] - center;
+                    float score = glm::dot(d, d) * (1.0f + kConeWeight * (1.0f - glm::dot(normals[t], axis)));
+                    if (newVertices < bestNewVertices || (newVertices == bestNewVertices && score < bestScore))
+                    {
+                        best = t;
+                        bestNewVertices = newVertices;
+                        bestScore = score;
+                    }
+                };
+
+                const uint32_t* pLast = newIndices.data() + newIndices.size() - 3;
+                for (uint32_t k = 0; k < 3; k++)
+                {
+                    for (uint32_t a = adjacencyOffsets[pLast[k]]; a < adjacencyOffsets[pLast[k] + 1]; a++) consider(adjacency[a]);
+                }
+
+                // The last triangle is surrounded, try the neighbors of the whole meshlet
+                if (best == kInvalidIndex)
+                {
+                    for (uint32_t v : meshletVertices)
+                    {
+                        for (uint32_t a = adjacencyOffsets[v]; a < adjacencyOffsets[v + 1]; a++) consider(adjacency[a]);
+                    }
+                }
+
+                // No connected triangles left, continue with the next one in Morton order. Fills meshlets of disconnected parts and triangle soups.
+                if (best == kInvalidIndex && emittedCount < triangleCount)
+                {
+                    while (emitted[mortonOrder[mortonCursor]]) mortonCursor++;
+                    consider(mortonOrder[mortonCursor]);
+                }
+
+                triangle = best;
+            }
+
+            MeshletData meshlet = computeBounds(pPositions, positionStride, newIndices.data(), indexOffset, meshletTriangles);
+            meshlet.vertexCount = (uint32_t)meshletVertices.size();
+            meshlets.push_back(meshlet);
+        }
+
+        std::memcpy(pIndices, newIndices.data(), newIndices.size() * sizeof(uint32_t));
+        return meshlets;
+    }
+
+    std::vector<std::vector<MeshletData>> MeshletBuilder::buildOptimized(std::vector<MeshOptimizer::VertexStream>& streams, uint32_t& vertexCount, std::vector<uint32_t>& indices,
+        const std::vector<MeshOptimizer::IndexRange>& ranges, uint32_t positionStream, MeshOptimizer::Report& report)
+    {
+        assert(positionStream < streams.size());
+
+        std::vector<MeshOptimizer::IndexRange> drawRanges = ranges;
+        if (drawRanges.empty())
+        {
+            drawRanges.push_back({ 0, uint32_t(indices.size()) });
+        }
+
+        MeshOptimizer::Stats before;
+        for (const auto& r : drawRanges)
+        {
+            before += MeshOptimizer::analyzeVertexCache(indices.data() + r.offset, r.count, vertexCount);
+        }
+
+        const MeshOptimizer::VertexStream& positions = streams[positionStream];
+        std::vector<std::vector<MeshletData>> meshlets(drawRanges.size());
+        std::vector<MeshOptimizer::IndexRange> meshletRanges;
+        for (size_t i = 0; i < drawRanges.size(); i++)
+        {
+            const MeshOptimizer::IndexRange& r = drawRanges[i];
+            meshlets[i] = build(positions.pData->data(), positions.stride, vertexCount, indices.data() + r.offset, r.count);
+            for (const MeshletData& m : meshlets[i])
+            {
+                meshletRanges.push_back({ r.offset + m.indexOffset, m.triangleCount * 3 });
+            }
+        }
+
+        // Triangles never leave their meshlet, the bounds stay valid. Welding and the vertex fetch order only change the vertex indices.
+        report = MeshOptimizer::optimize(streams, vertexCount, indices, meshletRanges, positionStream);
+
+        // Report the ranges as they are drawn, the optimizer only saw the meshlets
+        report.before = before;
+        report.after = MeshOptimizer::Stats();
+        for (const auto& r : drawRanges)
+        {
+            report.after += MeshOptimizer::analyzeVertexCache(indices.data() + r.offset, r.count, vertexCount);
+        }
+
+        // Welding may have merged vertices of a meshlet
+        std::vector<uint32_t> vertexStamp(vertexCount, kInvalidIndex);
+        uint32_t stamp = 0;
+        for (size_t i = 0; i < drawRanges.size(); i++)
+        {
+            for (MeshletData& m : meshlets[i])
+            {
+                const uint32_t* pFirst = indices.data() + drawRanges[i].offset + m.indexOffset;
+                m.vertexCount = 0;
+                for (uint32_t j = 0; j < m.triangleCount * 3; j++)
+                {
+                    if (vertexStamp[pFirst[j]] != stamp)
+                    {
+                        vertexStamp[pFirst[j]] = stamp;
+                        m.vertexCount++;
+                    }
+                }
+                stamp++;
+            }
+        }
+        return meshlets;
+    }
+
+    MeshletData MeshletBuilder::computeBounds(const uint8_t* pPositions, uint32_t positionStride, const uint32_t* pIndices, uint32_t indexOffset, uint32_t triangleCount)
+    {
+        MeshletData meshlet;
+        meshlet.indexOffset = indexOffset;
+        meshlet.triangleCount = triangleCount;
+
+        const uint32_t* pFirst = pIndices + indexOffset;
+        const uint32_t indexCount = triangleCount * 3;
+
+        // Bounding sphere around the center of the AABB
+        glm::vec3 boxMin(FLT_MAX);
+        glm::vec3 boxMax(-FLT_MAX);
+        for (uint32_t i = 0; i < indexCount; i++)
+        {
+            glm::vec3 p = loadPosition(pPositions, positionStride, pFirst[i]);
+            boxMin = glm::min(boxMin, p);
+            boxMax = glm::max(boxMax, p);
+        }
+        meshlet.center = (boxMin + boxMax) * 0.5f;
+        float radiusSq = 0;
+        for (uint32_t i = 0; i < indexCount; i++)
+        {
+            glm::vec3 d = loadPosition(pPositions, positionStride, pFirst[i]) - meshlet.center;
+            radiusSq = std::max(radiusSq, glm::dot(d, d));
+        }
+        meshlet.radius = std::sqrt(radiusSq);
+
+        // Normal cone. Degenerate triangles are never rasterized and are ignored.
+        glm::vec3 normalSum(0);
+        for (uint32_t t = 0; t < triangleCount; t++)
+        {
+            glm::vec3 p0 = loadPosition(pPositions, positionStride, pFirst[t * 3 + 0]);
+            glm::vec3 n = glm::cross(loadPosition(pPositions, positionStride, pFirst[t * 3 + 1]) - p0, loadPosition(pPositions, positionStride, pFirst[t * 3 + 2]) - p0);
+            float length = glm::length(n);
+            if (length > 0) normalSum += n / length;
+        }
+
+        meshlet.coneApex = meshlet.center;
+        float axisLength = glm::length(normalSum);
+        if (axisLength == 0) return meshlet;
+
+        glm::vec3 axis = normalSum / axisLength;
+        float minDot = 1;
+        float maxT = 0;
+        for (uint32_t t = 0; t < triangleCount; t++)
+        {
+            glm::vec3 p0 = loadPosition(pPositions, positionStride, pFirst[t * 3 + 0]);
+            glm::vec3 n = glm::cross(loadPosition(pPositions, positionStride, pFirst[t * 3 + 1]) - p0, loadPosition(pPositions, positionStride, pFirst[t * 3 + 2]) - p0);
+            float length = glm::length(n);
+            if (length == 0) continue;
+            n /= length;
+
+            float d = glm::dot(n, axis);
+            minDot = std::min(minDot, d);
+            // Distance along the axis from the center to the triangle's plane. The apex goes behind all the planes.
+            if (d > 0) maxT = std::max(maxT, glm::dot(meshlet.center - p0, n) / d);
+        }
+
+        if (minDot > kMinConeDot)
+        {
+            meshlet.coneAxis = axis;
+            meshlet.coneApex = meshlet.center - axis * maxT;
+            meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+        }
+        return meshlet;
+    }
+
+    void MeshletCuller::setView(const glm::mat4& viewProjMat, const glm::mat4& worldMat, bool cullBackFaces)
+    {
+        // Object space frustum planes, see Camera::calculateCameraParameters()
+        const glm::mat4 mat = viewProjMat * worldMat;
+        const glm::mat4 tempMat = glm::transpose(mat);
+        for (int i = 0; i < 6; i++)
+        {
+            glm::vec4 plane = (i & 1) ? tempMat[i >> 1] : -tempMat[i >> 1];
+            if (i != 5) // Z range is [0, w]. For the 0 <= z plane we don't need to add w
+            {
+                plane += tempMat[3];
+            }
+            float length = glm::length(glm::vec3(plane));
+            mPlanes[i] = (length > 0) ? plane / length : plane;
+        }
+
+        // The viewer projects to (0, 0, z, 0). For orthographic projections it's a point at infinity, the view direction.
+        glm::vec4 viewer = glm::inverse(mat) * glm::vec4(0, 0, 1, 0);
+        mIsViewerDirection = std::abs(viewer.w) <= 1e-6f * glm::length(glm::vec3(viewer));
+        mViewer = mIsViewerDirection ? glm::vec3(viewer) : glm::vec3(viewer) / viewer.w;
+
+        // Mirroring transforms flip the winding
+        mCullBackFaces = cullBackFaces && (glm::determinant(glm::mat3(worldMat)) > 0);
+    }
+
+    bool MeshletCuller::isCulled(const MeshletData& meshlet) const
+    {
+        for (const glm::vec4& plane : mPlanes)
+        {
+            if (glm::dot(glm::vec3(plane), meshlet.center) + plane.w < -meshlet.radius) return true;
+        }
+
+        if (mCullBackFaces && meshlet.coneCutoff < 1.0f)
+        {
+            glm::vec3 d = mIsViewerDirection ? mViewer : meshlet.coneApex - mViewer;
+            float length = glm::length(d);
+            if (length > 0 && glm::dot(d, meshlet.coneAxis) >= meshlet.coneCutoff * length) return true;
+        }
+        return false;
+    }
+
+    uint32_t MeshletCuller::cull(const std::vector<MeshletData>& meshlets, std::vector<uint8_t>& visibility) const
+    {
+        assert(visibility.size() == meshlets.size());
+        uint32_t culledTriangles = 0;
+        for (size_t i = 0; i < meshlets.size(); i++)
+        {
+            if (isCulled(meshlets[i]))
+            {
+                culledTriangles += meshlets[i].triangleCount;
+            }
+            else
+            {
+                visibility[i] = 1;
+            }
+        }
+        return culledTriangles;
+    }
+
+    uint32_t MeshletCuller::buildDrawRanges(const std::vector<MeshletData>& meshlets, const std::vector<uint8_t>& visibility, uint32_t maxRangeCount, std::vector<DrawRange>& ranges)
+    {
+        assert(maxRangeCount > 0);
+        ranges.clear();
+        uint32_t drawnTriangles = 0;
+        for (size_t i = 0; i < meshlets.size(); i++)
+        {
+            if (visibility[i] == 0) continue;
+            const MeshletData& meshlet = meshlets[i];
+            if (ranges.size() && ranges.back().indexOffset + ranges.back().indexCount == meshlet.indexOffset)
+            {
+                ranges.back().indexCount += meshlet.triangleCount * 3;
+            }
+            else
+            {
+                ranges.push_back({ meshlet.indexOffset, meshlet.triangleCount * 3 });
+            }
+            drawnTriangles += meshlet.triangleCount;
+        }
+
+        if (ranges.size() <= maxRangeCount) return drawnTriangles;
+
+        // Keep the (maxRangeCount - 1) largest gaps, fill the others
+        std::vector<uint32_t> gaps(ranges.size() - 1);
+        for (size_t i = 0; i < gaps.size(); i++) gaps[i] = ranges[i + 1].indexOffset - (ranges[i].indexOffset + ranges[i].indexCount);
+        std::vector<uint32_t> order(gaps.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::nth_element(order.begin(), order.begin() + (maxRangeCount - 1), order.end(), [&gaps](uint32_t a, uint32_t b) { return gaps[a] > gaps[b]; });
+        std::vector<uint8_t> keepGap(gaps.size(), 0);
+        for (uint32_t i = 0; i < maxRangeCount - 1; i++) keepGap[order[i]] = 1;
+
+        std::vector<DrawRange> merged;
+        merged.reserve(maxRangeCount);
+        merged.push_back(ranges[0]);
+        for (size_t i = 1; i < ranges.size(); i++)
+        {
+            if (keepGap[i - 1])
+            {
+                merged.push_back(ranges[i]);
+            }
+            else
+            {
+                drawnTriangles += gaps[i - 1] / 3;
+                merged.back().indexCount = ranges[i].indexOffset + ranges[i].indexCount - merged.back().indexOffset;
+            }
+        }
+        ranges.swap(merged);
+        return drawnTriangles;
+    }
+}
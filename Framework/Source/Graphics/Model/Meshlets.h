@@ -0,0 +1,123 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <vector>
+#include "glm/mat4x4.hpp"
+#include "Data/HostDeviceData.h"
+#include "Graphics/Model/MeshOptimizer.h"
+
+namespace Falcor
+{
+    /** Splits triangle lists into small clusters (meshlets) with bounding spheres and normal cones.
+        The triangles of the index buffer are reordered so that every meshlet is a contiguous index range, which can be drawn on its own.
+        Meshlets are grown greedily from triangles sharing vertices, preferring the ones closest to the meshlet and facing the same way. When the
+        neighborhood runs out, the next meshlet starts from the triangle following the last one in Morton order of the triangle centroids.
+    */
+    class MeshletBuilder
+    {
+    public:
+        static const uint32_t kMaxVertices = 64;
+        static const uint32_t kMaxTriangles = 124;
+
+        /** Build the meshlets of a triangle list
+            \param[in] pPositions Pointer to the first float3 position
+            \param[in] positionStride Distance between positions in bytes
+            \param[in] vertexCount Number of vertices
+            \param[in,out] pIndices The index buffer. The triangles are reordered, meshlet after meshlet.
+            \param[in] indexCount Number of indices
+            \return The meshlets, in index buffer order. The index offsets are relative to pIndices.
+        */
+        static std::vector<MeshletData> build(const uint8_t* pPositions, uint32_t positionStride, uint32_t vertexCount, uint32_t* pIndices, uint32_t indexCount);
+
+        /** Build the meshlets of index ranges sharing the same vertices, then run MeshOptimizer::optimize() inside each meshlet.
+            Meshlets are built first since they decide what can be culled. The vertex cache and overdraw orders are only lost at meshlet boundaries, so the
+            ACMR ends up slightly higher than optimizing the whole range, in exchange for meshlets that keep their bounds.
+            \param[in,out] streams Vertex streams, see MeshOptimizer::optimize()
+            \param[in,out] vertexCount Number of vertices in each stream
+            \param[in,out] indices Index buffer. Triangles are reordered inside their range.
+            \param[in] ranges Index ranges drawn separately. If empty, the whole index buffer is treated as a single range.
+            \param[in] positionStream Index of the stream holding float3 or float4 positions
+            \param[out] report Statistics of the ranges before building the meshlets and after optimizing
+            \return The meshlets of each range. The index offsets are relative to the start of the range.
+        */
+        static std::vector<std::vector<MeshletData>> buildOptimized(std::vector<MeshOptimizer::VertexStream>& streams, uint32_t& vertexCount, std::vector<uint32_t>& indices,
+            const std::vector<MeshOptimizer::IndexRange>& ranges, uint32_t positionStream, MeshOptimizer::Report& report);
+
+        /** Compute the bounding sphere and the normal cone of a range of triangles
+        */
+        static MeshletData computeBounds(const uint8_t* pPositions, uint32_t positionStride, const uint32_t* pIndices, uint32_t indexOffset, uint32_t triangleCount);
+
+    private:
+        MeshletBuilder() = delete;
+    };
+
+    /** Frustum and back-face culling of meshlets against a view.
+        The tests run in the mesh's object space, so the meshlet bounds are used as is for every instance.
+    */
+    class MeshletCuller
+    {
+    public:
+        /** A contiguous range of the index buffer
+        */
+        struct DrawRange
+        {
+            uint32_t indexOffset = 0;
+            uint32_t indexCount = 0;
+        };
+
+        /** Set the view
+            \param[in] viewProjMat The camera's view-projection matrix. Depth must increase away from the camera.
+            \param[in] worldMat The mesh instance's world matrix
+            \param[in] cullBackFaces Use the normal cones. Only valid when the rasterizer culls back faces, with counter-clockwise front faces.
+        */
+        void setView(const glm::mat4& viewProjMat, const glm::mat4& worldMat, bool cullBackFaces);
+
+        /** Check if a meshlet is outside the frustum or entirely back-facing
+        */
+        bool isCulled(const MeshletData& meshlet) const;
+
+        /** Cull a list of meshlets
+            \param[in] meshlets The meshlets
+            \param[in,out] visibility Per meshlet visibility. Visible meshlets are set to 1, the others are left unchanged, so that views can be accumulated.
+            \return The number of culled triangles
+        */
+        uint32_t cull(const std::vector<MeshletData>& meshlets, std::vector<uint8_t>& visibility) const;
+
+        /** Turn the visible meshlets into draw ranges. Consecutive visible meshlets are merged. If there would be more than maxRangeCount ranges, the
+            smallest gaps are filled with culled meshlets, since the extra draw calls would cost more than the culled triangles.
+            \return The number of triangles drawn
+        */
+        static uint32_t buildDrawRanges(const std::vector<MeshletData>& meshlets, const std::vector<uint8_t>& visibility, uint32_t maxRangeCount, std::vector<DrawRange>& ranges);
+
+    private:
+        glm::vec4 mPlanes[6];
+        glm::vec3 mViewer;              ///< Object space viewer position, or the view direction for orthographic projections
+        bool mIsViewerDirection = false;
+        bool mCullBackFaces = false;
+    };
+}
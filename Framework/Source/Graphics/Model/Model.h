@@ -68,6 +68,9 @@ namespace Falcor
             RemoveInstancing            = 0x20,   ///< Flatten mesh instances
             UseSpecGlossMaterials       = 0x40,   ///< Set materials to use Spec-Gloss shading model. Otherwise default is Metal-Rough for FBX, Spec-Gloss for OBJ.
             UseMetalRoughMaterials      = 0x80,   ///< Set materials to use Metal-Rough shading model. Otherwise default is Metal-Rough for FBX, Spec-Gloss for OBJ.
+            OptimizeMeshes              = 0x100,  ///< Weld duplicate vertices, reorder triangles for post-transform cache reuse and overdraw, and reorder vertices for fetch locality. See MeshOptimizer.
+            CompressVertices            = 0x200,  ///< Store positions as 16-bit values relative to the mesh's AABB, normals and bitangents as 2x16-bit octahedral vectors, texture coordinates as half floats, and use 16-bit indices when possible. Meshes with bones keep the full precision layout. Not supported by the ray tracing shaders. See VertexCompression.
+            GenerateMeshlets            = 0x400,  ///< Split triangle lists into meshlets which SceneRenderer can cull. Reorders the triangles, with OptimizeMeshes the vertex cache order is only kept inside each meshlet. See MeshletBuilder.
         };
 
         /** Create a new model from file
@@ -256,6 +259,7 @@ namespace Falcor
 
     protected:
         friend class SimpleModelImporter;
+        friend class BakedScene;
 
         Model();
         Model(const Model& other);
@@ -304,6 +308,10 @@ namespace Falcor
             flag_str(BuffersAsShaderResource);
             flag_str(RemoveInstancing);            
             flag_str(UseSpecGlossMaterials);
+            flag_str(UseMetalRoughMaterials);
+            flag_str(OptimizeMeshes);
+            flag_str(CompressVertices);
+            flag_str(GenerateMeshlets);
         default:
             should_not_get_here();
             return "";
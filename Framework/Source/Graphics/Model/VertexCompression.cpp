@@ -0,0 +1,252 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "VertexCompression.h"
+#include "Data/VertexAttrib.h"
+#include "glm/geometric.hpp"
+#include "glm/gtc/packing.hpp"
+#include <cstring>
+#include <cfloat>
+
+namespace Falcor
+{
+    namespace
+    {
+        int16_t toSnorm16(float v)
+        {
+            return (int16_t)std::round(glm::clamp(v, -1.0f, 1.0f) * 32767.0f);
+        }
+
+        float fromSnorm16(int16_t v)
+        {
+            return glm::max(float(v) / 32767.0f, -1.0f);
+        }
+
+        uint16_t toUnorm16(float v)
+        {
+            return (uint16_t)std::round(glm::clamp(v, 0.0f, 1.0f) * 65535.0f);
+        }
+
+        glm::vec3 loadVec3(const uint8_t* pData)
+        {
+            glm::vec3 v;
+            std::memcpy(&v, pData, sizeof(v));
+            return v;
+        }
+
+        bool isFloatVector(ResourceFormat format)
+        {
+            return format == ResourceFormat::RGB32Float || format == ResourceFormat::RGBA32Float;
+        }
+    }
+
+    ResourceFormat VertexCompression::getCompressedFormat(uint32_t shaderLocation, ResourceFormat format)
+    {
+        switch (shaderLocation)
+        {
+        case VERTEX_POSITION_LOC:
+            return isFloatVector(format) ? ResourceFormat::RGBA16Unorm : format;
+        case VERTEX_NORMAL_LOC:
+        case VERTEX_BITANGENT_LOC:
+            return (format == ResourceFormat::RGB32Float) ? ResourceFormat::RG16Snorm : format;
+        case VERTEX_TEXCOORD_LOC:
+            return (format == ResourceFormat::RG32Float || format == ResourceFormat::RGB32Float) ? ResourceFormat::RG16Float : format;
+        default:
+            return format;
+        }
+    }
+
+    std::vector<uint8_t> VertexCompression::compressAttribute(uint32_t shaderLocation, ResourceFormat format, const uint8_t* pData, uint32_t vertexCount, const BoundingBox& quantizationBox)
+    {
+        const ResourceFormat compressedFormat = getCompressedFormat(shaderLocation, format);
+        const uint32_t srcStride = getFormatBytesPerBlock(format);
+        const uint32_t dstStride = getFormatBytesPerBlock(compressedFormat);
+        std::vector<uint8_t> result(size_t(dstStride) * vertexCount);
+
+        if (compressedFormat == format)
+        {
+            std::memcpy(result.data(), pData, result.size());
+            return result;
+        }
+
+        for (uint32_t v = 0; v < vertexCount; v++)
+        {
+            const uint8_t* pSrc = pData + size_t(v) * srcStride;
+            uint8_t* pDst = result.data() + size_t(v) * dstStride;
+
+            switch (compressedFormat)
+            {
+            case ResourceFormat::RGBA16Unorm:
+            {
+                // Flat boxes have a zero extent on some axis, all the vertices are at the center
+                glm::vec3 extent = quantizationBox.extent;
+                glm::vec3 scale = glm::vec3(extent.x > 0 ? 0.5f / extent.x : 0, extent.y > 0 ? 0.5f / extent.y : 0, extent.z > 0 ? 0.5f / extent.z : 0);
+                glm::vec3 q = (loadVec3(pSrc) - quantizationBox.getMinPos()) * scale;
+                uint16_t encoded[4] = { toUnorm16(q.x), toUnorm16(q.y), toUnorm16(q.z), 0xffff };
+                std::memcpy(pDst, encoded, sizeof(encoded));
+                break;
+            }
+            case ResourceFormat::RG16Snorm:
+            {
+                int16_t encoded[2];
+                encodeOctahedral(loadVec3(pSrc), encoded);
+                std::memcpy(pDst, encoded, sizeof(encoded));
+                break;
+            }
+            case ResourceFormat::RG16Float:
+            {
+                float uv[2];
+                std::memcpy(uv, pSrc, sizeof(uv));
+                uint16_t encoded[2] = { glm::packHalf1x16(uv[0]), glm::packHalf1x16(uv[1]) };
+                std::memcpy(pDst, encoded, sizeof(encoded));
+                break;
+            }
+            default:
+                should_not_get_here();
+            }
+        }
+        return result;
+    }
+
+    BoundingBox VertexCompression::calcQuantizationBox(const uint8_t* pPositions, ResourceFormat format, uint32_t vertexCount)
+    {
+        assert(isFloatVector(format));
+        if (vertexCount == 0) return BoundingBox::fromMinMax(glm::vec3(0), glm::vec3(0));
+
+        const uint32_t stride = getFormatBytesPerBlock(format);
+        glm::vec3 boxMin(FLT_MAX);
+        glm::vec3 boxMax(-FLT_MAX);
+        for (uint32_t v = 0; v < vertexCount; v++)
+        {
+            glm::vec3 p = loadVec3(pPositions + size_t(v) * stride);
+            boxMin = glm::min(boxMin, p);
+            boxMax = glm::max(boxMax, p);
+        }
+        return BoundingBox::fromMinMax(boxMin, boxMax);
+    }
+
+    std::vector<uint8_t> VertexCompression::convertIndices(const uint32_t* pIndices, size_t indexCount, ResourceFormat format)
+    {
+        std::vector<uint8_t> result(indexCount * getFormatBytesPerBlock(format));
+        if (format == ResourceFormat::R16Uint)
+        {
+            uint16_t* pDst = (uint16_t*)result.data();
+            for (size_t i = 0; i < indexCount; i++)
+            {
+                assert(pIndices[i] <= 0xffff);
+                pDst[i] = (uint16_t)pIndices[i];
+            }
+        }
+        else
+        {
+            assert(format == ResourceFormat::R32Uint);
+            std::memcpy(result.data(), pIndices, result.size());
+        }
+        return result;
+    }
+
+    void VertexCompression::encodeOctahedral(const glm::vec3& v, int16_t encoded[2])
+    {
+        // Project on the octahedron, then fold the lower hemisphere over the diagonals
+        float l1Norm = std::abs(v.x) + std::abs(v.y) + std::abs(v.z);
+        glm::vec2 o = (l1Norm > 0) ? glm::vec2(v.x, v.y) / l1Norm : glm::vec2(0);
+        if (v.z < 0)
+        {
+            glm::vec2 signs(o.x >= 0 ? 1.0f : -1.0f, o.y >= 0 ? 1.0f : -1.0f);
+            o = (glm::vec2(1.0f) - glm::abs(glm::vec2(o.y, o.x))) * signs;
+        }
+        encoded[0] = toSnorm16(o.x);
+        encoded[1] = toSnorm16(o.y);
+    }
+
+    glm::vec3 VertexCompression::decodeOctahedral(const int16_t encoded[2])
+    {
+        glm::vec2 o(fromSnorm16(encoded[0]), fromSnorm16(encoded[1]));
+        glm::vec3 v(o.x, o.y, 1.0f - std::abs(o.x) - std::abs(o.y));
+        if (v.z < 0)
+        {
+            glm::vec2 signs(v.x >= 0 ? 1.0f : -1.0f, v.y >= 0 ? 1.0f : -1.0f);
+            glm::vec2 xy = (glm::vec2(1.0f) - glm::abs(glm::vec2(v.y, v.x))) * signs;
+            v.x = xy.x;
+            v.y = xy.y;
+        }
+        return glm::normalize(v);
+    }
+
+    bool VertexCompression::readPosition(const uint8_t* pVertex, ResourceFormat format, const BoundingBox& quantizationBox, glm::vec3& position)
+    {
+        if (isFloatVector(format))
+        {
+            position = loadVec3(pVertex);
+            return true;
+        }
+        if (format == ResourceFormat::RGBA16Unorm)
+        {
+            uint16_t encoded[4];
+            std::memcpy(encoded, pVertex, sizeof(encoded));
+            glm::vec3 q = glm::vec3(encoded[0], encoded[1], encoded[2]) / 65535.0f;
+            position = quantizationBox.getMinPos() + q * (quantizationBox.extent * 2.0f);
+            return true;
+        }
+        return false;
+    }
+
+    bool VertexCompression::readDirection(const uint8_t* pVertex, ResourceFormat format, glm::vec3& direction)
+    {
+        if (format == ResourceFormat::RGB32Float)
+        {
+            direction = loadVec3(pVertex);
+            return true;
+        }
+        if (format == ResourceFormat::RG16Snorm)
+        {
+            int16_t encoded[2];
+            std::memcpy(encoded, pVertex, sizeof(encoded));
+            direction = decodeOctahedral(encoded);
+            return true;
+        }
+        return false;
+    }
+
+    bool VertexCompression::readTexCrd(const uint8_t* pVertex, ResourceFormat format, glm::vec2& texCrd)
+    {
+        if (format == ResourceFormat::RG32Float || format == ResourceFormat::RGB32Float)
+        {
+            std::memcpy(&texCrd, pVertex, sizeof(texCrd));
+            return true;
+        }
+        if (format == ResourceFormat::RG16Float)
+        {
+            uint16_t encoded[2];
+            std::memcpy(encoded, pVertex, sizeof(encoded));
+            texCrd = glm::vec2(glm::unpackHalf1x16(encoded[0]), glm::unpackHalf1x16(encoded[1]));
+            return true;
+        }
+        return false;
+    }
+}
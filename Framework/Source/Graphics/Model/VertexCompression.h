@@ -0,0 +1,104 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <vector>
+#include "glm/vec2.hpp"
+#include "glm/vec3.hpp"
+#include "API/Formats.h"
+#include "Utils/AABB.h"
+
+namespace Falcor
+{
+    /** Encoding and decoding of the compressed vertex layout used by Model::LoadFlags::CompressVertices.
+        - Positions are stored as RGBA16Unorm, relative to the mesh's quantization box. The shaders decode them with the box passed in InternalPerMeshCB.
+        - Normals and bitangents are octahedral unit vectors stored as RG16Snorm.
+        - Texture coordinates are stored as RG16Float, decoded by the input assembler.
+        - Index buffers use R16Uint when the vertex count allows it.
+        The matching shader code is in DefaultVS.slang.
+    */
+    class VertexCompression
+    {
+    public:
+        /** Get the format an attribute is compressed to. Returns the original format if the attribute isn't compressed.
+            \param[in] shaderLocation The attribute's shader location, one of the VERTEX_*_LOC values
+            \param[in] format The uncompressed format
+        */
+        static ResourceFormat getCompressedFormat(uint32_t shaderLocation, ResourceFormat format);
+
+        /** Compress a tightly packed attribute stream.
+            \param[in] shaderLocation The attribute's shader location
+            \param[in] format The format of the data
+            \param[in] pData The attribute data, one element of the given format per vertex
+            \param[in] vertexCount Number of vertices
+            \param[in] quantizationBox The box positions are quantized to, see calcQuantizationBox()
+            \return The compressed stream, in the format returned by getCompressedFormat()
+        */
+        static std::vector<uint8_t> compressAttribute(uint32_t shaderLocation, ResourceFormat format, const uint8_t* pData, uint32_t vertexCount, const BoundingBox& quantizationBox);
+
+        /** Calculate the box to quantize positions to.
+            \param[in] pPositions Position stream, RGB32Float or RGBA32Float
+        */
+        static BoundingBox calcQuantizationBox(const uint8_t* pPositions, ResourceFormat format, uint32_t vertexCount);
+
+        /** Get the index format which can address all the vertices
+        */
+        static ResourceFormat getIndexFormat(uint32_t vertexCount) { return (vertexCount <= 0x10000) ? ResourceFormat::R16Uint : ResourceFormat::R32Uint; }
+
+        /** Convert 32-bit indices to the given format. The result is the data for the index buffer.
+        */
+        static std::vector<uint8_t> convertIndices(const uint32_t* pIndices, size_t indexCount, ResourceFormat format);
+
+        /** Octahedral encoding of a unit vector, as two signed normalized 16-bit values
+        */
+        static void encodeOctahedral(const glm::vec3& v, int16_t encoded[2]);
+
+        /** Decode an octahedral unit vector
+        */
+        static glm::vec3 decodeOctahedral(const int16_t encoded[2]);
+
+        /** Read a position in any of the supported formats.
+            \param[in] pVertex Pointer to the attribute
+            \param[in] format RGB32Float, RGBA32Float or RGBA16Unorm
+            \param[in] quantizationBox Used for RGBA16Unorm positions
+            \param[out] position The object space position
+            \return false if the format isn't supported
+        */
+        static bool readPosition(const uint8_t* pVertex, ResourceFormat format, const BoundingBox& quantizationBox, glm::vec3& position);
+
+        /** Read a normal or bitangent in any of the supported formats, RGB32Float or RG16Snorm
+        */
+        static bool readDirection(const uint8_t* pVertex, ResourceFormat format, glm::vec3& direction);
+
+        /** Read a texture coordinate in any of the supported formats, RG32Float, RGB32Float or RG16Float
+        */
+        static bool readTexCrd(const uint8_t* pVertex, ResourceFormat format, glm::vec2& texCrd);
+
+    private:
+        VertexCompression() = delete;
+    };
+}
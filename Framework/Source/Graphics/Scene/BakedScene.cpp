@@ -0,0 +1,732 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "BakedScene.h"
+#include "SceneExporter.h"
+#include "SceneImporter.h"
+#include "Graphics/Model/Model.h"
+#include "Graphics/Model/Mesh.h"
+#include "API/Texture.h"
+#include "API/Buffer.h"
+#include "API/VertexLayout.h"
+#include "API/Device.h"
+#include "Utils/BinaryFileStream.h"
+#include "Utils/MemoryMappedStream.h"
+#include "Utils/MemoryMappedFile.h"
+#include "Utils/CpuTimer.h"
+#include "Utils/Platform/OS.h"
+#include "rapidjson/document.h"
+#include <map>
+#include <set>
+#include <cstring>
+
+#define SCENE_IMPORTER
+#include "SceneExportImportCommon.h"
+
+namespace Falcor
+{
+    // Must be defined even though it's a const uint because value is passed as reference to functions
+    const uint32_t BakedScene::kVersion;
+
+    static const char kBakedSceneTag[] = "FBakedSc";
+    static const int32_t kNoIndex = -1;
+
+    /** Container layout. All counts are uint32_t, strings are a uint32_t length followed by the characters.
+        Header:         tag[8], version, uint64_t source hash
+        Sources:        count, file names
+        Description:    JSON scene description, as written by SceneExporter
+        Textures:       count, {source filename, width, height, mip count, format, bind flags, uint64_t size, packed mip chain}
+        Env-map:        int32_t texture index
+        Buffers:        count, {bind flags, uint64_t size, data}
+        Materials:      count, {name, base color, specular, emissive, shading model, alpha mode, double sided, alpha threshold, IoR, height scale/offset, int32_t texture indices[kMaterialTextureCount]}
+        Models:         count, {name, filename, mesh count, meshes}
+        Mesh:           vertex count, index count, topology, material index, bounding box, int32_t index buffer, index format, quantized positions, quantization box, meshlet count, MeshletData[], buffer layout count, layouts, instance count, mat4 transforms
+        Buffer layout:  int32_t buffer index (-1 for an empty slot), input class, step rate, element count, {name, offset, format, array size, shader location}
+        The payloads are handed to the resource creation functions straight from the mapped file.
+    */
+
+    static const uint32_t kMaterialTextureCount = 7;
+
+    static void getMaterialTextures(const Material* pMaterial, Texture::SharedPtr textures[kMaterialTextureCount])
+    {
+        textures[0] = pMaterial->getBaseColorTexture();
+        textures[1] = pMaterial->getSpecularTexture();
+        textures[2] = pMaterial->getEmissiveTexture();
+        textures[3] = pMaterial->getNormalMap();
+        textures[4] = pMaterial->getOcclusionMap();
+        textures[5] = pMaterial->getLightMap();
+        textures[6] = pMaterial->getHeightMap();
+    }
+
+    static void setMaterialTextures(Material* pMaterial, Texture::SharedPtr textures[kMaterialTextureCount])
+    {
+        if (textures[0]) pMaterial->setBaseColorTexture(textures[0]);
+        if (textures[1]) pMaterial->setSpecularTexture(textures[1]);
+        if (textures[2]) pMaterial->setEmissiveTexture(textures[2]);
+        if (textures[3]) pMaterial->setNormalMap(textures[3]);
+        if (textures[4]) pMaterial->setOcclusionMap(textures[4]);
+        if (textures[5]) pMaterial->setLightMap(textures[5]);
+        if (textures[6]) pMaterial->setHeightMap(textures[6]);
+    }
+
+    static uint64_t hashBytes(const void* pData, size_t size, uint64_t hash)
+    {
+        // 64-bit multiply-xorshift over 8-byte words. Only used to detect changes, not for security.
+        const uint64_t kMul = 0x9E3779B97F4A7C15ull;
+        const uint8_t* pBytes = (const uint8_t*)pData;
+        size_t wordCount = size / sizeof(uint64_t);
+        for (size_t i = 0; i < wordCount; i++)
+        {
+            uint64_t word;
+            std::memcpy(&word, pBytes + i * sizeof(uint64_t), sizeof(uint64_t));
+            hash = (hash ^ word) * kMul;
+            hash ^= hash >> 29;
+        }
+
+        for (size_t i = wordCount * sizeof(uint64_t); i < size; i++)
+        {
+            hash = (hash ^ pBytes[i]) * kMul;
+            hash ^= hash >> 29;
+        }
+        return hash ^ size;
+    }
+
+    static bool hashSources(const std::vector<std::string>& sources, Model::LoadFlags modelLoadFlags, Scene::LoadFlags sceneLoadFlags, uint64_t& hash)
+    {
+        // The baked-scene flags themselves don't change the content
+        sceneLoadFlags = sceneLoadFlags & ~(Scene::LoadFlags::DontUseBakedScene | Scene::LoadFlags::WriteBakedScene);
+
+        hash = 0xCBF29CE484222325ull;
+        uint32_t header[] = { BakedScene::kVersion, (uint32_t)modelLoadFlags, (uint32_t)sceneLoadFlags };
+        hash = hashBytes(header, sizeof(header), hash);
+
+        for (const auto& source : sources)
+        {
+            hash = hashBytes(source.data(), source.size(), hash);
+            auto pFile = MemoryMappedFile::create(source);
+            if (pFile == nullptr)
+            {
+                return false;
+            }
+            hash = hashBytes(pFile->getData(), pFile->getSize(), hash);
+        }
+        return true;
+    }
+
+    static bool findSourceFile(const std::string& filename, std::string& fullpath)
+    {
+        if (filename.empty()) return false;
+        if (doesFileExist(filename))
+        {
+            fullpath = filename;
+            return true;
+        }
+        return findFileInDataDirectories(filename, fullpath);
+    }
+
+    static void addSourceFile(const std::string& filename, std::vector<std::string>& sources, std::set<std::string>& added)
+    {
+        std::string fullpath;
+        if (findSourceFile(filename, fullpath) && added.insert(fullpath).second)
+        {
+            sources.push_back(fullpath);
+        }
+    }
+
+    static void addSceneFileWithIncludes(const std::string& fullpath, std::vector<std::string>& sources, std::set<std::string>& added)
+    {
+        if (added.insert(fullpath).second == false) return;
+        sources.push_back(fullpath);
+
+        // Includes are merged into the scene when it's loaded, so they can't be recovered from the scene itself
+        rapidjson::Document doc;
+        std::string jsonData = readFile(fullpath);
+        doc.Parse(jsonData.c_str());
+        if (doc.HasParseError() || doc.IsObject() == false || doc.HasMember(SceneKeys::kInclude) == false) return;
+
+        const auto& includes = doc[SceneKeys::kInclude];
+        if (includes.IsArray() == false) return;
+
+        const std::string directory = getDirectoryFromFile(fullpath);
+        for (uint32_t i = 0; i < includes.Size(); i++)
+        {
+            if (includes[i].IsString() == false) continue;
+            std::string includePath = directory + '/' + includes[i].GetString();
+            if (doesFileExist(includePath) || findFileInDataDirectories(includes[i].GetString(), includePath))
+            {
+                addSceneFileWithIncludes(includePath, sources, added);
+            }
+        }
+    }
+
+    static std::vector<std::string> collectSourceFiles(const Scene* pScene)
+    {
+        std::vector<std::string> sources;
+        std::set<std::string> added;
+
+        std::string sceneFullpath;
+        if (findSourceFile(pScene->getFilename(), sceneFullpath))
+        {
+            addSceneFileWithIncludes(sceneFullpath, sources, added);
+        }
+
+        for (uint32_t modelID = 0; modelID < pScene->getModelCount(); modelID++)
+        {
+            const Model* pModel = pScene->getModel(modelID).get();
+            addSourceFile(pModel->getFilename(), sources, added);
+
+            // OBJ materials live in a separate file
+            if (hasSuffix(pModel->getFilename(), ".obj", false))
+            {
+                const std::string& objFile = pModel->getFilename();
+                addSourceFile(objFile.substr(0, objFile.size() - 4) + ".mtl", sources, added);
+            }
+
+            for (uint32_t meshID = 0; meshID < pModel->getMeshCount(); meshID++)
+            {
+                Texture::SharedPtr textures[kMaterialTextureCount];
+                getMaterialTextures(pModel->getMesh(meshID)->getMaterial().get(), textures);
+                for (const auto& pTexture : textures)
+                {
+                    if (pTexture) addSourceFile(pTexture->getSourceFilename(), sources, added);
+                }
+            }
+        }
+
+        if (pScene->getEnvironmentMap())
+        {
+            addSourceFile(pScene->getEnvironmentMap()->getSourceFilename(), sources, added);
+        }
+
+        return sources;
+    }
+
+    static void writeString(BinaryFileStream& stream, const std::string& str)
+    {
+        stream << (uint32_t)str.size();
+        stream.write(str.data(), str.size());
+    }
+
+    static std::string readString(MemoryMappedStream& stream)
+    {
+        uint32_t length = 0;
+        stream >> length;
+        const char* pChars = (const char*)stream.view(length);
+        return pChars ? std::string(pChars, length) : std::string();
+    }
+
+    class BakedScene::Writer
+    {
+    public:
+        Writer(const std::string& filename) : mStream(filename, BinaryFileStream::Mode::Write) {}
+
+        bool write(const Scene::SharedPtr& pScene, const std::vector<std::string>& sources, uint64_t sourceHash)
+        {
+            // Collect the unique resources first, so that everything can be written in dependency order
+            for (uint32_t modelID = 0; modelID < pScene->getModelCount(); modelID++)
+            {
+                if (addModel(pScene->getModel(modelID).get()) == false) return false;
+            }
+            int32_t envMapIndex = pScene->getEnvironmentMap() ? addTexture(pScene->getEnvironmentMap().get()) : kNoIndex;
+            if (pScene->getEnvironmentMap() && envMapIndex == kNoIndex) return false;
+
+            // Header and sources
+            mStream.write(kBakedSceneTag, 8);
+            mStream << BakedScene::kVersion << sourceHash;
+            mStream << (uint32_t)sources.size();
+            for (const auto& s : sources) writeString(mStream, s);
+
+            // Everything which isn't expensive to load is kept in the regular scene description
+            writeString(mStream, SceneExporter::saveSceneToString(pScene));
+
+            mStream << (uint32_t)mTextures.size();
+            for (const Texture* pTexture : mTextures) writeTexture(pTexture);
+            mStream << envMapIndex;
+
+            mStream << (uint32_t)mBuffers.size();
+            for (Buffer* pBuffer : mBuffers) writeBuffer(pBuffer);
+
+            mStream << (uint32_t)mMaterials.size();
+            for (const Material* pMaterial : mMaterials) writeMaterial(pMaterial);
+
+            mStream << pScene->getModelCount();
+            for (uint32_t modelID = 0; modelID < pScene->getModelCount(); modelID++) writeModel(pScene->getModel(modelID).get());
+
+            return mStream.isFail() == false;
+        }
+
+        void remove() { mStream.remove(); }
+
+    private:
+        template<typename T>
+        static int32_t addUnique(T* pObj, std::vector<T*>& vec, std::map<const T*, int32_t>& map)
+        {
+            if (pObj == nullptr) return kNoIndex;
+            auto it = map.find(pObj);
+            if (it != map.end()) return it->second;
+            int32_t index = (int32_t)vec.size();
+            vec.push_back(pObj);
+            map[pObj] = index;
+            return index;
+        }
+
+        int32_t addTexture(const Texture* pTexture)
+        {
+            if (pTexture && (pTexture->getType() != Resource::Type::Texture2D || pTexture->getArraySize() != 1 || pTexture->getSampleCount() != 1))
+            {
+                logWarning("BakedScene: Texture " + pTexture->getSourceFilename() + " is not a single-slice 2D texture and can't be baked");
+                return kNoIndex;
+            }
+            return addUnique(pTexture, mTextures, mTextureMap);
+        }
+
+        bool addModel(const Model* pModel)
+        {
+            if (pModel->hasBones() || pModel->hasAnimations())
+            {
+                logWarning("BakedScene: Model " + pModel->getName() + " is animated and can't be baked");
+                return false;
+            }
+
+            for (uint32_t meshID = 0; meshID < pModel->getMeshCount(); meshID++)
+            {
+                const Mesh* pMesh = pModel->getMesh(meshID).get();
+                const Material* pMaterial = pMesh->getMaterial().get();
+                if (mMaterialMap.find(pMaterial) == mMaterialMap.end())
+                {
+                    Texture::SharedPtr textures[kMaterialTextureCount];
+                    getMaterialTextures(pMaterial, textures);
+                    for (const auto& pTexture : textures)
+                    {
+                        if (pTexture && addTexture(pTexture.get()) == kNoIndex) return false;
+                    }
+                    addUnique(pMaterial, mMaterials, mMaterialMap);
+                }
+
+                const Vao* pVao = pMesh->getVao().get();
+                for (uint32_t i = 0; i < pVao->getVertexBuffersCount(); i++)
+                {
+                    addUnique(pVao->getVertexBuffer(i).get(), mBuffers, mBufferMap);
+                }
+                addUnique(pVao->getIndexBuffer().get(), mBuffers, mBufferMap);
+            }
+            return true;
+        }
+
+        void writeTexture(const Texture* pTexture)
+        {
+            std::vector<uint8_t> data;
+            for (uint32_t mip = 0; mip < pTexture->getMipCount(); mip++)
+            {
+                std::vector<uint8_t> mipData = gpDevice->getRenderContext()->readTextureSubresource(pTexture, pTexture->getSubresourceIndex(0, mip));
+                data.insert(data.end(), mipData.begin(), mipData.end());
+            }
+
+            writeString(mStream, pTexture->getSourceFilename());
+            mStream << pTexture->getWidth() << pTexture->getHeight() << pTexture->getMipCount() << (uint32_t)pTexture->getFormat() << (uint32_t)pTexture->getBindFlags();
+            mStream << (uint64_t)data.size();
+            mStream.write(data.data(), data.size());
+        }
+
+        void writeBuffer(Buffer* pBuffer)
+        {
+            mStream << (uint32_t)pBuffer->getBindFlags() << (uint64_t)pBuffer->getSize();
+
+            // Mapping a GPU buffer would keep a staging copy alive for as long as the buffer, read it back through a temporary one instead
+            Buffer::SharedPtr pReadback = Buffer::create(pBuffer->getSize(), Resource::BindFlags::None, Buffer::CpuAccess::Read, nullptr);
+            RenderContext* pContext = gpDevice->getRenderContext();
+            pContext->copyBufferRegion(pReadback.get(), 0, pBuffer, 0, pBuffer->getSize());
+            pContext->flush(true);
+
+            const void* pData = pReadback->map(Buffer::MapType::Read);
+            mStream.write(pData, pBuffer->getSize());
+            pReadback->unmap();
+        }
+
+        void writeMaterial(const Material* pMaterial)
+        {
+            writeString(mStream, pMaterial->getName());
+            mStream << pMaterial->getBaseColor() << pMaterial->getSpecularParams() << pMaterial->getEmissiveColor();
+            mStream << pMaterial->getShadingModel() << pMaterial->getAlphaMode() << (uint32_t)pMaterial->isDoubleSided();
+            mStream << pMaterial->getAlphaThreshold() << pMaterial->getIndexOfRefraction() << pMaterial->getHeightScale() << pMaterial->getHeightOffset();
+
+            Texture::SharedPtr textures[kMaterialTextureCount];
+            getMaterialTextures(pMaterial, textures);
+            for (const auto& pTexture : textures)
+            {
+                mStream << (pTexture ? mTextureMap.at(pTexture.get()) : kNoIndex);
+            }
+        }
+
+        int32_t getBufferIndex(const Buffer* pBuffer) const
+        {
+            return pBuffer ? mBufferMap.at(pBuffer) : kNoIndex;
+        }
+
+        void writeModel(const Model* pModel)
+        {
+            writeString(mStream, pModel->getName());
+            writeString(mStream, pModel->getFilename());
+            mStream << pModel->getMeshCount();
+
+            for (uint32_t meshID = 0; meshID < pModel->getMeshCount(); meshID++)
+            {
+                const Mesh* pMesh = pModel->getMesh(meshID).get();
+                const Vao* pVao = pMesh->getVao().get();
+                mStream << pMesh->getVertexCount() << pMesh->getIndexCount() << (uint32_t)pVao->getPrimitiveTopology();
+                mStream << mMaterialMap.at(pMesh->getMaterial().get());
+                mStream << pMesh->getBoundingBox().center << pMesh->getBoundingBox().extent;
+                mStream << getBufferIndex(pVao->getIndexBuffer().get());
+                mStream << (uint32_t)pVao->getIndexBufferFormat() << (uint32_t)pMesh->hasQuantizedPositions();
+                mStream << pMesh->getPositionQuantizationBox().center << pMesh->getPositionQuantizationBox().extent;
+                const auto& meshlets = pMesh->getMeshlets();
+                mStream << (uint32_t)meshlets.size();
+                mStream.write(meshlets.data(), meshlets.size() * sizeof(MeshletData));
+
+                const VertexLayout* pLayout = pVao->getVertexLayout().get();
+                mStream << (uint32_t)pLayout->getBufferCount();
+                for (uint32_t i = 0; i < (uint32_t)pLayout->getBufferCount(); i++)
+                {
+                    const VertexBufferLayout* pBufferLayout = pLayout->getBufferLayout(i).get();
+                    if (pBufferLayout == nullptr || i >= pVao->getVertexBuffersCount())
+                    {
+                        mStream << kNoIndex;
+                        continue;
+                    }
+
+                    mStream << getBufferIndex(pVao->getVertexBuffer(i).get());
+                    mStream << (uint32_t)pBufferLayout->getInputClass() << pBufferLayout->getInstanceStepRate() << pBufferLayout->getElementCount();
+                    for (uint32_t e = 0; e < pBufferLayout->getElementCount(); e++)
+                    {
+                        writeString(mStream, pBufferLayout->getElementName(e));
+                        mStream << pBufferLayout->getElementOffset(e) << (uint32_t)pBufferLayout->getElementFormat(e) << pBufferLayout->getElementArraySize(e) << pBufferLayout->getElementShaderLocation(e);
+                    }
+                }
+
+                mStream << pModel->getMeshInstanceCount(meshID);
+                for (uint32_t i = 0; i < pModel->getMeshInstanceCount(meshID); i++)
+                {
+                    mStream << pModel->getMeshInstance(meshID, i)->getTransformMatrix();
+                }
+            }
+        }
+
+        BinaryFileStream mStream;
+        std::vector<const Texture*> mTextures;
+        std::map<const Texture*, int32_t> mTextureMap;
+        std::vector<Buffer*> mBuffers;
+        std::map<const Buffer*, int32_t> mBufferMap;
+        std::vector<const Material*> mMaterials;
+        std::map<const Material*, int32_t> mMaterialMap;
+    };
+
+    class BakedScene::Reader
+    {
+    public:
+        Reader(const std::string& filename) : mStream(filename), mFilename(filename) {}
+
+        bool read(Scene& scene, Model::LoadFlags modelLoadFlags, Scene::LoadFlags sceneLoadFlags)
+        {
+            if (mStream.isOpen() == false) return false;
+
+            char tag[8];
+            uint32_t version = 0;
+            uint64_t bakedHash = 0;
+            mStream.read(tag, 8);
+            mStream >> version >> bakedHash;
+            if (std::memcmp(tag, kBakedSceneTag, 8) != 0 || version != BakedScene::kVersion)
+            {
+                logInfo("BakedScene: " + mFilename + " was created by a different version and is ignored");
+                return false;
+            }
+
+            uint32_t sourceCount = 0;
+            mStream >> sourceCount;
+            std::vector<std::string> sources;
+            for (uint32_t i = 0; i < sourceCount && mStream.isGood(); i++) sources.push_back(readString(mStream));
+
+            uint64_t sourceHash;
+            if (hashSources(sources, modelLoadFlags, sceneLoadFlags, sourceHash) == false || sourceHash != bakedHash)
+            {
+                logInfo("BakedScene: " + mFilename + " is out of date and is ignored");
+                return false;
+            }
+
+            std::string description = readString(mStream);
+            if (readTextures() == false) return error();
+
+            int32_t envMapIndex;
+            mStream >> envMapIndex;
+            if (readBuffers() == false || readMaterials() == false) return error();
+
+            std::vector<Model::SharedPtr> models;
+            if (readModels(models) == false) return error();
+
+            if (SceneImporter::loadSceneFromString(scene, description, mFilename, models, modelLoadFlags, sceneLoadFlags) == false) return false;
+            if (envMapIndex != kNoIndex)
+            {
+                if (envMapIndex >= (int32_t)mTextures.size()) return error();
+                scene.setEnvironmentMap(mTextures[envMapIndex]);
+            }
+            return true;
+        }
+
+    private:
+        bool error()
+        {
+            logWarning("BakedScene: " + mFilename + " is corrupted and will be rebuilt");
+            return false;
+        }
+
+        template<typename T>
+        static bool getIndexed(const std::vector<T>& vec, int32_t index, T& result)
+        {
+            if (index == kNoIndex)
+            {
+                result = nullptr;
+                return true;
+            }
+            if (index < 0 || index >= (int32_t)vec.size()) return false;
+            result = vec[index];
+            return true;
+        }
+
+        bool readTextures()
+        {
+            uint32_t count = 0;
+            mStream >> count;
+            for (uint32_t i = 0; i < count && mStream.isGood(); i++)
+            {
+                std::string source = readString(mStream);
+                uint32_t width, height, mipCount, format, bindFlags;
+                uint64_t size;
+                mStream >> width >> height >> mipCount >> format >> bindFlags >> size;
+                const uint8_t* pData = mStream.view(size);
+                if (pData == nullptr) return false;
+
+                auto pTexture = Texture::create2D(width, height, ResourceFormat(format), 1, mipCount, pData, Resource::BindFlags(bindFlags));
+                if (pTexture == nullptr) return false;
+                pTexture->setSourceFilename(source);
+                mTextures.push_back(pTexture);
+
+                // Flush every few textures so we don't accumulate a ton of memory on the upload heap
+                if ((i % 16) == 15) gpDevice->flushAndSync();
+            }
+            return mStream.isGood();
+        }
+
+        bool readBuffers()
+        {
+            uint32_t count = 0;
+            mStream >> count;
+            for (uint32_t i = 0; i < count && mStream.isGood(); i++)
+            {
+                uint32_t bindFlags;
+                uint64_t size;
+                mStream >> bindFlags >> size;
+                const uint8_t* pData = mStream.view(size);
+                if (pData == nullptr) return false;
+                mBuffers.push_back(Buffer::create(size, Resource::BindFlags(bindFlags), Buffer::CpuAccess::None, pData));
+            }
+            return mStream.isGood();
+        }
+
+        bool readMaterials()
+        {
+            uint32_t count = 0;
+            mStream >> count;
+            for (uint32_t i = 0; i < count && mStream.isGood(); i++)
+            {
+                Material::SharedPtr pMaterial = Material::create(readString(mStream));
+                glm::vec4 baseColor, specular;
+                glm::vec3 emissive;
+                uint32_t shadingModel, alphaMode, doubleSided;
+                float alphaThreshold, IoR, heightScale, heightOffset;
+                mStream >> baseColor >> specular >> emissive >> shadingModel >> alphaMode >> doubleSided >> alphaThreshold >> IoR >> heightScale >> heightOffset;
+
+                Texture::SharedPtr textures[kMaterialTextureCount];
+                for (uint32_t t = 0; t < kMaterialTextureCount; t++)
+                {
+                    int32_t index;
+                    mStream >> index;
+                    if (getIndexed(mTextures, index, textures[t]) == false) return false;
+                }
+
+                // The shading model and textures must be set first, the texture setters update the rest of the flags
+                pMaterial->setShadingModel(shadingModel);
+                setMaterialTextures(pMaterial.get(), textures);
+                pMaterial->setBaseColor(baseColor);
+                pMaterial->setSpecularParams(specular);
+                pMaterial->setEmissiveColor(emissive);
+                pMaterial->setAlphaMode(alphaMode);
+                pMaterial->setDoubleSided(doubleSided != 0);
+                pMaterial->setAlphaThreshold(alphaThreshold);
+                pMaterial->setIndexOfRefraction(IoR);
+                pMaterial->setHeightScaleOffset(heightScale, heightOffset);
+                mMaterials.push_back(pMaterial);
+            }
+            return mStream.isGood();
+        }
+
+        bool readVertexLayout(VertexLayout::SharedPtr& pLayout, Vao::BufferVec& vertexBuffers)
+        {
+            uint32_t bufferCount = 0;
+            mStream >> bufferCount;
+            pLayout = VertexLayout::create();
+            vertexBuffers.resize(bufferCount);
+            for (uint32_t i = 0; i < bufferCount && mStream.isGood(); i++)
+            {
+                int32_t bufferIndex;
+                mStream >> bufferIndex;
+                if (bufferIndex == kNoIndex) continue;
+                if (getIndexed(mBuffers, bufferIndex, vertexBuffers[i]) == false) return false;
+
+                uint32_t inputClass, stepRate, elementCount;
+                mStream >> inputClass >> stepRate >> elementCount;
+                auto pBufferLayout = VertexBufferLayout::create();
+                pBufferLayout->setInputClass(VertexBufferLayout::InputClass(inputClass), stepRate);
+                for (uint32_t e = 0; e < elementCount && mStream.isGood(); e++)
+                {
+                    std::string name = readString(mStream);
+                    uint32_t offset, format, arraySize, shaderLocation;
+                    mStream >> offset >> format >> arraySize >> shaderLocation;
+                    pBufferLayout->addElement(name, offset, ResourceFormat(format), arraySize, shaderLocation);
+                }
+                pLayout->addBufferLayout(i, pBufferLayout);
+            }
+            return mStream.isGood();
+        }
+
+        bool readModels(std::vector<Model::SharedPtr>& models)
+        {
+            uint32_t count = 0;
+            mStream >> count;
+            for (uint32_t i = 0; i < count && mStream.isGood(); i++)
+            {
+                Model::SharedPtr pModel = Model::create();
+                pModel->setName(readString(mStream));
+                pModel->setFilename(readString(mStream));
+
+                uint32_t meshCount = 0;
+                mStream >> meshCount;
+                for (uint32_t m = 0; m < meshCount && mStream.isGood(); m++)
+                {
+                    uint32_t vertexCount, indexCount, topology, indexFormat, quantizedPositions;
+                    int32_t materialIndex, indexBufferIndex;
+                    BoundingBox box, quantizationBox;
+                    mStream >> vertexCount >> indexCount >> topology >> materialIndex >> box.center >> box.extent >> indexBufferIndex;
+                    mStream >> indexFormat >> quantizedPositions >> quantizationBox.center >> quantizationBox.extent;
+
+                    uint32_t meshletCount = 0;
+                    mStream >> meshletCount;
+                    const uint8_t* pMeshletData = mStream.view(meshletCount * sizeof(MeshletData));
+                    if (pMeshletData == nullptr) return false;
+                    std::vector<MeshletData> meshlets(meshletCount);
+                    std::memcpy(meshlets.data(), pMeshletData, meshletCount * sizeof(MeshletData));
+
+                    Material::SharedPtr pMaterial;
+                    Buffer::SharedPtr pIB;
+                    VertexLayout::SharedPtr pLayout;
+                    Vao::BufferVec vertexBuffers;
+                    if (getIndexed(mMaterials, materialIndex, pMaterial) == false || getIndexed(mBuffers, indexBufferIndex, pIB) == false) return false;
+                    if (readVertexLayout(pLayout, vertexBuffers) == false) return false;
+
+                    auto pMesh = Mesh::create(vertexBuffers, vertexCount, pIB, indexCount, pLayout, Vao::Topology(topology), pMaterial, box, false, ResourceFormat(indexFormat));
+                    if (quantizedPositions) pMesh->setPositionQuantizationBox(quantizationBox);
+                    pMesh->setMeshlets(std::move(meshlets));
+
+                    uint32_t instanceCount = 0;
+                    mStream >> instanceCount;
+                    for (uint32_t inst = 0; inst < instanceCount && mStream.isGood(); inst++)
+                    {
+                        glm::mat4 transform;
+                        mStream >> transform;
+                        pModel->addMeshInstance(pMesh, transform);
+                    }
+                }
+
+                if (mStream.isGood() == false) return false;
+                pModel->calculateModelProperties();
+                models.push_back(pModel);
+            }
+            return mStream.isGood();
+        }
+
+        MemoryMappedStream mStream;
+        std::string mFilename;
+        std::vector<Texture::SharedPtr> mTextures;
+        std::vector<Buffer::SharedPtr> mBuffers;
+        std::vector<Material::SharedPtr> mMaterials;
+    };
+
+    std::string BakedScene::getBakedFilename(const std::string& sceneFullpath)
+    {
+        return sceneFullpath + ".baked";
+    }
+
+    bool BakedScene::save(const std::string& filename, const Scene::SharedPtr& pScene, Model::LoadFlags modelLoadFlags, Scene::LoadFlags sceneLoadFlags)
+    {
+        if (pScene->getLightProbeCount() > 0)
+        {
+            logWarning("BakedScene: Scenes with light probes can't be baked");
+            return false;
+        }
+
+        auto startTime = CpuTimer::getCurrentTimePoint();
+        std::vector<std::string> sources = collectSourceFiles(pScene.get());
+        uint64_t sourceHash;
+        if (hashSources(sources, modelLoadFlags, sceneLoadFlags, sourceHash) == false)
+        {
+            return false;
+        }
+
+        Writer writer(filename);
+        if (writer.write(pScene, sources, sourceHash) == false)
+        {
+            logWarning("BakedScene: Can't bake scene to " + filename);
+            writer.remove();
+            return false;
+        }
+
+        logInfo("BakedScene: Baked " + filename + " in " + std::to_string(CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint())) + " ms");
+        return true;
+    }
+
+    bool BakedScene::load(Scene& scene, const std::string& filename, Model::LoadFlags modelLoadFlags, Scene::LoadFlags sceneLoadFlags)
+    {
+        auto startTime = CpuTimer::getCurrentTimePoint();
+        Reader reader(filename);
+        if (reader.read(scene, modelLoadFlags, sceneLoadFlags) == false)
+        {
+            return false;
+        }
+
+        logInfo("BakedScene: Loaded " + filename + " in " + std::to_string(CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint())) + " ms");
+        return true;
+    }
+}
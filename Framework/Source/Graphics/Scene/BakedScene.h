@@ -0,0 +1,74 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <string>
+#include "Scene.h"
+
+namespace Falcor
+{
+    /** Single-file container holding a fully loaded scene.
+        Baking stores the final vertex and index buffers, materials, textures including their mip chains, and the scene description
+        (lights, cameras, paths, instances). Loading maps the file and uploads the payloads directly, skipping model import, tangent
+        generation, texture decoding and mip generation.
+        The container records a content hash of every source file the scene was created from. It is only used while the hash matches.
+    */
+    class BakedScene
+    {
+    public:
+        static const uint32_t kVersion = 3;
+
+        /** Get the name of the baked container matching a scene file
+            \param[in] sceneFullpath Full path of the scene file
+        */
+        static std::string getBakedFilename(const std::string& sceneFullpath);
+
+        /** Bake a loaded scene.
+            Scenes with skinned or animated models, light probes or texture types other than single-slice 2D textures can't be baked.
+            \param[in] filename Output filename
+            \param[in] pScene The scene to bake. Its source files are collected from the scene filename, the model files and the texture files.
+            \param[in] modelLoadFlags Flags the scene was loaded with
+            \param[in] sceneLoadFlags Flags the scene was loaded with
+            \return true if the scene was baked, otherwise false
+        */
+        static bool save(const std::string& filename, const Scene::SharedPtr& pScene, Model::LoadFlags modelLoadFlags, Scene::LoadFlags sceneLoadFlags);
+
+        /** Load a baked scene.
+            \param[in] scene An empty scene to load into
+            \param[in] filename The baked container
+            \param[in] modelLoadFlags Flags to load the scene with. Must match the flags the scene was baked with.
+            \param[in] sceneLoadFlags Flags to load the scene with. Must match the flags the scene was baked with.
+            \return false if the file doesn't exist, is out of date or corrupted. The scene should be discarded in that case.
+        */
+        static bool load(Scene& scene, const std::string& filename, Model::LoadFlags modelLoadFlags, Scene::LoadFlags sceneLoadFlags);
+
+    private:
+        BakedScene() = delete;
+        class Reader;
+        class Writer;
+    };
+}
@@ -28,6 +28,7 @@
 #include "Framework.h"
 #include "Scene.h"
 #include "SceneImporter.h"
+#include "BakedScene.h"
 #include "glm/gtx/euler_angles.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 #include "Utils/Gui.h"
@@ -43,10 +44,29 @@ namespace Falcor
 
     Scene::SharedPtr Scene::loadFromFile(const std::string& filename, Model::LoadFlags modelLoadFlags, Scene::LoadFlags sceneLoadFlags)
     {
+        // Use the baked scene if it's up to date with the source files
+        std::string bakedFilename;
+        std::string fullpath;
+        if (is_set(sceneLoadFlags, LoadFlags::DontUseBakedScene) == false && findFileInDataDirectories(filename, fullpath))
+        {
+            bakedFilename = BakedScene::getBakedFilename(fullpath);
+            Scene::SharedPtr pScene = create(filename);
+            if (BakedScene::load(*pScene, bakedFilename, modelLoadFlags, sceneLoadFlags))
+            {
+                return pScene;
+            }
+        }
+
         Scene::SharedPtr pScene = create(filename);
         if (SceneImporter::loadScene(*pScene, filename, modelLoadFlags, sceneLoadFlags) == false)
         {
-            pScene = nullptr;
+            return nullptr;
+        }
+
+        // Bake the scene so the next load is fast. Failing to bake isn't an error, the scene just loads from the sources next time.
+        if (is_set(sceneLoadFlags, LoadFlags::WriteBakedScene) && bakedFilename.empty() == false)
+        {
+            BakedScene::save(bakedFilename, pScene, modelLoadFlags, sceneLoadFlags);
         }
         return pScene;
     }
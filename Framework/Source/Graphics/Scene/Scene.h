@@ -102,6 +102,8 @@ namespace Falcor
         {
             None = 0x0,
             GenerateAreaLights = 0x1,    ///< Create area light(s) for meshes that have emissive material
+            DontUseBakedScene = 0x2,     ///< Always load from the source files. Otherwise an up-to-date baked scene is used when available.
+            WriteBakedScene = 0x4,       ///< Bake the scene next to the source file when there is no up-to-date baked scene. Baked scenes hold the decoded textures and can be large.
         };
 
         static Scene::SharedPtr loadFromFile(const std::string& filename, Model::LoadFlags modelLoadFlags = Model::LoadFlags::None, Scene::LoadFlags sceneLoadFlags = LoadFlags::None);
@@ -289,6 +291,8 @@ namespace Falcor
         {
             flag_str(None);
             flag_str(GenerateAreaLights);
+            flag_str(DontUseBakedScene);
+            flag_str(WriteBakedScene);
         default:
             should_not_get_here();
             return "";
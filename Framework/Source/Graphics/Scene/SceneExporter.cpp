@@ -49,6 +49,12 @@ namespace Falcor
         return exporter.save(exportOptions);
     }
 
+    std::string SceneExporter::saveSceneToString(const Scene::SharedPtr& pScene, uint32_t exportOptions)
+    {
+        SceneExporter exporter("", pScene);
+        return exporter.serialize(exportOptions);
+    }
+
     template<typename T>
     void addLiteral(rapidjson::Value& jval, rapidjson::Document::AllocatorType& jallocator, const std::string& key, const T& value)
     {
@@ -103,6 +109,23 @@ namespace Falcor
     }
 
     bool SceneExporter::save(uint32_t exportOptions)
+    {
+        std::string str = serialize(exportOptions);
+
+        // Output the file
+        std::ofstream outputStream(mFilename.c_str());
+        if (outputStream.fail())
+        {
+            logError("Can't open output scene file " + mFilename + ".\nExporting failed.");
+            return false;
+        }
+        outputStream << str;
+        outputStream.close();
+
+        return true;
+    }
+
+    std::string SceneExporter::serialize(uint32_t exportOptions)
     {
         mExportOptions = exportOptions;
 
@@ -128,19 +151,7 @@ namespace Falcor
         rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
         writer.SetIndent(' ', 4);
         mJDoc.Accept(writer);
-        std::string str(buffer.GetString(), buffer.GetSize());
-
-        // Output the file
-        std::ofstream outputStream(mFilename.c_str());
-        if (outputStream.fail())
-        {
-            logError("Can't open output scene file " + mFilename + ".\nExporting failed.");
-            return false;
-        }
-        outputStream << str;
-        outputStream.close();
-
-        return true;
+        return std::string(buffer.GetString(), buffer.GetSize());
     }
 
     void SceneExporter::writeGlobalSettings(bool writeActivePath)
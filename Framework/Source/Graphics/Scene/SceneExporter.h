@@ -55,6 +55,10 @@ namespace Falcor
 
         static bool saveScene(const std::string& filename, const Scene::SharedPtr& pScene, uint32_t exportOptions = ExportAll);
 
+        /** Serialize the scene description into a JSON string, using the same layout as saveScene()
+        */
+        static std::string saveSceneToString(const Scene::SharedPtr& pScene, uint32_t exportOptions = ExportAll);
+
         static const uint32_t kVersion = 2;
 
     private:
@@ -63,6 +67,7 @@ namespace Falcor
             : mpScene(pScene), mFilename(filename) {}
 
         bool save(uint32_t exportOptions);
+        std::string serialize(uint32_t exportOptions);
 
         void writeModels();
         void writeLights();
@@ -105,6 +105,14 @@ namespace Falcor
         return importer.load(filename, modelLoadFlags, sceneLoadFlags);
     }
 
+    bool SceneImporter::loadSceneFromString(Scene& scene, const std::string& jsonData, const std::string& name, const std::vector<Model::SharedPtr>& models, Model::LoadFlags modelLoadFlags, Scene::LoadFlags sceneLoadFlags)
+    {
+        SceneImporter importer(scene);
+        importer.mFilename = name;
+        importer.mpPreloadedModels = &models;
+        return importer.parse(jsonData, modelLoadFlags, sceneLoadFlags);
+    }
+
     bool SceneImporter::createModelInstances(const rapidjson::Value& jsonVal, const Model::SharedPtr& pModel)
     {
         if (jsonVal.IsArray() == false)
@@ -227,7 +235,20 @@ namespace Falcor
         }
 
         // Load the model
-        auto pModel = Model::createFromFile(file.c_str(), modelFlags);
+        Model::SharedPtr pModel;
+        if (mpPreloadedModels)
+        {
+            if (mNextPreloadedModel >= mpPreloadedModels->size())
+            {
+                return error("Model " + file + " wasn't preloaded");
+            }
+            pModel = (*mpPreloadedModels)[mNextPreloadedModel++];
+        }
+        else
+        {
+            pModel = Model::createFromFile(file.c_str(), modelFlags);
+        }
+
         if (pModel == nullptr)
         {
             return error("Could not load model: " + file);
@@ -994,50 +1015,57 @@ namespace Falcor
     {
         std::string fullpath;
         mFilename = filename;
-        mModelLoadFlags = modelLoadFlags;
-        mSceneLoadFlags = sceneLoadFlags;
-
-        if (is_set(mSceneLoadFlags, Scene::LoadFlags::GenerateAreaLights))
-        {
-            mModelLoadFlags |= Model::LoadFlags::BuffersAsShaderResource;
-        }
 
         if (findFileInDataDirectories(filename, fullpath))
         {
             // Load the file
             std::string jsonData = readFile(fullpath);
-            rapidjson::StringStream JStream(jsonData.c_str());
 
             // Get the file directory
             auto last = fullpath.find_last_of("/\\");
             mDirectory = fullpath.substr(0, last);
 
-            // create the DOM
-            mJDoc.ParseStream(JStream);
+            return parse(jsonData, modelLoadFlags, sceneLoadFlags);
+        }
+        else
+        {
+            return error("File not found.");
+        }
+    }
 
-            if (mJDoc.HasParseError())
-            {
-                size_t line;
-                line = std::count(jsonData.begin(), jsonData.begin() + mJDoc.GetErrorOffset(), '\n');
-                return error(std::string("JSON Parse error in line ") + std::to_string(line) + ". " + rapidjson::GetParseError_En(mJDoc.GetParseError()));
-            }
+    bool SceneImporter::parse(const std::string& jsonData, Model::LoadFlags modelLoadFlags, Scene::LoadFlags sceneLoadFlags)
+    {
+        mModelLoadFlags = modelLoadFlags;
+        mSceneLoadFlags = sceneLoadFlags;
 
-            if (topLevelLoop() == false)
-            {
-                return false;
-            }
+        if (is_set(mSceneLoadFlags, Scene::LoadFlags::GenerateAreaLights))
+        {
+            mModelLoadFlags |= Model::LoadFlags::BuffersAsShaderResource;
+        }
 
-            if (is_set(mSceneLoadFlags, Scene::LoadFlags::GenerateAreaLights))
-            {
-                mScene.createAreaLights();
-            }
+        rapidjson::StringStream JStream(jsonData.c_str());
 
-            return true;
+        // create the DOM
+        mJDoc.ParseStream(JStream);
+
+        if (mJDoc.HasParseError())
+        {
+            size_t line;
+            line = std::count(jsonData.begin(), jsonData.begin() + mJDoc.GetErrorOffset(), '\n');
+            return error(std::string("JSON Parse error in line ") + std::to_string(line) + ". " + rapidjson::GetParseError_En(mJDoc.GetParseError()));
         }
-        else
+
+        if (topLevelLoop() == false)
         {
-            return error("File not found.");
+            return false;
         }
+
+        if (is_set(mSceneLoadFlags, Scene::LoadFlags::GenerateAreaLights))
+        {
+            mScene.createAreaLights();
+        }
+
+        return true;
     }
 
     bool SceneImporter::parseAmbientIntensity(const rapidjson::Value& jsonVal)
@@ -41,10 +41,18 @@ namespace Falcor
     public:
         static bool loadScene(Scene& scene, const std::string& filename, Model::LoadFlags modelLoadFlags, Scene::LoadFlags sceneLoadFlags);
 
+        /** Load a scene from a JSON string, using already created models instead of loading the model files.
+            \param[in] jsonData The scene description
+            \param[in] name Name used in error messages
+            \param[in] models Models to use, in the order they appear in the scene description
+        */
+        static bool loadSceneFromString(Scene& scene, const std::string& jsonData, const std::string& name, const std::vector<Model::SharedPtr>& models, Model::LoadFlags modelLoadFlags, Scene::LoadFlags sceneLoadFlags);
+
     private:
 
         SceneImporter(Scene& scene) : mScene(scene) {}
         bool load(const std::string& filename, Model::LoadFlags modelLoadFlags, Scene::LoadFlags sceneLoadFlags);
+        bool parse(const std::string& jsonData, Model::LoadFlags modelLoadFlags, Scene::LoadFlags sceneLoadFlags);
 
         bool parseVersion(const rapidjson::Value& jsonVal);
         bool parseSceneUnit(const rapidjson::Value& jsonVal);
@@ -86,6 +94,8 @@ namespace Falcor
         std::string mDirectory;
         Model::LoadFlags mModelLoadFlags;
         Scene::LoadFlags mSceneLoadFlags;
+        const std::vector<Model::SharedPtr>* mpPreloadedModels = nullptr;
+        uint32_t mNextPreloadedModel = 0;
 
         using ObjectMap = std::map<std::string, IMovableObject::SharedPtr>;
         bool isNameDuplicate(const std::string& name, const ObjectMap& objectMap, const std::string& objectType) const;
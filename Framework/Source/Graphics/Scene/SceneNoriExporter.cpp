@@ -29,6 +29,7 @@
 #include "SceneNoriExporter.h"
 #include <fstream>
 #include "Utils/Platform/OS.h"
+#include "Graphics/Model/VertexCompression.h"
 #include "Graphics/Scene/Editor/SceneEditor.h"
 
 #define SCENE_EXPORTER
@@ -578,38 +579,40 @@ namespace Falcor
             for (uint32_t vbIdx = 0; vbIdx < vbCnt; ++vbIdx)
             {
                 Buffer::SharedPtr pVB = pVao->getVertexBuffer(vbIdx);
-                float* pVBData = (float*)pVB->map(Buffer::MapType::Read);
+                const uint8_t* pVBData = (const uint8_t*)pVB->map(Buffer::MapType::Read);
 
+                // The attributes are decoded through VertexCompression, which also handles the compressed vertex layout
                 const VertexBufferLayout* pLayout = pVao->getVertexLayout()->getBufferLayout(vbIdx).get();
                 for (uint32_t elemIdx = 0; elemIdx < pLayout->getElementCount(); ++elemIdx)
                 {
-                    float* pData = reinterpret_cast<float*>((uint8_t*)pVBData + pLayout->getElementOffset(elemIdx));
+                    const uint8_t* pData = pVBData + pLayout->getElementOffset(elemIdx);
+                    const ResourceFormat format = pLayout->getElementFormat(elemIdx);
 
                     if (pLayout->getElementName(elemIdx) == VERTEX_POSITION_NAME)
                     {
-                        assert(pLayout->getElementFormat(elemIdx) == ResourceFormat::RGB32Float);
-                        for (uint32_t vertIdx = 0; vertIdx < vertCnt; ++vertIdx)
+                        glm::vec3 pos;
+                        for (uint32_t vertIdx = 0; vertIdx < vertCnt && VertexCompression::readPosition(pData, format, pMesh->getPositionQuantizationBox(), pos); ++vertIdx)
                         {
-                            fs << "v " << pData[0] << " " << pData[1] << " " << pData[2] << std::endl;
-                            pData = reinterpret_cast<float*>((uint8_t*)pData + pLayout->getStride());
+                            fs << "v " << pos.x << " " << pos.y << " " << pos.z << std::endl;
+                            pData += pLayout->getStride();
                         }
                     }
                     else if (pLayout->getElementName(elemIdx) == VERTEX_NORMAL_NAME)
                     {
-                        assert(pLayout->getElementFormat(elemIdx) == ResourceFormat::RGB32Float);
-                        for (uint32_t vertIdx = 0; vertIdx < vertCnt; ++vertIdx)
+                        glm::vec3 normal;
+                        for (uint32_t vertIdx = 0; vertIdx < vertCnt && VertexCompression::readDirection(pData, format, normal); ++vertIdx)
                         {
-                            fs << "vn " << pData[0] << " " << pData[1] << " " << pData[2] << std::endl;
-                            pData = reinterpret_cast<float*>((uint8_t*)pData + pLayout->getStride());
+                            fs << "vn " << normal.x << " " << normal.y << " " << normal.z << std::endl;
+                            pData += pLayout->getStride();
                         }
                     }
                     else if (pLayout->getElementName(elemIdx) == VERTEX_TEXCOORD_NAME)
                     {
-                        assert(pLayout->getElementFormat(elemIdx) == ResourceFormat::RG32Float);
-                        for (uint32_t vertIdx = 0; vertIdx < vertCnt; ++vertIdx)
+                        glm::vec2 texCrd;
+                        for (uint32_t vertIdx = 0; vertIdx < vertCnt && VertexCompression::readTexCrd(pData, format, texCrd); ++vertIdx)
                         {
-                            fs << "vt " << pData[0] << " " << pData[1] << " " << pData[2] << std::endl;
-                            pData = reinterpret_cast<float*>((uint8_t*)pData + pLayout->getStride());
+                            fs << "vt " << texCrd.x << " " << texCrd.y << std::endl;
+                            pData += pLayout->getStride();
                         }
                     }
                     else
@@ -626,14 +629,16 @@ namespace Falcor
 
             {
                 Buffer::SharedPtr pIB = pVao->getIndexBuffer();
-                assert(pVao->getIndexBufferFormat() == ResourceFormat::R32Uint);
-                uint32_t* pData = (uint32_t*)pIB->map(Buffer::MapType::Read);
+                const bool shortIndices = (pVao->getIndexBufferFormat() == ResourceFormat::R16Uint);
+                assert(shortIndices || pVao->getIndexBufferFormat() == ResourceFormat::R32Uint);
+                const void* pData = pIB->map(Buffer::MapType::Read);
+                auto getIndex = [&](uint32_t i) { return shortIndices ? (uint32_t)((const uint16_t*)pData)[i] : ((const uint32_t*)pData)[i]; };
                 for (uint32_t triangleIdx = 0; triangleIdx < pMesh->getPrimitiveCount(); ++triangleIdx)
                 {
                     fs << "f "
-                        << (pData[3 * triangleIdx + 0] + 1) << " "
-                        << (pData[3 * triangleIdx + 1] + 1) << " "
-                        << (pData[3 * triangleIdx + 2] + 1) << std::endl;
+                        << (getIndex(3 * triangleIdx + 0) + 1) << " "
+                        << (getIndex(3 * triangleIdx + 1) + 1) << " "
+                        << (getIndex(3 * triangleIdx + 2) + 1) << std::endl;
                 }
 
                 pIB->unmap();
@@ -48,6 +48,8 @@ namespace Falcor
     size_t SceneRenderer::sWorldInvTransposeMatOffset = ConstantBuffer::kInvalidOffset;
     size_t SceneRenderer::sMeshIdOffset = ConstantBuffer::kInvalidOffset;
     size_t SceneRenderer::sDrawIDOffset = ConstantBuffer::kInvalidOffset;
+    size_t SceneRenderer::sPositionDequantScaleOffset = ConstantBuffer::kInvalidOffset;
+    size_t SceneRenderer::sPositionDequantOffsetOffset = ConstantBuffer::kInvalidOffset;
     size_t SceneRenderer::sLightCountOffset = ConstantBuffer::kInvalidOffset;
     size_t SceneRenderer::sLightArrayOffset = ConstantBuffer::kInvalidOffset;
 
@@ -91,6 +93,8 @@ namespace Falcor
                 sMeshIdOffset = pType->findMember("gMeshId")->getOffset();
                 sDrawIDOffset = pType->findMember("gDrawId[0]")->getOffset();
                 sPrevWorldMatOffset = pType->findMember("gPrevWorldMat[0]")->getOffset();
+                sPositionDequantScaleOffset = pType->findMember("gPositionDequantScale")->getOffset();
+                sPositionDequantOffsetOffset = pType->findMember("gPositionDequantOffset")->getOffset();
             }
         }
 
@@ -223,6 +227,19 @@ namespace Falcor
 
             // Set mesh id
             pCB->setVariable(sMeshIdOffset, pMesh->getId());
+
+            // Set the position dequantization, the identity transform for meshes with full precision positions
+            if (pMesh->hasQuantizedPositions())
+            {
+                const BoundingBox& box = pMesh->getPositionQuantizationBox();
+                pCB->setVariable(sPositionDequantScaleOffset, box.getSize());
+                pCB->setVariable(sPositionDequantOffsetOffset, box.getMinPos());
+            }
+            else
+            {
+                pCB->setVariable(sPositionDequantScaleOffset, glm::vec3(1));
+                pCB->setVariable(sPositionDequantOffsetOffset, glm::vec3(0));
+            }
         }
 
         return true;
@@ -234,10 +251,10 @@ namespace Falcor
         return true;
     }
 
-    void SceneRenderer::executeDraw(const CurrentWorkingData& currentData, uint32_t indexCount, uint32_t instanceCount)
+    void SceneRenderer::executeDraw(const CurrentWorkingData& currentData, uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex)
     {
         // Draw
-        currentData.pContext->drawIndexedInstanced(indexCount, instanceCount, 0, 0, 0);
+        currentData.pContext->drawIndexedInstanced(indexCount, instanceCount, startIndex, 0, 0);
     }
 
     void SceneRenderer::draw(CurrentWorkingData& currentData, const Mesh* pMesh, uint32_t instanceCount)
@@ -258,7 +275,20 @@ namespace Falcor
             }
         }
 
-        executeDraw(currentData, pMesh->getIndexCount(), instanceCount);
+        // The meshlets are culled once the material's rasterizer state is set
+        if (mMeshletWorldMats.size())
+        {
+            cullMeshlets(currentData, pMesh);
+        }
+        else
+        {
+            mMeshletDrawRanges.assign(1, { 0, pMesh->getIndexCount() });
+        }
+
+        for (const auto& range : mMeshletDrawRanges)
+        {
+            executeDraw(currentData, range.indexCount, instanceCount, range.indexOffset);
+        }
         postFlushDraw(currentData);
         currentData.pState->getProgram()->removeDefine("_MS_STATIC_MATERIAL_FLAGS");
     }
@@ -274,6 +304,24 @@ namespace Falcor
         return currentData.pCamera->isObjectCulled(box);
     }
 
+    void SceneRenderer::cullMeshlets(const CurrentWorkingData& currentData, const Mesh* pMesh)
+    {
+        // The normal cones are only valid if the rasterizer drops the same triangles. A null state means the default one, which culls back faces.
+        const RasterizerState* pRsState = currentData.pState->getRasterizerState().get();
+        bool cullBackFaces = (pRsState == nullptr) || (pRsState->getCullMode() == RasterizerState::CullMode::Back && pRsState->isFrontCounterCW());
+
+        // Draw the meshlets visible from any of the batched instances
+        const std::vector<MeshletData>& meshlets = pMesh->getMeshlets();
+        mMeshletVisibility.assign(meshlets.size(), 0);
+        for (const glm::mat4& worldMat : mMeshletWorldMats)
+        {
+            mMeshletCuller.setView(currentData.pCamera->getViewProjMatrix(), worldMat, cullBackFaces);
+            mMeshletCuller.cull(meshlets, mMeshletVisibility);
+        }
+        mMeshletWorldMats.clear();
+        MeshletCuller::buildDrawRanges(meshlets, mMeshletVisibility, kMaxMeshletDrawRanges, mMeshletDrawRanges);
+    }
+
     void SceneRenderer::renderMeshInstances(CurrentWorkingData& currentData, const Scene::ModelInstance* pModelInstance, uint32_t meshID)
     {
         const Model* pModel = currentData.pModel;
@@ -291,6 +339,10 @@ namespace Falcor
             // Bind VAO and set topology            
             currentData.pState->setVao(useVsSkinning ? pMesh->getVao() : pModel->getMeshVao(pMesh));
 
+            // Skinned meshes move away from the meshlet bounds
+            const bool useMeshletCulling = mMeshletCullEnabled && currentData.pCamera && pMesh->getMeshlets().size() && (pMesh->hasBones() == false);
+            mMeshletWorldMats.clear();
+
             uint32_t activeInstances = 0;
 
             const uint32_t instanceCount = pModel->getMeshInstanceCount(meshID);
@@ -304,6 +356,10 @@ namespace Falcor
                     {
                         if (setPerMeshInstanceData(currentData, pModelInstance, pMeshInstance, activeInstances))
                         {
+                            if (useMeshletCulling)
+                            {
+                                mMeshletWorldMats.push_back(pModelInstance->getTransformMatrix() * pMeshInstance->getTransformMatrix());
+                            }
                             currentData.drawID++;
                             activeInstances++;
 
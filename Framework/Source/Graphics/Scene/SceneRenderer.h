@@ -33,6 +33,7 @@
 #include "Utils/CpuTimer.h"
 #include "API/ConstantBuffer.h"
 #include "Utils/DebugDrawer.h"
+#include "Graphics/Model/Meshlets.h"
 
 namespace Falcor
 {
@@ -81,6 +82,17 @@ namespace Falcor
         */
         bool isMeshCullingEnabled() const { return mCullEnabled; }
 
+        /** Enable/disable meshlet culling. The meshlets of the visible mesh instances are tested against the camera frustum, and against the normal cones when the
+            rasterizer culls back faces. Only the index ranges of the remaining meshlets are drawn. Disabled by default, since the tests use a single view. Only enable it
+            for renderers which draw each renderScene() call from the camera alone, not into several views at once (cube maps, cascades, stereo).
+            Meshes need to be loaded with Model::LoadFlags::GenerateMeshlets.
+        */
+        void toggleMeshletCulling(bool enable) { mMeshletCullEnabled = enable; }
+
+        /** Check if meshlet culling is enabled
+        */
+        bool isMeshletCullingEnabled() const { return mMeshletCullEnabled; }
+
         /** Set the maximal number of mesh instance to dispatch in a single draw call.
         */
         void setMaxInstanceCount(uint32_t instanceCount) { mMaxInstanceCount = instanceCount; }
@@ -135,6 +147,8 @@ namespace Falcor
         static size_t sWorldInvTransposeMatOffset;
         static size_t sMeshIdOffset;
         static size_t sDrawIDOffset;
+        static size_t sPositionDequantScaleOffset;
+        static size_t sPositionDequantOffsetOffset;
 
         static void updateVariableOffsets(const ProgramReflection* pReflector);
 
@@ -144,13 +158,14 @@ namespace Falcor
         virtual bool setPerMeshData(const CurrentWorkingData& currentData, const Mesh* pMesh);
         virtual bool setPerMeshInstanceData(const CurrentWorkingData& currentData, const Scene::ModelInstance* pModelInstance, const Model::MeshInstance* pMeshInstance, uint32_t drawInstanceID);
         virtual bool setPerMaterialData(const CurrentWorkingData& currentData, const Material* pMaterial);
-        virtual void executeDraw(const CurrentWorkingData& currentData, uint32_t indexCount, uint32_t instanceCount);
+        virtual void executeDraw(const CurrentWorkingData& currentData, uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex);
         virtual void postFlushDraw(const CurrentWorkingData& currentData);
         virtual bool cullMeshInstance(const CurrentWorkingData& currentData, const Scene::ModelInstance* pModelInstance, const Model::MeshInstance* pMeshInstance);
 
         void renderModelInstance(CurrentWorkingData& currentData, const Scene::ModelInstance* pModelInstance);
         void renderMeshInstances(CurrentWorkingData& currentData, const Scene::ModelInstance* pModelInstance, uint32_t meshID);
         void draw(CurrentWorkingData& currentData, const Mesh* pMesh, uint32_t instanceCount);
+        void cullMeshlets(const CurrentWorkingData& currentData, const Mesh* pMesh);
 
         void renderScene(CurrentWorkingData& currentData);
 
@@ -160,6 +175,14 @@ namespace Falcor
         uint32_t mMaxInstanceCount = 64;
         const Material* mpLastMaterial = nullptr;
         bool mCullEnabled = true;
+        bool mMeshletCullEnabled = false;
         bool mCompileMaterialWithProgram = true;
+
+        // World matrices of the instances batched in the next draw. Empty when the current mesh isn't culled per meshlet.
+        static const uint32_t kMaxMeshletDrawRanges = 16;
+        std::vector<glm::mat4> mMeshletWorldMats;
+        std::vector<uint8_t> mMeshletVisibility;
+        std::vector<MeshletCuller::DrawRange> mMeshletDrawRanges;
+        MeshletCuller mMeshletCuller;
     };
 }
@@ -540,16 +540,8 @@ namespace Falcor
         }
     }
 
-    void loadDDSDataFromFile(const std::string filename, DdsData& ddsData)
+    static bool loadDDSDataFromFile(const std::string& fullpath, DdsData& ddsData, std::string& error)
     {
-        std::string fullpath;
-        if (findFileInDataDirectories(filename, fullpath) == false)
-        {
-            msgBox("Error when loading DDS file. Can't find texture file " + filename);
-            //could not find file
-            return;
-        }
-
         BinaryFileStream stream(fullpath, BinaryFileStream::Mode::Read);
 
         //check the dds identifier
@@ -558,8 +550,8 @@ namespace Falcor
         if (ddsIdentifier != kDdsMagicNumber)
         {
             //not valid dds file apparently
-            logError(std::string("The dds file ") + filename + std::string(" is not a valid dds file"));
-            return;
+            error = std::string("The dds file ") + fullpath + std::string(" is not a valid dds file");
+            return false;
         }
 
         stream >> ddsData.header;
@@ -577,6 +569,12 @@ namespace Falcor
         uint32_t dataSize = stream.getRemainingStreamSize();
         ddsData.data.resize(dataSize);
         stream.read(ddsData.data.data(), dataSize);
+        if (dataSize == 0)
+        {
+            error = std::string("The dds file ") + fullpath + std::string(" has no image data");
+            return false;
+        }
+        return true;
     }
 
     static ResourceFormat convertBgrxFormatToBgra(DdsData& ddsData, ResourceFormat format)
@@ -663,11 +661,8 @@ namespace Falcor
         return nullptr;
     }
 
-    Texture::SharedPtr createTextureFromDDSFile(const std::string filename, bool generateMips, bool loadAsSrgb, Texture::BindFlags bindFlags)
+    Texture::SharedPtr createTextureFromDdsData(DdsData& ddsData, const std::string& filename, bool generateMips, bool loadAsSrgb, Texture::BindFlags bindFlags)
     {
-        DdsData ddsData;
-        loadDDSDataFromFile(filename, ddsData);
-
         ResourceFormat format = getDdsResourceFormat(ddsData);
         assert(format != ResourceFormat::Unknown);
 
@@ -697,40 +692,76 @@ namespace Falcor
         return nullptr;
     }
 
-    Texture::SharedPtr createTextureFromFile(const std::string& filename, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags)
+    struct TextureFileData
     {
-#define no_srgb()   \
-    if(loadAsSrgb)  \
-    {               \
-        logWarning("createTexture2DFromFile() warning. " + std::to_string(pBitmap->getBytesPerPixel()) + " channel images doesn't have a matching sRGB format. Loading in linear space.");  \
+        std::string filename;
+        bool isDds = false;
+        DdsData ddsData;
+        Bitmap::UniqueConstPtr pBitmap;
+    };
+
+    std::shared_ptr<TextureFileData> loadTextureFileData(const std::string& filename, std::string& error)
+    {
+        // The loaders would open a message box for missing files, which can't be done from worker threads
+        std::string fullpath;
+        if (findFileInDataDirectories(filename, fullpath) == false)
+        {
+            error = "Error when loading texture. Can't find texture file " + filename;
+            return nullptr;
+        }
+
+        auto pData = std::make_shared<TextureFileData>();
+        pData->filename = filename;
+
+        if (hasSuffix(filename, ".dds"))
+        {
+            pData->isDds = true;
+            if (loadDDSDataFromFile(fullpath, pData->ddsData, error) == false) return nullptr;
+        }
+        else
+        {
+            pData->pBitmap = Bitmap::createFromFile(fullpath, kTopDown, error);
+            if (pData->pBitmap == nullptr) return nullptr;
+        }
+        return pData;
     }
 
+    Texture::SharedPtr createTextureFromFileData(TextureFileData& data, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags)
+    {
         Texture::SharedPtr pTex;
-        if (hasSuffix(filename, ".dds"))
+        if (data.isDds)
         {
-            pTex = createTextureFromDDSFile(filename, generateMipLevels, loadAsSrgb, bindFlags);
+            pTex = createTextureFromDdsData(data.ddsData, data.filename, generateMipLevels, loadAsSrgb, bindFlags);
         }
         else
         {
-            Bitmap::UniqueConstPtr pBitmap = Bitmap::createFromFile(filename, kTopDown);
-            if(pBitmap)
+            const Bitmap* pBitmap = data.pBitmap.get();
+            ResourceFormat texFormat = pBitmap->getFormat();
+            if(loadAsSrgb)
             {
-                ResourceFormat texFormat = pBitmap->getFormat();
-                if(loadAsSrgb)
-                {
-                    texFormat = linearToSrgbFormat(texFormat);
-                }
-
-                pTex = Texture::create2D(pBitmap->getWidth(), pBitmap->getHeight(), texFormat, 1, generateMipLevels ? Texture::kMaxPossible : 1, pBitmap->getData(), bindFlags);
+                texFormat = linearToSrgbFormat(texFormat);
             }
+
+            pTex = Texture::create2D(pBitmap->getWidth(), pBitmap->getHeight(), texFormat, 1, generateMipLevels ? Texture::kMaxPossible : 1, pBitmap->getData(), bindFlags);
         }
 
         if (pTex != nullptr)
         {
-            pTex->setSourceFilename(stripDataDirectories(filename));
+            pTex->setSourceFilename(stripDataDirectories(data.filename));
         }
 
         return pTex;
     }
-#undef no_srgb
+
+    Texture::SharedPtr createTextureFromFile(const std::string& filename, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags)
+    {
+        std::string error;
+        std::shared_ptr<TextureFileData> pData = loadTextureFileData(filename, error);
+        if (pData == nullptr)
+        {
+            logError(error);
+            return nullptr;
+        }
+        return createTextureFromFileData(*pData, generateMipLevels, loadAsSrgb, bindFlags);
+    }
 }
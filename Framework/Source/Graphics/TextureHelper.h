@@ -26,10 +26,15 @@
 # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ***************************************************************************/
 #pragma once
+#include <memory>
 #include <string>
 #include "API/Texture.h"
 namespace Falcor
 {
+    /** Contents of an image file, read and decoded but not yet uploaded
+    */
+    struct TextureFileData;
+
     /*!
     *  \addtogroup Falcor
     *  @{
@@ -43,5 +48,18 @@ namespace Falcor
     */
     Texture::SharedPtr createTextureFromFile(const std::string& filename, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags = Texture::BindFlags::ShaderResource);
 
+    /** Read and decode an image file without creating a texture. Doesn't touch the device or open message boxes, so it can be called from worker threads.
+        \param[in] filename Filename of the image. Can also include a full path or relative path from a data directory
+        \param[out] error Why the file couldn't be read. The caller decides how to report it.
+        \return The decoded data, or nullptr if the file couldn't be read
+    */
+    std::shared_ptr<TextureFileData> loadTextureFileData(const std::string& filename, std::string& error);
+
+    /** Create a texture from data returned by loadTextureFileData(). Must be called from the thread that owns the render context.
+        The data may be modified in the process (DDS row flips), don't create more than one texture from it.
+        Parameters are the same as createTextureFromFile().
+    */
+    Texture::SharedPtr createTextureFromFileData(TextureFileData& data, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags = Texture::BindFlags::ShaderResource);
+
     /*! @} */
 }
\ No newline at end of file
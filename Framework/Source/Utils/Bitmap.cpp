@@ -46,20 +46,29 @@ namespace Falcor
 #else
     static bool isRGB32fSupported() { return false; } // FIX THIS
 #endif
-    const Bitmap* genError(const std::string& errMsg, const std::string& filename)
+    static const Bitmap* genError(const std::string& errMsg, const std::string& filename, std::string& error)
     {
-        std::string err = "Error when loading image file " + filename + '\n' + errMsg + '.';
-        logError(err);
+        error = "Error when loading image file " + filename + '\n' + errMsg + '.';
         return nullptr;
     }
 
     Bitmap::UniqueConstPtr Bitmap::createFromFile(const std::string& filename, bool isTopDown)
+    {
+        std::string error;
+        UniqueConstPtr pBmp = createFromFile(filename, isTopDown, error);
+        if(pBmp == nullptr)
+        {
+            logError(error);
+        }
+        return pBmp;
+    }
+
+    Bitmap::UniqueConstPtr Bitmap::createFromFile(const std::string& filename, bool isTopDown, std::string& error)
     {
         std::string fullpath;
         if(findFileInDataDirectories(filename, fullpath) == false)
         {
-            msgBox("Error when loading image file " + filename + "\n. Can't find the file");
-            return nullptr;
+            return UniqueConstPtr(genError("Can't find the file", filename, error));
         }
 
         FREE_IMAGE_FORMAT fifFormat = FIF_UNKNOWN;
@@ -72,21 +81,21 @@ namespace Falcor
 
             if(fifFormat == FIF_UNKNOWN)
             {
-                return UniqueConstPtr(genError("Image Type unknown", filename));
+                return UniqueConstPtr(genError("Image Type unknown", filename, error));
             }
         }
 
         // Check the the library supports loading this image Type
         if(FreeImage_FIFSupportsReading(fifFormat) == false)
         {
-            return UniqueConstPtr(genError("Library doesn't support the file format", filename));
+            return UniqueConstPtr(genError("Library doesn't support the file format", filename, error));
         }
 
         // Read the DIB
         FIBITMAP* pDib = FreeImage_Load(fifFormat, fullpath.c_str());
         if(pDib == nullptr)
         {
-            return UniqueConstPtr(genError("Can't read image file", filename));
+            return UniqueConstPtr(genError("Can't read image file", filename, error));
         }
 
         // create the bitmap
@@ -96,7 +105,9 @@ namespace Falcor
 
         if(pBmp->mHeight == 0 || pBmp->mWidth == 0 || FreeImage_GetBits(pDib) == nullptr)
         {
-            return UniqueConstPtr(genError("Invalid image", filename));
+            delete pBmp;
+            FreeImage_Unload(pDib);
+            return UniqueConstPtr(genError("Invalid image", filename, error));
         }
 
         uint32_t bpp = FreeImage_GetBPP(pDib);
@@ -127,8 +138,9 @@ namespace Falcor
             pBmp->mFormat = ResourceFormat::R8Unorm;
             break;
         default:
-            genError("Unknown bits-per-pixel", filename);
-            return nullptr;
+            delete pBmp;
+            FreeImage_Unload(pDib);
+            return UniqueConstPtr(genError("Unknown bits-per-pixel", filename, error));
         }
 
         // Convert the image to RGBX image
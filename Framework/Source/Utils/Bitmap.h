@@ -65,6 +65,14 @@ namespace Falcor
         */
         static UniqueConstPtr createFromFile(const std::string& filename, bool isTopDown);
 
+        /** Create a new object from file without logging. Safe to call from worker threads, since it never opens a message box.
+            \param[in] filename Filename, including a path. If the file can't be found relative to the current directory, Falcor will search for it in the common directories.
+            \param[in] isTopDown Control the memory layout of the image. If true, the top-left pixel is the first pixel in the buffer, otherwise the bottom-left pixel is first.
+            \param[out] error If loading failed, a description of the error.
+            \return If loading was successful, a new object. Otherwise, nullptr.
+        */
+        static UniqueConstPtr createFromFile(const std::string& filename, bool isTopDown, std::string& error);
+
         /** Store a memory buffer to a PNG file.
             \param[in] filename Output filename. Can include a path - absolute or relative to the executable directory.
             \param[in] width The width of the image.
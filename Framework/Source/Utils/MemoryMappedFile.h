@@ -0,0 +1,75 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <memory>
+#include <string>
+
+namespace Falcor
+{
+    /** Read-only memory mapping of an entire file.
+        The pages are loaded by the OS on first access, so opening large files is cheap. The view stays valid for the
+        lifetime of the object.
+    */
+    class MemoryMappedFile
+    {
+    public:
+        using SharedPtr = std::shared_ptr<MemoryMappedFile>;
+        using SharedConstPtr = std::shared_ptr<const MemoryMappedFile>;
+
+        /** Map a file for reading.
+            \param[in] filename Full path of the file to map
+            \return A new object, or nullptr if the file doesn't exist, is empty or can't be mapped
+        */
+        static SharedPtr create(const std::string& filename);
+
+        ~MemoryMappedFile();
+
+        /** Get a pointer to the beginning of the mapped view
+        */
+        const void* getData() const { return mpData; }
+
+        /** Get the size of the file in bytes
+        */
+        size_t getSize() const { return mSize; }
+
+        const std::string& getFilename() const { return mFilename; }
+
+    private:
+        MemoryMappedFile() = default;
+        MemoryMappedFile(const MemoryMappedFile&) = delete;
+        MemoryMappedFile& operator=(const MemoryMappedFile&) = delete;
+
+        const void* mpData = nullptr;
+        size_t mSize = 0;
+        std::string mFilename;
+
+        // Platform specific handles
+        void* mpFileHandle = nullptr;
+        void* mpMappingHandle = nullptr;
+    };
+}
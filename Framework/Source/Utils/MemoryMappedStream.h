@@ -0,0 +1,173 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <cstring>
+#include <string>
+#include "Utils/MemoryMappedFile.h"
+
+namespace Falcor
+{
+    /** Read-only stream over a memory mapped file.
+        Exposes the same read interface as BinaryFileStream, so parsers can switch between the two. In addition, view() returns a pointer
+        directly into the mapping, which lets a parser hand large payloads to resource creation without copying them first.
+        Pointers returned by view() are not guaranteed to be aligned and stay valid as long as the stream is open.
+    */
+    class MemoryMappedStream
+    {
+    public:
+        /** Default constructor.
+        */
+        MemoryMappedStream() {};
+
+        /** Constructor that maps a file
+            \param[in] filename Full path of the file to map
+        */
+        MemoryMappedStream(const std::string& filename)
+        {
+            open(filename);
+        }
+
+        /** Map a file for reading. Closes the previously mapped file, if any.
+            \param[in] filename Full path of the file to map
+            \return true if the file was mapped, otherwise false
+        */
+        bool open(const std::string& filename)
+        {
+            mpFile = MemoryMappedFile::create(filename);
+            mPosition = 0;
+            mFail = (mpFile == nullptr);
+            mEof = false;
+            return isOpen();
+        }
+
+        /** Release the mapping. Pointers returned by view() become invalid.
+        */
+        void close()
+        {
+            mpFile = nullptr;
+            mPosition = 0;
+        }
+
+        /** Checks if a file is mapped
+        */
+        bool isOpen() const { return mpFile != nullptr; }
+
+        /** Get the mapped file
+        */
+        const MemoryMappedFile::SharedPtr& getFile() const { return mpFile; }
+
+        /** Skip data in the stream. Advances the stream without reading.
+            \param[in] count Bytes to skip
+        */
+        void skip(size_t count)
+        {
+            view(count);
+        }
+
+        /** Calculates amount of remaining data in the file.
+            \return Number of bytes remaining in the stream
+        */
+        size_t getRemainingStreamSize() const
+        {
+            return isOpen() ? mpFile->getSize() - mPosition : 0;
+        }
+
+        /** Get the current read offset in bytes from the start of the file
+        */
+        size_t getPosition() const { return mPosition; }
+
+        /** Checks for validity of the stream
+            \return Returns true if no errors have been encountered and the end of the stream has not been reached
+        */
+        bool isGood() const { return (mFail == false) && (mEof == false); }
+
+        /** Checks for stream errors.
+            \return Returns true if the file couldn't be mapped.
+        */
+        bool isBad() const { return isOpen() == false; }
+
+        /** Checks for stream errors.
+            \return Returns true if any error has occurred while reading the file.
+        */
+        bool isFail() const { return mFail; }
+
+        /** Checks if the end of file has been reached.
+            \return Returns true if a read went past the end of the file
+        */
+        bool isEof() const { return mEof; }
+
+        /** Get a pointer to the next bytes of the stream and advance past them.
+            \param[in] count Number of bytes to consume
+            \return A pointer into the mapped file, or nullptr if less than count bytes remain. In that case the stream is moved to the end and the fail and EOF flags are set.
+        */
+        const uint8_t* view(size_t count)
+        {
+            if(mFail || count > getRemainingStreamSize())
+            {
+                mFail = true;
+                mEof = true;
+                mPosition = isOpen() ? mpFile->getSize() : 0;
+                return nullptr;
+            }
+
+            const uint8_t* pData = (const uint8_t*)mpFile->getData() + mPosition;
+            mPosition += count;
+            return pData;
+        }
+
+        /** Reads data from the stream
+            \param[out] pData Pointer to a buffer to copy/read data into. Zeroed if the read fails.
+            \param[in] count Number of bytes to read
+        */
+        MemoryMappedStream& read(void* pData, size_t count)
+        {
+            const uint8_t* pSrc = view(count);
+            if(pSrc)
+            {
+                std::memcpy(pData, pSrc, count);
+            }
+            else
+            {
+                std::memset(pData, 0, count);
+            }
+            return *this;
+        }
+
+        /** Extracts a single value from the stream
+            \param[out] val Reference of value to extract into
+        */
+        template<typename T>
+        MemoryMappedStream& operator>>(T& val) { return read(&val, sizeof(T)); }
+
+    private:
+        MemoryMappedFile::SharedPtr mpFile;
+        size_t mPosition = 0;
+        bool mFail = false;
+        bool mEof = false;
+    };
+}
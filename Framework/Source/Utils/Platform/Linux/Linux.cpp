@@ -30,6 +30,7 @@
 #include "Utils/StringUtils.h"
 #include "Utils/Platform/OS.h"
 #include "Utils/Logger.h"
+#include "Utils/MemoryMappedFile.h"
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -42,6 +43,8 @@
 #include <algorithm>
 #include <experimental/filesystem>
 #include <dlfcn.h>
+#include <sys/mman.h>
+#include <unistd.h>
 namespace fs = std::experimental::filesystem;
 
 namespace Falcor
@@ -513,4 +516,37 @@ namespace Falcor
     {
         return dlsym(dll, funcName.c_str());
     }
-}
\ No newline at end of file
+
+    MemoryMappedFile::SharedPtr MemoryMappedFile::create(const std::string& filename)
+    {
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) return nullptr;
+
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0)
+        {
+            close(fd);
+            return nullptr;
+        }
+
+        void* pData = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (pData == MAP_FAILED)
+        {
+            close(fd);
+            return nullptr;
+        }
+
+        SharedPtr pFile = SharedPtr(new MemoryMappedFile());
+        pFile->mpData = pData;
+        pFile->mSize = (size_t)st.st_size;
+        pFile->mFilename = filename;
+        pFile->mpFileHandle = (void*)(intptr_t)fd;
+        return pFile;
+    }
+
+    MemoryMappedFile::~MemoryMappedFile()
+    {
+        if (mpData) munmap(const_cast<void*>(mpData), mSize);
+        close((int)(intptr_t)mpFileHandle);
+    }
+}
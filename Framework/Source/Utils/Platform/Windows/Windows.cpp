@@ -36,7 +36,7 @@
 #include <sys/types.h>
 #include "API/Window.h"
 #include "psapi.h"
-#include "Utils/ThreadPool.h"
+#include "Utils/MemoryMappedFile.h"
 #include <future>
 #include <shellscalingapi.h>
 
@@ -589,4 +589,47 @@ namespace Falcor
     {
         return GetProcAddress(dll, funcName.c_str());
     }
+
+    MemoryMappedFile::SharedPtr MemoryMappedFile::create(const std::string& filename)
+    {
+        HANDLE hFile = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+        if (hFile == INVALID_HANDLE_VALUE) return nullptr;
+
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(hFile, &size) || size.QuadPart == 0)
+        {
+            CloseHandle(hFile);
+            return nullptr;
+        }
+
+        HANDLE hMapping = CreateFileMappingA(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (hMapping == nullptr)
+        {
+            CloseHandle(hFile);
+            return nullptr;
+        }
+
+        const void* pData = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+        if (pData == nullptr)
+        {
+            CloseHandle(hMapping);
+            CloseHandle(hFile);
+            return nullptr;
+        }
+
+        SharedPtr pFile = SharedPtr(new MemoryMappedFile());
+        pFile->mpData = pData;
+        pFile->mSize = (size_t)size.QuadPart;
+        pFile->mFilename = filename;
+        pFile->mpFileHandle = hFile;
+        pFile->mpMappingHandle = hMapping;
+        return pFile;
+    }
+
+    MemoryMappedFile::~MemoryMappedFile()
+    {
+        if (mpData) UnmapViewOfFile(mpData);
+        if (mpMappingHandle) CloseHandle((HANDLE)mpMappingHandle);
+        if (mpFileHandle) CloseHandle((HANDLE)mpFileHandle);
+    }
 }
@@ -82,10 +82,11 @@ namespace Falcor
         auto model = pybind11::enum_<Model::LoadFlags>(m, "ModelLoadFlags");
         model.val(Model::LoadFlags::None).val(Model::LoadFlags::DontGenerateTangentSpace).val(Model::LoadFlags::FindDegeneratePrimitives).val(Model::LoadFlags::AssumeLinearSpaceTextures);
         model.val(Model::LoadFlags::DontMergeMeshes).val(Model::LoadFlags::BuffersAsShaderResource).val(Model::LoadFlags::RemoveInstancing).val(Model::LoadFlags::UseSpecGlossMaterials);
+        model.val(Model::LoadFlags::UseMetalRoughMaterials).val(Model::LoadFlags::OptimizeMeshes).val(Model::LoadFlags::CompressVertices).val(Model::LoadFlags::GenerateMeshlets);
 
         // Scene load flags
         auto scene = pybind11::enum_<Scene::LoadFlags>(m, "SceneLoadFlags");
-        scene.val(Scene::LoadFlags::None).val(Scene::LoadFlags::GenerateAreaLights);
+        scene.val(Scene::LoadFlags::None).val(Scene::LoadFlags::GenerateAreaLights).val(Scene::LoadFlags::DontUseBakedScene).val(Scene::LoadFlags::WriteBakedScene);
 
         // Scene
         m.def(ScriptBindings::kLoadScene, &Scene::loadFromFile, "filename"_a, "modelLoadFlags"_a = Model::LoadFlags::None, "sceneLoadFlags"_a = Scene::LoadFlags::None);
@@ -0,0 +1,337 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "TaskScheduler.h"
+#include "Utils/Platform/OS.h"
+
+namespace Falcor
+{
+    namespace
+    {
+        // The scheduler the current thread works for, null on threads the scheduler didn't create
+        thread_local TaskScheduler* tlScheduler = nullptr;
+        thread_local uint32_t tlWorkerIndex = 0;
+    }
+
+    TaskGroup::TaskGroup() : TaskGroup(TaskScheduler::instance())
+    {
+    }
+
+    TaskGroup::TaskGroup(TaskScheduler& scheduler) : mScheduler(scheduler), mPending(0)
+    {
+    }
+
+    TaskGroup::~TaskGroup()
+    {
+        wait();
+    }
+
+    void TaskGroup::run(Task task)
+    {
+        mPending++;
+        TaskScheduler::Item item;
+        item.task = std::move(task);
+        item.pGroup = this;
+        mScheduler.push(std::move(item));
+    }
+
+    void TaskGroup::then(Task task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mContinuationMutex);
+            if (mPending.load() != 0)
+            {
+                mContinuations.push_back(std::move(task));
+                return;
+            }
+        }
+        run(std::move(task));
+    }
+
+    void TaskGroup::wait()
+    {
+        while (!isIdle())
+        {
+            if (!mScheduler.tryExecuteOne()) std::this_thread::yield();
+        }
+    }
+
+    bool TaskGroup::isIdle()
+    {
+        if (mPending.load() != 0) return false;
+
+        std::vector<Task> continuations;
+        {
+            std::lock_guard<std::mutex> lock(mContinuationMutex);
+            if (mContinuations.empty()) return mPending.load() == 0;
+
+            // The last tasks finished together and none of them saw itself as the last one, start the continuations from here
+            continuations.swap(mContinuations);
+            mPending += (uint32_t)continuations.size();
+        }
+
+        for (auto& task : continuations)
+        {
+            TaskScheduler::Item item;
+            item.task = std::move(task);
+            item.pGroup = this;
+            mScheduler.push(std::move(item));
+        }
+        return false;
+    }
+
+    void TaskGroup::onTaskFinished()
+    {
+        if (mPending.load() == 1)
+        {
+            // Most likely the last task. Queue the continuations before the count can reach zero so wait() doesn't return early.
+            std::vector<Task> continuations;
+            {
+                std::lock_guard<std::mutex> lock(mContinuationMutex);
+                continuations.swap(mContinuations);
+                mPending += (uint32_t)continuations.size();
+            }
+
+            for (auto& task : continuations)
+            {
+                TaskScheduler::Item item;
+                item.task = std::move(task);
+                item.pGroup = this;
+                mScheduler.push(std::move(item));
+            }
+        }
+
+        // Must be the last access, the group may be destroyed as soon as the count reaches zero
+        mPending--;
+    }
+
+    std::unique_ptr<TaskScheduler> TaskScheduler::create(const Desc& desc)
+    {
+        return std::unique_ptr<TaskScheduler>(new TaskScheduler(desc));
+    }
+
+    TaskScheduler& TaskScheduler::instance()
+    {
+        static std::unique_ptr<TaskScheduler> spInstance = create();
+        return *spInstance;
+    }
+
+    TaskScheduler::TaskScheduler(const Desc& desc) :
+        mQueuedCount(0), mRunningCount(0), mSleepingCount(0), mStop(false), mTasksExecuted(0), mTasksStolen(0)
+    {
+        uint32_t workerCount = desc.workerCount;
+        if (workerCount == 0)
+        {
+            workerCount = std::max(1u, std::thread::hardware_concurrency()) - 1;
+        }
+        // Fire-and-forget tasks need at least one thread that isn't waiting on something
+        workerCount = std::max(1u, workerCount);
+
+        // All queues must exist before the first worker starts stealing
+        for (uint32_t i = 0; i < workerCount; i++)
+        {
+            mQueues.push_back(std::make_unique<WorkerQueue>());
+        }
+
+        for (uint32_t i = 0; i < workerCount; i++)
+        {
+            mWorkers.emplace_back(&TaskScheduler::workerMain, this, i);
+            if (desc.pinWorkers)
+            {
+                setWorkerAffinity(i, 1u << ((i + 1) % 32));
+            }
+        }
+    }
+
+    TaskScheduler::~TaskScheduler()
+    {
+        waitIdle();
+
+        {
+            std::lock_guard<std::mutex> lock(mSleepMutex);
+            mStop = true;
+        }
+        mSleepCondition.notify_all();
+
+        for (auto& worker : mWorkers)
+        {
+            worker.join();
+        }
+    }
+
+    void TaskScheduler::setWorkerAffinity(uint32_t workerIndex, uint32_t affinityMask)
+    {
+        if (workerIndex >= getWorkerCount())
+        {
+            logWarning("TaskScheduler::setWorkerAffinity() - worker index " + std::to_string(workerIndex) + " is out of range");
+            return;
+        }
+        setThreadAffinity(mWorkers[workerIndex].native_handle(), affinityMask);
+    }
+
+    void TaskScheduler::spawn(Task task)
+    {
+        Item item;
+        item.task = std::move(task);
+        push(std::move(item));
+    }
+
+    void TaskScheduler::waitIdle()
+    {
+        while (mQueuedCount.load() != 0 || mRunningCount.load() != 0)
+        {
+            if (!tryExecuteOne()) std::this_thread::yield();
+        }
+    }
+
+    TaskScheduler::Stats TaskScheduler::getStats() const
+    {
+        Stats stats;
+        stats.tasksExecuted = mTasksExecuted.load();
+        stats.tasksStolen = mTasksStolen.load();
+        return stats;
+    }
+
+    void TaskScheduler::resetStats()
+    {
+        mTasksExecuted = 0;
+        mTasksStolen = 0;
+    }
+
+    void TaskScheduler::push(Item&& item)
+    {
+        WorkerQueue& queue = (tlScheduler == this) ? *mQueues[tlWorkerIndex] : mInjectionQueue;
+
+        // Count first, a worker that sees the count but not yet the item just looks again
+        mQueuedCount++;
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.items.push_back(std::move(item));
+        }
+
+        // Pairs with the sleeping count increment in workerMain(), one of the two sides always sees the other
+        if (mSleepingCount.load() > 0)
+        {
+            std::lock_guard<std::mutex> lock(mSleepMutex);
+            mSleepCondition.notify_one();
+        }
+    }
+
+    bool TaskScheduler::pop(Item& item)
+    {
+        auto take = [&](WorkerQueue& queue, bool newest)
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.items.empty()) return false;
+
+            if (newest)
+            {
+                item = std::move(queue.items.back());
+                queue.items.pop_back();
+            }
+            else
+            {
+                item = std::move(queue.items.front());
+                queue.items.pop_front();
+            }
+
+            // Running before queued drops, so waitIdle() never sees both at zero while the task is in flight
+            mRunningCount++;
+            mQueuedCount--;
+            return true;
+        };
+
+        const bool isWorker = (tlScheduler == this);
+        const uint32_t queueCount = (uint32_t)mQueues.size();
+
+        // Own deque first, LIFO
+        if (isWorker && take(*mQueues[tlWorkerIndex], true)) return true;
+
+        // Then work handed in by other threads
+        if (take(mInjectionQueue, false)) return true;
+
+        // Then steal the oldest task of another worker. For a split range that's the biggest piece left.
+        const uint32_t start = isWorker ? tlWorkerIndex + 1 : 0;
+        for (uint32_t i = 0; i < queueCount; i++)
+        {
+            const uint32_t victim = (start + i) % queueCount;
+            if (isWorker && victim == tlWorkerIndex) continue;
+
+            if (take(*mQueues[victim], false))
+            {
+                mTasksStolen++;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool TaskScheduler::tryExecuteOne()
+    {
+        Item item;
+        if (!pop(item)) return false;
+        execute(item);
+        return true;
+    }
+
+    void TaskScheduler::execute(Item& item)
+    {
+        item.task();
+
+        // Release the captures before the group is signalled, they may reference state owned by the waiting scope
+        TaskGroup* pGroup = item.pGroup;
+        item.task = nullptr;
+
+        mTasksExecuted++;
+        if (pGroup) pGroup->onTaskFinished();
+        mRunningCount--;
+    }
+
+    void TaskScheduler::workerMain(uint32_t workerIndex)
+    {
+        tlScheduler = this;
+        tlWorkerIndex = workerIndex;
+
+        while (true)
+        {
+            if (tryExecuteOne()) continue;
+
+            std::unique_lock<std::mutex> lock(mSleepMutex);
+            mSleepingCount++;
+            mSleepCondition.wait(lock, [this]() { return mStop.load() || mQueuedCount.load() != 0; });
+            mSleepingCount--;
+
+            if (mStop.load() && mQueuedCount.load() == 0) break;
+        }
+    }
+
+    uint32_t TaskScheduler::getDefaultGrainSize(uint32_t count) const
+    {
+        return std::max(1u, count / (getConcurrency() * 8));
+    }
+}
@@ -0,0 +1,241 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Falcor
+{
+    class TaskScheduler;
+
+    /** A set of tasks that can be waited on as a whole.
+        Tasks may spawn more tasks into the same group. Continuations registered with then() run once every task in the group finished.
+        The destructor waits, so tasks may safely reference locals of the scope that owns the group.
+    */
+    class TaskGroup
+    {
+    public:
+        using Task = std::function<void()>;
+
+        /** Create a group on the given scheduler. The default is the global scheduler.
+        */
+        TaskGroup();
+        TaskGroup(TaskScheduler& scheduler);
+        ~TaskGroup();
+
+        TaskGroup(const TaskGroup&) = delete;
+        TaskGroup& operator=(const TaskGroup&) = delete;
+
+        /** Queue a task
+        */
+        void run(Task task);
+
+        /** Queue a task to run after all tasks currently in the group, including tasks they spawn, completed.
+            Continuations are part of the group, wait() doesn't return before they ran. If the group is idle the task is queued immediately.
+        */
+        void then(Task task);
+
+        /** Block until the group is idle. The calling thread executes queued tasks while it waits.
+        */
+        void wait();
+
+        /** Check if all tasks and continuations completed
+        */
+        bool isIdle();
+
+    private:
+        friend class TaskScheduler;
+        void onTaskFinished();
+
+        TaskScheduler& mScheduler;
+        std::atomic<uint32_t> mPending;
+        std::mutex mContinuationMutex;
+        std::vector<Task> mContinuations;
+    };
+
+    /** Work-stealing task scheduler shared by the CPU-heavy parts of the framework.
+        Every worker owns a deque. Tasks spawned from a worker go to the back of its own deque and are popped LIFO, which keeps the working set hot.
+        Idle workers steal from the front of other deques. Tasks spawned from other threads go through a shared injection queue.
+        Threads that wait on a TaskGroup execute tasks too, so nested parallelism never deadlocks.
+    */
+    class TaskScheduler
+    {
+    public:
+        using Task = std::function<void()>;
+
+        struct Desc
+        {
+            uint32_t workerCount = 0;   ///< Worker threads to create. 0 uses one less than the hardware thread count, the thread that waits makes up for it.
+            bool pinWorkers = false;    ///< Pin worker i to hardware thread i + 1 with setThreadAffinity(). Hardware thread 0 is left to the main thread.
+        };
+
+        struct Stats
+        {
+            uint64_t tasksExecuted = 0; ///< Tasks run to completion, by workers and by waiting threads
+            uint64_t tasksStolen = 0;   ///< Tasks taken from another worker's deque
+        };
+
+        /** Create a scheduler with its own worker threads
+        */
+        static std::unique_ptr<TaskScheduler> create(const Desc& desc);
+        static std::unique_ptr<TaskScheduler> create() { return create(Desc()); }
+
+        /** Get the global scheduler. It is created on first use and drains its queues before the application exits.
+        */
+        static TaskScheduler& instance();
+
+        /** Finishes all queued tasks, then stops the workers
+        */
+        ~TaskScheduler();
+
+        /** Number of worker threads
+        */
+        uint32_t getWorkerCount() const { return (uint32_t)mWorkers.size(); }
+
+        /** Number of threads that execute tasks when one thread waits on them
+        */
+        uint32_t getConcurrency() const { return getWorkerCount() + 1; }
+
+        /** Set the affinity mask of a worker thread. See setThreadAffinity().
+        */
+        void setWorkerAffinity(uint32_t workerIndex, uint32_t affinityMask);
+
+        /** Queue a fire-and-forget task. Use a TaskGroup to wait for it.
+        */
+        void spawn(Task task);
+
+        /** Block until no task is queued or running. The calling thread helps.
+        */
+        void waitIdle();
+
+        /** Call func(first, last) on disjoint sub-ranges covering [begin, end) and wait for all of them.
+            The range is split in halves until a piece has at most grainSize items, idle workers steal the larger halves.
+            \param[in] grainSize Largest range handed to func. 0 picks about 8 ranges per thread.
+        */
+        template<typename Func>
+        void parallelFor(uint32_t begin, uint32_t end, uint32_t grainSize, const Func& func)
+        {
+            if (end <= begin) return;
+            grainSize = grainSize ? grainSize : getDefaultGrainSize(end - begin);
+
+            TaskGroup group(*this);
+            std::function<void(uint32_t, uint32_t)> split = [&](uint32_t first, uint32_t last)
+            {
+                while (last - first > grainSize)
+                {
+                    const uint32_t mid = first + (last - first) / 2;
+                    group.run([&split, mid, last]() { split(mid, last); });
+                    last = mid;
+                }
+                func(first, last);
+            };
+            split(begin, end);
+            group.wait();
+        }
+
+        /** Reduce [begin, end) in parallel. func(first, last) returns the value of a sub-range, reduce(a, b) combines two values.
+            Sub-range values are combined in range order, so the result doesn't depend on the thread count for a given grainSize.
+            \param[in] grainSize Largest range handed to func. 0 picks about 8 ranges per thread.
+        */
+        template<typename T, typename Func, typename Reduce>
+        T parallelReduce(uint32_t begin, uint32_t end, uint32_t grainSize, const T& identity, const Func& func, const Reduce& reduce)
+        {
+            if (end <= begin) return identity;
+            grainSize = grainSize ? grainSize : getDefaultGrainSize(end - begin);
+
+            const uint32_t chunkCount = (end - begin + grainSize - 1) / grainSize;
+            std::vector<T> partial(chunkCount, identity);
+            parallelFor(0, chunkCount, 1, [&](uint32_t firstChunk, uint32_t lastChunk)
+            {
+                for (uint32_t c = firstChunk; c < lastChunk; c++)
+                {
+                    const uint32_t first = begin + c * grainSize;
+                    partial[c] = func(first, std::min(first + grainSize, end));
+                }
+            });
+
+            T result = identity;
+            for (const T& value : partial)
+            {
+                result = reduce(result, value);
+            }
+            return result;
+        }
+
+        /** Get the counters accumulated since the last resetStats()
+        */
+        Stats getStats() const;
+
+        void resetStats();
+
+    private:
+        friend class TaskGroup;
+
+        struct Item
+        {
+            Task task;
+            TaskGroup* pGroup = nullptr;
+        };
+
+        struct WorkerQueue
+        {
+            std::mutex mutex;
+            std::deque<Item> items;
+        };
+
+        TaskScheduler(const Desc& desc);
+
+        void push(Item&& item);
+        bool tryExecuteOne();
+        bool pop(Item& item);
+        void execute(Item& item);
+        void workerMain(uint32_t workerIndex);
+        uint32_t getDefaultGrainSize(uint32_t count) const;
+
+        std::vector<std::thread> mWorkers;
+        std::vector<std::unique_ptr<WorkerQueue>> mQueues;
+        WorkerQueue mInjectionQueue;
+
+        std::atomic<uint32_t> mQueuedCount;
+        std::atomic<uint32_t> mRunningCount;
+        std::atomic<uint32_t> mSleepingCount;
+        std::atomic<bool> mStop;
+        std::mutex mSleepMutex;
+        std::condition_variable mSleepCondition;
+
+        std::atomic<uint64_t> mTasksExecuted;
+        std::atomic<uint64_t> mTasksStolen;
+    };
+}
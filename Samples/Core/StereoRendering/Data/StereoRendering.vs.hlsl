@@ -37,7 +37,7 @@ VertexOut main(VertexIn vIn)
     vOut.prevPosH = float4(0.0f, 0.0f, 0.0f, 0.0f);
 
     float4x4 worldMat = getWorldMat(vIn);
-    float4 posW = mul(vIn.pos, worldMat);
+    float4 posW = mul(getPosition(vIn), worldMat);
     vOut.posW = posW.xyz;
 
 #ifdef HAS_TEXCRD
@@ -53,13 +53,13 @@ VertexOut main(VertexIn vIn)
 #endif
 
 #ifdef HAS_NORMAL
-    vOut.normalW = mul(vIn.normal, getWorldInvTransposeMat(vIn)).xyz;
+    vOut.normalW = mul(getNormal(vIn), getWorldInvTransposeMat(vIn)).xyz;
 #else
     vOut.normalW = 0;
 #endif
 
 #ifdef HAS_BITANGENT
-    vOut.bitangentW = mul(vIn.bitangent, (float3x3)getWorldMat(vIn)).xyz;
+    vOut.bitangentW = mul(getBitangent(vIn), (float3x3)getWorldMat(vIn)).xyz;
 #else
     vOut.bitangentW = 0;
 #endif
@@ -0,0 +1,70 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include "Falcor.h"
+
+using namespace Falcor;
+
+/** Joint bilateral upsampling of a low-res lighting buffer guided by the full-res G-buffer.
+    Each full-res pixel blends its 2x2 low-res neighbors by bilinear weight, depth and normal similarity.
+    Depth/normal inputs use the SVGF_CompactNormDepth layout (oct normal, linear Z, Z derivative).
+*/
+class BilateralUpsamplePass : public RenderPass, inherit_shared_from_this<RenderPass, BilateralUpsamplePass>
+{
+public:
+    using SharedPtr = std::shared_ptr<BilateralUpsamplePass>;
+
+    static SharedPtr create(const Dictionary& dict = {});
+
+    /** Upsample pSrcTex into pTargetFbo.
+        \param[in] pLowResNormDepth Depth/normal at the resolution of pSrcTex, point-downscaled from pHighResNormDepth
+        \param[in] pHighResNormDepth Depth/normal at the resolution of pTargetFbo
+    */
+    void execute(RenderContext* pContext,
+                 const Texture::SharedPtr& pSrcTex,
+                 const Texture::SharedPtr& pLowResNormDepth,
+                 const Texture::SharedPtr& pHighResNormDepth,
+                 const Fbo::SharedPtr& pTargetFbo);
+
+    void renderUI(Gui* pGui, const char* uiGroup);
+
+    RenderPassReflection reflect() const override;
+    void execute(RenderContext* pContext, const RenderData* pRenderData) override;
+
+    std::string getDesc(void) override { return "Bilateral Upsample Pass"; }
+
+private:
+    BilateralUpsamplePass();
+
+    float mDepthSigma = 1.0f;
+    float mNormalPower = 32.0f;
+
+    GraphicsState::SharedPtr mpState;
+    GraphicsProgram::SharedPtr mpProgram;
+    GraphicsVars::SharedPtr mpVars;
+};
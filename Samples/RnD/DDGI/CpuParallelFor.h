@@ -1,53 +1,68 @@
-/***************************************************************************
-# Copyright (c) 2017, NVIDIA CORPORATION. All rights reserved.
-#
-# Redistribution and use in source and binary forms, with or without
-# modification, are permitted provided that the following conditions
-# are met:
-#  * Redistributions of source code must retain the above copyright
-#    notice, this list of conditions and the following disclaimer.
-#  * Redistributions in binary form must reproduce the above copyright
-#    notice, this list of conditions and the following disclaimer in the
-#    documentation and/or other materials provided with the distribution.
-#  * Neither the name of NVIDIA CORPORATION nor the names of its
-#    contributors may be used to endorse or promote products derived
-#    from this software without specific prior written permission.
-#
-# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
-# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
-# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
-# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
-# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
-# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
-# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
-# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
-# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
-# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
-# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
-***************************************************************************/
-#include <thread>
-
-template<uint32_t threadCount>
-class ThreadPool
-{
-public:
-    ~ThreadPool()
-    {
-        for (auto& t : mThreads)
-        {
-            if (t.joinable()) t.join();
-        }
-    }
-
-    std::thread& getAvailable()
-    {
-        std::thread& t = mThreads[mCurrent];
-        if (t.joinable()) t.join();
-        mCurrent = (mCurrent + 1) % arraysize(mThreads);
-        return t;
-    }
-
-private:
-    std::thread mThreads[threadCount];
-    uint32_t mCurrent = 0;
-};
\ No newline at end of file
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include "Utils/TaskScheduler.h"
+
+namespace Falcor
+{
+    /** Number of worker threads to use when the caller didn't ask for a specific count
+    */
+    inline uint32_t getDefaultCpuThreadCount()
+    {
+        return TaskScheduler::instance().getConcurrency();
+    }
+
+    /** Run func(i) for i in [0, count) on at most threadCount threads of the global task scheduler. Items are handed out one at a
+        time so uneven work (e.g. rows that hit geometry vs rows that miss) balances itself. The calling thread takes part.
+    */
+    inline void parallelFor(uint32_t count, uint32_t threadCount, const std::function<void(uint32_t)>& func)
+    {
+        if (count == 0) return;
+
+        std::atomic<uint32_t> next(0);
+        auto worker = [&]()
+        {
+            for (uint32_t i = next++; i < count; i = next++)
+            {
+                func(i);
+            }
+        };
+
+        threadCount = std::max(1u, std::min(threadCount, count));
+        TaskGroup group;
+        for (uint32_t t = 1; t < threadCount; ++t)
+        {
+            group.run(worker);
+        }
+        worker();
+        group.wait();
+    }
+}
@@ -0,0 +1,899 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "CpuSVGF.h"
+#include "CpuParallelFor.h"
+#include "glm/gtc/packing.hpp"
+#include <emmintrin.h>
+#include <cfloat>
+#include <fstream>
+
+namespace Falcor
+{
+    namespace
+    {
+        const uint32_t kFrameMagic = 0x46475653;    // 'SVGF'
+        const uint32_t kFrameVersion = 1;
+        const float kAtrousKernel[3] = { 1.0f, 2.0f / 3.0f, 1.0f / 6.0f };
+        const float kVarianceKernel[2][2] = { { 1.0f / 4.0f, 1.0f / 8.0f }, { 1.0f / 8.0f, 1.0f / 16.0f } };
+        const float kEpsVariance = 1e-10f;
+        const uint32_t kMaxHistoryLength = 32;
+
+        struct FrameHeader
+        {
+            uint32_t magic;
+            uint32_t version;
+            uint32_t width;
+            uint32_t height;
+        };
+
+        inline float luminance(const float3& rgb)
+        {
+            return glm::dot(rgb, float3(0.2126f, 0.7152f, 0.0722f));
+        }
+
+        inline float saturate(float v)
+        {
+            return glm::clamp(v, 0.0f, 1.0f);
+        }
+
+        inline float fract(float v)
+        {
+            return v - std::floor(v);
+        }
+
+        /** OctToDir() in Helpers.slang, the normal is packed as two halfs in the bits of a float
+        */
+        float3 octToDir(float packed)
+        {
+            uint32_t octo;
+            std::memcpy(&octo, &packed, sizeof(octo));
+            float2 e = glm::unpackHalf2x16(octo);
+            float3 v(e, 1.0f - std::abs(e.x) - std::abs(e.y));
+            if (v.z < 0.0f)
+            {
+                float2 s(v.x >= 0.0f ? 1.0f : -1.0f, v.y >= 0.0f ? 1.0f : -1.0f);
+                v.x = (1.0f - std::abs(e.y)) * s.x;
+                v.y = (1.0f - std::abs(e.x)) * s.y;
+            }
+            return glm::normalize(v);
+        }
+
+        template<typename T>
+        T loadOrZero(const std::vector<T>& data, uint32_t width, uint32_t height, int x, int y)
+        {
+            return (x >= 0 && y >= 0 && x < (int)width && y < (int)height) ? data[(size_t)y * width + x] : T(0.0f);
+        }
+
+        // SSE versions of expf() and logf(), after the Cephes library. Accurate to a few ulp over the range the filter uses.
+        inline __m128 exp4(__m128 x)
+        {
+            const __m128 one = _mm_set1_ps(1.0f);
+            x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(-87.0f)), _mm_set1_ps(88.0f));
+
+            // x = n * ln(2) + r
+            __m128 fx = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(1.44269504088896341f)), _mm_set1_ps(0.5f));
+            __m128 n = _mm_cvtepi32_ps(_mm_cvttps_epi32(fx));
+            n = _mm_sub_ps(n, _mm_and_ps(_mm_cmpgt_ps(n, fx), one));
+            __m128 r = _mm_sub_ps(x, _mm_mul_ps(n, _mm_set1_ps(0.693359375f)));
+            r = _mm_sub_ps(r, _mm_mul_ps(n, _mm_set1_ps(-2.12194440e-4f)));
+
+            __m128 y = _mm_set1_ps(1.9875691500e-4f);
+            y = _mm_add_ps(_mm_mul_ps(y, r), _mm_set1_ps(1.3981999507e-3f));
+            y = _mm_add_ps(_mm_mul_ps(y, r), _mm_set1_ps(8.3334519073e-3f));
+            y = _mm_add_ps(_mm_mul_ps(y, r), _mm_set1_ps(4.1665795894e-2f));
+            y = _mm_add_ps(_mm_mul_ps(y, r), _mm_set1_ps(1.6666665459e-1f));
+            y = _mm_add_ps(_mm_mul_ps(y, r), _mm_set1_ps(5.0000001201e-1f));
+            y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(y, _mm_mul_ps(r, r)), r), one);
+
+            __m128i e = _mm_slli_epi32(_mm_add_epi32(_mm_cvttps_epi32(n), _mm_set1_epi32(127)), 23);
+            return _mm_mul_ps(y, _mm_castsi128_ps(e));
+        }
+
+        /** Only valid for x > 0
+        */
+        inline __m128 log4(__m128 x)
+        {
+            const __m128 one = _mm_set1_ps(1.0f);
+            x = _mm_max_ps(x, _mm_set1_ps(FLT_MIN));
+
+            // x = m * 2^e, m in [0.5, 1)
+            __m128i bits = _mm_castps_si128(x);
+            __m128 e = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(126)));
+            x = _mm_or_ps(_mm_and_ps(x, _mm_castsi128_ps(_mm_set1_epi32(0x007fffff))), _mm_set1_ps(0.5f));
+
+            // Move m to [sqrt(0.5), sqrt(2))
+            __m128 mask = _mm_cmplt_ps(x, _mm_set1_ps(0.707106781186547524f));
+            __m128 tmp = _mm_and_ps(x, mask);
+            x = _mm_sub_ps(x, one);
+            e = _mm_sub_ps(e, _mm_and_ps(one, mask));
+            x = _mm_add_ps(x, tmp);
+
+            __m128 z = _mm_mul_ps(x, x);
+            __m128 y = _mm_set1_ps(7.0376836292e-2f);
+            y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(-1.1514610310e-1f));
+            y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.1676998740e-1f));
+            y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(-1.2420140846e-1f));
+            y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.4249322787e-1f));
+            y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(-1.6668057665e-1f));
+            y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(2.0000714765e-1f));
+            y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(-2.4999993993e-1f));
+            y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(3.3333331174e-1f));
+            y = _mm_mul_ps(_mm_mul_ps(y, x), z);
+
+            y = _mm_add_ps(y, _mm_mul_ps(e, _mm_set1_ps(-2.12194440e-4f)));
+            y = _mm_sub_ps(y, _mm_mul_ps(z, _mm_set1_ps(0.5f)));
+            x = _mm_add_ps(x, y);
+            return _mm_add_ps(x, _mm_mul_ps(e, _mm_set1_ps(0.693359375f)));
+        }
+
+        inline __m128 select(__m128 mask, __m128 a, __m128 b)
+        {
+            return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+        }
+
+        inline __m128 abs4(__m128 v)
+        {
+            return _mm_and_ps(v, _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff)));
+        }
+    }
+
+    bool CpuSVGF::Image::readTexture(RenderContext* pContext, const Texture::SharedPtr& pTexture, Image& image)
+    {
+        const ResourceFormat format = pTexture->getFormat();
+        if (format != ResourceFormat::RGBA32Float && format != ResourceFormat::RGBA16Float)
+        {
+            logError("CpuSVGF: unsupported texture format " + to_string(format) + ", expected RGBA32Float or RGBA16Float");
+            return false;
+        }
+
+        image.resize(pTexture->getWidth(), pTexture->getHeight());
+        std::vector<uint8> data = pContext->readTextureSubresource(pTexture.get(), 0);
+        if (format == ResourceFormat::RGBA32Float)
+        {
+            assert(data.size() >= image.pixels.size() * sizeof(float4));
+            std::memcpy(image.pixels.data(), data.data(), image.pixels.size() * sizeof(float4));
+        }
+        else
+        {
+            assert(data.size() >= image.pixels.size() * sizeof(uint64_t));
+            const uint64_t* pHalfs = (const uint64_t*)data.data();
+            for (size_t i = 0; i < image.pixels.size(); ++i)
+            {
+                image.pixels[i] = glm::unpackHalf4x16(pHalfs[i]);
+            }
+        }
+        return true;
+    }
+
+    void CpuSVGF::Image::save(const std::string& filename) const
+    {
+        const Bitmap::FileFormat fileFormat = Bitmap::getFormatFromFileExtension(getExtensionFromFile(filename));
+        if (fileFormat != Bitmap::FileFormat::PfmFile && fileFormat != Bitmap::FileFormat::ExrFile)
+        {
+            logWarning("CpuSVGF: '" + filename + "' is not a floating point format, the image will be quantized");
+        }
+        Bitmap::saveImage(filename, width, height, fileFormat, Bitmap::ExportFlags::ExportAlpha, ResourceFormat::RGBA32Float, true, (void*)pixels.data());
+    }
+
+    bool CpuSVGF::Image::load(const std::string& filename, Image& image)
+    {
+        Bitmap::UniqueConstPtr pBitmap = Bitmap::createFromFile(filename, true);
+        if (!pBitmap) return false;
+
+        image.resize(pBitmap->getWidth(), pBitmap->getHeight());
+        const size_t count = image.pixels.size();
+        switch (pBitmap->getFormat())
+        {
+        case ResourceFormat::RGBA32Float:
+            std::memcpy(image.pixels.data(), pBitmap->getData(), count * sizeof(float4));
+            break;
+        case ResourceFormat::RGB32Float:
+            for (size_t i = 0; i < count; ++i)
+            {
+                image.pixels[i] = float4(((const float3*)pBitmap->getData())[i], 1.0f);
+            }
+            break;
+        case ResourceFormat::RGBA16Float:
+            for (size_t i = 0; i < count; ++i)
+            {
+                image.pixels[i] = glm::unpackHalf4x16(((const uint64_t*)pBitmap->getData())[i]);
+            }
+            break;
+        default:
+            logError("CpuSVGF: '" + filename + "' is not a floating point image");
+            return false;
+        }
+        return true;
+    }
+
+    bool CpuSVGF::Frame::capture(RenderContext* pContext, const Texture::SharedPtr& pInputSignal, const Texture::SharedPtr& pMotionVec,
+                                 const Texture::SharedPtr& pLinearZ, const Texture::SharedPtr& pNormalDepth, Frame& frame)
+    {
+        return Image::readTexture(pContext, pInputSignal, frame.inputSignal) &&
+               Image::readTexture(pContext, pMotionVec, frame.motionVec) &&
+               Image::readTexture(pContext, pLinearZ, frame.linearZ) &&
+               Image::readTexture(pContext, pNormalDepth, frame.compactNormalDepth);
+    }
+
+    bool CpuSVGF::Frame::save(const std::string& filename) const
+    {
+        std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+        if (!file)
+        {
+            logError("CpuSVGF: can't open '" + filename + "' for writing");
+            return false;
+        }
+
+        FrameHeader header = { kFrameMagic, kFrameVersion, inputSignal.width, inputSignal.height };
+        file.write((const char*)&header, sizeof(header));
+        for (const Image* pImage : { &inputSignal, &motionVec, &linearZ, &compactNormalDepth })
+        {
+            assert(pImage->width == header.width && pImage->height == header.height);
+            file.write((const char*)pImage->pixels.data(), pImage->pixels.size() * sizeof(float4));
+        }
+        return file.good();
+    }
+
+    bool CpuSVGF::Frame::load(const std::string& filename, Frame& frame)
+    {
+        std::string fullPath;
+        if (!findFileInDataDirectories(filename, fullPath))
+        {
+            fullPath = filename;
+        }
+        std::ifstream file(fullPath, std::ios::binary);
+        if (!file)
+        {
+            logError("CpuSVGF: can't open '" + filename + "'");
+            return false;
+        }
+
+        FrameHeader header;
+        file.read((char*)&header, sizeof(header));
+        if (!file || header.magic != kFrameMagic || header.version != kFrameVersion)
+        {
+            logError("CpuSVGF: '" + filename + "' is not a SVGF frame capture or has an unsupported version");
+            return false;
+        }
+
+        for (Image* pImage : { &frame.inputSignal, &frame.motionVec, &frame.linearZ, &frame.compactNormalDepth })
+        {
+            pImage->resize(header.width, header.height);
+            file.read((char*)pImage->pixels.data(), pImage->pixels.size() * sizeof(float4));
+        }
+        if (!file)
+        {
+            logError("CpuSVGF: '" + filename + "' is truncated");
+            return false;
+        }
+        return true;
+    }
+
+    void CpuSVGF::Plane::resize(uint32_t width, uint32_t height, uint32_t padding)
+    {
+        pad = padding;
+        stride = width + 2 * padding;
+        data.assign((size_t)stride * height, 0.0f);
+    }
+
+    CpuSVGF::SharedPtr CpuSVGF::create(uint32_t width, uint32_t height, const Settings& settings)
+    {
+        return SharedPtr(new CpuSVGF(width, height, settings));
+    }
+
+    CpuSVGF::CpuSVGF(uint32_t width, uint32_t height, const Settings& settings) : mWidth(width), mHeight(height), mSettings(settings)
+    {
+        for (ReprojectionBuffers* pBuffers : { &mCurrReproj, &mPrevReproj })
+        {
+            pBuffers->signal.resize(width, height);
+            pBuffers->moments.assign((size_t)width * height, float2(0.0f));
+            pBuffers->historyLength.assign((size_t)width * height, 0.0f);
+        }
+        for (Image* pImage : { &mPrevLinearZ, &mLastFiltered, &mAtrousPing, &mAtrousPong, &mOutput })
+        {
+            pImage->resize(width, height);
+        }
+    }
+
+    void CpuSVGF::reset()
+    {
+        for (ReprojectionBuffers* pBuffers : { &mCurrReproj, &mPrevReproj })
+        {
+            pBuffers->signal.resize(mWidth, mHeight);
+            std::fill(pBuffers->moments.begin(), pBuffers->moments.end(), float2(0.0f));
+            std::fill(pBuffers->historyLength.begin(), pBuffers->historyLength.end(), 0.0f);
+        }
+        mPrevLinearZ.resize(mWidth, mHeight);
+        mLastFiltered.resize(mWidth, mHeight);
+    }
+
+    const CpuSVGF::Image& CpuSVGF::execute(const Frame& frame)
+    {
+        for (const Image* pImage : { &frame.inputSignal, &frame.motionVec, &frame.linearZ, &frame.compactNormalDepth })
+        {
+            if (pImage->width != mWidth || pImage->height != mHeight)
+            {
+                logError("CpuSVGF::execute() - the frame is " + std::to_string(pImage->width) + "x" + std::to_string(pImage->height) +
+                         ", the denoiser was created for " + std::to_string(mWidth) + "x" + std::to_string(mHeight));
+                return mOutput;
+            }
+        }
+
+        const CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+        mSettings.atrousRadius = glm::clamp(mSettings.atrousRadius, 1u, 2u);
+        mSettings.tileSize = std::max((mSettings.tileSize + 3) & ~3u, 4u);
+
+        temporalReprojection(frame);
+        spatialVarianceEstimation(frame);
+
+        if (mSettings.useSimd)
+        {
+            prepareGeometryPlanes(frame);
+        }
+        for (uint32_t i = 0; i < mSettings.atrousIterations; ++i)
+        {
+            Image& output = (i == mSettings.atrousIterations - 1) ? mOutput : mAtrousPong;
+            if (mSettings.useSimd)
+            {
+                atrousFilterSimd(i, mAtrousPing, output);
+            }
+            else
+            {
+                atrousFilter(frame, i, mAtrousPing, output);
+            }
+
+            if (i == std::min(mSettings.feedbackTap, mSettings.atrousIterations - 1))
+            {
+                mLastFiltered.pixels = output.pixels;
+            }
+
+            std::swap(mAtrousPing, mAtrousPong);
+        }
+
+        std::swap(mCurrReproj, mPrevReproj);
+        mPrevLinearZ.pixels = frame.linearZ.pixels;
+
+        mLastExecuteTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+        return mOutput;
+    }
+
+    void CpuSVGF::forEachTile(const std::function<void(uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1)>& func) const
+    {
+        const uint32_t tileSize = mSettings.tileSize;
+        const uint32_t tilesX = (mWidth + tileSize - 1) / tileSize;
+        const uint32_t tilesY = (mHeight + tileSize - 1) / tileSize;
+        const uint32_t threadCount = mSettings.threadCount ? mSettings.threadCount : getDefaultCpuThreadCount();
+
+        parallelFor(tilesX * tilesY, threadCount, [&](uint32_t tile)
+        {
+            const uint32_t x0 = (tile % tilesX) * tileSize;
+            const uint32_t y0 = (tile / tilesX) * tileSize;
+            func(x0, y0, std::min(x0 + tileSize, mWidth), std::min(y0 + tileSize, mHeight));
+        });
+    }
+
+    CpuSVGF::Sample CpuSVGF::fetchSample(const Image& signal, const Frame& frame, int x, int y) const
+    {
+        const float4 s = signal.at(x, y);
+        const float4 nd = frame.compactNormalDepth.at(x, y);
+
+        Sample sample;
+        sample.signal = float3(s);
+        sample.variance = s.w;
+        sample.normal = glm::normalize(octToDir(nd.x));
+        sample.linearZ = nd.y;
+        sample.zDerivative = nd.z;
+        sample.luminance = luminance(sample.signal);
+        return sample;
+    }
+
+    float CpuSVGF::computeWeight(const Sample& center, const Sample& p, float phiDepth, float phiNormal, float phiColor) const
+    {
+        const float wNormal = std::pow(saturate(glm::dot(center.normal, p.normal)), phiNormal);
+        const float wZ = (phiDepth == 0.0f) ? 0.0f : std::abs(center.linearZ - p.linearZ) / phiDepth;
+        const float wLdirect = std::abs(center.luminance - p.luminance) / phiColor;
+
+        return std::exp(0.0f - std::max(wLdirect, 0.0f) - std::max(wZ, 0.0f)) * wNormal;
+    }
+
+    bool CpuSVGF::isReprojectionValid(int2 coord, float z, float zPrev, float fwidthZ, const float3& normal, const float3& normalPrev, float fwidthNormal) const
+    {
+        // Check whether the reprojected pixel is inside of the screen
+        if (coord.x < 1 || coord.y < 1 || coord.x > (int)mWidth - 1 || coord.y > (int)mHeight - 1) return false;
+
+        // Check if the deviation of depths is acceptable
+        if (std::abs(zPrev - z) / (fwidthZ + 1e-2f) > 2.0f) return false;
+
+        // Check normals for compatibility
+        if (glm::distance(normal, normalPrev) / (fwidthNormal + 1e-2f) > 16.0f) return false;
+
+        return true;
+    }
+
+    bool CpuSVGF::reprojectLastFilteredData(const Frame& frame, int x, int y, float3& prevSignal, float2& prevMoments, float& historyLength) const
+    {
+        const float2 imageDim = float2(mWidth, mHeight);
+
+        // .xy motion, .w normal derivative
+        const float4 motionVec = frame.motionVec.at(x, y);
+        const float2 motion = float2(motionVec);
+        const float normalFwidth = motionVec.w;
+
+        // .x Z, .y Z derivative, .z last frame Z, .w world normal
+        const float4 depth = frame.linearZ.at(x, y);
+        const float3 normal = octToDir(depth.w);
+
+        // +0.5 to account for texel center offset. Conversions truncate like the shader's.
+        const float2 prevPos = float2(x, y) + motion * imageDim;
+        const int2 iposPrev = int2(prevPos + float2(0.5f));
+        const int2 prevBase = int2(prevPos);
+
+        prevSignal = float3(0.0f);
+        prevMoments = float2(0.0f);
+
+        bool v[4];
+        const int2 offset[4] = { int2(0, 0), int2(1, 0), int2(0, 1), int2(1, 1) };
+
+        // Check for all 4 taps of the bilinear filter for validity
+        bool valid = false;
+        for (int sampleIdx = 0; sampleIdx < 4; ++sampleIdx)
+        {
+            const int2 loc = prevBase + offset[sampleIdx];
+            const float4 depthPrev = mPrevLinearZ.load(loc.x, loc.y);
+            const float3 normalPrev = octToDir(depthPrev.w);
+
+            v[sampleIdx] = isReprojectionValid(iposPrev, depth.z, depthPrev.x, depth.y, normal, normalPrev, normalFwidth);
+            valid = valid || v[sampleIdx];
+        }
+
+        // Perform bilinear interpolation
+        if (valid)
+        {
+            float sumWeights = 0.0f;
+            const float fx = fract(prevPos.x);
+            const float fy = fract(prevPos.y);
+            const float w[4] = { (1 - fx) * (1 - fy), fx * (1 - fy), (1 - fx) * fy, fx * fy };
+
+            for (int sampleIdx = 0; sampleIdx < 4; ++sampleIdx)
+            {
+                if (v[sampleIdx])
+                {
+                    const int2 loc = prevBase + offset[sampleIdx];
+                    prevSignal += w[sampleIdx] * float3(mLastFiltered.load(loc.x, loc.y));
+                    prevMoments += w[sampleIdx] * loadOrZero(mPrevReproj.moments, mWidth, mHeight, loc.x, loc.y);
+                    sumWeights += w[sampleIdx];
+                }
+            }
+
+            // Redistribute weights in case not all taps were used
+            valid = (sumWeights >= 0.01f);
+            prevSignal = valid ? prevSignal / sumWeights : float3(0.0f);
+            prevMoments = valid ? prevMoments / sumWeights : float2(0.0f);
+        }
+
+        // Perform a cross-bilateral filter with binary decision to find some suitable samples spatially
+        if (!valid)
+        {
+            float count = 0.0f;
+            const int radius = 1;
+            for (int yy = -radius; yy <= radius; ++yy)
+            {
+                for (int xx = -radius; xx <= radius; ++xx)
+                {
+                    const int2 p = iposPrev + int2(xx, yy);
+                    const float4 depthP = mPrevLinearZ.load(p.x, p.y);
+                    const float3 normalP = octToDir(depthP.w);
+
+                    if (isReprojectionValid(iposPrev, depth.z, depthP.x, depth.y, normal, normalP, normalFwidth))
+                    {
+                        prevSignal += float3(mLastFiltered.load(p.x, p.y));
+                        prevMoments += loadOrZero(mPrevReproj.moments, mWidth, mHeight, p.x, p.y);
+                        count += 1.0f;
+                    }
+                }
+            }
+
+            if (count > 0.0f)
+            {
+                valid = true;
+                prevSignal /= count;
+                prevMoments /= count;
+            }
+        }
+
+        if (valid)
+        {
+            historyLength = loadOrZero(mPrevReproj.historyLength, mWidth, mHeight, iposPrev.x, iposPrev.y);
+        }
+        else
+        {
+            prevSignal = float3(0.0f);
+            prevMoments = float2(0.0f);
+            historyLength = 0.0f;
+        }
+
+        return valid;
+    }
+
+    void CpuSVGF::temporalReprojection(const Frame& frame)
+    {
+        forEachTile([&](uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1)
+        {
+            for (uint32_t y = y0; y < y1; ++y)
+            {
+                for (uint32_t x = x0; x < x1; ++x)
+                {
+                    const size_t idx = (size_t)y * mWidth + x;
+                    float3 signal = float3(frame.inputSignal.at(x, y));
+                    if (std::isnan(signal.x) || std::isnan(signal.y) || std::isnan(signal.z))
+                    {
+                        signal = float3(0.0f);
+                    }
+
+                    if (!mSettings.enableTemporalReprojection)
+                    {
+                        // Performs a uniform bilateral filter with variance = 1
+                        mCurrReproj.signal.at(x, y) = float4(signal, 1.0f);
+                        mCurrReproj.moments[idx] = float2(0.0f);
+                        mCurrReproj.historyLength[idx] = 1.0f;
+                        continue;
+                    }
+
+                    float historyLength;
+                    float3 prevSignal;
+                    float2 prevMoments;
+                    const bool success = reprojectLastFilteredData(frame, x, y, prevSignal, prevMoments, historyLength);
+
+                    historyLength = std::min((float)kMaxHistoryLength, success ? historyLength + 1.0f : 1.0f);
+
+                    // Boost the temporal accumulation while the history is short so the samples get equal weights
+                    const float alpha = success ? std::max(mSettings.alpha, 1.0f / historyLength) : 1.0f;
+                    const float alphaMoments = success ? std::max(mSettings.momentsAlpha, 1.0f / historyLength) : 1.0f;
+
+                    float2 moments;
+                    moments.x = luminance(signal);
+                    moments.y = moments.x * moments.x;
+                    moments = glm::mix(prevMoments, moments, alphaMoments);
+
+                    const float variance = std::max(0.0f, moments.y - moments.x * moments.x);
+
+                    mCurrReproj.signal.at(x, y) = float4(glm::mix(prevSignal, signal, alpha), variance);
+                    mCurrReproj.moments[idx] = moments;
+                    mCurrReproj.historyLength[idx] = historyLength;
+                }
+            }
+        });
+    }
+
+    void CpuSVGF::spatialVarianceEstimation(const Frame& frame)
+    {
+        const Image& input = mCurrReproj.signal;
+
+        forEachTile([&](uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1)
+        {
+            for (uint32_t y = y0; y < y1; ++y)
+            {
+                for (uint32_t x = x0; x < x1; ++x)
+                {
+                    const float h = mCurrReproj.historyLength[(size_t)y * mWidth + x];
+                    if (h >= 4.0f || !mSettings.enableSpatialVarianceEstimation)
+                    {
+                        mAtrousPing.at(x, y) = input.at(x, y);
+                        continue;
+                    }
+
+                    const Sample center = fetchSample(input, frame, x, y);
+                    if (center.linearZ < 0.0f) // Not a valid depth, must be the sky box
+                    {
+                        mAtrousPing.at(x, y) = float4(center.signal, center.variance);
+                        continue;
+                    }
+
+                    const float phiDepth = std::max(center.zDerivative, 1e-8f) * 3.0f;
+
+                    float sumWeight = 0.0f;
+                    float3 sumSignal(0.0f);
+                    float2 sumMoments(0.0f);
+
+                    // Compute the first and second moment spatially, with a cross-bilateral filter on the signal
+                    const int radius = 3;
+                    for (int yy = -radius; yy <= radius; ++yy)
+                    {
+                        for (int xx = -radius; xx <= radius; ++xx)
+                        {
+                            const int px = (int)x + xx;
+                            const int py = (int)y + yy;
+                            if (px < 0 || py < 0 || px >= (int)mWidth || py >= (int)mHeight) continue;
+
+                            const Sample p = fetchSample(input, frame, px, py);
+                            const float2 momentsP = mCurrReproj.moments[(size_t)py * mWidth + px];
+                            const float weight = computeWeight(center, p, phiDepth * glm::length(float2(xx, yy)), mSettings.phiNormal, mSettings.phiColor);
+
+                            sumWeight += weight;
+                            sumSignal += p.signal * weight;
+                            sumMoments += momentsP * weight;
+                        }
+                    }
+
+                    sumWeight = std::max(sumWeight, 1e-6f);
+                    sumSignal /= sumWeight;
+                    sumMoments /= sumWeight;
+
+                    float variance = sumMoments.y - sumMoments.x * sumMoments.x;
+                    variance *= 4.0f / h; // Boost the variance for the first few frames
+
+                    mAtrousPing.at(x, y) = float4(sumSignal, variance);
+                }
+            }
+        });
+    }
+
+    void CpuSVGF::atrousFilter(const Frame& frame, uint32_t iteration, const Image& input, Image& output)
+    {
+        const int stepSize = 1 << iteration;
+        const int radius = (int)mSettings.atrousRadius;
+
+        forEachTile([&](uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1)
+        {
+            for (uint32_t y = y0; y < y1; ++y)
+            {
+                for (uint32_t x = x0; x < x1; ++x)
+                {
+                    const Sample center = fetchSample(input, frame, x, y);
+                    if (center.linearZ < 0.0f)
+                    {
+                        output.at(x, y) = float4(center.signal, center.variance);
+                        continue;
+                    }
+
+                    // Variance, filtered using a 3x3 gaussian blur
+                    float variance = 0.0f;
+                    for (int yy = -1; yy <= 1; ++yy)
+                    {
+                        for (int xx = -1; xx <= 1; ++xx)
+                        {
+                            variance += input.load(x + xx, y + yy).w * kVarianceKernel[std::abs(xx)][std::abs(yy)];
+                        }
+                    }
+
+                    const float phiColor = mSettings.phiColor * std::sqrt(std::max(0.0f, kEpsVariance + variance));
+                    const float phiDepth = std::max(center.zDerivative, 1e-8f) * stepSize;
+
+                    // Explicitly accumulate the center pixel with weight 1 to prevent issues with the edge-stopping functions
+                    float sumWeight = 1.0f;
+                    float3 sumSignal = center.signal;
+                    float sumVariance = center.variance;
+
+                    for (int yy = -radius; yy <= radius; ++yy)
+                    {
+                        for (int xx = -radius; xx <= radius; ++xx)
+                        {
+                            const int px = (int)x + xx * stepSize;
+                            const int py = (int)y + yy * stepSize;
+                            const bool inside = px >= 0 && py >= 0 && px < (int)mWidth && py < (int)mHeight;
+                            if (!inside || (xx == 0 && yy == 0)) continue;
+
+                            const Sample p = fetchSample(input, frame, px, py);
+                            const float edgeStopping = computeWeight(center, p, phiDepth * glm::length(float2(xx, yy)), mSettings.phiNormal, phiColor);
+                            const float weight = edgeStopping * kAtrousKernel[std::abs(xx)] * kAtrousKernel[std::abs(yy)];
+
+                            sumWeight += weight;
+                            sumSignal += p.signal * weight;
+                            sumVariance += p.variance * weight * weight;
+                        }
+                    }
+
+                    output.at(x, y) = float4(sumSignal / sumWeight, sumVariance / (sumWeight * sumWeight));
+                }
+            }
+        });
+    }
+
+    void CpuSVGF::prepareGeometryPlanes(const Frame& frame)
+    {
+        // The widest a-trous step plus one SIMD vector, so every load of the filter stays inside the padded rows
+        const uint32_t maxStep = 1u << (std::max(mSettings.atrousIterations, 1u) - 1);
+        const uint32_t padding = mSettings.atrousRadius * maxStep + 4;
+
+        for (Plane* pPlane : { &mNormalX, &mNormalY, &mNormalZ, &mLinearZ, &mZDerivative, &mSignalR, &mSignalG, &mSignalB, &mVariance, &mLuminance })
+        {
+            if (pPlane->pad != padding || pPlane->data.size() != (size_t)(mWidth + 2 * padding) * mHeight)
+            {
+                pPlane->resize(mWidth, mHeight, padding);
+            }
+        }
+
+        forEachTile([&](uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1)
+        {
+            for (uint32_t y = y0; y < y1; ++y)
+            {
+                for (uint32_t x = x0; x < x1; ++x)
+                {
+                    const float4 nd = frame.compactNormalDepth.at(x, y);
+                    const float3 n = glm::normalize(octToDir(nd.x));
+                    mNormalX.row(y)[x] = n.x;
+                    mNormalY.row(y)[x] = n.y;
+                    mNormalZ.row(y)[x] = n.z;
+                    mLinearZ.row(y)[x] = nd.y;
+                    mZDerivative.row(y)[x] = nd.z;
+                }
+            }
+        });
+    }
+
+    void CpuSVGF::atrousFilterSimd(uint32_t iteration, const Image& input, Image& output)
+    {
+        const int stepSize = 1 << iteration;
+        const int radius = (int)mSettings.atrousRadius;
+        const int width = (int)mWidth;
+        const int height = (int)mHeight;
+
+        // Structure of arrays copy of the signal, loads of 4 neighboring pixels are a single instruction
+        forEachTile([&](uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1)
+        {
+            for (uint32_t y = y0; y < y1; ++y)
+            {
+                for (uint32_t x = x0; x < x1; ++x)
+                {
+                    const float4 s = input.at(x, y);
+                    mSignalR.row(y)[x] = s.x;
+                    mSignalG.row(y)[x] = s.y;
+                    mSignalB.row(y)[x] = s.z;
+                    mVariance.row(y)[x] = s.w;
+                    mLuminance.row(y)[x] = luminance(float3(s));
+                }
+            }
+        });
+
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 laneOffsets = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+        const __m128 phiNormal = _mm_set1_ps(mSettings.phiNormal);
+
+        forEachTile([&](uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1)
+        {
+            for (uint32_t y = y0; y < y1; ++y)
+            {
+                // Tiles start on a multiple of 4, lanes past the end of the tile are computed and dropped
+                for (uint32_t x = x0; x < x1; x += 4)
+                {
+                    const __m128 cR = _mm_loadu_ps(mSignalR.row(y) + x);
+                    const __m128 cG = _mm_loadu_ps(mSignalG.row(y) + x);
+                    const __m128 cB = _mm_loadu_ps(mSignalB.row(y) + x);
+                    const __m128 cVar = _mm_loadu_ps(mVariance.row(y) + x);
+                    const __m128 cLum = _mm_loadu_ps(mLuminance.row(y) + x);
+                    const __m128 cNx = _mm_loadu_ps(mNormalX.row(y) + x);
+                    const __m128 cNy = _mm_loadu_ps(mNormalY.row(y) + x);
+                    const __m128 cNz = _mm_loadu_ps(mNormalZ.row(y) + x);
+                    const __m128 cZ = _mm_loadu_ps(mLinearZ.row(y) + x);
+                    const __m128 cDz = _mm_loadu_ps(mZDerivative.row(y) + x);
+
+                    // Variance, filtered using a 3x3 gaussian blur. The padding is zero like out of bounds loads.
+                    __m128 variance = zero;
+                    for (int yy = -1; yy <= 1; ++yy)
+                    {
+                        const int py = (int)y + yy;
+                        if (py < 0 || py >= height) continue;
+                        const float* pRow = mVariance.row(py) + x;
+                        for (int xx = -1; xx <= 1; ++xx)
+                        {
+                            variance = _mm_add_ps(variance, _mm_mul_ps(_mm_loadu_ps(pRow + xx), _mm_set1_ps(kVarianceKernel[std::abs(xx)][std::abs(yy)])));
+                        }
+                    }
+
+                    const __m128 phiColor = _mm_mul_ps(_mm_set1_ps(mSettings.phiColor), _mm_sqrt_ps(_mm_max_ps(zero, _mm_add_ps(_mm_set1_ps(kEpsVariance), variance))));
+                    const __m128 invPhiColor = _mm_div_ps(one, phiColor);
+                    const __m128 phiDepth = _mm_mul_ps(_mm_max_ps(cDz, _mm_set1_ps(1e-8f)), _mm_set1_ps((float)stepSize));
+
+                    __m128 sumWeight = one;
+                    __m128 sumR = cR, sumG = cG, sumB = cB;
+                    __m128 sumVariance = cVar;
+
+                    for (int yy = -radius; yy <= radius; ++yy)
+                    {
+                        const int py = (int)y + yy * stepSize;
+                        if (py < 0 || py >= height) continue;
+
+                        for (int xx = -radius; xx <= radius; ++xx)
+                        {
+                            if (xx == 0 && yy == 0) continue;
+
+                            const int dx = xx * stepSize;
+                            const __m128 laneX = _mm_add_ps(_mm_set1_ps(float((int)x + dx)), laneOffsets);
+                            const __m128 inside = _mm_and_ps(_mm_cmpge_ps(laneX, zero), _mm_cmplt_ps(laneX, _mm_set1_ps((float)width)));
+
+                            const int offset = (int)x + dx;
+                            const __m128 nDot = _mm_add_ps(_mm_add_ps(
+                                _mm_mul_ps(cNx, _mm_loadu_ps(mNormalX.row(py) + offset)),
+                                _mm_mul_ps(cNy, _mm_loadu_ps(mNormalY.row(py) + offset))),
+                                _mm_mul_ps(cNz, _mm_loadu_ps(mNormalZ.row(py) + offset)));
+                            const __m128 cosN = _mm_min_ps(_mm_max_ps(nDot, zero), one);
+
+                            // phiDepth * length is never 0 away from the center, the shader's guard isn't needed
+                            const __m128 invPhiDepth = _mm_div_ps(one, _mm_mul_ps(phiDepth, _mm_set1_ps(glm::length(float2(xx, yy)))));
+                            const __m128 wZ = _mm_mul_ps(abs4(_mm_sub_ps(cZ, _mm_loadu_ps(mLinearZ.row(py) + offset))), invPhiDepth);
+                            const __m128 wL = _mm_mul_ps(abs4(_mm_sub_ps(cLum, _mm_loadu_ps(mLuminance.row(py) + offset))), invPhiColor);
+
+                            // pow(cosN, phiNormal) * exp(-wL - wZ) folded into a single exp
+                            const __m128 exponent = _mm_sub_ps(_mm_sub_ps(_mm_mul_ps(phiNormal, log4(cosN)), wL), wZ);
+                            const __m128 valid = _mm_and_ps(inside, _mm_cmpgt_ps(cosN, zero));
+                            const __m128 kernel = _mm_set1_ps(kAtrousKernel[std::abs(xx)] * kAtrousKernel[std::abs(yy)]);
+                            const __m128 weight = _mm_and_ps(valid, _mm_mul_ps(exp4(exponent), kernel));
+
+                            sumWeight = _mm_add_ps(sumWeight, weight);
+                            sumR = _mm_add_ps(sumR, _mm_mul_ps(weight, _mm_loadu_ps(mSignalR.row(py) + offset)));
+                            sumG = _mm_add_ps(sumG, _mm_mul_ps(weight, _mm_loadu_ps(mSignalG.row(py) + offset)));
+                            sumB = _mm_add_ps(sumB, _mm_mul_ps(weight, _mm_loadu_ps(mSignalB.row(py) + offset)));
+                            sumVariance = _mm_add_ps(sumVariance, _mm_mul_ps(_mm_mul_ps(weight, weight), _mm_loadu_ps(mVariance.row(py) + offset)));
+                        }
+                    }
+
+                    const __m128 invWeight = _mm_div_ps(one, sumWeight);
+                    // Pixels without a valid depth (the sky box) pass through
+                    const __m128 sky = _mm_cmplt_ps(cZ, zero);
+                    alignas(16) float r[4], g[4], b[4], v[4];
+                    _mm_store_ps(r, select(sky, cR, _mm_mul_ps(sumR, invWeight)));
+                    _mm_store_ps(g, select(sky, cG, _mm_mul_ps(sumG, invWeight)));
+                    _mm_store_ps(b, select(sky, cB, _mm_mul_ps(sumB, invWeight)));
+                    _mm_store_ps(v, select(sky, cVar, _mm_mul_ps(sumVariance, _mm_mul_ps(invWeight, invWeight))));
+
+                    const uint32_t laneCount = std::min(4u, x1 - x);
+                    for (uint32_t i = 0; i < laneCount; ++i)
+                    {
+                        output.at(x + i, y) = float4(r[i], g[i], b[i], v[i]);
+                    }
+                }
+            }
+        });
+    }
+
+    CpuSVGF::ImageDifference CpuSVGF::compare(const Image& a, const Image& b, float tolerance)
+    {
+        ImageDifference diff;
+        if (a.width != b.width || a.height != b.height)
+        {
+            logError("CpuSVGF::compare() - the images have different sizes");
+            diff.maxError = std::numeric_limits<float>::infinity();
+            diff.rmse = std::numeric_limits<float>::infinity();
+            diff.differingPixels = std::max(a.width * a.height, b.width * b.height);
+            return diff;
+        }
+
+        double sumSquares = 0.0;
+        for (size_t i = 0; i < a.pixels.size(); ++i)
+        {
+            const float3 d = glm::abs(float3(a.pixels[i]) - float3(b.pixels[i]));
+            const float maxChannel = std::max(d.x, std::max(d.y, d.z));
+            diff.maxError = std::max(diff.maxError, maxChannel);
+            if (maxChannel > tolerance) diff.differingPixels++;
+            sumSquares += glm::dot(d, d);
+        }
+        diff.rmse = a.pixels.empty() ? 0.0f : (float)std::sqrt(sumSquares / (a.pixels.size() * 3));
+        return diff;
+    }
+}
@@ -0,0 +1,199 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include "Falcor.h"
+
+namespace Falcor
+{
+    /** CPU reference implementation of SVGFPass.
+        Mirrors the reprojection, variance estimation and a-trous shaders so captured frame sequences can be denoised
+        offline and parameter changes can be regression-tested against golden images without a GPU. Passes are split
+        into tiles that run in parallel, the a-trous filter processes four pixels at a time with SSE.
+        Intermediate buffers are kept in 32-bit floats while SVGFPass stores them in half precision, compare against
+        GPU output with a tolerance.
+    */
+    class CpuSVGF
+    {
+    public:
+        using SharedPtr = std::shared_ptr<CpuSVGF>;
+
+        /** Same meaning and defaults as the SVGFPass parameters
+        */
+        struct Settings
+        {
+            uint32_t atrousIterations = 4;
+            uint32_t feedbackTap = 1;
+            uint32_t atrousRadius = 2;          ///< 1 or 2
+            float alpha = 0.15f;
+            float momentsAlpha = 0.2f;
+            float phiColor = 10.0f;
+            float phiNormal = 128.0f;
+            bool enableTemporalReprojection = true;
+            bool enableSpatialVarianceEstimation = true;
+
+            uint32_t tileSize = 64;             ///< Rounded up to a multiple of 4
+            uint32_t threadCount = 0;           ///< 0 uses all hardware threads
+            bool useSimd = true;
+        };
+
+        /** RGBA32 image, top row first
+        */
+        struct Image
+        {
+            uint32_t width = 0;
+            uint32_t height = 0;
+            std::vector<float4> pixels;
+
+            void resize(uint32_t w, uint32_t h) { width = w; height = h; pixels.assign((size_t)w * h, float4(0.0f)); }
+            float4& at(int x, int y) { return pixels[(size_t)y * width + x]; }
+            const float4& at(int x, int y) const { return pixels[(size_t)y * width + x]; }
+
+            /** Out of bounds loads return 0, like texture loads in the shaders
+            */
+            float4 load(int x, int y) const { return (x >= 0 && y >= 0 && x < (int)width && y < (int)height) ? at(x, y) : float4(0.0f); }
+
+            /** Read back a RGBA32Float or RGBA16Float texture
+            */
+            static bool readTexture(RenderContext* pContext, const Texture::SharedPtr& pTexture, Image& image);
+
+            /** Save to/load from PFM or EXR. Golden images should be PFM, EXR rounds to half precision.
+            */
+            void save(const std::string& filename) const;
+            static bool load(const std::string& filename, Image& image);
+        };
+
+        /** The SVGFPass::Execute() inputs of one frame. linearZ and compactNormalDepth carry bit-packed normals,
+            frames are saved in a raw binary format instead of an image format that would round them.
+        */
+        struct Frame
+        {
+            Image inputSignal;
+            Image motionVec;
+            Image linearZ;
+            Image compactNormalDepth;
+
+            static bool capture(RenderContext* pContext, const Texture::SharedPtr& pInputSignal, const Texture::SharedPtr& pMotionVec,
+                                const Texture::SharedPtr& pLinearZ, const Texture::SharedPtr& pNormalDepth, Frame& frame);
+            bool save(const std::string& filename) const;
+            static bool load(const std::string& filename, Frame& frame);
+        };
+
+        struct ImageDifference
+        {
+            float maxError = 0.0f;      ///< Largest absolute difference of any RGB channel
+            float rmse = 0.0f;          ///< Over all RGB channels
+            uint32_t differingPixels = 0;
+        };
+
+        static SharedPtr create(uint32_t width, uint32_t height, const Settings& settings = Settings());
+
+        void setSettings(const Settings& settings) { mSettings = settings; }
+        const Settings& getSettings() const { return mSettings; }
+
+        /** Denoise the next frame of a sequence. The history of the previous frames is used for temporal reprojection.
+            \return The filtered signal in rgb and its variance in a, valid until the next call
+        */
+        const Image& execute(const Frame& frame);
+
+        /** Forget the history, the next frame starts a new sequence
+        */
+        void reset();
+
+        /** Time spent in the last execute(), in ms
+        */
+        double getLastExecuteTime() const { return mLastExecuteTime; }
+
+        /** Compare the RGB channels of two images of the same size.
+            \param[in] tolerance Absolute difference above which a pixel counts as differing
+        */
+        static ImageDifference compare(const Image& a, const Image& b, float tolerance = 1e-3f);
+
+    private:
+        CpuSVGF(uint32_t width, uint32_t height, const Settings& settings);
+
+        struct ReprojectionBuffers
+        {
+            Image signal;                   ///< Signal, variance
+            std::vector<float2> moments;
+            std::vector<float> historyLength;
+        };
+
+        /** A single channel with a zeroed border so four neighboring pixels can be loaded without bounds checks
+        */
+        struct Plane
+        {
+            uint32_t pad = 0;
+            uint32_t stride = 0;
+            std::vector<float> data;
+
+            void resize(uint32_t width, uint32_t height, uint32_t padding);
+            float* row(int y) { return data.data() + (size_t)y * stride + pad; }
+            const float* row(int y) const { return data.data() + (size_t)y * stride + pad; }
+        };
+
+        struct Sample
+        {
+            float3 signal;
+            float variance;
+            float3 normal;
+            float linearZ;
+            float zDerivative;
+            float luminance;
+        };
+
+        Sample fetchSample(const Image& signal, const Frame& frame, int x, int y) const;
+        float computeWeight(const Sample& center, const Sample& p, float phiDepth, float phiNormal, float phiColor) const;
+        bool isReprojectionValid(int2 coord, float z, float zPrev, float fwidthZ, const float3& normal, const float3& normalPrev, float fwidthNormal) const;
+        bool reprojectLastFilteredData(const Frame& frame, int x, int y, float3& prevSignal, float2& prevMoments, float& historyLength) const;
+
+        void forEachTile(const std::function<void(uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1)>& func) const;
+        void temporalReprojection(const Frame& frame);
+        void spatialVarianceEstimation(const Frame& frame);
+        void atrousFilter(const Frame& frame, uint32_t iteration, const Image& input, Image& output);
+        void atrousFilterSimd(uint32_t iteration, const Image& input, Image& output);
+        void prepareGeometryPlanes(const Frame& frame);
+
+        uint32_t mWidth;
+        uint32_t mHeight;
+        Settings mSettings;
+
+        ReprojectionBuffers mCurrReproj;
+        ReprojectionBuffers mPrevReproj;
+        Image mPrevLinearZ;
+        Image mLastFiltered;
+        Image mAtrousPing;
+        Image mAtrousPong;
+        Image mOutput;
+
+        // Structure of arrays copies of the inputs of the SIMD a-trous filter
+        Plane mNormalX, mNormalY, mNormalZ, mLinearZ, mZDerivative;
+        Plane mSignalR, mSignalG, mSignalB, mVariance, mLuminance;
+
+        double mLastExecuteTime = 0.0;
+    };
+}
@@ -0,0 +1,600 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "CpuSceneBvh.h"
+
+namespace Falcor
+{
+    namespace
+    {
+        float srgbToLinear(float c)
+        {
+            return (c <= 0.04045f) ? (c / 12.92f) : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+
+        /** Average color of a texture computed from its smallest mip level. Only 8-bit RGBA/BGRA formats are supported.
+        */
+        bool computeTextureAverage(RenderContext* pContext, const Texture* pTexture, float4& average)
+        {
+            ResourceFormat format = pTexture->getFormat();
+            bool bgra = false;
+            switch (format)
+            {
+            case ResourceFormat::RGBA8Unorm:
+            case ResourceFormat::RGBA8UnormSrgb:
+                break;
+            case ResourceFormat::BGRA8Unorm:
+            case ResourceFormat::BGRA8UnormSrgb:
+            case ResourceFormat::BGRX8Unorm:
+            case ResourceFormat::BGRX8UnormSrgb:
+                bgra = true;
+                break;
+            default:
+                return false;
+            }
+
+            uint32_t mip = pTexture->getMipCount() - 1;
+            std::vector<uint8> data = pContext->readTextureSubresource(pTexture, pTexture->getSubresourceIndex(0, mip));
+            uint32_t texelCount = pTexture->getWidth(mip) * pTexture->getHeight(mip);
+            if (texelCount == 0 || data.size() < texelCount * 4)
+            {
+                return false;
+            }
+
+            bool srgb = isSrgbFormat(format);
+            bool hasAlpha = doesFormatHasAlpha(format);
+            glm::dvec4 sum(0.0);
+            for (uint32_t i = 0; i < texelCount; ++i)
+            {
+                float4 c = float4(data[i * 4 + 0], data[i * 4 + 1], data[i * 4 + 2], data[i * 4 + 3]) / 255.0f;
+                if (bgra) std::swap(c.r, c.b);
+                if (srgb)
+                {
+                    c.r = srgbToLinear(c.r);
+                    c.g = srgbToLinear(c.g);
+                    c.b = srgbToLinear(c.b);
+                }
+                if (!hasAlpha) c.a = 1.0f;
+                sum += glm::dvec4(c);
+            }
+            average = float4(sum / double(texelCount));
+            return true;
+        }
+
+        CpuSceneBvh::SurfaceMaterial convertMaterial(RenderContext* pContext, const Material* pMaterial, std::unordered_map<const Texture*, float4>& textureAverages)
+        {
+            // Mirrors prepareShadingData() in Shading.slang, textures are replaced by their average color
+            float4 baseColor = pMaterial->getBaseColor();
+            const Texture* pBaseColorTex = pMaterial->getBaseColorTexture().get();
+            if (pBaseColorTex)
+            {
+                auto it = textureAverages.find(pBaseColorTex);
+                if (it == textureAverages.end())
+                {
+                    float4 average = baseColor;
+                    if (!computeTextureAverage(pContext, pBaseColorTex, average))
+                    {
+                        logWarning("CpuSceneBvh: unsupported base color texture format " + to_string(pBaseColorTex->getFormat()) + ", using the constant base color of material '" + pMaterial->getName() + "'");
+                    }
+                    it = textureAverages.emplace(pBaseColorTex, average).first;
+                }
+                baseColor = it->second;
+            }
+
+            float4 spec = pMaterial->getSpecularParams();
+            CpuSceneBvh::SurfaceMaterial m;
+            if (pMaterial->getShadingModel() == ShadingModelMetalRough)
+            {
+                m.diffuse = glm::mix(float3(baseColor), float3(0.0f), spec.b);
+                m.linearRoughness = spec.g;
+            }
+            else
+            {
+                m.diffuse = float3(baseColor);
+                m.linearRoughness = 1.0f - spec.a;
+            }
+            m.linearRoughness = std::max(0.08f, m.linearRoughness);
+            m.emissive = pMaterial->getEmissiveColor();
+            return m;
+        }
+
+        /** Read back positions, normals and indices of a triangle list mesh. Normals are left empty if the mesh has none.
+        */
+        bool readMeshGeometry(const Mesh* pMesh, std::vector<float3>& positions, std::vector<float3>& normals, std::vector<uint32_t>& indices)
+        {
+            const Vao* pVao = pMesh->getVao().get();
+            if (pVao->getPrimitiveTopology() != Vao::Topology::TriangleList)
+            {
+                logWarning("CpuSceneBvh: skipping a mesh with a topology other than triangle list");
+                return false;
+            }
+
+            const uint32_t vertCnt = pMesh->getVertexCount();
+            positions.clear();
+            normals.clear();
+            for (uint32_t vbIdx = 0; vbIdx < pVao->getVertexBuffersCount(); ++vbIdx)
+            {
+                const VertexBufferLayout* pLayout = pVao->getVertexLayout()->getBufferLayout(vbIdx).get();
+                if (pLayout == nullptr) continue;
+
+                const Buffer::SharedPtr& pVB = pVao->getVertexBuffer(vbIdx);
+                const uint8_t* pVBData = nullptr;
+                for (uint32_t elemIdx = 0; elemIdx < pLayout->getElementCount(); ++elemIdx)
+                {
+                    const std::string& name = pLayout->getElementName(elemIdx);
+                    const bool isPosition = (name == VERTEX_POSITION_NAME);
+                    std::vector<float3>* pTarget = isPosition ? &positions : ((name == VERTEX_NORMAL_NAME) ? &normals : nullptr);
+                    if (pTarget == nullptr) continue;
+
+                    // Compressed layouts are decoded through VertexCompression, unsupported formats leave the stream empty
+                    const ResourceFormat format = pLayout->getElementFormat(elemIdx);
+
+                    if (pVBData == nullptr) pVBData = (const uint8_t*)pVB->map(Buffer::MapType::Read);
+                    const uint8_t* pData = pVBData + pLayout->getElementOffset(elemIdx);
+                    pTarget->resize(vertCnt);
+                    for (uint32_t vertIdx = 0; vertIdx < vertCnt; ++vertIdx)
+                    {
+                        bool supported = isPosition ? VertexCompression::readPosition(pData, format, pMesh->getPositionQuantizationBox(), (*pTarget)[vertIdx]) : VertexCompression::readDirection(pData, format, (*pTarget)[vertIdx]);
+                        if (supported == false)
+                        {
+                            pTarget->clear();
+                            break;
+                        }
+                        pData += pLayout->getStride();
+                    }
+                }
+                if (pVBData) pVB->unmap();
+            }
+
+            if (positions.empty())
+            {
+                logWarning("CpuSceneBvh: skipping a mesh without positions in a supported format");
+                return false;
+            }
+
+            const Buffer::SharedPtr& pIB = pVao->getIndexBuffer();
+            indices.resize(pMesh->getPrimitiveCount() * 3);
+            if (pIB == nullptr)
+            {
+                for (uint32_t i = 0; i < (uint32_t)indices.size(); ++i) indices[i] = i;
+            }
+            else if (pVao->getIndexBufferFormat() == ResourceFormat::R32Uint)
+            {
+                const uint32_t* pData = (const uint32_t*)pIB->map(Buffer::MapType::Read);
+                std::memcpy(indices.data(), pData, indices.size() * sizeof(uint32_t));
+                pIB->unmap();
+            }
+            else if (pVao->getIndexBufferFormat() == ResourceFormat::R16Uint)
+            {
+                const uint16_t* pData = (const uint16_t*)pIB->map(Buffer::MapType::Read);
+                for (size_t i = 0; i < indices.size(); ++i) indices[i] = pData[i];
+                pIB->unmap();
+            }
+            else
+            {
+                logWarning("CpuSceneBvh: unsupported index buffer format");
+                return false;
+            }
+
+            for (uint32_t idx : indices)
+            {
+                if (idx >= vertCnt)
+                {
+                    logWarning("CpuSceneBvh: skipping a mesh with out of range indices");
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        float surfaceArea(const float3& boundsMin, const float3& boundsMax)
+        {
+            float3 d = glm::max(boundsMax - boundsMin, float3(0.0f));
+            return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+        }
+
+        bool intersectTriangle(const CpuSceneBvh::Triangle& tri, const float3& origin, const float3& dir, float tMin, float tMax, float& t, float2& bary)
+        {
+            // Moller-Trumbore
+            float3 e1 = tri.p1 - tri.p0;
+            float3 e2 = tri.p2 - tri.p0;
+            float3 pv = glm::cross(dir, e2);
+            float det = glm::dot(e1, pv);
+            if (std::abs(det) < 1e-12f) return false;
+
+            float invDet = 1.0f / det;
+            float3 tv = origin - tri.p0;
+            float u = glm::dot(tv, pv) * invDet;
+            if (u < 0.0f || u > 1.0f) return false;
+
+            float3 qv = glm::cross(tv, e1);
+            float v = glm::dot(dir, qv) * invDet;
+            if (v < 0.0f || u + v > 1.0f) return false;
+
+            float hitT = glm::dot(e2, qv) * invDet;
+            if (hitT < tMin || hitT > tMax) return false;
+
+            t = hitT;
+            bary = float2(u, v);
+            return true;
+        }
+
+        bool intersectBounds(const float3& boundsMin, const float3& boundsMax, const float3& origin, const float3& invDir, float tMin, float tMax, float& tEntry)
+        {
+            float3 t0 = (boundsMin - origin) * invDir;
+            float3 t1 = (boundsMax - origin) * invDir;
+            float3 tNear = glm::min(t0, t1);
+            float3 tFar = glm::max(t0, t1);
+            float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, tMin));
+            float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, tMax));
+            tEntry = enter;
+            return enter <= exit;
+        }
+    }
+
+    CpuSceneBvh::SharedPtr CpuSceneBvh::create(const Scene* pScene, RenderContext* pContext)
+    {
+        std::vector<Triangle> triangles;
+        std::vector<SurfaceMaterial> materials;
+        std::unordered_map<const Material*, uint32_t> materialIds;
+        std::unordered_map<const Texture*, float4> textureAverages;
+
+        std::vector<float3> positions;
+        std::vector<float3> normals;
+        std::vector<uint32_t> indices;
+
+        for (uint32_t modelId = 0; modelId < pScene->getModelCount(); ++modelId)
+        {
+            const Model* pModel = pScene->getModel(modelId).get();
+            for (uint32_t meshId = 0; meshId < pModel->getMeshCount(); ++meshId)
+            {
+                const Mesh* pMesh = pModel->getMesh(meshId).get();
+                // Skinned meshes are captured in their bind pose
+                if (!readMeshGeometry(pMesh, positions, normals, indices)) continue;
+
+                const Material* pMaterial = pMesh->getMaterial().get();
+                auto matIt = materialIds.find(pMaterial);
+                if (matIt == materialIds.end())
+                {
+                    matIt = materialIds.emplace(pMaterial, (uint32_t)materials.size()).first;
+                    materials.push_back(pMaterial ? convertMaterial(pContext, pMaterial, textureAverages) : SurfaceMaterial());
+                }
+                const uint32_t materialId = matIt->second;
+
+                for (uint32_t instanceId = 0; instanceId < pScene->getModelInstanceCount(modelId); ++instanceId)
+                {
+                    const auto& pModelInstance = pScene->getModelInstance(modelId, instanceId);
+                    if (!pModelInstance->isVisible()) continue;
+
+                    for (uint32_t meshInstanceId = 0; meshInstanceId < pModel->getMeshInstanceCount(meshId); ++meshInstanceId)
+                    {
+                        const auto& pMeshInstance = pModel->getMeshInstance(meshId, meshInstanceId);
+                        if (!pMeshInstance->isVisible()) continue;
+
+                        // Same composition as SceneRenderer
+                        glm::mat4 worldMat = pModelInstance->getTransformMatrix() * pMeshInstance->getTransformMatrix();
+                        appendMesh(positions, normals, indices, worldMat, materialId, triangles);
+                    }
+                }
+            }
+        }
+
+        return create(std::move(triangles), std::move(materials));
+    }
+
+    void CpuSceneBvh::appendMesh(const std::vector<float3>& positions, const std::vector<float3>& normals, const std::vector<uint32_t>& indices,
+                                 const glm::mat4& worldMat, uint32_t materialId, std::vector<Triangle>& triangles)
+    {
+        glm::mat3 normalMat = glm::transpose(glm::inverse(glm::mat3(worldMat)));
+
+        for (size_t i = 0; i + 2 < indices.size(); i += 3)
+        {
+            Triangle tri;
+            tri.p0 = float3(worldMat * float4(positions[indices[i + 0]], 1.0f));
+            tri.p1 = float3(worldMat * float4(positions[indices[i + 1]], 1.0f));
+            tri.p2 = float3(worldMat * float4(positions[indices[i + 2]], 1.0f));
+            if (normals.empty())
+            {
+                float3 n = glm::cross(tri.p1 - tri.p0, tri.p2 - tri.p0);
+                tri.n0 = tri.n1 = tri.n2 = n;
+            }
+            else
+            {
+                tri.n0 = normalMat * normals[indices[i + 0]];
+                tri.n1 = normalMat * normals[indices[i + 1]];
+                tri.n2 = normalMat * normals[indices[i + 2]];
+            }
+            tri.materialId = materialId;
+            triangles.push_back(tri);
+        }
+    }
+
+    CpuSceneBvh::SharedPtr CpuSceneBvh::create(std::vector<Triangle> triangles, std::vector<SurfaceMaterial> materials)
+    {
+        if (materials.empty())
+        {
+            materials.push_back(SurfaceMaterial());
+        }
+        for (auto& tri : triangles)
+        {
+            if (tri.materialId >= materials.size())
+            {
+                logWarning("CpuSceneBvh: triangle references an invalid material, using material 0 instead");
+                tri.materialId = 0;
+            }
+        }
+
+        SharedPtr pBvh = SharedPtr(new CpuSceneBvh());
+        pBvh->mTriangles = std::move(triangles);
+        pBvh->mMaterials = std::move(materials);
+        pBvh->build();
+        return pBvh;
+    }
+
+    void CpuSceneBvh::build()
+    {
+        mNodes.clear();
+        mBoundingBox = BoundingBox();
+        if (mTriangles.empty()) return;
+
+        const uint32_t triCount = (uint32_t)mTriangles.size();
+        std::vector<uint32_t> order(triCount);
+        std::vector<float3> centroids(triCount);
+        for (uint32_t i = 0; i < triCount; ++i)
+        {
+            order[i] = i;
+            centroids[i] = (mTriangles[i].p0 + mTriangles[i].p1 + mTriangles[i].p2) * (1.0f / 3.0f);
+        }
+
+        mNodes.reserve(2 * triCount / MaxLeafSize + 1);
+        mNodes.emplace_back();
+        buildRecursive(0, 0, triCount, 0, order, centroids);
+
+        // Store the triangles in leaf order so leaves reference contiguous ranges
+        std::vector<Triangle> sorted(triCount);
+        for (uint32_t i = 0; i < triCount; ++i)
+        {
+            sorted[i] = mTriangles[order[i]];
+        }
+        mTriangles.swap(sorted);
+
+        mBoundingBox = BoundingBox::fromMinMax(mNodes[0].boundsMin, mNodes[0].boundsMax);
+    }
+
+    void CpuSceneBvh::buildRecursive(uint32_t nodeIdx, uint32_t first, uint32_t count, uint32_t depth, std::vector<uint32_t>& order, const std::vector<float3>& centroids)
+    {
+        float3 boundsMin(std::numeric_limits<float>::max());
+        float3 boundsMax(-std::numeric_limits<float>::max());
+        float3 centroidMin = boundsMin;
+        float3 centroidMax = boundsMax;
+        for (uint32_t i = first; i < first + count; ++i)
+        {
+            const Triangle& tri = mTriangles[order[i]];
+            boundsMin = glm::min(boundsMin, glm::min(tri.p0, glm::min(tri.p1, tri.p2)));
+            boundsMax = glm::max(boundsMax, glm::max(tri.p0, glm::max(tri.p1, tri.p2)));
+            centroidMin = glm::min(centroidMin, centroids[order[i]]);
+            centroidMax = glm::max(centroidMax, centroids[order[i]]);
+        }
+
+        mNodes[nodeIdx].boundsMin = boundsMin;
+        mNodes[nodeIdx].boundsMax = boundsMax;
+        mNodes[nodeIdx].offset = first;
+        mNodes[nodeIdx].count = count;
+
+        float3 centroidExtent = centroidMax - centroidMin;
+        int axis = (centroidExtent.x > centroidExtent.y && centroidExtent.x > centroidExtent.z) ? 0 : ((centroidExtent.y > centroidExtent.z) ? 1 : 2);
+        if (count <= MaxLeafSize || centroidExtent[axis] <= 0.0f) return;
+
+        uint32_t* pBegin = order.data() + first;
+        uint32_t* pEnd = pBegin + count;
+        uint32_t* pMid = nullptr;
+
+        if (depth < MaxSahDepth)
+        {
+            // Binned SAH along the axis with the largest centroid extent
+            struct Bin
+            {
+                float3 boundsMin = float3(std::numeric_limits<float>::max());
+                float3 boundsMax = float3(-std::numeric_limits<float>::max());
+                uint32_t count = 0;
+            } bins[SahBinCount];
+
+            const float scale = float(SahBinCount) / centroidExtent[axis];
+            auto binIndex = [&](uint32_t triIdx)
+            {
+                int b = int((centroids[triIdx][axis] - centroidMin[axis]) * scale);
+                return glm::clamp(b, 0, SahBinCount - 1);
+            };
+
+            for (uint32_t* p = pBegin; p != pEnd; ++p)
+            {
+                const Triangle& tri = mTriangles[*p];
+                Bin& bin = bins[binIndex(*p)];
+                bin.boundsMin = glm::min(bin.boundsMin, glm::min(tri.p0, glm::min(tri.p1, tri.p2)));
+                bin.boundsMax = glm::max(bin.boundsMax, glm::max(tri.p0, glm::max(tri.p1, tri.p2)));
+                bin.count++;
+            }
+
+            float rightCost[SahBinCount];
+            {
+                Bin acc;
+                for (int b = SahBinCount - 1; b > 0; --b)
+                {
+                    acc.boundsMin = glm::min(acc.boundsMin, bins[b].boundsMin);
+                    acc.boundsMax = glm::max(acc.boundsMax, bins[b].boundsMax);
+                    acc.count += bins[b].count;
+                    rightCost[b] = acc.count ? surfaceArea(acc.boundsMin, acc.boundsMax) * acc.count : 0.0f;
+                }
+            }
+
+            float bestCost = std::numeric_limits<float>::max();
+            int bestSplit = -1;
+            Bin acc;
+            for (int b = 0; b < SahBinCount - 1; ++b)
+            {
+                acc.boundsMin = glm::min(acc.boundsMin, bins[b].boundsMin);
+                acc.boundsMax = glm::max(acc.boundsMax, bins[b].boundsMax);
+                acc.count += bins[b].count;
+                if (acc.count == 0 || acc.count == count) continue;
+                float cost = surfaceArea(acc.boundsMin, acc.boundsMax) * acc.count + rightCost[b + 1];
+                if (cost < bestCost)
+                {
+                    bestCost = cost;
+                    bestSplit = b;
+                }
+            }
+
+            // Traversal cost relative to a triangle test is assumed to be 1
+            const float leafCost = float(count);
+            const float parentArea = surfaceArea(boundsMin, boundsMax);
+            if (bestSplit >= 0 && parentArea > 0.0f)
+            {
+                if (1.0f + bestCost / parentArea >= leafCost && count <= 4 * MaxLeafSize) return;
+                pMid = std::partition(pBegin, pEnd, [&](uint32_t triIdx) { return binIndex(triIdx) <= bestSplit; });
+            }
+        }
+
+        if (pMid == nullptr || pMid == pBegin || pMid == pEnd)
+        {
+            pMid = pBegin + count / 2;
+            std::nth_element(pBegin, pMid, pEnd, [&](uint32_t a, uint32_t b) { return centroids[a][axis] < centroids[b][axis]; });
+        }
+
+        const uint32_t leftCount = uint32_t(pMid - pBegin);
+        const uint32_t leftIdx = (uint32_t)mNodes.size();
+        mNodes.emplace_back();
+        buildRecursive(leftIdx, first, leftCount, depth + 1, order, centroids);
+
+        const uint32_t rightIdx = (uint32_t)mNodes.size();
+        mNodes.emplace_back();
+        buildRecursive(rightIdx, first + leftCount, count - leftCount, depth + 1, order, centroids);
+
+        mNodes[nodeIdx].offset = rightIdx;
+        mNodes[nodeIdx].count = 0;
+    }
+
+    template<bool kAnyHit>
+    bool CpuSceneBvh::traverse(const float3& origin, const float3& dir, float tMin, float tMax, Hit& hit) const
+    {
+        if (mNodes.empty()) return false;
+
+        float3 invDir;
+        for (int i = 0; i < 3; ++i)
+        {
+            invDir[i] = (std::abs(dir[i]) > 1e-20f) ? (1.0f / dir[i]) : std::copysign(1e20f, dir[i]);
+        }
+
+        bool found = false;
+        float closest = tMax;
+        uint32_t stack[MaxTraversalDepth];
+        uint32_t stackSize = 0;
+        uint32_t nodeIdx = 0;
+
+        float tEntry;
+        if (!intersectBounds(mNodes[0].boundsMin, mNodes[0].boundsMax, origin, invDir, tMin, closest, tEntry)) return false;
+
+        while (true)
+        {
+            const Node& node = mNodes[nodeIdx];
+            if (node.count > 0)
+            {
+                for (uint32_t i = node.offset; i < node.offset + node.count; ++i)
+                {
+                    float t;
+                    float2 bary;
+                    if (intersectTriangle(mTriangles[i], origin, dir, tMin, closest, t, bary))
+                    {
+                        found = true;
+                        closest = t;
+                        hit.t = t;
+                        hit.triangleIdx = i;
+                        hit.barycentrics = bary;
+                        if (kAnyHit) return true;
+                    }
+                }
+            }
+            else
+            {
+                // Visit the nearer child first
+                uint32_t children[2] = { nodeIdx + 1, node.offset };
+                float tChild[2];
+                bool hitChild[2];
+                for (int c = 0; c < 2; ++c)
+                {
+                    hitChild[c] = intersectBounds(mNodes[children[c]].boundsMin, mNodes[children[c]].boundsMax, origin, invDir, tMin, closest, tChild[c]);
+                }
+
+                if (hitChild[0] && hitChild[1])
+                {
+                    uint32_t nearIdx = (tChild[0] <= tChild[1]) ? 0 : 1;
+                    assert(stackSize < MaxTraversalDepth);
+                    stack[stackSize++] = children[1 - nearIdx];
+                    nodeIdx = children[nearIdx];
+                    continue;
+                }
+                else if (hitChild[0] || hitChild[1])
+                {
+                    nodeIdx = hitChild[0] ? children[0] : children[1];
+                    continue;
+                }
+            }
+
+            if (stackSize == 0) break;
+            nodeIdx = stack[--stackSize];
+        }
+
+        return found;
+    }
+
+    bool CpuSceneBvh::intersect(const float3& origin, const float3& dir, float tMin, float tMax, Hit& hit) const
+    {
+        return traverse<false>(origin, dir, tMin, tMax, hit);
+    }
+
+    bool CpuSceneBvh::occluded(const float3& origin, const float3& dir, float tMin, float tMax) const
+    {
+        Hit hit;
+        return traverse<true>(origin, dir, tMin, tMax, hit);
+    }
+
+    float3 CpuSceneBvh::getShadingNormal(const Hit& hit) const
+    {
+        const Triangle& tri = mTriangles[hit.triangleIdx];
+        float w = 1.0f - hit.barycentrics.x - hit.barycentrics.y;
+        float3 n = tri.n0 * w + tri.n1 * hit.barycentrics.x + tri.n2 * hit.barycentrics.y;
+        float len = glm::length(n);
+        return (len > 0.0f) ? n / len : getGeometricNormal(hit);
+    }
+
+    float3 CpuSceneBvh::getGeometricNormal(const Hit& hit) const
+    {
+        const Triangle& tri = mTriangles[hit.triangleIdx];
+        float3 n = glm::cross(tri.p1 - tri.p0, tri.p2 - tri.p0);
+        float len = glm::length(n);
+        return (len > 0.0f) ? n / len : float3(0.0f, 0.0f, 1.0f);
+    }
+}
@@ -0,0 +1,147 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include "Falcor.h"
+
+namespace Falcor
+{
+    /** CPU bounding volume hierarchy over the world-space triangles of a scene.
+        Used by the CPU probe baker and other offline tools that need to trace rays against the scene
+        without going through the rasterizer. The BVH is built from a world-space triangle soup, which doesn't need
+        a GPU. Tools that have the mesh data on the CPU fill the soup with appendMesh(). When a Scene is already
+        loaded, create(const Scene*, RenderContext*) reads the geometry back from its GPU buffers instead.
+        The BVH is static once created.
+    */
+    class CpuSceneBvh
+    {
+    public:
+        using SharedPtr = std::shared_ptr<CpuSceneBvh>;
+        using SharedConstPtr = std::shared_ptr<const CpuSceneBvh>;
+
+        /** Subset of the material parameters the probe shading pass actually uses
+        */
+        struct SurfaceMaterial
+        {
+            float3 diffuse = float3(1.0f);
+            float3 emissive = float3(0.0f);
+            float linearRoughness = 1.0f;
+        };
+
+        struct Triangle
+        {
+            float3 p0;
+            float3 p1;
+            float3 p2;
+            float3 n0;
+            float3 n1;
+            float3 n2;
+            uint32_t materialId = 0;
+        };
+
+        struct Hit
+        {
+            float t = std::numeric_limits<float>::max();
+            uint32_t triangleIdx = uint32_t(-1);
+            float2 barycentrics;
+        };
+
+        /** Create a BVH from a world-space triangle soup. This is the entry point for baking without a GPU.
+            \param[in] triangles The triangles. materialId of each triangle indexes into materials.
+            \param[in] materials The surface materials. If empty, a single default material is used.
+        */
+        static SharedPtr create(std::vector<Triangle> triangles, std::vector<SurfaceMaterial> materials);
+
+        /** Transform an indexed triangle list into world space and append it to a triangle soup.
+            \param[in] positions Object-space vertex positions
+            \param[in] normals Object-space vertex normals. If empty, the face normals are used.
+            \param[in] indices Three indices per triangle
+            \param[in] worldMat Object to world transform
+            \param[in] materialId Material index stored in the new triangles
+            \param[out] triangles The soup to append to
+        */
+        static void appendMesh(const std::vector<float3>& positions, const std::vector<float3>& normals, const std::vector<uint32_t>& indices,
+                               const glm::mat4& worldMat, uint32_t materialId, std::vector<Triangle>& triangles);
+
+        /** Convenience wrapper that creates a BVH from all visible triangle list meshes of a loaded scene.
+            The geometry is read back from the GPU vertex/index buffers, since meshes don't keep a CPU copy.
+            \param[in] pContext Context used to read back base color textures, their smallest mip gives the surface albedo
+        */
+        static SharedPtr create(const Scene* pScene, RenderContext* pContext);
+
+        /** Find the closest hit in [tMin, tMax]. Returns false on a miss.
+        */
+        bool intersect(const float3& origin, const float3& dir, float tMin, float tMax, Hit& hit) const;
+
+        /** Returns true if anything is hit in [tMin, tMax]
+        */
+        bool occluded(const float3& origin, const float3& dir, float tMin, float tMax) const;
+
+        /** Interpolated shading normal at a hit, not flipped
+        */
+        float3 getShadingNormal(const Hit& hit) const;
+        float3 getGeometricNormal(const Hit& hit) const;
+
+        const Triangle& getTriangle(uint32_t idx) const { return mTriangles[idx]; }
+        const SurfaceMaterial& getMaterial(const Hit& hit) const { return mMaterials[mTriangles[hit.triangleIdx].materialId]; }
+        uint32_t getTriangleCount() const { return (uint32_t)mTriangles.size(); }
+        uint32_t getNodeCount() const { return (uint32_t)mNodes.size(); }
+        const BoundingBox& getBoundingBox() const { return mBoundingBox; }
+
+    private:
+        CpuSceneBvh() = default;
+
+        void build();
+        void buildRecursive(uint32_t nodeIdx, uint32_t first, uint32_t count, uint32_t depth, std::vector<uint32_t>& order, const std::vector<float3>& centroids);
+
+        template<bool kAnyHit>
+        bool traverse(const float3& origin, const float3& dir, float tMin, float tMax, Hit& hit) const;
+
+        /** 32 bytes. Interior nodes store the index of the second child, the first child directly follows its parent.
+        */
+        struct Node
+        {
+            float3 boundsMin;
+            uint32_t offset;    // First triangle for leaves, second child for interior nodes
+            float3 boundsMax;
+            uint32_t count;     // Triangle count for leaves, 0 for interior nodes
+        };
+
+        enum
+        {
+            MaxLeafSize = 4,
+            SahBinCount = 16,
+            MaxSahDepth = 32,           // Below this depth nodes are split at the median to bound the tree depth
+            MaxTraversalDepth = 64,
+        };
+
+        std::vector<Node> mNodes;
+        std::vector<Triangle> mTriangles;
+        std::vector<SurfaceMaterial> mMaterials;
+        BoundingBox mBoundingBox;
+    };
+}
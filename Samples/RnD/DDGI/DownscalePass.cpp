@@ -69,11 +69,13 @@ DownscalePass::DownscalePass() : RenderPass("DownscalePass")
 void DownscalePass::execute(RenderContext* pContext,
     const Texture::SharedPtr& pSrcTex,
     int firstArraySlice,
-    const Fbo::SharedPtr& pTargetFbo)
+    const Fbo::SharedPtr& pTargetFbo,
+    Filter filter)
 {
     mpVars["PerFrameCB"]["gSizeHighRes"] = float2(pSrcTex->getWidth(), pSrcTex->getHeight());
     mpVars["PerFrameCB"]["gSizeLowRes"] = float2(pTargetFbo->getWidth(), pTargetFbo->getHeight());
     mpVars["PerFrameCB"]["gDownsampleFactor"] = float2(std::round(pSrcTex->getWidth()/pTargetFbo->getWidth()), std::round(pSrcTex->getHeight()/pTargetFbo->getHeight()));
+    mpVars["PerFrameCB"]["gPointFilter"] = (filter == Filter::Point);
 
     mpVars->getDefaultBlock()->setSrv(mSourceTexBindingLoc, 0, pSrcTex->getSRV(0, Resource::kMaxPossible, firstArraySlice));
 
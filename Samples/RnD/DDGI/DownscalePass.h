@@ -35,12 +35,21 @@ class DownscalePass : public RenderPass, inherit_shared_from_this<RenderPass, Do
 public:
     using SharedPtr = std::shared_ptr<DownscalePass>;
 
+    /** How a block of high-res texels is reduced to one low-res texel
+    */
+    enum class Filter
+    {
+        Min,    ///< Component-wise minimum over the block
+        Point,  ///< The texel under the low-res pixel center. Use it for bit-packed data and for G-buffer data that must match what a low-res pass point-samples.
+    };
+
     static SharedPtr create(const Dictionary& dict = {});
 
     void execute(RenderContext* pContext,
                  const Texture::SharedPtr& pSrcTex,
                  int firstArraySlice,
-                 const Fbo::SharedPtr& pTargetFbo);
+                 const Fbo::SharedPtr& pTargetFbo,
+                 Filter filter = Filter::Min);
 
     RenderPassReflection reflect() const override;
     void execute(RenderContext* pContext, const RenderData* pRenderData) override;
@@ -57,6 +57,13 @@ const Gui::DropdownList indirectSpecularMethodList =
     { 2, "LightFieldProbeRayTracing"},
 };
 
+const Gui::DropdownList indirectResolutionList =
+{
+    { 0, "Full"},
+    { 1, "Half"},
+    { 2, "Quarter"},
+};
+
 void HybridRenderer::initShadowPass(uint32_t windowWidth, uint32_t windowHeight)
 {
     mpShadowPass = CascadedShadowMaps::create(mpSceneRenderer->getScene()->getLight(0), 2048, 2048, windowWidth, windowHeight, mpSceneRenderer->getScene()->shared_from_this());
@@ -70,6 +77,59 @@ void HybridRenderer::initLightFieldProbes(const Scene::SharedPtr& pScene)
 {
     mpLightProbeVolume = LightFieldProbeVolume::create();
     mpLightProbeVolume->setScene(pScene);
+
+    // Cascades are only allocated while they are in use
+    mpLightProbeCascades = nullptr;
+    if (mUseProbeCascades)
+    {
+        mpLightProbeCascades = LightFieldProbeCascades::create();
+        mpLightProbeCascades->setScene(pScene);
+    }
+}
+
+void HybridRenderer::traceIndirect(RenderContext* pContext, const LightFieldProbeRayTracing::SharedPtr& pRayTracer, Camera::SharedPtr& pCamera, const Fbo::SharedPtr& pTargetFbo)
+{
+    if (mUseProbeCascades && mpLightProbeCascades)
+    {
+        pRayTracer->execute(pContext, pCamera, mpLightProbeCascades, mpGBufferFbo, pTargetFbo);
+    }
+    else
+    {
+        pRayTracer->execute(pContext, pCamera, mpLightProbeVolume, mpGBufferFbo, pTargetFbo);
+    }
+}
+
+HybridRenderer::IndirectLevel* HybridRenderer::prepareIndirectLevel(RenderContext* pContext)
+{
+    if (mIndirectResolution == IndirectResolution::Full) return nullptr;
+
+    IndirectLevel* pLevel = &mIndirectLevels[(uint32_t)mIndirectResolution - 1];
+    if (!mIndirectLevelReady)
+    {
+        PROFILE("indirectDownscale");
+        GPU_EVENT(pContext, "indirectDownscale");
+
+        // Point filtering keeps the packed normals intact and picks the G-buffer texels the tracer shades at low res
+        mpIndirectDownscalePass->execute(pContext, mpGBufferFbo->getColorTexture(GBufferRT::SVGF_MotionVec), 0, pLevel->pMotionVecFbo, DownscalePass::Filter::Point);
+        mpIndirectDownscalePass->execute(pContext, mpGBufferFbo->getColorTexture(GBufferRT::SVGF_LinearZ), 0, pLevel->pLinearZFbo, DownscalePass::Filter::Point);
+        mpIndirectDownscalePass->execute(pContext, mpGBufferFbo->getColorTexture(GBufferRT::SVGF_CompactNormDepth), 0, pLevel->pNormDepthFbo, DownscalePass::Filter::Point);
+        mIndirectLevelReady = true;
+    }
+    return pLevel;
+}
+
+Texture::SharedPtr HybridRenderer::upsampleIndirect(RenderContext* pContext, const IndirectLevel* pLevel, const Texture::SharedPtr& pSrcTex)
+{
+    if (!pLevel) return pSrcTex;
+
+    PROFILE("indirectUpsample");
+    GPU_EVENT(pContext, "indirectUpsample");
+    mpIndirectUpsamplePass->execute(pContext,
+        pSrcTex,
+        pLevel->pNormDepthFbo->getColorTexture(0),
+        mpGBufferFbo->getColorTexture(GBufferRT::SVGF_CompactNormDepth),
+        mpUpsampledFP16Fbo);
+    return mpUpsampledFP16Fbo->getColorTexture(0);
 }
 
 void HybridRenderer::setSceneSampler(uint32_t maxAniso)
@@ -133,6 +193,8 @@ void HybridRenderer::initScene(SampleCallbacks* pSample, Scene::SharedPtr pScene
     mpSceneRenderer = SceneRenderer::create(pScene);
     mpSceneRenderer->setCameraControllerType(SceneRenderer::CameraControllerType::FirstPerson);
     mpSceneRenderer->toggleStaticMaterialCompilation(mPerMaterialShader);
+    // The scene renderer only draws the main camera
+    mpSceneRenderer->toggleMeshletCulling(mMeshletCulling);
     setSceneSampler(mpSceneSampler ? mpSceneSampler->getMaxAnisotropy() : 4);
     setActiveCameraAspectRatio(pSample->getCurrentFbo()->getWidth(), pSample->getCurrentFbo()->getHeight());
 
@@ -180,6 +242,9 @@ void HybridRenderer::initScene(SampleCallbacks* pSample, Scene::SharedPtr pScene
     mpIndirectDiffuse = IndirectLighting::create(IndirectLighting::Diffuse);
     mpIndirectSpecular = IndirectLighting::create(IndirectLighting::Specular);
 
+    mpIndirectDownscalePass = DownscalePass::create();
+    mpIndirectUpsamplePass = BilateralUpsamplePass::create();
+
     pSample->setCurrentTime(0);
 
     initLightFieldProbes(pScene);
@@ -207,7 +272,7 @@ void HybridRenderer::loadModel(SampleCallbacks* pSample, const std::string& file
         pBar = ProgressBar::create("Loading Model");
     }
 
-    Model::SharedPtr pModel = Model::createFromFile(filename.c_str());
+    Model::SharedPtr pModel = Model::createFromFile(filename.c_str(), Model::LoadFlags::GenerateMeshlets);
     if (!pModel) return;
     Scene::SharedPtr pScene = Scene::create();
     pScene->addModelInstance(pModel, "instance");
@@ -226,7 +291,7 @@ void HybridRenderer::loadScene(SampleCallbacks* pSample, const std::string& file
         pBar = ProgressBar::create("Loading Scene", 100);
     }
 
-    Scene::SharedPtr pScene = Scene::loadFromFile(filename);
+    Scene::SharedPtr pScene = Scene::loadFromFile(filename, Model::LoadFlags::GenerateMeshlets, mWriteBakedScene ? Scene::LoadFlags::WriteBakedScene : Scene::LoadFlags::None);
 
     if (pScene != nullptr)
     {
@@ -288,6 +353,7 @@ void HybridRenderer::beginFrame(RenderContext* pContext, Fbo* pTargetFbo, uint64
     pContext->clearFbo(mpMainFbo.get(), glm::vec4(0.0f, 0.0f, 0.0f, 1.0f), 1, 0, FboAttachmentType::All);
     pContext->clearFbo(mpGBufferFbo.get(), vec4(0), 1.f, 0, FboAttachmentType::All);
     pContext->clearFbo(mpPostProcessFbo.get(), glm::vec4(), 1, 0, FboAttachmentType::Color);
+    mIndirectLevelReady = false;
 
     if (mAAMode == AAMode::TAA)
     {
@@ -322,20 +388,34 @@ void HybridRenderer::indirectDiffuse(RenderContext* pRenderContext, Fbo::SharedP
         GPU_EVENT(pRenderContext, "indirectDiffuse");
 
         Camera::SharedPtr pCamera = mpSceneRenderer->getScene()->getActiveCamera();
-        mpIndirectDiffuseRayTracer->execute(pRenderContext, pCamera, mpLightProbeVolume, mpGBufferFbo, mpTempFP16Fbo);
+        IndirectLevel* pLevel = prepareIndirectLevel(pRenderContext);
+        Fbo::SharedPtr pTraceFbo = pLevel ? pLevel->pLightingFbo : mpTempFP16Fbo;
+        traceIndirect(pRenderContext, mpIndirectDiffuseRayTracer, pCamera, pTraceFbo);
 
-        Texture::SharedPtr rtOutput = mpTempFP16Fbo->getColorTexture(0);
+        Texture::SharedPtr rtOutput = pTraceFbo->getColorTexture(0);
         if (mEnableIndirectDiffuseDenoiser)
         {
             PROFILE("SVGF");
             GPU_EVENT(pRenderContext, "SVGF");
 
-            rtOutput = mpIndirectDiffuseDenoiser->Execute(pRenderContext,
-                rtOutput,
-                mpGBufferFbo->getColorTexture(GBufferRT::SVGF_MotionVec),
-                mpGBufferFbo->getColorTexture(GBufferRT::SVGF_LinearZ),
-                mpGBufferFbo->getColorTexture(GBufferRT::SVGF_CompactNormDepth));
+            if (pLevel)
+            {
+                rtOutput = pLevel->pDiffuseDenoiser->Execute(pRenderContext,
+                    rtOutput,
+                    pLevel->pMotionVecFbo->getColorTexture(0),
+                    pLevel->pLinearZFbo->getColorTexture(0),
+                    pLevel->pNormDepthFbo->getColorTexture(0));
+            }
+            else
+            {
+                rtOutput = mpIndirectDiffuseDenoiser->Execute(pRenderContext,
+                    rtOutput,
+                    mpGBufferFbo->getColorTexture(GBufferRT::SVGF_MotionVec),
+                    mpGBufferFbo->getColorTexture(GBufferRT::SVGF_LinearZ),
+                    mpGBufferFbo->getColorTexture(GBufferRT::SVGF_CompactNormDepth));
+            }
         }
+        rtOutput = upsampleIndirect(pRenderContext, pLevel, rtOutput);
 
         mpIndirectDiffuse->execute(pRenderContext, pCamera, rtOutput, mpGBufferFbo, mpTempFP16Fbo);
 
@@ -359,11 +439,17 @@ void HybridRenderer::indirectSpecular(RenderContext* pRenderContext, Fbo::Shared
 
         Camera::SharedPtr pCamera = mpSceneRenderer->getScene()->getActiveCamera();
 
+        // Only the probe tracer runs at reduced resolution, SSR keeps marching the full-res HZB
+        IndirectLevel* pLevel = nullptr;
+        Fbo::SharedPtr pTraceFbo = mpTempFP16Fbo;
         if (mIndirectSpecularMethod == IndirectSpecularMethod::LightFieldProbeRayTracing)
         {
+            pLevel = prepareIndirectLevel(pRenderContext);
+            if (pLevel) pTraceFbo = pLevel->pLightingFbo;
+
             PROFILE("LFRT");
             GPU_EVENT(pRenderContext, "LFRT");
-            mpIndirectSpecularRayTracer->execute(pRenderContext, pCamera, mpLightProbeVolume, mpGBufferFbo, mpTempFP16Fbo);
+            traceIndirect(pRenderContext, mpIndirectSpecularRayTracer, pCamera, pTraceFbo);
         }
         else if (mIndirectSpecularMethod == IndirectSpecularMethod::ScreenSpaceReflection)
         {
@@ -375,14 +461,25 @@ void HybridRenderer::indirectSpecular(RenderContext* pRenderContext, Fbo::Shared
             mpSSRPass->execute(pRenderContext, pCamera.get(), pColorIn, mpHZBTexture, mpGBufferFbo, mpTempFP16Fbo);
         }
 
-        Texture::SharedPtr outTex = mpTempFP16Fbo->getColorTexture(0);
+        Texture::SharedPtr outTex = pTraceFbo->getColorTexture(0);
         if (mEnableIndirectSpecularDenoiser)
         {
-            Texture::SharedPtr motionVec = mpGBufferFbo->getColorTexture(GBufferRT::SVGF_MotionVec);
-            Texture::SharedPtr linearZ = mpGBufferFbo->getColorTexture(GBufferRT::SVGF_LinearZ);
-            Texture::SharedPtr normalDepth = mpGBufferFbo->getColorTexture(GBufferRT::SVGF_CompactNormDepth);
-            outTex = mpIndirectSpecularDenoiser->Execute(pRenderContext, outTex, motionVec, linearZ, normalDepth);
+            if (pLevel)
+            {
+                Texture::SharedPtr motionVec = pLevel->pMotionVecFbo->getColorTexture(0);
+                Texture::SharedPtr linearZ = pLevel->pLinearZFbo->getColorTexture(0);
+                Texture::SharedPtr normalDepth = pLevel->pNormDepthFbo->getColorTexture(0);
+                outTex = pLevel->pSpecularDenoiser->Execute(pRenderContext, outTex, motionVec, linearZ, normalDepth);
+            }
+            else
+            {
+                Texture::SharedPtr motionVec = mpGBufferFbo->getColorTexture(GBufferRT::SVGF_MotionVec);
+                Texture::SharedPtr linearZ = mpGBufferFbo->getColorTexture(GBufferRT::SVGF_LinearZ);
+                Texture::SharedPtr normalDepth = mpGBufferFbo->getColorTexture(GBufferRT::SVGF_CompactNormDepth);
+                outTex = mpIndirectSpecularDenoiser->Execute(pRenderContext, outTex, motionVec, linearZ, normalDepth);
+            }
         }
+        outTex = upsampleIndirect(pRenderContext, pLevel, outTex);
 
         mpIndirectSpecular->execute(pRenderContext, pCamera, outTex, mpGBufferFbo, mpTempFP16Fbo);
 
@@ -517,7 +614,14 @@ void HybridRenderer::onFrameRender(SampleCallbacks* pSample, RenderContext* pRen
         {
             PROFILE("updateLightFieldProbe");
             GPU_EVENT(pRenderContext, "updateLightFieldProbe");
-            mpLightProbeVolume->update(pRenderContext);
+            if (mUseProbeCascades && mpLightProbeCascades)
+            {
+                mpLightProbeCascades->update(pRenderContext, mpSceneRenderer->getScene()->getActiveCamera().get());
+            }
+            else
+            {
+                mpLightProbeVolume->update(pRenderContext, mpSceneRenderer->getScene()->getActiveCamera().get());
+            }
         }
 
         depthPass(pRenderContext, mpDepthPassFbo);
@@ -540,7 +644,17 @@ void HybridRenderer::onFrameRender(SampleCallbacks* pSample, RenderContext* pRen
         {
             PROFILE("lightFieldProbeViewer");
             GPU_EVENT(pRenderContext, "lightFieldProbeViewer");
-            mpLightProbeVolume->debugDraw(pRenderContext, mpSceneRenderer->getScene()->getActiveCamera(), mpMainFbo);
+            if (mUseProbeCascades && mpLightProbeCascades)
+            {
+                for (uint32_t i = 0; i < mpLightProbeCascades->getCascadeCount(); ++i)
+                {
+                    mpLightProbeCascades->getCascade(i)->debugDraw(pRenderContext, mpSceneRenderer->getScene()->getActiveCamera(), mpMainFbo);
+                }
+            }
+            else
+            {
+                mpLightProbeVolume->debugDraw(pRenderContext, mpSceneRenderer->getScene()->getActiveCamera(), mpMainFbo);
+            }
         }
 
         postProcess(pRenderContext, pTargetFbo);
@@ -622,6 +736,25 @@ void HybridRenderer::onResizeSwapChain(SampleCallbacks* pSample, uint32_t width,
     mpIndirectDiffuseDenoiser = SVGFPass::create(width, height);
     mpIndirectSpecularDenoiser = SVGFPass::create(width, height);
 
+    mpUpsampledFP16Fbo = FboHelper::create2D(width, height, FP16FboDesc);
+
+    Fbo::Desc FP32FboDesc;
+    FP32FboDesc.setColorTarget(0, ResourceFormat::RGBA32Float);
+    for (uint32_t i = 0; i < arraysize(mIndirectLevels); i++)
+    {
+        const uint32_t scale = 2u << i;
+        const uint32_t levelWidth = (width + scale - 1) / scale;
+        const uint32_t levelHeight = (height + scale - 1) / scale;
+
+        IndirectLevel& level = mIndirectLevels[i];
+        level.pLightingFbo = FboHelper::create2D(levelWidth, levelHeight, FP16FboDesc);
+        level.pMotionVecFbo = FboHelper::create2D(levelWidth, levelHeight, FP32FboDesc);
+        level.pLinearZFbo = FboHelper::create2D(levelWidth, levelHeight, FP32FboDesc);
+        level.pNormDepthFbo = FboHelper::create2D(levelWidth, levelHeight, FP32FboDesc);
+        level.pDiffuseDenoiser = SVGFPass::create(levelWidth, levelHeight);
+        level.pSpecularDenoiser = SVGFPass::create(levelWidth, levelHeight);
+    }
+
     mpHZBTexture = HierarchicalZBuffer::createHZBTexture(width, height);
 
     applyAaMode(pSample);
@@ -734,6 +867,7 @@ void HybridRenderer::onGuiRender(SampleCallbacks* pSample, Gui* pGui)
             loadScene(pSample, filename, true);
         }
     }
+    pGui->addCheckBox("Write Baked Scene", mWriteBakedScene, true);
 
     if (mpSceneRenderer)
     {
@@ -806,6 +940,11 @@ void HybridRenderer::onGuiRender(SampleCallbacks* pSample, Gui* pGui)
             }
             pGui->addTooltip("Create a specialized version of the lighting program for each material in the scene");
 
+            if (pGui->addCheckBox("Meshlet Culling", mMeshletCulling))
+            {
+                mpSceneRenderer->toggleMeshletCulling(mMeshletCulling);
+            }
+
             uint32_t maxAniso = mpSceneSampler->getMaxAnisotropy();
             if (pGui->addIntVar("Max Anisotropy", (int&)maxAniso, 1, 16))
             {
@@ -871,14 +1010,42 @@ void HybridRenderer::onGuiRender(SampleCallbacks* pSample, Gui* pGui)
             pGui->endGroup();
         }
 
-        mpLightProbeVolume->renderUI(pGui, "Light Field Probe Volume");
+        if (pGui->addCheckBox("Camera-Centered Probe Cascades", mUseProbeCascades))
+        {
+            if (mUseProbeCascades && !mpLightProbeCascades)
+            {
+                mpLightProbeCascades = LightFieldProbeCascades::create();
+                mpLightProbeCascades->setScene(mpSceneRenderer->getScene());
+            }
+            else if (!mUseProbeCascades)
+            {
+                mpLightProbeCascades = nullptr;
+            }
+        }
+        if (mUseProbeCascades && mpLightProbeCascades)
+        {
+            mpLightProbeCascades->renderUI(pGui, "Light Field Probe Cascades");
+        }
+        else
+        {
+            mpLightProbeVolume->renderUI(pGui, "Light Field Probe Volume");
+        }
+
+        // Denoisers of the active resolution, each level keeps its own history and settings
+        const IndirectLevel* pIndirectLevel = mIndirectResolution == IndirectResolution::Full ? nullptr : &mIndirectLevels[(uint32_t)mIndirectResolution - 1];
+
+        pGui->addDropdown("Probe Ray Traced Indirect Resolution", indirectResolutionList, (uint32_t&)mIndirectResolution);
+        if (pIndirectLevel)
+        {
+            mpIndirectUpsamplePass->renderUI(pGui, "Indirect Upsampling");
+        }
 
         if (pGui->beginGroup("Indirect Diffuse"))
         {
             pGui->addCheckBox("Enable Light Field Probe Ray Traced Indirect Diffuse", mEnableIndirectDiffuse);
             pGui->addCheckBox("Enable Indirect Diffuse Denoiser", mEnableIndirectDiffuseDenoiser);
             pGui->addCheckBox("Display Indirect Diffuse Result (DEBUG)", mDebugDisplayIndirectDiffuse);
-            mpIndirectDiffuseDenoiser->RenderGui(pGui, "SVGF");
+            (pIndirectLevel ? pIndirectLevel->pDiffuseDenoiser : mpIndirectDiffuseDenoiser)->RenderGui(pGui, "SVGF");
 
             pGui->endGroup();
         }
@@ -903,7 +1070,8 @@ void HybridRenderer::onGuiRender(SampleCallbacks* pSample, Gui* pGui)
 
             if (mEnableIndirectSpecularDenoiser)
             {
-                mpIndirectSpecularDenoiser->RenderGui(pGui, "SVGF");
+                const bool lowRes = pIndirectLevel && mIndirectSpecularMethod == IndirectSpecularMethod::LightFieldProbeRayTracing;
+                (lowRes ? pIndirectLevel->pSpecularDenoiser : mpIndirectSpecularDenoiser)->RenderGui(pGui, "SVGF");
             }
 
             pGui->endGroup();
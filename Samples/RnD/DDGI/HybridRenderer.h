@@ -34,9 +34,12 @@
 #include "Experimental/RenderPasses/GBufferLightingPass.h"
 #include "Experimental/RenderPasses/ForwardLightingPass.h"
 #include "LightFieldProbeVolume.h"
+#include "LightFieldProbeCascades.h"
 #include "LightFieldProbeRayTracing.h"
 #include "IndirectLighting.h"
 #include "SVGFPass.h"
+#include "DownscalePass.h"
+#include "BilateralUpsamplePass.h"
 
 using namespace Falcor;
 
@@ -71,6 +74,8 @@ private:
     FXAA::SharedPtr mpFXAA;
 
     LightFieldProbeVolume::SharedPtr mpLightProbeVolume;
+    LightFieldProbeCascades::SharedPtr mpLightProbeCascades;
+    bool mUseProbeCascades = false;
 
     LightFieldProbeRayTracing::SharedPtr mpIndirectDiffuseRayTracer;
     SVGFPass::SharedPtr mpIndirectDiffuseDenoiser;
@@ -85,6 +90,24 @@ private:
     BlitPass::SharedPtr mpBlitPass;
     BlitPass::SharedPtr mpAdditiveBlitPass;
 
+    /** Inputs and denoisers for probe ray traced indirect lighting below full resolution.
+        The G-buffer is point-downscaled so SVGF and the upsampler see the texels the tracer shaded.
+    */
+    struct IndirectLevel
+    {
+        Fbo::SharedPtr pLightingFbo;
+        Fbo::SharedPtr pMotionVecFbo;
+        Fbo::SharedPtr pLinearZFbo;
+        Fbo::SharedPtr pNormDepthFbo;
+        SVGFPass::SharedPtr pDiffuseDenoiser;
+        SVGFPass::SharedPtr pSpecularDenoiser;
+    };
+    IndirectLevel mIndirectLevels[2];   // 1/2 and 1/4 per axis
+    bool mIndirectLevelReady = false;   // The active level has been downscaled this frame
+    DownscalePass::SharedPtr mpIndirectDownscalePass;
+    BilateralUpsamplePass::SharedPtr mpIndirectUpsamplePass;
+    Fbo::SharedPtr mpUpsampledFP16Fbo;
+
     //  The Temporal Anti-Aliasing Pass.
     class
     {
@@ -134,6 +157,9 @@ private:
     void initShadowPass(uint32_t windowWidth, uint32_t windowHeight);
     void initAA(SampleCallbacks* pSample);
     void initLightFieldProbes(const Scene::SharedPtr& pScene);
+    void traceIndirect(RenderContext* pContext, const LightFieldProbeRayTracing::SharedPtr& pRayTracer, Camera::SharedPtr& pCamera, const Fbo::SharedPtr& pTargetFbo);
+    IndirectLevel* prepareIndirectLevel(RenderContext* pContext);
+    Texture::SharedPtr upsampleIndirect(RenderContext* pContext, const IndirectLevel* pLevel, const Texture::SharedPtr& pSrcTex);
     void updateLightProbe(const LightProbe::SharedPtr& pLight);
 
 	SceneRenderer::SharedPtr mpSceneRenderer;
@@ -174,6 +200,13 @@ private:
         LightFieldProbeRayTracing,
     };
 
+    enum class IndirectResolution
+    {
+        Full = 0,
+        Half,
+        Quarter,
+    };
+
     float mOpacityScale = 0.5f;
     AAMode mAAMode = AAMode::None;
     SamplePattern mTAASamplePattern = SamplePattern::Halton;
@@ -184,6 +217,8 @@ private:
     void applyCameraPathState();
     bool mPerMaterialShader = false;
     bool mUseCsSkinning = false;
+    bool mWriteBakedScene = false;
+    bool mMeshletCulling = true;
     bool mVisualizeCascades = false;
     bool mEnableSSAO = false;
 
@@ -192,6 +227,7 @@ private:
     bool mDebugDisplayIndirectDiffuse = false;
 
     IndirectSpecularMethod mIndirectSpecularMethod;
+    IndirectResolution mIndirectResolution = IndirectResolution::Full;
     bool mEnableIndirectSpecularDenoiser = false;
     bool mDebugDisplayIndirectSpecular = false;
 
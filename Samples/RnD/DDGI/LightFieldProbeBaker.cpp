@@ -0,0 +1,519 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "LightFieldProbeBaker.h"
+#include "LightFieldProbeMath.h"
+#include "CpuParallelFor.h"
+#include "LightFieldProbeCompression.h"
+
+namespace Falcor
+{
+    using namespace LightFieldProbeMath;
+
+    namespace
+    {
+        // Hemisphere discretization of LightFieldProbeFiltering.slang
+        const int kNumThetaSamples = 16;
+        const int kNumPhiSamples = 64;
+        const float kDeltaTheta = float(M_PI) / 2 / kNumThetaSamples;
+        const float kDeltaPhi = float(M_PI) * 2 / kNumPhiSamples;
+
+        float3 sampleBilinearClamp(const float3* pTexels, uint32_t resolution, float2 uv)
+        {
+            float x = uv.x * resolution - 0.5f;
+            float y = uv.y * resolution - 0.5f;
+            float fx = std::floor(x);
+            float fy = std::floor(y);
+            float wx = x - fx;
+            float wy = y - fy;
+            int maxIdx = int(resolution) - 1;
+            int x0 = glm::clamp(int(fx), 0, maxIdx);
+            int x1 = glm::clamp(int(fx) + 1, 0, maxIdx);
+            int y0 = glm::clamp(int(fy), 0, maxIdx);
+            int y1 = glm::clamp(int(fy) + 1, 0, maxIdx);
+            float3 top = glm::mix(pTexels[y0 * resolution + x0], pTexels[y0 * resolution + x1], wx);
+            float3 bottom = glm::mix(pTexels[y1 * resolution + x0], pTexels[y1 * resolution + x1], wx);
+            return glm::mix(top, bottom, wy);
+        }
+
+        float samplePointClamp(const float* pTexels, uint32_t resolution, float2 uv)
+        {
+            int maxIdx = int(resolution) - 1;
+            int x = glm::clamp(int(std::floor(uv.x * resolution)), 0, maxIdx);
+            int y = glm::clamp(int(std::floor(uv.y * resolution)), 0, maxIdx);
+            return pTexels[y * resolution + x];
+        }
+
+        float fresnelSchlick(float f0, float f90, float u)
+        {
+            return f0 + (f90 - f0) * std::pow(1.0f - u, 5.0f);
+        }
+
+        /** evalDiffuseFrostbiteBrdf() from BRDF.slang
+        */
+        float3 evalDiffuseFrostbiteBrdf(const float3& diffuse, float linearRoughness, float NdotL, float NdotV, float LdotH)
+        {
+            float energyBias = glm::mix(0.0f, 0.5f, linearRoughness);
+            float energyFactor = glm::mix(1.0f, 1.0f / 1.51f, linearRoughness);
+            float fd90 = energyBias + 2.0f * LdotH * LdotH * linearRoughness;
+            float lightScatter = fresnelSchlick(1.0f, fd90, NdotL);
+            float viewScatter = fresnelSchlick(1.0f, fd90, NdotV);
+            return (viewScatter * lightScatter * energyFactor * float(M_1_PI)) * diffuse;
+        }
+
+        /** evalDirectionalLight()/evalPointLight() from Lights.slang. Returns false if the light doesn't reach the point.
+        */
+        bool evalLight(const LightData& light, const float3& posW, float3& L, float& distance, float3& intensity)
+        {
+            if (light.type == LightDirectional)
+            {
+                L = -glm::normalize(light.dirW);
+                distance = std::numeric_limits<float>::max();
+                intensity = light.intensity;
+                return true;
+            }
+            else if (light.type == LightPoint)
+            {
+                L = light.posW - posW;
+                float distSquared = glm::dot(L, L);
+                if (distSquared <= 1e-5f) return false;
+                distance = std::sqrt(distSquared);
+                L /= distance;
+
+                float falloff = 1.0f / ((0.01f * 0.01f) + distSquared);
+                float cosTheta = -glm::dot(L, light.dirW);
+                if (cosTheta < light.cosOpeningAngle)
+                {
+                    return false;
+                }
+                else if (light.penumbraAngle > 0.0f)
+                {
+                    float deltaAngle = light.openingAngle - std::acos(cosTheta);
+                    falloff *= glm::clamp((deltaAngle - light.penumbraAngle) / light.penumbraAngle, 0.0f, 1.0f);
+                }
+                intensity = light.intensity * falloff;
+                return true;
+            }
+            return false;
+        }
+    }
+
+    void LightFieldProbeAtlas::allocate(uint32_t probes, uint32_t octRes, uint32_t lowResRes, uint32_t filteredRes, uint32_t shCoeffs)
+    {
+        probeCount = probes;
+        octResolution = octRes;
+        lowResResolution = lowResRes;
+        filteredResolution = filteredRes;
+        shCoeffCount = shCoeffs;
+
+        radiance.assign(getOctSliceSize() * probes, 0);
+        normal.assign(getOctSliceSize() * probes, 0);
+        distance.assign(getOctSliceSize() * probes, 0);
+        lowResDistance.assign(getLowResSliceSize() * probes, 0);
+        irradiance.assign(shCoeffs > 0 ? 0 : getFilteredSliceSize() * probes, 0);
+        distanceMoments.assign(getFilteredSliceSize() * probes, 0);
+        irradianceSH.assign(size_t(shCoeffs) * probes, float4(0.0f));
+        radianceBC6H.clear();
+        normalBC5.clear();
+    }
+
+    void LightFieldProbeAtlas::compress()
+    {
+        const size_t compressedSize = LightFieldProbeCompression::getSliceSize(octResolution) * probeCount;
+        radianceBC6H.resize(compressedSize);
+        normalBC5.resize(compressedSize);
+        LightFieldProbeCompression::encodeBC6H(radiance.data(), octResolution, probeCount, radianceBC6H.data());
+        LightFieldProbeCompression::encodeBC5(normal.data(), octResolution, probeCount, normalBC5.data());
+    }
+
+    LightFieldProbeBaker::SharedPtr LightFieldProbeBaker::create(const Settings& settings)
+    {
+        return SharedPtr(new LightFieldProbeBaker(settings));
+    }
+
+    uint32_t LightFieldProbeBaker::getThreadCount() const
+    {
+        if (mSettings.threadCount > 0) return mSettings.threadCount;
+        return getDefaultCpuThreadCount();
+    }
+
+    void LightFieldProbeBaker::bake(const CpuSceneBvh& bvh, const std::vector<LightData>& lights, const std::vector<float3>& probePositions, LightFieldProbeAtlas& atlas)
+    {
+        atlas.allocate((uint32_t)probePositions.size(), mSettings.octResolution, mSettings.lowResResolution, mSettings.filteredResolution, mSettings.shCoeffCount);
+
+        std::vector<uint32_t> probeIndices(probePositions.size());
+        for (uint32_t i = 0; i < (uint32_t)probeIndices.size(); ++i) probeIndices[i] = i;
+        bakeProbes(bvh, lights, probePositions, probeIndices, atlas);
+    }
+
+    void LightFieldProbeBaker::bakeProbes(const CpuSceneBvh& bvh, const std::vector<LightData>& lights, const std::vector<float3>& probePositions, const std::vector<uint32_t>& probeIndices, LightFieldProbeAtlas& atlas)
+    {
+        if (atlas.octResolution != mSettings.octResolution || atlas.lowResResolution != mSettings.lowResResolution ||
+            atlas.filteredResolution != mSettings.filteredResolution || atlas.shCoeffCount != mSettings.shCoeffCount || atlas.probeCount != probePositions.size())
+        {
+            logError("LightFieldProbeBaker::bakeProbes() - atlas dimensions don't match the baker settings");
+            return;
+        }
+        if (mSettings.octResolution % mSettings.lowResResolution != 0)
+        {
+            logError("LightFieldProbeBaker::bakeProbes() - the octahedral resolution must be a multiple of the low-res resolution");
+            return;
+        }
+
+        if (mSettings.shCoeffCount > 0 && (!mpSHProjector || mpSHProjector->getResolution() != mSettings.octResolution || mpSHProjector->getCoeffCount() != mSettings.shCoeffCount))
+        {
+            mpSHProjector = LightFieldProbeSH::create(mSettings.octResolution, mSettings.shCoeffCount);
+            if (!mpSHProjector) return;
+        }
+
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+        const uint32_t threadCount = getThreadCount();
+        const uint32_t probeCount = (uint32_t)probeIndices.size();
+        std::atomic<uint64_t> rayCount(0);
+
+        // Radiance, normal and distance, one work item per probe row
+        const uint32_t octRes = mSettings.octResolution;
+        parallelFor(probeCount * octRes, threadCount, [&](uint32_t item)
+        {
+            uint32_t probeIdx = probeIndices[item / octRes];
+            traceProbeRow(bvh, lights, probePositions[probeIdx], probeIdx, item % octRes, atlas, rayCount);
+        });
+
+        // Low-res distance
+        const uint32_t lowResRes = mSettings.lowResResolution;
+        parallelFor(probeCount * lowResRes, threadCount, [&](uint32_t item)
+        {
+            downscaleProbeRow(probeIndices[item / lowResRes], item % lowResRes, atlas);
+        });
+
+        // Filtering samples the quantized atlases, same as the GPU
+        const std::vector<FilterSample> samples = createFilterSamples();
+        const size_t octSliceSize = atlas.getOctSliceSize();
+        std::vector<float3> radiance(octSliceSize);
+        std::vector<float> distance(octSliceSize);
+        for (uint32_t probeIdx : probeIndices)
+        {
+            const uint32_t* pRadiance = atlas.radiance.data() + probeIdx * octSliceSize;
+            const uint16_t* pDistance = atlas.distance.data() + probeIdx * octSliceSize;
+            parallelFor(octRes, threadCount, [&](uint32_t row)
+            {
+                for (size_t i = size_t(row) * octRes; i < size_t(row + 1) * octRes; ++i)
+                {
+                    radiance[i] = unpackR11G11B10(pRadiance[i]);
+                    distance[i] = unpackR16F(pDistance[i]);
+                }
+            });
+
+            parallelFor(mSettings.filteredResolution, threadCount, [&](uint32_t row)
+            {
+                filterProbeRow(probeIdx, row, samples, radiance, distance, atlas);
+            });
+
+            if (atlas.shCoeffCount > 0)
+            {
+                mpSHProjector->project(radiance.data(), atlas.irradianceSH.data() + size_t(probeIdx) * atlas.shCoeffCount);
+            }
+        }
+
+        mLastBakeTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+        mLastRayCount = rayCount;
+    }
+
+    void LightFieldProbeBaker::traceProbeRow(const CpuSceneBvh& bvh, const std::vector<LightData>& lights, const float3& probePos, uint32_t probeIdx, uint32_t row, LightFieldProbeAtlas& atlas, std::atomic<uint64_t>& rayCount) const
+    {
+        const uint32_t res = mSettings.octResolution;
+        const size_t offset = probeIdx * atlas.getOctSliceSize() + size_t(row) * res;
+        uint32_t* pRadiance = atlas.radiance.data() + offset;
+        uint32_t* pNormal = atlas.normal.data() + offset;
+        uint16_t* pDistance = atlas.distance.data() + offset;
+
+        uint64_t localRays = 0;
+        for (uint32_t x = 0; x < res; ++x)
+        {
+            float3 dir = texelToDirection(x, row, res);
+
+            // The cube face cameras clip against view-space depth, which is the distance along the major axis
+            float3 absDir = glm::abs(dir);
+            float majorAxis = std::max(absDir.x, std::max(absDir.y, absDir.z));
+            float tMin = mSettings.nearPlane / majorAxis;
+            float tMax = mSettings.farPlane / majorAxis;
+
+            CpuSceneBvh::Hit hit;
+            ++localRays;
+            if (bvh.intersect(probePos, dir, tMin, tMax, hit))
+            {
+                float3 normal;
+                float3 radiance = shade(bvh, lights, hit, probePos, dir, normal, localRays);
+                pRadiance[x] = packR11G11B10(radiance);
+                const bool backface = glm::dot(bvh.getShadingNormal(hit), dir) >= 0.0f;
+                pNormal[x] = packRGBA8(float4(octToUv(octEncode(normal)), backface ? 1.0f : 0.0f, 1.0f));
+                pDistance[x] = packR16F(hit.t);
+            }
+            else
+            {
+                pRadiance[x] = packR11G11B10(float3(0.0f));
+                pNormal[x] = packRGBA8(float4(0.0f));
+                pDistance[x] = packR16F(mSettings.missDistance);
+            }
+        }
+        rayCount += localRays;
+    }
+
+    float3 LightFieldProbeBaker::shade(const CpuSceneBvh& bvh, const std::vector<LightData>& lights, const CpuSceneBvh::Hit& hit, const float3& origin, const float3& dir, float3& normal, uint64_t& rayCount) const
+    {
+        const CpuSceneBvh::SurfaceMaterial& material = bvh.getMaterial(hit);
+        const float3 posW = origin + dir * hit.t;
+        const float3 V = -dir;
+
+        // Geometry is rasterized without culling, so make the normal face the probe
+        float3 N = bvh.getShadingNormal(hit);
+        if (glm::dot(N, V) < 0.0f) N = -N;
+        normal = N;
+
+        const float NdotV = glm::clamp(glm::dot(N, V), 0.0f, 1.0f);
+        const float3 shadowOrigin = posW + bvh.getGeometricNormal(hit) * (glm::dot(bvh.getGeometricNormal(hit), V) < 0.0f ? -mSettings.shadowRayBias : mSettings.shadowRayBias);
+
+        float3 color = material.emissive;
+        for (uint32_t l = 0; l < (uint32_t)lights.size(); ++l)
+        {
+            float3 L;
+            float distance;
+            float3 intensity;
+            if (!evalLight(lights[l], posW, L, distance, intensity)) continue;
+
+            float NdotL = glm::clamp(glm::dot(N, L), 0.0f, 1.0f);
+            if (NdotL <= 0.0f) continue;
+
+            float3 H = glm::normalize(V + L);
+            float LdotH = glm::clamp(glm::dot(L, H), 0.0f, 1.0f);
+            float3 brdf = glm::clamp(evalDiffuseFrostbiteBrdf(material.diffuse, material.linearRoughness, NdotL, NdotV, LdotH), float3(0.0f), float3(1.0f));
+            float3 contribution = intensity * brdf * NdotL;
+
+            if (l == 0 || mSettings.shadowAllLights)
+            {
+                ++rayCount;
+                if (bvh.occluded(shadowOrigin, L, 0.0f, distance)) continue;
+            }
+            color += contribution;
+        }
+        return color;
+    }
+
+    void LightFieldProbeBaker::downscaleProbeRow(uint32_t probeIdx, uint32_t row, LightFieldProbeAtlas& atlas) const
+    {
+        // Same as DownscalePass: minimum over each block of high-res texels
+        const uint32_t highRes = atlas.octResolution;
+        const uint32_t lowRes = atlas.lowResResolution;
+        const uint32_t factor = highRes / lowRes;
+        const uint16_t* pSrc = atlas.distance.data() + probeIdx * atlas.getOctSliceSize();
+        uint16_t* pDst = atlas.lowResDistance.data() + probeIdx * atlas.getLowResSliceSize() + size_t(row) * lowRes;
+
+        for (uint32_t x = 0; x < lowRes; ++x)
+        {
+            float minDist = 1e6f;
+            for (uint32_t dy = 0; dy < factor; ++dy)
+            {
+                const uint16_t* pRow = pSrc + size_t(row * factor + dy) * highRes + x * factor;
+                for (uint32_t dx = 0; dx < factor; ++dx)
+                {
+                    minDist = std::min(minDist, unpackR16F(pRow[dx]));
+                }
+            }
+            pDst[x] = packR16F(minDist);
+        }
+    }
+
+    std::vector<LightFieldProbeBaker::FilterSample> LightFieldProbeBaker::createFilterSamples() const
+    {
+        std::vector<FilterSample> samples;
+        samples.reserve(kNumThetaSamples * kNumPhiSamples);
+        for (int i = 0; i < kNumThetaSamples; ++i)
+        {
+            float theta = kDeltaTheta * i;
+            float cosTheta = std::cos(theta);
+            float sinTheta = std::sin(theta);
+            for (int j = 0; j < kNumPhiSamples; ++j)
+            {
+                float phi = kDeltaPhi * j;
+                FilterSample s;
+                s.dir = float3(sinTheta * std::cos(phi), sinTheta * std::sin(phi), cosTheta);
+                s.irradianceWeight = cosTheta * sinTheta;
+                s.depthWeight = std::pow(cosTheta, mSettings.depthSharpness);
+                samples.push_back(s);
+            }
+        }
+        return samples;
+    }
+
+    void LightFieldProbeBaker::filterProbeRow(uint32_t probeIdx, uint32_t row, const std::vector<FilterSample>& samples, const std::vector<float3>& radiance, const std::vector<float>& distance, LightFieldProbeAtlas& atlas) const
+    {
+        const uint32_t res = atlas.filteredResolution;
+        const uint32_t octRes = atlas.octResolution;
+        const size_t offset = probeIdx * atlas.getFilteredSliceSize() + size_t(row) * res;
+        uint32_t* pIrradiance = (atlas.shCoeffCount > 0) ? nullptr : atlas.irradiance.data() + offset;
+        uint32_t* pMoments = atlas.distanceMoments.data() + offset;
+
+        for (uint32_t x = 0; x < res; ++x)
+        {
+            float3 N = texelToDirection(x, row, res);
+            float3 T = getPerpendicularStark(N);
+            float3 B = glm::normalize(glm::cross(N, T));
+
+            float3 irradiance(0.0f);
+            float2 moments(0.0f);
+            float distWeightSum = 0.0f;
+            for (const FilterSample& s : samples)
+            {
+                float3 Wi = glm::normalize(T * s.dir.x + B * s.dir.y + N * s.dir.z);
+                float2 uv = octToUv(octEncode(Wi));
+
+                if (pIrradiance)
+                {
+                    irradiance += sampleBilinearClamp(radiance.data(), octRes, uv) * s.irradianceWeight;
+                }
+
+                float rayProbeDist = samplePointClamp(distance.data(), octRes, uv);
+                moments.x += rayProbeDist * s.depthWeight;
+                moments.y += rayProbeDist * rayProbeDist * s.depthWeight;
+                distWeightSum += s.depthWeight;
+            }
+
+            if (pIrradiance)
+            {
+                pIrradiance[x] = packR11G11B10(irradiance * (kDeltaTheta * kDeltaPhi));
+            }
+            pMoments[x] = packRG16F(moments / distWeightSum);
+        }
+    }
+
+    bool LightFieldProbeAtlas::uploadSlices(RenderContext* pContext, const Texture::SharedPtr& pTex, uint32_t resolution, uint32_t probeCount, const void* pData)
+    {
+        if (pTex->getWidth() != resolution || pTex->getHeight() != resolution || pTex->getArraySize() != probeCount || pTex->getMipCount() != 1)
+        {
+            logError("LightFieldProbeAtlas::uploadSlices() - texture dimensions don't match the atlas");
+            return false;
+        }
+        pContext->updateTextureSubresources(pTex.get(), 0, probeCount, pData);
+        return true;
+    }
+
+    void LightFieldProbeAtlas::upload(RenderContext* pContext,
+                                      const Texture::SharedPtr& pRadianceTex, const Texture::SharedPtr& pNormalTex,
+                                      const Texture::SharedPtr& pDistanceTex, const Texture::SharedPtr& pLowResDistanceTex,
+                                      const Texture::SharedPtr& pIrradianceTex, const Texture::SharedPtr& pDistanceMomentsTex,
+                                      const TypedBuffer<float4>::SharedPtr& pIrradianceSH) const
+    {
+        if (probeCount == 0) return;
+
+        const bool compressedRadiance = isCompressedFormat(pRadianceTex->getFormat());
+        const bool compressedNormal = isCompressedFormat(pNormalTex->getFormat());
+        if ((compressedRadiance || compressedNormal) && !isCompressed())
+        {
+            logError("LightFieldProbeAtlas::upload() - block compressed textures require a compressed atlas");
+            return;
+        }
+        uploadSlices(pContext, pRadianceTex, octResolution, probeCount, compressedRadiance ? (const void*)radianceBC6H.data() : radiance.data());
+        uploadSlices(pContext, pNormalTex, octResolution, probeCount, compressedNormal ? (const void*)normalBC5.data() : normal.data());
+        uploadSlices(pContext, pDistanceTex, octResolution, probeCount, distance.data());
+        uploadSlices(pContext, pLowResDistanceTex, lowResResolution, probeCount, lowResDistance.data());
+        if (shCoeffCount > 0)
+        {
+            uploadSH(pIrradianceSH, shCoeffCount, probeCount, irradianceSH.data());
+        }
+        else
+        {
+            uploadSlices(pContext, pIrradianceTex, filteredResolution, probeCount, irradiance.data());
+        }
+        uploadSlices(pContext, pDistanceMomentsTex, filteredResolution, probeCount, distanceMoments.data());
+    }
+
+    void LightFieldProbeAtlas::download(RenderContext* pContext,
+                                        const Texture::SharedPtr& pRadianceTex, const Texture::SharedPtr& pNormalTex,
+                                        const Texture::SharedPtr& pDistanceTex, const Texture::SharedPtr& pLowResDistanceTex,
+                                        const Texture::SharedPtr& pIrradianceTex, const Texture::SharedPtr& pDistanceMomentsTex,
+                                        const TypedBuffer<float4>::SharedPtr& pIrradianceSH)
+    {
+        const uint32_t probes = pRadianceTex->getArraySize();
+        const uint32_t shCoeffs = (pIrradianceTex == nullptr && pIrradianceSH) ? pIrradianceSH->getElementCount() / probes : 0;
+        allocate(probes, pRadianceTex->getWidth(), pLowResDistanceTex->getWidth(), pDistanceMomentsTex->getWidth(), shCoeffs);
+
+        auto readSlices = [&](const Texture::SharedPtr& pTex, void* pDst, size_t sliceBytes)
+        {
+            for (uint32_t i = 0; i < probeCount; ++i)
+            {
+                std::vector<uint8> data = pContext->readTextureSubresource(pTex.get(), pTex->getSubresourceIndex(i, 0));
+                assert(data.size() >= sliceBytes);
+                std::memcpy((uint8_t*)pDst + i * sliceBytes, data.data(), std::min(sliceBytes, data.size()));
+            }
+        };
+
+        if (isCompressedFormat(pRadianceTex->getFormat()))
+        {
+            const size_t compressedSliceSize = (size_t)LightFieldProbeCompression::getSliceSize(octResolution);
+            radianceBC6H.resize(compressedSliceSize * probeCount);
+            normalBC5.resize(compressedSliceSize * probeCount);
+            readSlices(pRadianceTex, radianceBC6H.data(), compressedSliceSize);
+            readSlices(pNormalTex, normalBC5.data(), compressedSliceSize);
+            LightFieldProbeCompression::decodeBC6H(radianceBC6H.data(), octResolution, probeCount, radiance.data());
+            LightFieldProbeCompression::decodeBC5(normalBC5.data(), octResolution, probeCount, normal.data());
+        }
+        else
+        {
+            readSlices(pRadianceTex, radiance.data(), getOctSliceSize() * sizeof(uint32_t));
+            readSlices(pNormalTex, normal.data(), getOctSliceSize() * sizeof(uint32_t));
+        }
+        readSlices(pDistanceTex, distance.data(), getOctSliceSize() * sizeof(uint16_t));
+        readSlices(pLowResDistanceTex, lowResDistance.data(), getLowResSliceSize() * sizeof(uint16_t));
+        if (shCoeffCount > 0)
+        {
+            // getElement() reads the whole buffer back once, the remaining calls hit the CPU copy
+            for (uint32_t i = 0; i < (uint32_t)irradianceSH.size(); ++i)
+            {
+                irradianceSH[i] = pIrradianceSH->getElement(i);
+            }
+        }
+        else
+        {
+            readSlices(pIrradianceTex, irradiance.data(), getFilteredSliceSize() * sizeof(uint32_t));
+        }
+        readSlices(pDistanceMomentsTex, distanceMoments.data(), getFilteredSliceSize() * sizeof(uint32_t));
+    }
+
+    bool LightFieldProbeAtlas::uploadSH(const TypedBuffer<float4>::SharedPtr& pBuffer, uint32_t coeffCount, uint32_t probeCount, const float4* pData)
+    {
+        if (!pBuffer || pBuffer->getElementCount() != coeffCount * probeCount)
+        {
+            logError("LightFieldProbeAtlas::uploadSH() - buffer size doesn't match the atlas");
+            return false;
+        }
+        for (uint32_t i = 0; i < coeffCount * probeCount; ++i)
+        {
+            pBuffer->setElement(i, pData[i]);
+        }
+        return true;
+    }
+}
@@ -0,0 +1,170 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include "Falcor.h"
+#include "CpuSceneBvh.h"
+#include "LightFieldProbeSH.h"
+#include <atomic>
+
+namespace Falcor
+{
+    /** CPU copy of the light field probe atlases. Texels use the exact bit layout of the textures allocated by
+        LightFieldProbeVolume::createFBOs(), one tightly packed array slice per probe, so the data can be uploaded
+        or read back without conversion.
+    */
+    struct LightFieldProbeAtlas
+    {
+        uint32_t probeCount = 0;
+        uint32_t octResolution = 0;
+        uint32_t lowResResolution = 0;
+        uint32_t filteredResolution = 0;
+        uint32_t shCoeffCount = 0;              ///< If non-zero the irradiance is stored in irradianceSH instead of irradiance
+
+        std::vector<uint32_t> radiance;         ///< R11G11B10Float
+        std::vector<uint32_t> normal;           ///< RGBA8Unorm
+        std::vector<uint16_t> distance;         ///< R16Float
+        std::vector<uint16_t> lowResDistance;   ///< R16Float
+        std::vector<uint32_t> irradiance;       ///< R11G11B10Float
+        std::vector<uint32_t> distanceMoments;  ///< RG16Float
+        std::vector<float4> irradianceSH;       ///< shCoeffCount coefficients per probe, see LightFieldProbeSH
+
+        std::vector<uint8_t> radianceBC6H;      ///< BC6H_UF16 blocks of the radiance, empty until compress() is called
+        std::vector<uint8_t> normalBC5;         ///< BC5Unorm blocks of the normals, empty until compress() is called
+
+        void allocate(uint32_t probes, uint32_t octRes, uint32_t lowResRes, uint32_t filteredRes, uint32_t shCoeffs = 0);
+
+        /** Block compress the radiance and normal atlases, see LightFieldProbeCompression. The uncompressed texels are kept.
+        */
+        void compress();
+        bool isCompressed() const { return !radianceBC6H.empty(); }
+
+        size_t getOctSliceSize() const { return size_t(octResolution) * octResolution; }
+        size_t getLowResSliceSize() const { return size_t(lowResResolution) * lowResResolution; }
+        size_t getFilteredSliceSize() const { return size_t(filteredResolution) * filteredResolution; }
+
+        /** Upload the atlas into the probe volume textures. The textures must have been created with matching dimensions.
+            The irradiance goes to pIrradianceTex, or to pIrradianceSH if the atlas stores spherical harmonics.
+            Block compressed radiance and normal textures get the compressed blocks, which requires a compressed atlas.
+        */
+        void upload(RenderContext* pContext,
+                    const Texture::SharedPtr& pRadianceTex, const Texture::SharedPtr& pNormalTex,
+                    const Texture::SharedPtr& pDistanceTex, const Texture::SharedPtr& pLowResDistanceTex,
+                    const Texture::SharedPtr& pIrradianceTex, const Texture::SharedPtr& pDistanceMomentsTex,
+                    const TypedBuffer<float4>::SharedPtr& pIrradianceSH = nullptr) const;
+
+        /** Read the probe volume textures back into the atlas. The atlas is reallocated to match the textures.
+            Pass a null pIrradianceTex and a pIrradianceSH buffer for a volume that stores spherical harmonics.
+            Block compressed radiance and normal textures are read into the compressed blocks and decoded.
+        */
+        void download(RenderContext* pContext,
+                      const Texture::SharedPtr& pRadianceTex, const Texture::SharedPtr& pNormalTex,
+                      const Texture::SharedPtr& pDistanceTex, const Texture::SharedPtr& pLowResDistanceTex,
+                      const Texture::SharedPtr& pIrradianceTex, const Texture::SharedPtr& pDistanceMomentsTex,
+                      const TypedBuffer<float4>::SharedPtr& pIrradianceSH = nullptr);
+
+        /** Copy the spherical harmonics coefficients of probeCount probes into a buffer
+        */
+        static bool uploadSH(const TypedBuffer<float4>::SharedPtr& pBuffer, uint32_t coeffCount, uint32_t probeCount, const float4* pData);
+
+        /** Upload tightly packed array slices into a probe atlas texture.
+            \param[in] pData probeCount slices of resolution x resolution texels
+            \return false if the texture dimensions don't match
+        */
+        static bool uploadSlices(RenderContext* pContext, const Texture::SharedPtr& pTex, uint32_t resolution, uint32_t probeCount, const void* pData);
+    };
+
+    /** Reference CPU implementation of the light field probe update.
+        Traces one ray per octahedral texel against a CpuSceneBvh instead of rasterizing six cube faces, shades the hit
+        the same way LightFieldProbeShading does, and runs the same cosine/moment filtering as LightFieldProbeFiltering.slang.
+        With Settings::shCoeffCount set the irradiance is projected to spherical harmonics like LightFieldProbeSHProjection does.
+        Work is distributed over all hardware threads. The baker only touches CPU data, so it runs without a GPU when the
+        CpuSceneBvh is created from a triangle soup.
+    */
+    class LightFieldProbeBaker
+    {
+    public:
+        using SharedPtr = std::shared_ptr<LightFieldProbeBaker>;
+
+        struct Settings
+        {
+            uint32_t octResolution = 1024;
+            uint32_t lowResResolution = 32;
+            uint32_t filteredResolution = 128;
+            float depthSharpness = 50.0f;       ///< Same as LightFieldProbeFiltering::mDepthSharpness
+            float nearPlane = 0.01f;            ///< Depth range of the cube face cameras used by the GPU path
+            float farPlane = 10.0f;
+            float missDistance = 10000.0f;      ///< Distance written for rays that escape the scene
+            float shadowRayBias = 1e-3f;
+            bool shadowAllLights = false;       ///< The GPU path only has a visibility buffer for light 0
+            uint32_t shCoeffCount = 0;          ///< Project the irradiance to spherical harmonics instead of filtering an octahedral map
+            uint32_t threadCount = 0;           ///< 0 uses all hardware threads
+        };
+
+        static SharedPtr create(const Settings& settings = Settings());
+
+        /** Bake all probes. The atlas is (re)allocated to hold probePositions.size() probes, probe i is written to slice i.
+        */
+        void bake(const CpuSceneBvh& bvh, const std::vector<LightData>& lights, const std::vector<float3>& probePositions, LightFieldProbeAtlas& atlas);
+
+        /** Bake a subset of the probes into an already allocated atlas.
+        */
+        void bakeProbes(const CpuSceneBvh& bvh, const std::vector<LightData>& lights, const std::vector<float3>& probePositions, const std::vector<uint32_t>& probeIndices, LightFieldProbeAtlas& atlas);
+
+        const Settings& getSettings() const { return mSettings; }
+        void setSettings(const Settings& settings) { mSettings = settings; }
+
+        /** Statistics of the last bake
+        */
+        double getLastBakeTime() const { return mLastBakeTime; }
+        uint64_t getLastRayCount() const { return mLastRayCount; }
+
+    private:
+        LightFieldProbeBaker(const Settings& settings) : mSettings(settings) {}
+
+        uint32_t getThreadCount() const;
+        void traceProbeRow(const CpuSceneBvh& bvh, const std::vector<LightData>& lights, const float3& probePos, uint32_t probeIdx, uint32_t row, LightFieldProbeAtlas& atlas, std::atomic<uint64_t>& rayCount) const;
+        float3 shade(const CpuSceneBvh& bvh, const std::vector<LightData>& lights, const CpuSceneBvh::Hit& hit, const float3& origin, const float3& dir, float3& normal, uint64_t& rayCount) const;
+        void downscaleProbeRow(uint32_t probeIdx, uint32_t row, LightFieldProbeAtlas& atlas) const;
+
+        /** One direction of the 16x64 hemisphere loop in LightFieldProbeFiltering.ps.slang, in tangent space
+        */
+        struct FilterSample
+        {
+            float3 dir;
+            float irradianceWeight;     // cos(theta) * sin(theta)
+            float depthWeight;          // pow(cos(theta), depthSharpness)
+        };
+        std::vector<FilterSample> createFilterSamples() const;
+        void filterProbeRow(uint32_t probeIdx, uint32_t row, const std::vector<FilterSample>& samples, const std::vector<float3>& radiance, const std::vector<float>& distance, LightFieldProbeAtlas& atlas) const;
+
+        Settings mSettings;
+        LightFieldProbeSH::SharedPtr mpSHProjector;
+        double mLastBakeTime = 0.0;
+        uint64_t mLastRayCount = 0;
+    };
+}
@@ -0,0 +1,428 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "LightFieldProbeCache.h"
+#include "LightFieldProbeCompression.h"
+#include <unordered_set>
+
+namespace Falcor
+{
+    namespace
+    {
+        const char kCacheMagic[8] = { 'L', 'F', 'P', 'C', 'A', 'C', 'H', 'E' };
+        const uint32_t kCacheVersion = 5;
+        const uint64_t kSectionAlignment = 4096;
+
+        struct FileHeader
+        {
+            char magic[8];
+            uint32_t version;
+            uint32_t headerSize;
+            uint64_t sceneHash;
+            int32_t probesCount[3];
+            float probeStep[3];
+            float probeStartPosition[3];
+            uint32_t octResolution;
+            uint32_t lowResResolution;
+            uint32_t filteredResolution;
+            uint32_t probeSliceCount;
+            uint32_t shCoeffCount;
+            uint32_t compressedHighRes;     // Radiance and normal sections hold BC6H and BC5 blocks
+            struct
+            {
+                uint64_t offset;    // 0 if the section is not present
+                uint64_t size;
+            } sections[(uint32_t)LightFieldProbeCache::Section::Count];
+        };
+
+        /** 64-bit FNV-1a
+        */
+        class ContentHash
+        {
+        public:
+            void add(const void* pData, size_t size)
+            {
+                const uint8_t* pBytes = (const uint8_t*)pData;
+                for (size_t i = 0; i < size; ++i)
+                {
+                    mHash = (mHash ^ pBytes[i]) * 1099511628211ull;
+                }
+            }
+
+            template<typename T>
+            void add(const T& value)
+            {
+                static_assert(std::is_trivially_copyable<T>::value, "ContentHash::add() requires a trivially copyable type");
+                add(&value, sizeof(T));
+            }
+
+            void add(const std::string& str)
+            {
+                add(str.size());
+                add(str.data(), str.size());
+            }
+
+            void addFile(const std::string& filename)
+            {
+                add(filename);
+
+                // Files shared by several models or materials are only read once
+                if (filename.empty() || mHashedFiles.insert(filename).second == false) return;
+                std::string fullPath;
+                if (findFileInDataDirectories(filename, fullPath))
+                {
+                    MemoryMappedFile::SharedPtr pFile = MemoryMappedFile::create(fullPath);
+                    if (pFile)
+                    {
+                        add(pFile->getSize());
+                        add(pFile->getData(), pFile->getSize());
+                    }
+                }
+            }
+
+            void addTexture(const Texture* pTexture)
+            {
+                // Textures edited in place change the lighting as much as the models do
+                addFile(pTexture ? pTexture->getSourceFilename() : std::string());
+            }
+
+            uint64_t get() const { return mHash; }
+
+        private:
+            uint64_t mHash = 14695981039346656037ull;
+            std::unordered_set<std::string> mHashedFiles;
+        };
+
+        uint32_t getTexelSize(LightFieldProbeCache::Section section)
+        {
+            switch (section)
+            {
+            case LightFieldProbeCache::Section::LowResDistance:
+            case LightFieldProbeCache::Section::Distance:
+                return sizeof(uint16_t);
+            case LightFieldProbeCache::Section::IrradianceSH:
+                return sizeof(float4);
+            default:
+                return sizeof(uint32_t);
+            }
+        }
+
+        uint32_t getResolution(const LightFieldProbeCache::GridDesc& grid, LightFieldProbeCache::Section section)
+        {
+            switch (section)
+            {
+            case LightFieldProbeCache::Section::Irradiance:
+            case LightFieldProbeCache::Section::DistanceMoments:
+                return grid.filteredResolution;
+            case LightFieldProbeCache::Section::LowResDistance:
+                return grid.lowResResolution;
+            default:
+                return grid.octResolution;
+            }
+        }
+
+        uint64_t getExpectedSectionSize(const LightFieldProbeCache::GridDesc& grid, LightFieldProbeCache::Section section, bool compressedHighRes)
+        {
+            if (section == LightFieldProbeCache::Section::IrradianceSH)
+            {
+                return uint64_t(grid.probeSliceCount) * grid.shCoeffCount * getTexelSize(section);
+            }
+            if (compressedHighRes && (section == LightFieldProbeCache::Section::Radiance || section == LightFieldProbeCache::Section::Normal))
+            {
+                return uint64_t(grid.probeSliceCount) * LightFieldProbeCompression::getSliceSize(grid.octResolution);
+            }
+            uint64_t res = getResolution(grid, section);
+            return uint64_t(grid.probeSliceCount) * res * res * getTexelSize(section);
+        }
+    }
+
+    uint64_t LightFieldProbeCache::computeSceneHash(const Scene* pScene, const BoundingBox& sceneBounds, const GridDesc& grid)
+    {
+        ContentHash hash;
+        hash.add(kCacheVersion);
+
+        hash.add(sceneBounds.getMinPos());
+        hash.add(sceneBounds.getMaxPos());
+        hash.add(grid.probesCount);
+        hash.add(grid.probeStep);
+        hash.add(grid.probeStartPosition);
+        hash.add(grid.octResolution);
+        hash.add(grid.lowResResolution);
+        hash.add(grid.filteredResolution);
+        hash.add(grid.probeSliceCount);
+        hash.add(grid.shCoeffCount);
+        hash.add(grid.brickTable.size());
+        hash.add(grid.brickTable.data(), grid.brickTable.size() * sizeof(int32_t));
+        hash.add(grid.probeOffsets.size());
+        hash.add(grid.probeOffsets.data(), grid.probeOffsets.size() * sizeof(float4));
+
+        for (uint32_t modelId = 0; modelId < pScene->getModelCount(); ++modelId)
+        {
+            const Model* pModel = pScene->getModel(modelId).get();
+            hash.addFile(pModel->getFilename());
+            hash.add(pModel->getVertexCount());
+            hash.add(pModel->getPrimitiveCount());
+
+            for (uint32_t meshId = 0; meshId < pModel->getMeshCount(); ++meshId)
+            {
+                const Material* pMaterial = pModel->getMesh(meshId)->getMaterial().get();
+                if (pMaterial)
+                {
+                    hash.add(pMaterial->getBaseColor());
+                    hash.add(pMaterial->getSpecularParams());
+                    hash.add(pMaterial->getEmissiveColor());
+                    hash.add(pMaterial->getFlags());
+                    hash.addTexture(pMaterial->getBaseColorTexture().get());
+                    hash.addTexture(pMaterial->getSpecularTexture().get());
+                    hash.addTexture(pMaterial->getEmissiveTexture().get());
+                    hash.addTexture(pMaterial->getNormalMap().get());
+                }
+
+                for (uint32_t i = 0; i < pModel->getMeshInstanceCount(meshId); ++i)
+                {
+                    const auto& pMeshInstance = pModel->getMeshInstance(meshId, i);
+                    hash.add(pMeshInstance->isVisible());
+                    hash.add(pMeshInstance->getTransformMatrix());
+                }
+            }
+
+            for (uint32_t i = 0; i < pScene->getModelInstanceCount(modelId); ++i)
+            {
+                const auto& pInstance = pScene->getModelInstance(modelId, i);
+                hash.add(pInstance->isVisible());
+                hash.add(pInstance->getTransformMatrix());
+            }
+        }
+
+        for (uint32_t i = 0; i < pScene->getLightCount(); ++i)
+        {
+            const LightData& light = pScene->getLight(i)->getData();
+            hash.add(light.type);
+            hash.add(light.posW);
+            hash.add(light.dirW);
+            hash.add(light.intensity);
+            hash.add(light.openingAngle);
+            hash.add(light.cosOpeningAngle);
+            hash.add(light.penumbraAngle);
+        }
+        hash.add(pScene->getLightProbeCount());
+        hash.add(pScene->getLightingScale());
+
+        return hash.get();
+    }
+
+    LightFieldProbeCache::SharedPtr LightFieldProbeCache::load(const std::string& filename, uint64_t sceneHash)
+    {
+        MemoryMappedFile::SharedPtr pFile = MemoryMappedFile::create(filename);
+        if (!pFile) return nullptr;
+
+        if (pFile->getSize() < sizeof(FileHeader))
+        {
+            logWarning("LightFieldProbeCache: '" + filename + "' is truncated");
+            return nullptr;
+        }
+
+        FileHeader header;
+        std::memcpy(&header, pFile->getData(), sizeof(header));
+        if (std::memcmp(header.magic, kCacheMagic, sizeof(kCacheMagic)) != 0 || header.version != kCacheVersion || header.headerSize != sizeof(FileHeader))
+        {
+            logWarning("LightFieldProbeCache: '" + filename + "' is not a probe cache or was written by a different version");
+            return nullptr;
+        }
+        if (header.sceneHash != sceneHash)
+        {
+            return nullptr;
+        }
+
+        SharedPtr pCache = SharedPtr(new LightFieldProbeCache());
+        pCache->mpFile = pFile;
+        pCache->mGrid.probesCount = int3(header.probesCount[0], header.probesCount[1], header.probesCount[2]);
+        pCache->mGrid.probeStep = float3(header.probeStep[0], header.probeStep[1], header.probeStep[2]);
+        pCache->mGrid.probeStartPosition = float3(header.probeStartPosition[0], header.probeStartPosition[1], header.probeStartPosition[2]);
+        pCache->mGrid.octResolution = header.octResolution;
+        pCache->mGrid.lowResResolution = header.lowResResolution;
+        pCache->mGrid.filteredResolution = header.filteredResolution;
+        pCache->mGrid.probeSliceCount = header.probeSliceCount;
+        pCache->mGrid.shCoeffCount = header.shCoeffCount;
+        pCache->mCompressedHighRes = header.compressedHighRes != 0;
+
+        for (uint32_t i = 0; i < (uint32_t)Section::Count; ++i)
+        {
+            const auto& section = header.sections[i];
+            if (section.offset == 0) continue;
+
+            bool valid = section.size == getExpectedSectionSize(pCache->mGrid, Section(i), pCache->mCompressedHighRes);
+            valid = valid && section.offset + section.size <= pFile->getSize();
+            if (!valid)
+            {
+                logWarning("LightFieldProbeCache: '" + filename + "' is corrupt");
+                return nullptr;
+            }
+            pCache->mSectionOffsets[i] = section.offset;
+        }
+
+        // The filtered data is what the shading needs, a cache without it is useless
+        const Section irradianceSection = (header.shCoeffCount > 0) ? Section::IrradianceSH : Section::Irradiance;
+        if (!pCache->hasSection(irradianceSection) || !pCache->hasSection(Section::DistanceMoments) || !pCache->hasSection(Section::LowResDistance))
+        {
+            logWarning("LightFieldProbeCache: '" + filename + "' doesn't contain the filtered probe data");
+            return nullptr;
+        }
+        return pCache;
+    }
+
+    bool LightFieldProbeCache::write(const std::string& filename, uint64_t sceneHash, const GridDesc& grid, const LightFieldProbeAtlas& atlas, bool includeHighRes)
+    {
+        if (atlas.probeCount != grid.probeSliceCount || atlas.octResolution != grid.octResolution ||
+            atlas.lowResResolution != grid.lowResResolution || atlas.filteredResolution != grid.filteredResolution || atlas.shCoeffCount != grid.shCoeffCount)
+        {
+            logError("LightFieldProbeCache::write() - atlas doesn't match the grid description");
+            return false;
+        }
+
+        // Compressed atlases are stored compressed, a quarter of the size of the raw texels
+        const bool compressedHighRes = includeHighRes && atlas.isCompressed();
+        const void* pSectionData[(uint32_t)Section::Count] =
+        {
+            (grid.shCoeffCount > 0) ? nullptr : atlas.irradiance.data(),
+            atlas.distanceMoments.data(),
+            atlas.lowResDistance.data(),
+            includeHighRes ? (compressedHighRes ? (const void*)atlas.radianceBC6H.data() : atlas.radiance.data()) : nullptr,
+            includeHighRes ? (compressedHighRes ? (const void*)atlas.normalBC5.data() : atlas.normal.data()) : nullptr,
+            includeHighRes ? atlas.distance.data() : nullptr,
+            (grid.shCoeffCount > 0) ? atlas.irradianceSH.data() : nullptr,
+        };
+
+        FileHeader header = {};
+        std::memcpy(header.magic, kCacheMagic, sizeof(kCacheMagic));
+        header.version = kCacheVersion;
+        header.headerSize = sizeof(FileHeader);
+        header.sceneHash = sceneHash;
+        for (int i = 0; i < 3; ++i)
+        {
+            header.probesCount[i] = grid.probesCount[i];
+            header.probeStep[i] = grid.probeStep[i];
+            header.probeStartPosition[i] = grid.probeStartPosition[i];
+        }
+        header.octResolution = grid.octResolution;
+        header.lowResResolution = grid.lowResResolution;
+        header.filteredResolution = grid.filteredResolution;
+        header.probeSliceCount = grid.probeSliceCount;
+        header.shCoeffCount = grid.shCoeffCount;
+        header.compressedHighRes = compressedHighRes ? 1 : 0;
+
+        uint64_t offset = sizeof(FileHeader);
+        for (uint32_t i = 0; i < (uint32_t)Section::Count; ++i)
+        {
+            if (pSectionData[i] == nullptr) continue;
+            offset = (offset + kSectionAlignment - 1) / kSectionAlignment * kSectionAlignment;
+            header.sections[i].offset = offset;
+            header.sections[i].size = getExpectedSectionSize(grid, Section(i), compressedHighRes);
+            offset += header.sections[i].size;
+        }
+
+        // Write to a temporary file first so an interrupted write never leaves a corrupt cache behind
+        const std::string tempFilename = filename + ".tmp";
+        {
+            BinaryFileStream stream(tempFilename, BinaryFileStream::Mode::Write);
+            if (stream.isFail())
+            {
+                logWarning("LightFieldProbeCache: can't open '" + tempFilename + "' for writing");
+                return false;
+            }
+
+            stream.write(&header, sizeof(header));
+            uint64_t written = sizeof(header);
+            const std::vector<uint8_t> padding(kSectionAlignment, 0);
+            for (uint32_t i = 0; i < (uint32_t)Section::Count; ++i)
+            {
+                if (pSectionData[i] == nullptr) continue;
+                stream.write(padding.data(), size_t(header.sections[i].offset - written));
+                stream.write(pSectionData[i], size_t(header.sections[i].size));
+                written = header.sections[i].offset + header.sections[i].size;
+            }
+
+            if (stream.isBad())
+            {
+                logWarning("LightFieldProbeCache: failed to write '" + tempFilename + "'");
+                stream.remove();
+                return false;
+            }
+        }
+
+        std::remove(filename.c_str());
+        if (std::rename(tempFilename.c_str(), filename.c_str()) != 0)
+        {
+            logWarning("LightFieldProbeCache: failed to rename '" + tempFilename + "' to '" + filename + "'");
+            return false;
+        }
+        return true;
+    }
+
+    const void* LightFieldProbeCache::getSectionData(Section section) const
+    {
+        uint64_t offset = mSectionOffsets[(uint32_t)section];
+        return offset ? (const uint8_t*)mpFile->getData() + offset : nullptr;
+    }
+
+    bool LightFieldProbeCache::upload(RenderContext* pContext,
+                                      const Texture::SharedPtr& pRadianceTex, const Texture::SharedPtr& pNormalTex,
+                                      const Texture::SharedPtr& pDistanceTex, const Texture::SharedPtr& pLowResDistanceTex,
+                                      const Texture::SharedPtr& pIrradianceTex, const Texture::SharedPtr& pDistanceMomentsTex,
+                                      const TypedBuffer<float4>::SharedPtr& pIrradianceSH) const
+    {
+        const Texture::SharedPtr pTextures[(uint32_t)Section::Count] =
+        {
+            pIrradianceTex, pDistanceMomentsTex, pLowResDistanceTex, pRadianceTex, pNormalTex, pDistanceTex, nullptr
+        };
+
+        if (hasCompressedHighRes() && (!isCompressedFormat(pRadianceTex->getFormat()) || !isCompressedFormat(pNormalTex->getFormat())))
+        {
+            logError("LightFieldProbeCache::upload() - the cache stores compressed atlases, the radiance and normal textures must be block compressed");
+            return false;
+        }
+
+        for (uint32_t i = 0; i < (uint32_t)Section::Count; ++i)
+        {
+            const void* pData = getSectionData(Section(i));
+            if (pData == nullptr) continue;
+            if (Section(i) == Section::IrradianceSH)
+            {
+                if (!LightFieldProbeAtlas::uploadSH(pIrradianceSH, mGrid.shCoeffCount, getProbeCount(), (const float4*)pData))
+                {
+                    return false;
+                }
+                continue;
+            }
+            if (!LightFieldProbeAtlas::uploadSlices(pContext, pTextures[i], getResolution(mGrid, Section(i)), getProbeCount(), pData))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
@@ -0,0 +1,120 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include "Falcor.h"
+#include "LightFieldProbeBaker.h"
+
+namespace Falcor
+{
+    /** Persistent on-disk copy of the light field probe atlases.
+        The file is a fixed header followed by page aligned, tightly packed texture arrays in the GPU texel formats, so it
+        can be memory mapped and uploaded without any conversion. A cache is only valid for the scene content hash it was
+        written with, see computeSceneHash().
+    */
+    class LightFieldProbeCache
+    {
+    public:
+        using SharedPtr = std::shared_ptr<LightFieldProbeCache>;
+        using SharedConstPtr = std::shared_ptr<const LightFieldProbeCache>;
+
+        /** Grid parameters of the probe volume the cache was baked for
+        */
+        struct GridDesc
+        {
+            int3 probesCount;
+            float3 probeStep;
+            float3 probeStartPosition;
+            uint32_t octResolution = 0;
+            uint32_t lowResResolution = 0;
+            uint32_t filteredResolution = 0;
+            uint32_t probeSliceCount = 0;       ///< Texture array layers, the number of allocated bricks times the brick size
+            uint32_t shCoeffCount = 0;          ///< Spherical harmonics coefficients per probe, 0 if the irradiance is an octahedral atlas
+            std::vector<int32_t> brickTable;    ///< Brick indirection table. Only hashed, it is rebuilt from the scene on load
+            std::vector<float4> probeOffsets;   ///< Per-probe relocation offset and state. Only hashed, probes are classified again on load
+        };
+
+        enum class Section : uint32_t
+        {
+            Irradiance,         ///< R11G11B10Float, filtered resolution. Only without spherical harmonics
+            DistanceMoments,    ///< RG16Float, filtered resolution
+            LowResDistance,     ///< R16Float, low-res resolution
+            Radiance,           ///< R11G11B10Float or BC6H_UF16 blocks, octahedral resolution. Optional
+            Normal,             ///< RGBA8Unorm or BC5Unorm blocks, octahedral resolution. Optional
+            Distance,           ///< R16Float, octahedral resolution. Optional
+            IrradianceSH,       ///< RGBA32Float, shCoeffCount coefficients per probe. Only with spherical harmonics
+            Count
+        };
+
+        /** Hash of everything that affects the probe content: model files, instance transforms, materials, lights,
+            the volume bounds and the grid parameters.
+        */
+        static uint64_t computeSceneHash(const Scene* pScene, const BoundingBox& sceneBounds, const GridDesc& grid);
+
+        /** Map a cache file.
+            \return The cache, or nullptr if the file doesn't exist, is corrupt or was written for a different hash
+        */
+        static SharedPtr load(const std::string& filename, uint64_t sceneHash);
+
+        /** Write a cache file.
+            \param[in] includeHighRes Also store the full resolution radiance, normal and distance atlases. The radiance and normal
+                        atlases are stored block compressed if the atlas was compressed, see LightFieldProbeAtlas::compress().
+        */
+        static bool write(const std::string& filename, uint64_t sceneHash, const GridDesc& grid, const LightFieldProbeAtlas& atlas, bool includeHighRes);
+
+        /** Upload all sections present in the file into the probe volume textures.
+            If hasCompressedHighRes() the radiance and normal textures must be BC6HU16 and BC5Unorm.
+        */
+        bool upload(RenderContext* pContext,
+                    const Texture::SharedPtr& pRadianceTex, const Texture::SharedPtr& pNormalTex,
+                    const Texture::SharedPtr& pDistanceTex, const Texture::SharedPtr& pLowResDistanceTex,
+                    const Texture::SharedPtr& pIrradianceTex, const Texture::SharedPtr& pDistanceMomentsTex,
+                    const TypedBuffer<float4>::SharedPtr& pIrradianceSH = nullptr) const;
+
+        const GridDesc& getGridDesc() const { return mGrid; }
+        uint32_t getProbeCount() const { return mGrid.probeSliceCount; }
+        bool hasSection(Section section) const { return getSectionData(section) != nullptr; }
+        bool hasCompressedHighRes() const { return mCompressedHighRes && hasSection(Section::Radiance); }
+
+        /** Check if the file holds the full resolution radiance, normal and distance atlases, which the probe ray trace reads.
+            Without them only the filtered data can be used.
+        */
+        bool hasHighRes() const { return hasSection(Section::Radiance) && hasSection(Section::Normal) && hasSection(Section::Distance); }
+
+        /** Get a pointer into the mapped file, or nullptr if the section is not present
+        */
+        const void* getSectionData(Section section) const;
+
+    private:
+        LightFieldProbeCache() = default;
+
+        MemoryMappedFile::SharedPtr mpFile;
+        GridDesc mGrid;
+        uint64_t mSectionOffsets[(uint32_t)Section::Count] = {};
+        bool mCompressedHighRes = false;
+    };
+}
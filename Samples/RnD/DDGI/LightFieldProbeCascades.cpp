@@ -0,0 +1,136 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "LightFieldProbeCascades.h"
+
+namespace Falcor
+{
+    LightFieldProbeCascades::SharedPtr LightFieldProbeCascades::create(const Settings& settings)
+    {
+        return SharedPtr(new LightFieldProbeCascades(settings));
+    }
+
+    LightFieldProbeCascades::LightFieldProbeCascades(const Settings& settings) : mSettings(settings)
+    {
+        createCascades();
+    }
+
+    void LightFieldProbeCascades::setScene(const Scene::SharedPtr& pScene)
+    {
+        mpScene = pScene;
+        for (auto& pCascade : mCascades)
+        {
+            pCascade->setScene(pScene);
+        }
+    }
+
+    void LightFieldProbeCascades::setSettings(const Settings& settings)
+    {
+        mSettings = settings;
+        createCascades();
+    }
+
+    void LightFieldProbeCascades::createCascades()
+    {
+        mSettings.cascadeCount = glm::clamp(mSettings.cascadeCount, 1u, (uint32_t)MaxCascadeCount);
+        mSettings.baseProbeStep = std::max(mSettings.baseProbeStep, 0.01f);
+        mSettings.stepScale = std::max(mSettings.stepScale, 1.0f);
+
+        mCascades.clear();
+        float step = mSettings.baseProbeStep;
+        for (uint32_t i = 0; i < mSettings.cascadeCount; ++i)
+        {
+            LightFieldProbeVolume::SharedPtr pCascade = LightFieldProbeVolume::create();
+            pCascade->setProbesCount(mSettings.probesCount);
+            pCascade->setScrollingProbeStep(float3(step));
+            if (mpScene)
+            {
+                pCascade->setScene(mpScene);
+            }
+            mCascades.push_back(pCascade);
+            step *= mSettings.stepScale;
+        }
+        mScrolledCounts.assign(mCascades.size(), 0);
+    }
+
+    void LightFieldProbeCascades::update(RenderContext* pContext, const Camera* pCamera)
+    {
+        for (size_t i = 0; i < mCascades.size(); ++i)
+        {
+            if (pCamera)
+            {
+                mScrolledCounts[i] = mCascades[i]->scrollTo(pContext, pCamera->getPosition());
+            }
+            mCascades[i]->update(pContext, pCamera);
+        }
+    }
+
+    BoundingBox LightFieldProbeCascades::getCascadeBounds(uint32_t index) const
+    {
+        const LightFieldProbeVolume* pCascade = mCascades[index].get();
+        const float3 minPos = pCascade->getProbeStartPosition();
+        const float3 maxPos = minPos + pCascade->getProbeStep() * float3(pCascade->getProbesCount() - 1);
+        return BoundingBox::fromMinMax(minPos, maxPos);
+    }
+
+    float LightFieldProbeCascades::getFadeWidth(uint32_t index) const
+    {
+        const float3 step = mCascades[index]->getProbeStep();
+        return std::max(std::max(step.x, std::max(step.y, step.z)) * mSettings.fadeCells, 1e-4f);
+    }
+
+    void LightFieldProbeCascades::renderUI(Gui* pGui, const char* group)
+    {
+        if (pGui->beginGroup(group))
+        {
+            // The layout is only rebuilt on Apply, changing it reallocates every cascade
+            int cascadeCount = (int)mSettings.cascadeCount;
+            if (pGui->addIntVar("Cascade Count", cascadeCount, 1, MaxCascadeCount))
+            {
+                mSettings.cascadeCount = (uint32_t)cascadeCount;
+            }
+            pGui->addInt3Var("Probes Per Cascade", mSettings.probesCount, 1, 256);
+            pGui->addFloatVar("Finest Probe Step", mSettings.baseProbeStep, 0.01f, 100.0f);
+            pGui->addFloatVar("Step Scale", mSettings.stepScale, 1.0f, 8.0f);
+            if (pGui->addButton("Apply"))
+            {
+                createCascades();
+            }
+            pGui->addFloatVar("Fade Width (steps)", mSettings.fadeCells, 0.0f, 4.0f);
+
+            for (uint32_t i = 0; i < getCascadeCount(); ++i)
+            {
+                const std::string name = "Cascade " + std::to_string(i);
+                pGui->addText((name + ": probe step " + std::to_string(mCascades[i]->getProbeStep().x) +
+                               ", probes wrapped last frame " + std::to_string(mScrolledCounts[i])).c_str());
+                mCascades[i]->renderUI(pGui, name.c_str());
+            }
+
+            pGui->endGroup();
+        }
+    }
+}
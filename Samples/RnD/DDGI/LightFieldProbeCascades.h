@@ -0,0 +1,92 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include "Falcor.h"
+#include "LightFieldProbeVolume.h"
+
+namespace Falcor
+{
+    /** Nested light field probe volumes centered on the camera.
+        Cascade i has a probe spacing of baseProbeStep * stepScale^i, so the same probe count covers a larger region at
+        a lower density the further it is from the camera. Each cascade is a scrolling volume: when the camera moves it
+        shifts by whole cells and only the probes that wrap around to the new side are re-rendered.
+        Shading blends from each cascade to the next coarser one over the outer cell of its region.
+    */
+    class LightFieldProbeCascades
+    {
+    public:
+        using SharedPtr = std::shared_ptr<LightFieldProbeCascades>;
+
+        enum
+        {
+            MaxCascadeCount = 4,        // Must match MAX_PROBE_CASCADES in LightFieldProbeRayTracing.slang
+        };
+
+        struct Settings
+        {
+            uint32_t cascadeCount = 3;
+            int3 probesCount = int3(8, 4, 8);       ///< Per cascade
+            float baseProbeStep = 1.0f;             ///< Spacing of the finest cascade
+            float stepScale = 2.0f;                 ///< Spacing ratio between consecutive cascades
+            float fadeCells = 1.0f;                 ///< Width of the blend region at the boundary of a cascade, in probe steps
+        };
+
+        static SharedPtr create(const Settings& settings = Settings());
+
+        void setScene(const Scene::SharedPtr& pScene);
+
+        /** Change the cascade layout. All cascades are reallocated.
+        */
+        void setSettings(const Settings& settings);
+        const Settings& getSettings() const { return mSettings; }
+
+        /** Center the cascades on the camera, then update the probes of each cascade, finest first.
+        */
+        void update(RenderContext* pContext, const Camera* pCamera);
+
+        uint32_t getCascadeCount() const { return (uint32_t)mCascades.size(); }
+        const LightFieldProbeVolume::SharedPtr& getCascade(uint32_t index) const { return mCascades[index]; }
+
+        /** Region of a cascade where probe interpolation is valid. Shading fades to the next cascade over getFadeWidth() inside it.
+        */
+        BoundingBox getCascadeBounds(uint32_t index) const;
+        float getFadeWidth(uint32_t index) const;
+
+        void renderUI(Gui* pGui, const char* group = nullptr);
+
+    private:
+        LightFieldProbeCascades(const Settings& settings);
+
+        void createCascades();
+
+        Settings mSettings;
+        Scene::SharedPtr mpScene;
+        std::vector<LightFieldProbeVolume::SharedPtr> mCascades;
+        std::vector<uint32_t> mScrolledCounts;      // Probes that wrapped around during the last update, per cascade
+    };
+}
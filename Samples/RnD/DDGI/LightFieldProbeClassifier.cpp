@@ -0,0 +1,167 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "LightFieldProbeClassifier.h"
+#include "CpuParallelFor.h"
+
+namespace Falcor
+{
+    LightFieldProbeClassifier::SharedPtr LightFieldProbeClassifier::create(const Settings& settings)
+    {
+        return SharedPtr(new LightFieldProbeClassifier(settings));
+    }
+
+    LightFieldProbeClassifier::LightFieldProbeClassifier(const Settings& settings)
+        : mSettings(settings)
+    {
+        generateRayDirections();
+    }
+
+    void LightFieldProbeClassifier::setSettings(const Settings& settings)
+    {
+        mSettings = settings;
+        generateRayDirections();
+    }
+
+    void LightFieldProbeClassifier::generateRayDirections()
+    {
+        // Spherical Fibonacci set, evenly spread and deterministic so the result doesn't change between runs
+        const uint32_t count = std::max(1u, mSettings.rayCount);
+        const float goldenAngle = float(M_PI) * (3.0f - std::sqrt(5.0f));
+
+        mRayDirections.resize(count);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            float z = 1.0f - (2.0f * i + 1.0f) / count;
+            float r = std::sqrt(std::max(0.0f, 1.0f - z * z));
+            float phi = goldenAngle * i;
+            mRayDirections[i] = float3(r * std::cos(phi), r * std::sin(phi), z);
+        }
+    }
+
+    LightFieldProbeClassifier::RayStats LightFieldProbeClassifier::traceRays(const CpuSceneBvh& bvh, const float3& position) const
+    {
+        RayStats stats;
+        for (const float3& dir : mRayDirections)
+        {
+            CpuSceneBvh::Hit hit;
+            if (!bvh.intersect(position, dir, 0.0f, std::numeric_limits<float>::max(), hit))
+            {
+                continue;
+            }
+
+            bool backface = glm::dot(bvh.getGeometricNormal(hit), dir) > 0.0f;
+            if (backface)
+            {
+                stats.backfaceCount++;
+                if (hit.t < stats.closestBackfaceT)
+                {
+                    stats.closestBackfaceT = hit.t;
+                    stats.closestBackfaceDir = dir;
+                }
+            }
+            else if (hit.t < stats.closestFrontfaceT)
+            {
+                stats.closestFrontfaceT = hit.t;
+                stats.closestFrontfaceDir = dir;
+            }
+        }
+        return stats;
+    }
+
+    LightFieldProbeClassifier::ProbeResult LightFieldProbeClassifier::classifyProbe(const CpuSceneBvh& bvh, const float3& position, const float3& probeStep) const
+    {
+        const float minStep = std::min(probeStep.x, std::min(probeStep.y, probeStep.z));
+        const float minDistance = mSettings.minSurfaceDistance * minStep;
+        const float3 maxOffset = probeStep * mSettings.maxOffset;
+        const uint32_t backfaceLimit = uint32_t(mSettings.backfaceThreshold * mRayDirections.size());
+
+        ProbeResult result;
+        for (uint32_t iter = 0; iter < mSettings.iterationCount; ++iter)
+        {
+            RayStats stats = traceRays(bvh, position + result.offset);
+
+            float3 move;
+            if (stats.backfaceCount > backfaceLimit)
+            {
+                // Inside geometry, step through the closest back face and keep some clearance on the other side
+                move = stats.closestBackfaceDir * (stats.closestBackfaceT + minDistance);
+            }
+            else if (stats.closestFrontfaceT < minDistance)
+            {
+                // Outside but too close to a surface, the probe would mostly see that surface
+                move = -stats.closestFrontfaceDir * (minDistance - stats.closestFrontfaceT);
+            }
+            else
+            {
+                break;
+            }
+
+            result.offset = glm::clamp(result.offset + move, -maxOffset, maxOffset);
+        }
+
+        RayStats stats = traceRays(bvh, position + result.offset);
+        if (stats.backfaceCount > backfaceLimit)
+        {
+            result.offset = float3(0.0f);
+            result.state = ProbeState::Inactive;
+        }
+        return result;
+    }
+
+    std::vector<LightFieldProbeClassifier::ProbeResult> LightFieldProbeClassifier::classify(const CpuSceneBvh& bvh, const std::vector<float3>& probePositions, const float3& probeStep) const
+    {
+        std::vector<ProbeResult> results(probePositions.size());
+
+        const uint32_t threadCount = mSettings.threadCount > 0 ? mSettings.threadCount : getDefaultCpuThreadCount();
+        parallelFor((uint32_t)probePositions.size(), threadCount, [&](uint32_t i)
+        {
+            results[i] = classifyProbe(bvh, probePositions[i], probeStep);
+        });
+
+        return results;
+    }
+
+    bool LightFieldProbeClassifier::renderUI(Gui* pGui, const char* group)
+    {
+        bool changed = false;
+        if (pGui->beginGroup(group))
+        {
+            if (pGui->addIntVar("Ray Count", (int&)mSettings.rayCount, 4, 1024))
+            {
+                generateRayDirections();
+                changed = true;
+            }
+            changed |= pGui->addFloatVar("Backface Threshold", mSettings.backfaceThreshold, 0.0f, 1.0f);
+            changed |= pGui->addFloatVar("Min Surface Distance", mSettings.minSurfaceDistance, 0.0f, 0.5f);
+            changed |= pGui->addFloatVar("Max Offset", mSettings.maxOffset, 0.0f, 0.5f);
+            changed |= pGui->addIntVar("Iterations", (int&)mSettings.iterationCount, 0, 16);
+            pGui->endGroup();
+        }
+        return changed;
+    }
+}
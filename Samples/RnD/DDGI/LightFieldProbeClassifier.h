@@ -0,0 +1,101 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include "Falcor.h"
+#include "CpuSceneBvh.h"
+
+namespace Falcor
+{
+    /** Moves grid-placed probes out of scene geometry and flags the ones that can't be rescued.
+        Each probe casts a sphere of rays against the CPU BVH. A probe that sees a large fraction of back faces
+        is inside geometry and is pushed through the closest back face; a probe that sits too close to a front
+        face is pushed away from it. Offsets are bounded to a fraction of the grid cell so the probe keeps its
+        place in the trilinear cage. Probes that are still enclosed after relocation are marked inactive.
+    */
+    class LightFieldProbeClassifier
+    {
+    public:
+        using SharedPtr = std::shared_ptr<LightFieldProbeClassifier>;
+
+        enum class ProbeState : uint32_t
+        {
+            Active = 0,
+            Inactive = 1,       // Fully enclosed by geometry, never rendered and ignored when shading
+        };
+
+        struct Settings
+        {
+            uint32_t rayCount = 64;
+            float backfaceThreshold = 0.25f;        // Fraction of back face hits above which a probe is considered inside geometry
+            float minSurfaceDistance = 0.1f;        // Minimum distance to a front face, relative to the smallest probe step
+            float maxOffset = 0.45f;                // Maximum offset along each axis, relative to the probe step
+            uint32_t iterationCount = 3;
+            uint32_t threadCount = 0;               // 0 uses all hardware threads
+        };
+
+        struct ProbeResult
+        {
+            float3 offset = float3(0.0f);
+            ProbeState state = ProbeState::Active;
+        };
+
+        static SharedPtr create(const Settings& settings = Settings());
+
+        /** Classify probes placed at probePositions.
+            \param[in] probeStep Grid spacing, bounds the offsets
+            \return One result per probe, in the same order as probePositions
+        */
+        std::vector<ProbeResult> classify(const CpuSceneBvh& bvh, const std::vector<float3>& probePositions, const float3& probeStep) const;
+
+        const Settings& getSettings() const { return mSettings; }
+        void setSettings(const Settings& settings);
+
+        /** Returns true if a setting changed and the probes need to be classified again
+        */
+        bool renderUI(Gui* pGui, const char* group = nullptr);
+
+    private:
+        LightFieldProbeClassifier(const Settings& settings);
+
+        struct RayStats
+        {
+            uint32_t backfaceCount = 0;
+            float closestBackfaceT = std::numeric_limits<float>::max();
+            float3 closestBackfaceDir;
+            float closestFrontfaceT = std::numeric_limits<float>::max();
+            float3 closestFrontfaceDir;
+        };
+
+        RayStats traceRays(const CpuSceneBvh& bvh, const float3& position) const;
+        ProbeResult classifyProbe(const CpuSceneBvh& bvh, const float3& position, const float3& probeStep) const;
+        void generateRayDirections();
+
+        Settings mSettings;
+        std::vector<float3> mRayDirections;
+    };
+}
@@ -0,0 +1,502 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "LightFieldProbeCompression.h"
+#include "LightFieldProbeMath.h"
+#include <array>
+#include <emmintrin.h>
+
+namespace Falcor
+{
+    using namespace LightFieldProbeMath;
+
+    namespace
+    {
+        const uint32_t kTexelsPerBlock = LightFieldProbeCompression::kBlockDim * LightFieldProbeCompression::kBlockDim;
+
+        // BC6H mode 11: one region, 10-bit endpoints stored as is, 4-bit indices
+        const uint32_t kBC6HMode11 = 0x03;
+        const uint32_t kBC6HModeBits = 5;
+        const uint32_t kBC6HEndpointBits = 10;
+        const int32_t kBC6HMaxEndpoint = (1 << kBC6HEndpointBits) - 1;
+        const uint32_t kBC6HIndexOffset = kBC6HModeBits + 6 * kBC6HEndpointBits;
+        const int32_t kBC6HWeights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+        const uint16_t kMaxHalf = 0x7BFF;
+
+        /** 128 bits read and written LSB first, the bit order of BC6H
+        */
+        struct Block128
+        {
+            uint64_t bits[2] = {};
+
+            void write(uint32_t offset, uint32_t count, uint64_t value)
+            {
+                const uint32_t word = offset >> 6;
+                const uint32_t shift = offset & 63;
+                value &= (1ull << count) - 1;
+                bits[word] |= value << shift;
+                if (shift + count > 64)
+                {
+                    bits[word + 1] |= value >> (64 - shift);
+                }
+            }
+
+            uint32_t read(uint32_t offset, uint32_t count) const
+            {
+                const uint32_t word = offset >> 6;
+                const uint32_t shift = offset & 63;
+                uint64_t value = bits[word] >> shift;
+                if (shift + count > 64)
+                {
+                    value |= bits[word + 1] << (64 - shift);
+                }
+                return uint32_t(value & ((1ull << count) - 1));
+            }
+        };
+
+        /** Run func(slice, blockX, blockY) for every block, one row of blocks per work item
+        */
+        template<typename Func>
+        void forEachBlock(uint32_t resolution, uint32_t sliceCount, uint32_t threadCount, const Func& func)
+        {
+            const uint32_t blocksPerRow = resolution / LightFieldProbeCompression::kBlockDim;
+            parallelFor(sliceCount * blocksPerRow, threadCount, [&](uint32_t row)
+            {
+                const uint32_t slice = row / blocksPerRow;
+                const uint32_t blockY = row % blocksPerRow;
+                for (uint32_t blockX = 0; blockX < blocksPerRow; ++blockX)
+                {
+                    func(slice, blockX, blockY);
+                }
+            });
+        }
+
+        inline size_t getTexelIndex(uint32_t resolution, uint32_t slice, uint32_t blockX, uint32_t blockY, uint32_t i)
+        {
+            const uint32_t x = blockX * LightFieldProbeCompression::kBlockDim + i % LightFieldProbeCompression::kBlockDim;
+            const uint32_t y = blockY * LightFieldProbeCompression::kBlockDim + i / LightFieldProbeCompression::kBlockDim;
+            return (size_t(slice) * resolution + y) * resolution + x;
+        }
+
+        inline size_t getBlockOffset(uint32_t resolution, uint32_t slice, uint32_t blockX, uint32_t blockY)
+        {
+            const uint32_t blocksPerRow = resolution / LightFieldProbeCompression::kBlockDim;
+            return ((size_t(slice) * blocksPerRow + blockY) * blocksPerRow + blockX) * LightFieldProbeCompression::kBlockBytes;
+        }
+
+        // BC6H works on the bit patterns of the half floats. The decoder interpolates the unquantized endpoints and scales
+        // the result by 31/64, so the encoder fits the endpoints to the half bits scaled by 64/31.
+
+        inline float halfToInterpolated(uint16_t h)
+        {
+            return float(h) * (64.0f / 31.0f);
+        }
+
+        inline int32_t quantizeBC6H(float v)
+        {
+            return glm::clamp(int32_t(std::floor((v - 32.0f) / 64.0f + 0.5f)), 0, kBC6HMaxEndpoint);
+        }
+
+        inline int32_t unquantizeBC6H(int32_t q)
+        {
+            if (q == 0) return 0;
+            if (q == kBC6HMaxEndpoint) return 0xFFFF;
+            return ((q << 16) + 0x8000) >> kBC6HEndpointBits;
+        }
+
+        inline int32_t interpolateBC6H(int32_t a, int32_t b, uint32_t index)
+        {
+            const int32_t w = kBC6HWeights[index];
+            return (a * (64 - w) + b * w + 32) >> 6;
+        }
+
+        /** Index of the palette weight closest to w, for w in [0, 64]
+        */
+        const std::array<uint8_t, 65>& getWeightToIndexTable()
+        {
+            static const std::array<uint8_t, 65> table = []()
+            {
+                std::array<uint8_t, 65> t;
+                for (int32_t w = 0; w <= 64; ++w)
+                {
+                    uint8_t best = 0;
+                    for (uint8_t i = 1; i < 16; ++i)
+                    {
+                        if (std::abs(kBC6HWeights[i] - w) < std::abs(kBC6HWeights[best] - w)) best = i;
+                    }
+                    t[w] = best;
+                }
+                return t;
+            }();
+            return table;
+        }
+
+        struct BC6HTexels
+        {
+            alignas(16) float c[3][kTexelsPerBlock];
+        };
+
+        /** Endpoints along the principal axis of the block colors, found by power iteration on the covariance matrix
+        */
+        void fitBC6HEndpoints(const BC6HTexels& texels, float3& e0, float3& e1)
+        {
+            float3 mean(0.0f);
+            float3 minColor(FLT_MAX);
+            float3 maxColor(0.0f);
+            for (uint32_t i = 0; i < kTexelsPerBlock; ++i)
+            {
+                const float3 c(texels.c[0][i], texels.c[1][i], texels.c[2][i]);
+                mean += c;
+                minColor = glm::min(minColor, c);
+                maxColor = glm::max(maxColor, c);
+            }
+            mean /= float(kTexelsPerBlock);
+
+            glm::mat3 covariance(0.0f);
+            for (uint32_t i = 0; i < kTexelsPerBlock; ++i)
+            {
+                const float3 d = float3(texels.c[0][i], texels.c[1][i], texels.c[2][i]) - mean;
+                covariance += glm::outerProduct(d, d);
+            }
+
+            float3 axis = maxColor - minColor;
+            if (glm::dot(axis, axis) == 0.0f)
+            {
+                e0 = e1 = mean;
+                return;
+            }
+            for (uint32_t i = 0; i < 8; ++i)
+            {
+                const float3 next = covariance * axis;
+                const float lengthSq = glm::dot(next, next);
+                if (lengthSq < 1e-12f) break;
+                axis = next / std::sqrt(lengthSq);
+            }
+
+            float tMin = FLT_MAX;
+            float tMax = -FLT_MAX;
+            for (uint32_t i = 0; i < kTexelsPerBlock; ++i)
+            {
+                const float t = glm::dot(float3(texels.c[0][i], texels.c[1][i], texels.c[2][i]) - mean, axis);
+                tMin = std::min(tMin, t);
+                tMax = std::max(tMax, t);
+            }
+            e0 = glm::clamp(mean + axis * tMin, float3(0.0f), float3(65535.0f));
+            e1 = glm::clamp(mean + axis * tMax, float3(0.0f), float3(65535.0f));
+        }
+
+        /** Pick the palette entry closest to the projection of each texel on the segment between the unquantized endpoints
+        */
+        void findBC6HIndices(const BC6HTexels& texels, const int32_t a[3], const int32_t b[3], uint8_t indices[kTexelsPerBlock])
+        {
+            const float d[3] = { float(b[0] - a[0]), float(b[1] - a[1]), float(b[2] - a[2]) };
+            const float lengthSq = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+            if (lengthSq == 0.0f)
+            {
+                std::memset(indices, 0, kTexelsPerBlock);
+                return;
+            }
+
+            const std::array<uint8_t, 65>& weightToIndex = getWeightToIndexTable();
+            const __m128 scale = _mm_set1_ps(64.0f / lengthSq);
+            const __m128 maxWeight = _mm_set1_ps(64.0f);
+            const __m128 zero = _mm_setzero_ps();
+            for (uint32_t i = 0; i < kTexelsPerBlock; i += 4)
+            {
+                __m128 t = zero;
+                for (uint32_t c = 0; c < 3; ++c)
+                {
+                    __m128 delta = _mm_sub_ps(_mm_load_ps(&texels.c[c][i]), _mm_set1_ps(float(a[c])));
+                    t = _mm_add_ps(t, _mm_mul_ps(delta, _mm_set1_ps(d[c])));
+                }
+                t = _mm_min_ps(_mm_max_ps(_mm_mul_ps(t, scale), zero), maxWeight);
+
+                alignas(16) int32_t weights[4];
+                _mm_store_si128((__m128i*)weights, _mm_cvtps_epi32(t));
+                for (uint32_t j = 0; j < 4; ++j)
+                {
+                    indices[i + j] = weightToIndex[weights[j]];
+                }
+            }
+        }
+
+        float evaluateBC6H(const BC6HTexels& texels, const int32_t a[3], const int32_t b[3], const uint8_t indices[kTexelsPerBlock])
+        {
+            float error = 0.0f;
+            for (uint32_t i = 0; i < kTexelsPerBlock; ++i)
+            {
+                for (uint32_t c = 0; c < 3; ++c)
+                {
+                    const float d = float(interpolateBC6H(a[c], b[c], indices[i])) - texels.c[c][i];
+                    error += d * d;
+                }
+            }
+            return error;
+        }
+
+        /** Least squares endpoints for a fixed set of indices
+            \return false if the indices don't constrain both endpoints
+        */
+        bool refitBC6HEndpoints(const BC6HTexels& texels, const uint8_t indices[kTexelsPerBlock], float3& e0, float3& e1)
+        {
+            float a00 = 0.0f, a01 = 0.0f, a11 = 0.0f;
+            float3 b0(0.0f), b1(0.0f);
+            for (uint32_t i = 0; i < kTexelsPerBlock; ++i)
+            {
+                const float f = float(kBC6HWeights[indices[i]]) / 64.0f;
+                const float g = 1.0f - f;
+                const float3 c(texels.c[0][i], texels.c[1][i], texels.c[2][i]);
+                a00 += g * g;
+                a01 += g * f;
+                a11 += f * f;
+                b0 += g * c;
+                b1 += f * c;
+            }
+
+            const float det = a00 * a11 - a01 * a01;
+            if (std::abs(det) < 1e-6f) return false;
+
+            const float invDet = 1.0f / det;
+            e0 = glm::clamp((a11 * b0 - a01 * b1) * invDet, float3(0.0f), float3(65535.0f));
+            e1 = glm::clamp((a00 * b1 - a01 * b0) * invDet, float3(0.0f), float3(65535.0f));
+            return true;
+        }
+
+        struct BC6HCandidate
+        {
+            int32_t q0[3];
+            int32_t q1[3];
+            uint8_t indices[kTexelsPerBlock];
+            float error;
+
+            void set(const BC6HTexels& texels, const float3& e0, const float3& e1)
+            {
+                int32_t a[3], b[3];
+                for (uint32_t c = 0; c < 3; ++c)
+                {
+                    q0[c] = quantizeBC6H(e0[c]);
+                    q1[c] = quantizeBC6H(e1[c]);
+                    a[c] = unquantizeBC6H(q0[c]);
+                    b[c] = unquantizeBC6H(q1[c]);
+                }
+                findBC6HIndices(texels, a, b, indices);
+                error = evaluateBC6H(texels, a, b, indices);
+            }
+        };
+
+        void encodeBC6HBlock(const BC6HTexels& texels, uint8_t* pDst)
+        {
+            float3 e0, e1;
+            fitBC6HEndpoints(texels, e0, e1);
+            BC6HCandidate best;
+            best.set(texels, e0, e1);
+
+            // The extreme projections are pulled out by outliers, one refit with the chosen indices usually lowers the error
+            if (best.error > 0.0f && refitBC6HEndpoints(texels, best.indices, e0, e1))
+            {
+                BC6HCandidate refit;
+                refit.set(texels, e0, e1);
+                if (refit.error < best.error) best = refit;
+            }
+
+            // The MSB of the first index is implicitly 0, swap the endpoints if needed
+            if (best.indices[0] & 0x8)
+            {
+                for (uint32_t c = 0; c < 3; ++c) std::swap(best.q0[c], best.q1[c]);
+                for (uint32_t i = 0; i < kTexelsPerBlock; ++i) best.indices[i] = 15 - best.indices[i];
+            }
+
+            Block128 block;
+            uint32_t offset = 0;
+            block.write(offset, kBC6HModeBits, kBC6HMode11);
+            offset += kBC6HModeBits;
+            for (uint32_t c = 0; c < 3; ++c, offset += kBC6HEndpointBits) block.write(offset, kBC6HEndpointBits, best.q0[c]);
+            for (uint32_t c = 0; c < 3; ++c, offset += kBC6HEndpointBits) block.write(offset, kBC6HEndpointBits, best.q1[c]);
+            block.write(offset, 3, best.indices[0]);
+            offset += 3;
+            for (uint32_t i = 1; i < kTexelsPerBlock; ++i, offset += 4) block.write(offset, 4, best.indices[i]);
+            std::memcpy(pDst, block.bits, sizeof(block.bits));
+        }
+
+        /** BC4 block with 8 interpolated values, values are 0..255
+        */
+        void encodeBC4Block(const float values[kTexelsPerBlock], uint8_t* pDst)
+        {
+            float minValue = values[0];
+            float maxValue = values[0];
+            for (uint32_t i = 1; i < kTexelsPerBlock; ++i)
+            {
+                minValue = std::min(minValue, values[i]);
+                maxValue = std::max(maxValue, values[i]);
+            }
+
+            // red0 > red1 selects the 8 value palette: index 0 is red0, 1 is red1 and 2-7 step from red0 to red1
+            pDst[0] = uint8_t(maxValue);
+            pDst[1] = uint8_t(minValue);
+            uint64_t indexBits = 0;
+            if (maxValue > minValue)
+            {
+                static const uint8_t kStepToIndex[8] = { 1, 7, 6, 5, 4, 3, 2, 0 };
+                const __m128 minV = _mm_set1_ps(minValue);
+                const __m128 scale = _mm_set1_ps(7.0f / (maxValue - minValue));
+                for (uint32_t i = 0; i < kTexelsPerBlock; i += 4)
+                {
+                    __m128 steps = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&values[i]), minV), scale);
+                    alignas(16) int32_t step[4];
+                    _mm_store_si128((__m128i*)step, _mm_cvtps_epi32(steps));
+                    for (uint32_t j = 0; j < 4; ++j)
+                    {
+                        indexBits |= uint64_t(kStepToIndex[glm::clamp(step[j], 0, 7)]) << (3 * (i + j));
+                    }
+                }
+            }
+            for (uint32_t i = 0; i < 6; ++i)
+            {
+                pDst[2 + i] = uint8_t(indexBits >> (8 * i));
+            }
+        }
+
+        void decodeBC4Block(const uint8_t* pSrc, uint8_t values[kTexelsPerBlock])
+        {
+            const int32_t r0 = pSrc[0];
+            const int32_t r1 = pSrc[1];
+            int32_t palette[8] = { r0, r1 };
+            if (r0 > r1)
+            {
+                for (int32_t i = 2; i < 8; ++i) palette[i] = ((8 - i) * r0 + (i - 1) * r1) / 7;
+            }
+            else
+            {
+                for (int32_t i = 2; i < 6; ++i) palette[i] = ((6 - i) * r0 + (i - 1) * r1) / 5;
+                palette[6] = 0;
+                palette[7] = 255;
+            }
+
+            uint64_t indexBits = 0;
+            for (uint32_t i = 0; i < 6; ++i)
+            {
+                indexBits |= uint64_t(pSrc[2 + i]) << (8 * i);
+            }
+            for (uint32_t i = 0; i < kTexelsPerBlock; ++i)
+            {
+                values[i] = uint8_t(palette[(indexBits >> (3 * i)) & 0x7]);
+            }
+        }
+    }
+
+    namespace LightFieldProbeCompression
+    {
+        void encodeBC6H(const uint32_t* pSrc, uint32_t resolution, uint32_t sliceCount, uint8_t* pDst, uint32_t threadCount)
+        {
+            assert(resolution % kBlockDim == 0);
+            forEachBlock(resolution, sliceCount, threadCount, [&](uint32_t slice, uint32_t blockX, uint32_t blockY)
+            {
+                BC6HTexels texels;
+                for (uint32_t i = 0; i < kTexelsPerBlock; ++i)
+                {
+                    const float3 color = unpackR11G11B10(pSrc[getTexelIndex(resolution, slice, blockX, blockY, i)]);
+                    for (uint32_t c = 0; c < 3; ++c)
+                    {
+                        // Clamps away infinities and NaNs too, they are never written by the probe update
+                        const uint16_t h = std::min(glm::packHalf1x16(std::max(color[c], 0.0f)), kMaxHalf);
+                        texels.c[c][i] = halfToInterpolated(h);
+                    }
+                }
+                encodeBC6HBlock(texels, pDst + getBlockOffset(resolution, slice, blockX, blockY));
+            });
+        }
+
+        void encodeBC5(const uint32_t* pSrc, uint32_t resolution, uint32_t sliceCount, uint8_t* pDst, uint32_t threadCount)
+        {
+            assert(resolution % kBlockDim == 0);
+            forEachBlock(resolution, sliceCount, threadCount, [&](uint32_t slice, uint32_t blockX, uint32_t blockY)
+            {
+                float values[2][kTexelsPerBlock];
+                for (uint32_t i = 0; i < kTexelsPerBlock; ++i)
+                {
+                    const uint32_t texel = pSrc[getTexelIndex(resolution, slice, blockX, blockY, i)];
+                    values[0][i] = float(texel & 0xFF);
+                    values[1][i] = float((texel >> 8) & 0xFF);
+                }
+                uint8_t* pBlock = pDst + getBlockOffset(resolution, slice, blockX, blockY);
+                encodeBC4Block(values[0], pBlock);
+                encodeBC4Block(values[1], pBlock + 8);
+            });
+        }
+
+        void decodeBC6H(const uint8_t* pSrc, uint32_t resolution, uint32_t sliceCount, uint32_t* pDst, uint32_t threadCount)
+        {
+            assert(resolution % kBlockDim == 0);
+            forEachBlock(resolution, sliceCount, threadCount, [&](uint32_t slice, uint32_t blockX, uint32_t blockY)
+            {
+                Block128 block;
+                std::memcpy(block.bits, pSrc + getBlockOffset(resolution, slice, blockX, blockY), sizeof(block.bits));
+
+                int32_t a[3] = {};
+                int32_t b[3] = {};
+                const bool valid = block.read(0, kBC6HModeBits) == kBC6HMode11;
+                if (valid)
+                {
+                    for (uint32_t c = 0; c < 3; ++c)
+                    {
+                        a[c] = unquantizeBC6H(block.read(kBC6HModeBits + c * kBC6HEndpointBits, kBC6HEndpointBits));
+                        b[c] = unquantizeBC6H(block.read(kBC6HModeBits + (3 + c) * kBC6HEndpointBits, kBC6HEndpointBits));
+                    }
+                }
+
+                for (uint32_t i = 0; i < kTexelsPerBlock; ++i)
+                {
+                    const uint32_t index = (i == 0) ? block.read(kBC6HIndexOffset, 3) : block.read(kBC6HIndexOffset + 4 * i - 1, 4);
+                    float3 color(0.0f);
+                    for (uint32_t c = 0; valid && c < 3; ++c)
+                    {
+                        const uint16_t h = uint16_t((interpolateBC6H(a[c], b[c], index) * 31) >> 6);
+                        color[c] = glm::unpackHalf1x16(h);
+                    }
+                    pDst[getTexelIndex(resolution, slice, blockX, blockY, i)] = packR11G11B10(color);
+                }
+            });
+        }
+
+        void decodeBC5(const uint8_t* pSrc, uint32_t resolution, uint32_t sliceCount, uint32_t* pDst, uint32_t threadCount)
+        {
+            assert(resolution % kBlockDim == 0);
+            forEachBlock(resolution, sliceCount, threadCount, [&](uint32_t slice, uint32_t blockX, uint32_t blockY)
+            {
+                const uint8_t* pBlock = pSrc + getBlockOffset(resolution, slice, blockX, blockY);
+                uint8_t x[kTexelsPerBlock];
+                uint8_t y[kTexelsPerBlock];
+                decodeBC4Block(pBlock, x);
+                decodeBC4Block(pBlock + 8, y);
+                for (uint32_t i = 0; i < kTexelsPerBlock; ++i)
+                {
+                    pDst[getTexelIndex(resolution, slice, blockX, blockY, i)] = uint32_t(x[i]) | (uint32_t(y[i]) << 8) | 0xFF000000u;
+                }
+            });
+        }
+    }
+}
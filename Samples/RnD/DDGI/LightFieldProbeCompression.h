@@ -0,0 +1,69 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include "Falcor.h"
+#include "CpuParallelFor.h"
+
+namespace Falcor
+{
+    /** CPU block compression of the light field probe atlases.
+        Radiance (R11G11B10Float) is encoded to BC6H_UF16 and the octahedral normals (xy of RGBA8Unorm) to BC5Unorm.
+        Both formats use 16 bytes per 4x4 block, a quarter of the uncompressed atlases. Rows of blocks are distributed
+        over the worker threads and the index search of both encoders handles four texels at a time with SSE.
+    */
+    namespace LightFieldProbeCompression
+    {
+        const uint32_t kBlockDim = 4;
+        const uint32_t kBlockBytes = 16;
+
+        /** Size of one compressed atlas slice. The resolution must be a multiple of kBlockDim.
+        */
+        inline uint64_t getSliceSize(uint32_t resolution)
+        {
+            return uint64_t(resolution / kBlockDim) * (resolution / kBlockDim) * kBlockBytes;
+        }
+
+        /** Encode sliceCount slices of R11G11B10Float texels to BC6H_UF16.
+            All blocks use the single region mode with 10-bit endpoints (mode 11). The radiance of a probe is smooth
+            enough that partitioned modes rarely pay off, and a fixed mode keeps the encoder fast.
+        */
+        void encodeBC6H(const uint32_t* pSrc, uint32_t resolution, uint32_t sliceCount, uint8_t* pDst, uint32_t threadCount = getDefaultCpuThreadCount());
+
+        /** Encode the xy channels of RGBA8Unorm texels to BC5Unorm. The normal atlas stores octahedral vectors in xy, zw are dropped.
+        */
+        void encodeBC5(const uint32_t* pSrc, uint32_t resolution, uint32_t sliceCount, uint8_t* pDst, uint32_t threadCount = getDefaultCpuThreadCount());
+
+        /** Decode blocks written by encodeBC6H() to R11G11B10Float. Blocks using another mode decode to black.
+        */
+        void decodeBC6H(const uint8_t* pSrc, uint32_t resolution, uint32_t sliceCount, uint32_t* pDst, uint32_t threadCount = getDefaultCpuThreadCount());
+
+        /** Decode BC5Unorm blocks to RGBA8Unorm, z is 0 and w is 1
+        */
+        void decodeBC5(const uint8_t* pSrc, uint32_t resolution, uint32_t sliceCount, uint32_t* pDst, uint32_t threadCount = getDefaultCpuThreadCount());
+    }
+}
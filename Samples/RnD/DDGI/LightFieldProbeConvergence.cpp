@@ -0,0 +1,187 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "LightFieldProbeConvergence.h"
+
+namespace Falcor
+{
+    namespace
+    {
+        const char kShaderFilename[] = "LightFieldProbeConvergence.slang";
+        const float kMinLuminance = 1e-4f;      // Keeps the relative change of black probes finite
+    }
+
+    LightFieldProbeConvergence::SharedPtr LightFieldProbeConvergence::create(const Settings& settings)
+    {
+        return SharedPtr(new LightFieldProbeConvergence(settings));
+    }
+
+    LightFieldProbeConvergence::LightFieldProbeConvergence(const Settings& settings) : mSettings(settings)
+    {
+        mpProgram = ComputeProgram::createFromFile(kShaderFilename, "main");
+        mpVars = ComputeVars::create(mpProgram->getReflector());
+        mpState = ComputeState::create();
+        mpState->setProgram(mpProgram);
+
+        Sampler::Desc samplerDesc;
+        samplerDesc.setFilterMode(Sampler::Filter::Linear, Sampler::Filter::Linear, Sampler::Filter::Linear);
+        samplerDesc.setAddressingMode(Sampler::AddressMode::Clamp, Sampler::AddressMode::Clamp, Sampler::AddressMode::Clamp);
+        mpVars->setSampler("gLinearSampler", Sampler::create(samplerDesc));
+    }
+
+    void LightFieldProbeConvergence::reset(uint32_t probeCount, uint32_t sliceCount)
+    {
+        mProbes.assign(probeCount, ProbeState());
+        mFrameMeasurements.clear();
+        mStats = Stats();
+
+        mpLuminance = TypedBuffer<float>::create(std::max(sliceCount, 1u), Resource::BindFlags::ShaderResource | Resource::BindFlags::UnorderedAccess);
+        for (auto& r : mReadbacks)
+        {
+            r.pStaging = Buffer::create(mpLuminance->getSize(), Resource::BindFlags::None, Buffer::CpuAccess::Read, nullptr);
+            r.measurements.clear();
+        }
+        mReadbackIndex = 0;
+    }
+
+    void LightFieldProbeConvergence::measure(RenderContext* pContext, const Texture::SharedPtr& pRadianceTex, uint32_t probe, uint32_t sliceIdx, float hysteresis)
+    {
+        assert(probe < mProbes.size() && sliceIdx < mpLuminance->getElementCount());
+
+        mpVars->setTexture("gRadianceTex", pRadianceTex);
+        mpVars->setTypedBuffer("gLuminance", mpLuminance);
+        mpVars["PerPassCB"]["gArrayIndex"] = (int)sliceIdx;
+
+        pContext->pushComputeState(mpState);
+        pContext->pushComputeVars(mpVars);
+
+        // One group reduces the whole probe
+        pContext->dispatch(1, 1, 1);
+
+        pContext->popComputeVars();
+        pContext->popComputeState();
+
+        mFrameMeasurements.push_back({ probe, sliceIdx, hysteresis });
+    }
+
+    void LightFieldProbeConvergence::readMeasurements(RenderContext* pContext)
+    {
+        PendingReadback& r = mReadbacks[mReadbackIndex];
+        if (r.measurements.empty()) return;
+
+        const float* pLuminance = (const float*)r.pStaging->map(Buffer::MapType::Read);
+        float deltaSum = 0.0f;
+        for (const Measurement& m : r.measurements)
+        {
+            ProbeState& p = mProbes[m.probe];
+            const float measured = pLuminance[m.sliceIdx];
+
+            // Without hysteresis the filtered values were overwritten, there is nothing to compare with
+            if (!p.hasLuminance || m.hysteresis <= 0.0f)
+            {
+                p.luminance = measured;
+                p.delta = 1.0f;
+                p.stableUpdates = 0;
+                p.hasLuminance = true;
+                p.converged = false;
+            }
+            else
+            {
+                const float blended = glm::mix(measured, p.luminance, m.hysteresis);
+                p.delta = std::abs(blended - p.luminance) / std::max(std::max(blended, p.luminance), kMinLuminance);
+                p.luminance = blended;
+                p.stableUpdates = (p.delta < mSettings.threshold) ? p.stableUpdates + 1 : 0;
+                p.converged = p.stableUpdates >= mSettings.stableUpdateCount;
+            }
+            deltaSum += p.delta;
+        }
+        r.pStaging->unmap();
+
+        mStats.averageDelta = deltaSum / r.measurements.size();
+        mStats.convergedCount = (uint32_t)std::count_if(mProbes.cbegin(), mProbes.cend(), [](const ProbeState& p) { return p.converged; });
+        r.measurements.clear();
+    }
+
+    void LightFieldProbeConvergence::endFrame(RenderContext* pContext)
+    {
+        if (!mpLuminance) return;
+
+        // The oldest readback is reused, its copy has been done for a few frames
+        readMeasurements(pContext);
+
+        if (!mFrameMeasurements.empty())
+        {
+            PendingReadback& r = mReadbacks[mReadbackIndex];
+            pContext->copyBufferRegion(r.pStaging.get(), 0, mpLuminance.get(), 0, mpLuminance->getSize());
+            r.measurements.swap(mFrameMeasurements);
+            mFrameMeasurements.clear();
+        }
+        mReadbackIndex = (mReadbackIndex + 1) % ReadbackCount;
+    }
+
+    void LightFieldProbeConvergence::reactivate(uint32_t probe)
+    {
+        ProbeState& p = mProbes[probe];
+        if (p.converged)
+        {
+            mStats.reactivatedCount++;
+            mStats.convergedCount--;
+        }
+        p.converged = false;
+        p.stableUpdates = 0;
+    }
+
+    void LightFieldProbeConvergence::reactivateAll()
+    {
+        for (uint32_t i = 0; i < (uint32_t)mProbes.size(); ++i)
+        {
+            reactivate(i);
+        }
+    }
+
+    void LightFieldProbeConvergence::renderUI(Gui* pGui, const char* group)
+    {
+        if (pGui->beginGroup(group))
+        {
+            pGui->addFloatVar("Hysteresis", mSettings.hysteresis, 0.0f, 0.99f);
+            pGui->addFloatVar("Convergence Threshold", mSettings.threshold, 0.0f, 1.0f);
+            pGui->addIntVar("Stable Updates", (int&)mSettings.stableUpdateCount, 1, 1024);
+            if (pGui->addCheckBox("Retire Converged Probes", mSettings.retireConverged) && !mSettings.retireConverged)
+            {
+                reactivateAll();
+            }
+
+            std::string stats;
+            stats += "Converged: " + std::to_string(mStats.convergedCount) + " / " + std::to_string(mProbes.size()) + "\n";
+            stats += "Reactivated: " + std::to_string(mStats.reactivatedCount) + "\n";
+            stats += "Average change: " + std::to_string(mStats.averageDelta);
+            pGui->addText(stats.c_str());
+
+            pGui->endGroup();
+        }
+    }
+}
@@ -0,0 +1,133 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include "Falcor.h"
+
+namespace Falcor
+{
+    /** Tracks how much each light field probe still changes between updates.
+        After a probe is rendered its mean radiance luminance is measured on the GPU and read back a few frames later.
+        The filtered values are blended with exponential hysteresis, so the tracker blends the measured luminance the same
+        way and compares it with the previous estimate. A probe whose relative luminance change stays below the threshold
+        for enough consecutive updates is converged and can be retired from per-frame updates until it is reactivated.
+    */
+    class LightFieldProbeConvergence
+    {
+    public:
+        using SharedPtr = std::shared_ptr<LightFieldProbeConvergence>;
+
+        struct Settings
+        {
+            float hysteresis = 0.9f;            ///< Weight of the previous filtered values when a probe with valid data is updated again
+            float threshold = 0.01f;            ///< Relative luminance change below which an update counts as stable
+            uint32_t stableUpdateCount = 8;     ///< Consecutive stable updates before a probe is converged
+            bool retireConverged = true;        ///< Skip per-frame updates of converged probes
+        };
+
+        struct Stats
+        {
+            uint32_t convergedCount = 0;
+            uint32_t reactivatedCount = 0;      ///< Converged probes reactivated since the last reset
+            float averageDelta = 0.0f;          ///< Average relative luminance change of the measurements read back last
+        };
+
+        static SharedPtr create(const Settings& settings = Settings());
+
+        /** Forget all measurements and size the tracker for a new probe allocation.
+            \param[in] probeCount Probes are identified by their index in the volume, in [0, probeCount)
+            \param[in] sliceCount Layers in the probe texture arrays
+        */
+        void reset(uint32_t probeCount, uint32_t sliceCount);
+
+        /** Measure a probe that was just rendered.
+            \param[in] hysteresis Hysteresis the filtered values were blended with, 0 restarts the luminance estimate
+        */
+        void measure(RenderContext* pContext, const Texture::SharedPtr& pRadianceTex, uint32_t probe, uint32_t sliceIdx, float hysteresis);
+
+        /** Queue the readback of this frame's measurements and process the oldest ones. Call once per frame after the updates.
+        */
+        void endFrame(RenderContext* pContext);
+
+        /** True if the probe is converged and retiring is enabled
+        */
+        bool isRetired(uint32_t probe) const { return mSettings.retireConverged && mProbes[probe].converged; }
+        bool isConverged(uint32_t probe) const { return mProbes[probe].converged; }
+        float getDelta(uint32_t probe) const { return mProbes[probe].delta; }
+
+        /** Make converged probes update again, e.g. when the lighting around them changed
+        */
+        void reactivate(uint32_t probe);
+        void reactivateAll();
+
+        const Stats& getStats() const { return mStats; }
+        const Settings& getSettings() const { return mSettings; }
+        void setSettings(const Settings& settings) { mSettings = settings; }
+
+        void renderUI(Gui* pGui, const char* group = nullptr);
+
+    private:
+        LightFieldProbeConvergence(const Settings& settings);
+
+        void readMeasurements(RenderContext* pContext);
+
+        struct ProbeState
+        {
+            float luminance = 0.0f;             // Estimate of the filtered luminance
+            float delta = 1.0f;                 // Relative change at the last update
+            uint32_t stableUpdates = 0;
+            bool hasLuminance = false;
+            bool converged = false;
+        };
+
+        struct Measurement
+        {
+            uint32_t probe;
+            uint32_t sliceIdx;
+            float hysteresis;
+        };
+
+        Settings mSettings;
+        Stats mStats;
+        std::vector<ProbeState> mProbes;
+        std::vector<Measurement> mFrameMeasurements;
+
+        // Mean luminance per slice, copied to a staging buffer and read back a few frames later to avoid stalling
+        TypedBuffer<float>::SharedPtr mpLuminance;
+        enum { ReadbackCount = 4 };
+        struct PendingReadback
+        {
+            Buffer::SharedPtr pStaging;
+            std::vector<Measurement> measurements;
+        } mReadbacks[ReadbackCount];
+        uint32_t mReadbackIndex = 0;
+
+        ComputeState::SharedPtr mpState;
+        ComputeProgram::SharedPtr mpProgram;
+        ComputeVars::SharedPtr mpVars;
+    };
+}
@@ -76,8 +76,21 @@ void LightFieldProbeFiltering::execute(RenderContext* pContext,
                                        const Texture::SharedPtr& pRadianceTex,
                                        const Texture::SharedPtr pDistanceTex,
                                        int arrayIndex,
-                                       const Fbo::SharedPtr& pTargetFbo)
+                                       const Fbo::SharedPtr& pTargetFbo,
+                                       float hysteresis)
 {
+    // The previous values are blended in by the output merger, the target slice can't be read while it's bound
+    if (hysteresis > 0.0f && hysteresis != mBlendStateHysteresis)
+    {
+        BlendState::Desc blendDesc;
+        blendDesc.setBlendFactor(glm::vec4(hysteresis));
+        blendDesc.setRtBlend(0, true).setRtParams(0, BlendState::BlendOp::Add, BlendState::BlendOp::Add,
+            BlendState::BlendFunc::OneMinusBlendFactor, BlendState::BlendFunc::BlendFactor, BlendState::BlendFunc::OneMinusBlendFactor, BlendState::BlendFunc::BlendFactor);
+        mpHysteresisBlendState = BlendState::create(blendDesc);
+        mBlendStateHysteresis = hysteresis;
+    }
+    mpState->setBlendState((hysteresis > 0.0f) ? mpHysteresisBlendState : nullptr);
+
     mpVars->setTexture("gRadianceTex", pRadianceTex);
     mpVars->setTexture("gDistanceTex", pDistanceTex);
     mFrameCount++;
@@ -99,6 +112,18 @@ void LightFieldProbeFiltering::execute(RenderContext* pContext,
     mpState->popFbo();    
 }
 
+void LightFieldProbeFiltering::setDistanceOnly(bool distanceOnly)
+{
+    if (distanceOnly)
+    {
+        mpProgram->addDefine("_DISTANCE_ONLY");
+    }
+    else
+    {
+        mpProgram->removeDefine("_DISTANCE_ONLY");
+    }
+}
+
 RenderPassReflection LightFieldProbeFiltering::reflect() const
 {
     should_not_get_here();
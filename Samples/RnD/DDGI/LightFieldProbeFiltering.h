@@ -37,11 +37,20 @@ public:
 
     static SharedPtr create(const Dictionary& dict = {});
 
+    /** Filter one probe slice into the target.
+        \param[in] hysteresis Weight of the values already in the target, the result is lerp(filtered, previous, hysteresis).
+            0 overwrites the target, use it for probes without valid data.
+    */
     void execute(RenderContext* pContext,
                  const Texture::SharedPtr& pRadianceTex,
                  const Texture::SharedPtr pDistanceTex,
                  int arrayIndex,
-                 const Fbo::SharedPtr& pTargetFbo);
+                 const Fbo::SharedPtr& pTargetFbo,
+                 float hysteresis = 0.0f);
+
+    /** Only filter the distance moments, written to target 0. Used when the irradiance is stored as spherical harmonics.
+    */
+    void setDistanceOnly(bool distanceOnly);
 
     RenderPassReflection reflect() const override;
     void execute(RenderContext* pContext, const RenderData* pRenderData) override;
@@ -55,6 +64,10 @@ private:
     float mFrameCount = 1;
     float mDepthSharpness = 50;
 
+    // Blends with the constant blend factor, rebuilt when the hysteresis changes
+    BlendState::SharedPtr mpHysteresisBlendState;
+    float mBlendStateHysteresis = -1.0f;
+
     GraphicsState::SharedPtr mpState;
     GraphicsProgram::SharedPtr mpProgram;
     GraphicsVars::SharedPtr mpVars;
@@ -0,0 +1,120 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include "Falcor.h"
+#include "glm/gtc/packing.hpp"
+
+namespace Falcor
+{
+    /** CPU mirrors of the octahedral helpers in Helpers.slang and of the texel encodings used by the
+        light field probe atlases. Keep these in sync with the shader code, the CPU baker relies on them
+        to produce data that is interchangeable with the GPU path.
+    */
+    namespace LightFieldProbeMath
+    {
+        inline float signNotZero(float v)
+        {
+            return v >= 0.0f ? 1.0f : -1.0f;
+        }
+
+        inline float2 signNotZero(float2 v)
+        {
+            return float2(signNotZero(v.x), signNotZero(v.y));
+        }
+
+        inline float2 uvToOct(float2 uv)
+        {
+            return uv * 2.0f - 1.0f;
+        }
+
+        inline float2 octToUv(float2 o)
+        {
+            return o * 0.5f + 0.5f;
+        }
+
+        /** Assumes that v is a unit vector. The result is an octahedral vector on the [-1, +1] square.
+        */
+        inline float2 octEncode(float3 v)
+        {
+            float l1norm = std::abs(v.x) + std::abs(v.y) + std::abs(v.z);
+            float2 result = float2(v.x, v.y) * (1.0f / l1norm);
+            if (v.z < 0.0f)
+            {
+                result = (1.0f - glm::abs(float2(result.y, result.x))) * signNotZero(result);
+            }
+            return result;
+        }
+
+        /** Returns a unit vector. Argument o is an octahedral vector on the [-1, +1] square.
+        */
+        inline float3 octDecode(float2 o)
+        {
+            float3 v = float3(o.x, o.y, 1.0f - std::abs(o.x) - std::abs(o.y));
+            if (v.z < 0.0f)
+            {
+                float2 xy = (1.0f - glm::abs(float2(v.y, v.x))) * signNotZero(float2(v.x, v.y));
+                v.x = xy.x;
+                v.y = xy.y;
+            }
+            return glm::normalize(v);
+        }
+
+        /** Same as the shader version, the result is intentionally not normalized.
+        */
+        inline float3 getPerpendicularStark(float3 u)
+        {
+            float3 a = glm::abs(u);
+            uint32_t xm = ((a.x - a.y) < 0 && (a.x - a.z) < 0) ? 1 : 0;
+            uint32_t ym = (a.y - a.z) < 0 ? (1 ^ xm) : 0;
+            uint32_t zm = 1 ^ (xm | ym);
+            return glm::cross(u, float3(xm, ym, zm));
+        }
+
+        /** Direction stored at the center of texel (x, y) of a square octahedral map
+        */
+        inline float3 texelToDirection(uint32_t x, uint32_t y, uint32_t resolution)
+        {
+            float2 uv = (float2(x, y) + 0.5f) / float(resolution);
+            return octDecode(uvToOct(uv));
+        }
+
+        // Texel encodings matching the formats allocated by LightFieldProbeVolume::createFBOs()
+
+        inline uint32_t packR11G11B10(float3 v) { return glm::packF2x11_1x10(glm::max(v, float3(0.0f))); }
+        inline float3 unpackR11G11B10(uint32_t v) { return glm::unpackF2x11_1x10(v); }
+
+        inline uint32_t packRGBA8(float4 v) { return glm::packUnorm4x8(v); }
+        inline float4 unpackRGBA8(uint32_t v) { return glm::unpackUnorm4x8(v); }
+
+        inline uint16_t packR16F(float v) { return glm::packHalf1x16(v); }
+        inline float unpackR16F(uint16_t v) { return glm::unpackHalf1x16(v); }
+
+        inline uint32_t packRG16F(float2 v) { return glm::packHalf2x16(v); }
+        inline float2 unpackRG16F(uint32_t v) { return glm::unpackHalf2x16(v); }
+    }
+}
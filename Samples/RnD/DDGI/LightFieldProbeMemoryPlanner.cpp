@@ -0,0 +1,192 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "LightFieldProbeMemoryPlanner.h"
+
+namespace Falcor
+{
+    namespace
+    {
+        uint32_t clampPowerOf2(uint32_t value, uint32_t minValue, uint32_t maxValue)
+        {
+            return glm::clamp(getNextPowerOf2(std::max(value, 1u)), minValue, maxValue);
+        }
+    }
+
+    uint64_t LightFieldProbeMemoryPlanner::Footprint::getTotal() const
+    {
+        uint64_t total = 0;
+        for (uint64_t bytes : atlasBytes) total += bytes;
+        return total;
+    }
+
+    ResourceFormat LightFieldProbeMemoryPlanner::getAtlasFormat(Atlas atlas)
+    {
+        switch (atlas)
+        {
+        case Atlas::Radiance:           return ResourceFormat::R11G11B10Float;
+        case Atlas::Normal:             return ResourceFormat::RGBA8Unorm;
+        case Atlas::Distance:           return ResourceFormat::R16Float;
+        case Atlas::LowResDistance:     return ResourceFormat::R16Float;
+        case Atlas::Irradiance:         return ResourceFormat::R11G11B10Float;
+        case Atlas::DistanceMoments:    return ResourceFormat::RG16Float;
+        default:
+            should_not_get_here();
+            return ResourceFormat::Unknown;
+        }
+    }
+
+    ResourceFormat LightFieldProbeMemoryPlanner::getCompressedAtlasFormat(Atlas atlas)
+    {
+        switch (atlas)
+        {
+        case Atlas::Radiance:           return ResourceFormat::BC6HU16;
+        case Atlas::Normal:             return ResourceFormat::BC5Unorm;
+        default:                        return getAtlasFormat(atlas);
+        }
+    }
+
+    uint32_t LightFieldProbeMemoryPlanner::getAtlasResolution(const Resolutions& resolutions, Atlas atlas)
+    {
+        switch (atlas)
+        {
+        case Atlas::Radiance:
+        case Atlas::Normal:
+        case Atlas::Distance:
+            return resolutions.octahedral;
+        case Atlas::LowResDistance:
+            return resolutions.lowRes;
+        default:
+            return resolutions.filtered;
+        }
+    }
+
+    const char* LightFieldProbeMemoryPlanner::getAtlasName(Atlas atlas)
+    {
+        switch (atlas)
+        {
+        case Atlas::Radiance:           return "Radiance";
+        case Atlas::Normal:             return "Normal";
+        case Atlas::Distance:           return "Distance";
+        case Atlas::LowResDistance:     return "Low-Res Distance";
+        case Atlas::Irradiance:         return "Irradiance";
+        case Atlas::DistanceMoments:    return "Distance Moments";
+        default:
+            should_not_get_here();
+            return "";
+        }
+    }
+
+    LightFieldProbeMemoryPlanner::Footprint LightFieldProbeMemoryPlanner::computeFootprint(const Resolutions& resolutions, uint32_t probeCount, uint32_t shCoeffCount, bool compressed)
+    {
+        Footprint footprint;
+        for (uint32_t i = 0; i < (uint32_t)Atlas::Count; ++i)
+        {
+            uint64_t res = getAtlasResolution(resolutions, Atlas(i));
+            const ResourceFormat format = compressed ? getCompressedAtlasFormat(Atlas(i)) : getAtlasFormat(Atlas(i));
+            footprint.atlasBytes[i] = res * res * probeCount * getFormatBytesPerBlock(format) / getFormatPixelsPerBlock(format);
+        }
+        if (shCoeffCount > 0)
+        {
+            footprint.atlasBytes[(uint32_t)Atlas::Irradiance] = uint64_t(probeCount) * shCoeffCount * sizeof(float4);
+        }
+        return footprint;
+    }
+
+    uint64_t LightFieldProbeMemoryPlanner::getTextureBytes(const Texture* pTexture)
+    {
+        if (!pTexture) return 0;
+
+        uint64_t layers = pTexture->getArraySize();
+        if (pTexture->getType() == Texture::Type::TextureCube) layers *= 6;
+
+        const ResourceFormat format = pTexture->getFormat();
+        const uint64_t texels = uint64_t(pTexture->getWidth()) * pTexture->getHeight() * pTexture->getDepth();
+        return texels * layers * getFormatBytesPerBlock(format) / getFormatPixelsPerBlock(format);
+    }
+
+    LightFieldProbeMemoryPlanner::Resolutions LightFieldProbeMemoryPlanner::validate(const Resolutions& resolutions)
+    {
+        Resolutions r;
+        r.octahedral = clampPowerOf2(resolutions.octahedral, MinOctahedralResolution, MaxOctahedralResolution);
+        r.cubemap = clampPowerOf2(resolutions.cubemap, MinOctahedralResolution, MaxOctahedralResolution);
+        r.lowRes = clampPowerOf2(resolutions.lowRes, MinLowResResolution, r.octahedral);
+        r.filtered = clampPowerOf2(resolutions.filtered, MinFilteredResolution, MaxFilteredResolution);
+        return r;
+    }
+
+    LightFieldProbeMemoryPlanner::Resolutions LightFieldProbeMemoryPlanner::fitToBudget(uint64_t budgetBytes, uint32_t probeCount, uint32_t shCoeffCount, const Resolutions& maxResolutions, bool* pFits)
+    {
+        Resolutions r = validate(maxResolutions);
+        const uint32_t lowResFactor = r.octahedral / r.lowRes;
+
+        while (computeFootprint(r, probeCount, shCoeffCount).getTotal() > budgetBytes)
+        {
+            const Footprint footprint = computeFootprint(r, probeCount, shCoeffCount);
+            const uint64_t highResBytes = footprint.atlasBytes[(uint32_t)Atlas::Radiance] + footprint.atlasBytes[(uint32_t)Atlas::Normal] +
+                                          footprint.atlasBytes[(uint32_t)Atlas::Distance] + footprint.atlasBytes[(uint32_t)Atlas::LowResDistance];
+            const uint64_t filteredBytes = footprint.atlasBytes[(uint32_t)Atlas::Irradiance] + footprint.atlasBytes[(uint32_t)Atlas::DistanceMoments];
+
+            const bool canShrinkHighRes = r.octahedral > MinOctahedralResolution;
+            const bool canShrinkFiltered = r.filtered > MinFilteredResolution;
+            if (canShrinkHighRes && (highResBytes >= filteredBytes || !canShrinkFiltered))
+            {
+                r.octahedral /= 2;
+                r.cubemap = std::min(r.cubemap, r.octahedral);
+                r.lowRes = std::max<uint32_t>(MinLowResResolution, r.octahedral / lowResFactor);
+            }
+            else if (canShrinkFiltered)
+            {
+                r.filtered /= 2;
+            }
+            else
+            {
+                if (pFits) *pFits = false;
+                return r;
+            }
+        }
+
+        if (pFits) *pFits = true;
+        return r;
+    }
+
+    std::string LightFieldProbeMemoryPlanner::formatBytes(uint64_t bytes)
+    {
+        const char* units[] = { "B", "KB", "MB", "GB" };
+        double value = double(bytes);
+        uint32_t unit = 0;
+        while (value >= 1024.0 && unit < arraysize(units) - 1)
+        {
+            value /= 1024.0;
+            unit++;
+        }
+
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "%.2f %s", value, units[unit]);
+        return buffer;
+    }
+}
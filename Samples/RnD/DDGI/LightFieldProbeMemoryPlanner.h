@@ -0,0 +1,116 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include "Falcor.h"
+
+namespace Falcor
+{
+    /** Computes the GPU memory used by the light field probe atlases and picks atlas resolutions that fit a budget.
+        The atlases are texture arrays with one layer per probe, so their size scales with the probe count and the
+        square of the resolution. The scratch render targets used while rendering a probe don't depend on the probe
+        count and are not part of the budget.
+    */
+    class LightFieldProbeMemoryPlanner
+    {
+    public:
+        struct Resolutions
+        {
+            uint32_t cubemap = 1024;        ///< Size of the cubemap faces the probes are rendered to
+            uint32_t octahedral = 1024;     ///< Radiance, normal and distance atlases
+            uint32_t lowRes = 32;           ///< Low resolution distance atlas, must divide the octahedral resolution
+            uint32_t filtered = 128;        ///< Irradiance and distance moments atlases
+
+            bool operator==(const Resolutions& other) const
+            {
+                return cubemap == other.cubemap && octahedral == other.octahedral && lowRes == other.lowRes && filtered == other.filtered;
+            }
+            bool operator!=(const Resolutions& other) const { return !(*this == other); }
+        };
+
+        enum class Atlas : uint32_t
+        {
+            Radiance,
+            Normal,
+            Distance,
+            LowResDistance,
+            Irradiance,
+            DistanceMoments,
+            Count
+        };
+
+        struct Footprint
+        {
+            uint64_t atlasBytes[(uint32_t)Atlas::Count] = {};
+            uint64_t getTotal() const;
+        };
+
+        static ResourceFormat getAtlasFormat(Atlas atlas);
+
+        /** Format of an atlas once the probes are static and compressed. Only the radiance and normal atlases are compressed.
+        */
+        static ResourceFormat getCompressedAtlasFormat(Atlas atlas);
+        static uint32_t getAtlasResolution(const Resolutions& resolutions, Atlas atlas);
+        static const char* getAtlasName(Atlas atlas);
+
+        /** Exact size of each atlas for probeCount texture array layers
+            \param[in] shCoeffCount Spherical harmonics coefficients per probe. If non-zero the irradiance is a buffer of
+                        RGBA32Float coefficients instead of an octahedral atlas.
+            \param[in] compressed Use the compressed formats of the radiance and normal atlases
+        */
+        static Footprint computeFootprint(const Resolutions& resolutions, uint32_t probeCount, uint32_t shCoeffCount = 0, bool compressed = false);
+
+        /** Size of a texture's top mip level over all array layers and faces
+        */
+        static uint64_t getTextureBytes(const Texture* pTexture);
+
+        /** Clamp resolutions to powers of two within the supported range and make the low-res atlas divide the octahedral one
+        */
+        static Resolutions validate(const Resolutions& resolutions);
+
+        /** Pick the largest resolutions, no larger than maxResolutions, whose atlases fit into budgetBytes.
+            Resolutions are halved starting with the atlas that uses the most memory. The octahedral and cubemap
+            resolutions are kept equal and the octahedral to low-res ratio is kept fixed.
+            \param[in] shCoeffCount Same as for computeFootprint()
+            \param[out] pFits Set to false if the budget can't be met even at the minimum resolutions
+        */
+        static Resolutions fitToBudget(uint64_t budgetBytes, uint32_t probeCount, uint32_t shCoeffCount, const Resolutions& maxResolutions, bool* pFits = nullptr);
+
+        /** Format a byte count for the UI
+        */
+        static std::string formatBytes(uint64_t bytes);
+
+        enum
+        {
+            MinOctahedralResolution = 64,
+            MaxOctahedralResolution = 4096,
+            MinLowResResolution = 4,
+            MinFilteredResolution = 16,
+            MaxFilteredResolution = 1024,
+        };
+    };
+}
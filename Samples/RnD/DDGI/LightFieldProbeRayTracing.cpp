@@ -48,9 +48,15 @@ LightFieldProbeRayTracing::LightFieldProbeRayTracing(Type type) : RenderPass("Li
     mpState->setDepthStencilState(pDepthStencilState);
     mpState->setVao(pVao);
     mpState->setProgram(mpProgram);
+
+    // Cascades after the first one add their weighted contribution
+    BlendState::Desc blendDesc;
+    blendDesc.setRtBlend(0, true).setRtParams(0, BlendState::BlendOp::Add, BlendState::BlendOp::Add,
+        BlendState::BlendFunc::One, BlendState::BlendFunc::One, BlendState::BlendFunc::One, BlendState::BlendFunc::Zero);
+    mpAdditiveBlendState = BlendState::create(blendDesc);
 }
 
-void LightFieldProbeRayTracing::setVarsData(Camera::SharedPtr& pCamera, LightFieldProbeVolume::SharedPtr& pProbe, Fbo::SharedPtr& pSceneGBufferFbo)
+void LightFieldProbeRayTracing::setVarsData(Camera::SharedPtr& pCamera, const LightFieldProbeVolume::SharedPtr& pProbe, Fbo::SharedPtr& pSceneGBufferFbo)
 {
     mpVars->setTexture("gOctRadianceTex", pProbe->getRadianceTexture());
     mpVars->setTexture("gOctNormalTex", pProbe->getNormalTexture());
@@ -58,6 +64,9 @@ void LightFieldProbeRayTracing::setVarsData(Camera::SharedPtr& pCamera, LightFie
     mpVars->setTexture("gOctLowResDistanceTex", pProbe->getLowResDistanceTexture());
     mpVars->setTexture("gIrradianceTex", pProbe->getIrradianceTexture());
     mpVars->setTexture("gDistanceMomentsTex", pProbe->getDistanceMomentsTexture());
+    mpVars->setTypedBuffer("gProbeOffsets", pProbe->getProbeOffsetsBuffer());
+    mpVars->setTypedBuffer("gProbeBrickTable", pProbe->getBrickTableBuffer());
+    mpVars->setTypedBuffer("gIrradianceSH", pProbe->getIrradianceSHBuffer());
     mpVars->setTexture("gNormalTex", pSceneGBufferFbo->getColorTexture(GBufferRT::NORMAL_BITANGENT));
     mpVars->setTexture("gDiffuseOpacity", pSceneGBufferFbo->getColorTexture(GBufferRT::DIFFUSE_OPACITY));
     mpVars->setTexture("gSpecRoughTex", pSceneGBufferFbo->getColorTexture(GBufferRT::SPECULAR_ROUGHNESS));
@@ -74,20 +83,17 @@ void LightFieldProbeRayTracing::setVarsData(Camera::SharedPtr& pCamera, LightFie
     mConstantData.gProbeStartPosition = pProbe->getProbeStartPosition();
     mConstantData.gSizeHighRes = float2(pProbe->getDistanceTexture()->getWidth(), pProbe->getDistanceTexture()->getHeight());
     mConstantData.gSizeLowRes = float2(pProbe->getLowResDistanceTexture()->getWidth(), pProbe->getLowResDistanceTexture()->getHeight());
+    mConstantData.gIrradianceSHCoeffCount = (int)pProbe->getIrradianceSHCoeffCount();
+    mConstantData.gGridScrollOffset = pProbe->getGridScrollOffset();
     // Update to GPU
     ConstantBuffer* pCB = pDefaultBlock->getConstantBuffer("PerFrameCB").get();
     assert(sizeof(mConstantData) <= pCB->getSize());
     pCB->setBlob(&mConstantData, 0, sizeof(mConstantData));
 }
 
-void LightFieldProbeRayTracing::execute(RenderContext* pContext,
-    Camera::SharedPtr& pCamera,
-    LightFieldProbeVolume::SharedPtr& pProbe,
-    Fbo::SharedPtr& pSceneGBufferFbo,
-    Fbo::SharedPtr& pTargetFbo)
+void LightFieldProbeRayTracing::draw(RenderContext* pContext, const BlendState::SharedPtr& pBlendState, Fbo::SharedPtr& pTargetFbo)
 {
-    setVarsData(pCamera, pProbe, pSceneGBufferFbo);
-
+    mpState->setBlendState(pBlendState);
     mpState->pushFbo(pTargetFbo);
 
     pContext->pushGraphicsState(mpState);
@@ -101,6 +107,43 @@ void LightFieldProbeRayTracing::execute(RenderContext* pContext,
     mpState->popFbo();    
 }
 
+void LightFieldProbeRayTracing::execute(RenderContext* pContext,
+    Camera::SharedPtr& pCamera,
+    LightFieldProbeVolume::SharedPtr& pProbe,
+    Fbo::SharedPtr& pSceneGBufferFbo,
+    Fbo::SharedPtr& pTargetFbo)
+{
+    mConstantData.gCascadeIndex = 0;
+    mConstantData.gCascadeCount = 0;
+    setVarsData(pCamera, pProbe, pSceneGBufferFbo);
+    draw(pContext, nullptr, pTargetFbo);
+}
+
+void LightFieldProbeRayTracing::execute(RenderContext* pContext,
+    Camera::SharedPtr& pCamera,
+    const LightFieldProbeCascades::SharedPtr& pCascades,
+    Fbo::SharedPtr& pSceneGBufferFbo,
+    Fbo::SharedPtr& pTargetFbo)
+{
+    const uint32_t cascadeCount = pCascades->getCascadeCount();
+    assert(cascadeCount <= LightFieldProbeCascades::MaxCascadeCount);
+    mConstantData.gCascadeCount = (int)cascadeCount;
+    for (uint32_t i = 0; i < cascadeCount; ++i)
+    {
+        BoundingBox bounds = pCascades->getCascadeBounds(i);
+        mConstantData.gCascadeMin[i] = float4(bounds.getMinPos(), pCascades->getFadeWidth(i));
+        mConstantData.gCascadeMax[i] = float4(bounds.getMaxPos(), 0.0f);
+    }
+
+    // The first cascade overwrites the target, the others are accumulated on top of it
+    for (uint32_t i = 0; i < cascadeCount; ++i)
+    {
+        mConstantData.gCascadeIndex = (int)i;
+        setVarsData(pCamera, pCascades->getCascade(i), pSceneGBufferFbo);
+        draw(pContext, (i == 0) ? nullptr : mpAdditiveBlendState, pTargetFbo);
+    }
+}
+
 // TODO: implementation
 RenderPassReflection LightFieldProbeRayTracing::reflect() const
 {
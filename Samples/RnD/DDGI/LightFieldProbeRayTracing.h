@@ -1,6 +1,7 @@
 #pragma once
 #include <Falcor.h>
 #include "LightFieldProbeVolume.h"
+#include "LightFieldProbeCascades.h"
 
 namespace Falcor
 {
@@ -23,6 +24,14 @@ namespace Falcor
             Fbo::SharedPtr& pSceneGBufferFbo,
             Fbo::SharedPtr& pTargetFbo);
 
+        /** Trace every cascade and blend the results, each pixel is weighted towards the finest cascade that covers it
+        */
+        void execute(RenderContext* pContext,
+            Camera::SharedPtr& pCamera,
+            const LightFieldProbeCascades::SharedPtr& pCascades,
+            Fbo::SharedPtr& pSceneGBufferFbo,
+            Fbo::SharedPtr& pTargetFbo);
+
         virtual RenderPassReflection reflect() const override;
         virtual void execute(RenderContext* pContext, const RenderData* pRenderData) override;
         virtual std::string getDesc() override { return "Light Field Probe Ray Tracing"; }
@@ -30,9 +39,11 @@ namespace Falcor
     private:
         LightFieldProbeRayTracing(Type type);
 
-        void setVarsData(Camera::SharedPtr& pCamera, LightFieldProbeVolume::SharedPtr& pProbe, Fbo::SharedPtr& pSceneGBufferFbo);
+        void setVarsData(Camera::SharedPtr& pCamera, const LightFieldProbeVolume::SharedPtr& pProbe, Fbo::SharedPtr& pSceneGBufferFbo);
+        void draw(RenderContext* pContext, const BlendState::SharedPtr& pBlendState, Fbo::SharedPtr& pTargetFbo);
 
         GraphicsState::SharedPtr mpState;
+        BlendState::SharedPtr mpAdditiveBlendState;
         GraphicsProgram::SharedPtr mpProgram;
         GraphicsVars::SharedPtr mpVars;
 
@@ -50,6 +61,14 @@ namespace Falcor
             float gFrameCount = 1.0;;
             float2 gSizeHighRes;
             float2 gSizeLowRes;
+            int gIrradianceSHCoeffCount = 0;
+            int gCascadeIndex = 0;
+            int gCascadeCount = 0;
+            float gDummy2;
+            int3 gGridScrollOffset;
+            float gDummy3;
+            float4 gCascadeMin[LightFieldProbeCascades::MaxCascadeCount];
+            float4 gCascadeMax[LightFieldProbeCascades::MaxCascadeCount];
         } mConstantData;
     };
 }
@@ -0,0 +1,202 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "LightFieldProbeSH.h"
+#include "LightFieldProbeMath.h"
+#include <xmmintrin.h>
+
+namespace Falcor
+{
+    using namespace LightFieldProbeMath;
+
+    namespace
+    {
+        /** Solid angle of the spherical triangle abc (Van Oosterom and Strackee 1983)
+        */
+        double sphericalTriangleArea(const glm::dvec3& a, const glm::dvec3& b, const glm::dvec3& c)
+        {
+            double numer = std::abs(glm::dot(a, glm::cross(b, c)));
+            double denom = 1.0 + glm::dot(a, b) + glm::dot(b, c) + glm::dot(c, a);
+            return 2.0 * std::atan2(numer, denom);
+        }
+    }
+
+    uint32_t LightFieldProbeSH::getCoeffCount(IrradianceEncoding encoding)
+    {
+        switch (encoding)
+        {
+        case IrradianceEncoding::SHL1: return L1CoeffCount;
+        case IrradianceEncoding::SHL2: return L2CoeffCount;
+        default: return 0;
+        }
+    }
+
+    void LightFieldProbeSH::evalBasis(const float3& d, float basis[MaxCoeffCount])
+    {
+        basis[0] = 0.282095f;
+        basis[1] = 0.488603f * d.y;
+        basis[2] = 0.488603f * d.z;
+        basis[3] = 0.488603f * d.x;
+        basis[4] = 1.092548f * d.x * d.y;
+        basis[5] = 1.092548f * d.y * d.z;
+        basis[6] = 0.315392f * (3.0f * d.z * d.z - 1.0f);
+        basis[7] = 1.092548f * d.x * d.z;
+        basis[8] = 0.546274f * (d.x * d.x - d.y * d.y);
+    }
+
+    float LightFieldProbeSH::getCosineLobe(uint32_t coeff)
+    {
+        return (coeff == 0) ? float(M_PI) : ((coeff < 4) ? float(2.0 * M_PI / 3.0) : float(M_PI / 4.0));
+    }
+
+    float3 LightFieldProbeSH::evalIrradiance(const float4* pCoeffs, uint32_t coeffCount, const float3& n)
+    {
+        float basis[MaxCoeffCount];
+        evalBasis(n, basis);
+
+        float3 irradiance(0.0f);
+        for (uint32_t i = 0; i < coeffCount; ++i)
+        {
+            irradiance += float3(pCoeffs[i]) * basis[i];
+        }
+        return glm::max(irradiance, float3(0.0f));
+    }
+
+    std::vector<float> LightFieldProbeSH::computeTexelSolidAngles(uint32_t resolution)
+    {
+        auto cornerDir = [resolution](uint32_t x, uint32_t y)
+        {
+            return glm::dvec3(octDecode(uvToOct(float2(x, y) / float(resolution))));
+        };
+
+        std::vector<double> solidAngles(size_t(resolution) * resolution);
+        double sum = 0.0;
+        for (uint32_t y = 0; y < resolution; ++y)
+        {
+            for (uint32_t x = 0; x < resolution; ++x)
+            {
+                const glm::dvec3 a = cornerDir(x, y);
+                const glm::dvec3 b = cornerDir(x + 1, y);
+                const glm::dvec3 c = cornerDir(x + 1, y + 1);
+                const glm::dvec3 d = cornerDir(x, y + 1);
+
+                // The equator of the octahedral map runs along texel diagonals, split the texel along the same
+                // diagonal so neither triangle straddles the fold
+                const float2 center = uvToOct((float2(x, y) + 0.5f) / float(resolution));
+                double area;
+                if (center.x * center.y > 0.0f)
+                {
+                    area = sphericalTriangleArea(a, b, d) + sphericalTriangleArea(b, c, d);
+                }
+                else
+                {
+                    area = sphericalTriangleArea(a, b, c) + sphericalTriangleArea(a, c, d);
+                }
+                solidAngles[size_t(y) * resolution + x] = area;
+                sum += area;
+            }
+        }
+
+        // The triangles tile the sphere, renormalize anyway so a constant radiance projects exactly after rounding
+        const double scale = 4.0 * M_PI / sum;
+        std::vector<float> result(solidAngles.size());
+        for (size_t i = 0; i < solidAngles.size(); ++i)
+        {
+            result[i] = float(solidAngles[i] * scale);
+        }
+        return result;
+    }
+
+    LightFieldProbeSH::SharedPtr LightFieldProbeSH::create(uint32_t resolution, uint32_t coeffCount)
+    {
+        if (resolution == 0 || resolution % 4 != 0 || coeffCount == 0 || coeffCount > MaxCoeffCount)
+        {
+            logError("LightFieldProbeSH::create() - invalid resolution " + std::to_string(resolution) + " or coefficient count " + std::to_string(coeffCount));
+            return nullptr;
+        }
+        return SharedPtr(new LightFieldProbeSH(resolution, coeffCount));
+    }
+
+    LightFieldProbeSH::LightFieldProbeSH(uint32_t resolution, uint32_t coeffCount) : mResolution(resolution), mCoeffCount(coeffCount)
+    {
+        const std::vector<float> solidAngles = computeTexelSolidAngles(resolution);
+        const size_t texelCount = solidAngles.size();
+        mWeights.resize(texelCount * coeffCount);
+        for (uint32_t y = 0; y < resolution; ++y)
+        {
+            for (uint32_t x = 0; x < resolution; ++x)
+            {
+                const size_t texel = size_t(y) * resolution + x;
+                float basis[MaxCoeffCount];
+                evalBasis(texelToDirection(x, y, resolution), basis);
+                for (uint32_t k = 0; k < coeffCount; ++k)
+                {
+                    mWeights[k * texelCount + texel] = basis[k] * solidAngles[texel] * getCosineLobe(k);
+                }
+            }
+        }
+    }
+
+    void LightFieldProbeSH::project(const float3* pRadiance, float4* pCoeffs) const
+    {
+        const size_t texelCount = size_t(mResolution) * mResolution;
+
+        __m128 sum[MaxCoeffCount][3];
+        for (uint32_t k = 0; k < mCoeffCount; ++k)
+        {
+            sum[k][0] = sum[k][1] = sum[k][2] = _mm_setzero_ps();
+        }
+
+        // The resolution is a multiple of 4, so is the texel count
+        for (size_t i = 0; i < texelCount; i += 4)
+        {
+            const float3* p = pRadiance + i;
+            const __m128 r = _mm_setr_ps(p[0].r, p[1].r, p[2].r, p[3].r);
+            const __m128 g = _mm_setr_ps(p[0].g, p[1].g, p[2].g, p[3].g);
+            const __m128 b = _mm_setr_ps(p[0].b, p[1].b, p[2].b, p[3].b);
+            for (uint32_t k = 0; k < mCoeffCount; ++k)
+            {
+                const __m128 w = _mm_loadu_ps(mWeights.data() + k * texelCount + i);
+                sum[k][0] = _mm_add_ps(sum[k][0], _mm_mul_ps(w, r));
+                sum[k][1] = _mm_add_ps(sum[k][1], _mm_mul_ps(w, g));
+                sum[k][2] = _mm_add_ps(sum[k][2], _mm_mul_ps(w, b));
+            }
+        }
+
+        for (uint32_t k = 0; k < mCoeffCount; ++k)
+        {
+            float4 coeff(0.0f);
+            for (uint32_t c = 0; c < 3; ++c)
+            {
+                alignas(16) float lanes[4];
+                _mm_store_ps(lanes, sum[k][c]);
+                coeff[c] = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+            }
+            pCoeffs[k] = coeff;
+        }
+    }
+}
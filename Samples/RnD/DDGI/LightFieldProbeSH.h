@@ -0,0 +1,96 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include "Falcor.h"
+
+namespace Falcor
+{
+    /** How a probe volume stores the filtered irradiance
+    */
+    enum class IrradianceEncoding : uint32_t
+    {
+        Octahedral,     ///< Octahedral map at the filtered resolution, produced by LightFieldProbeFiltering
+        SHL1,           ///< 4 spherical harmonics coefficients per probe
+        SHL2,           ///< 9 spherical harmonics coefficients per probe
+    };
+
+    /** Spherical harmonics projection of the probe radiance, CPU mirror of LightFieldProbeSH.slang.
+        Coefficients are stored with the clamped cosine convolution applied, so evaluating them in direction n gives
+        the irradiance E(n) that the octahedral irradiance atlas would hold for n.
+        A projector precomputes basis * texel solid angle for every texel of an octahedral map, projecting a probe is
+        then a single pass over its radiance, four texels at a time.
+    */
+    class LightFieldProbeSH
+    {
+    public:
+        using SharedPtr = std::shared_ptr<LightFieldProbeSH>;
+        using SharedConstPtr = std::shared_ptr<const LightFieldProbeSH>;
+
+        enum
+        {
+            L1CoeffCount = 4,
+            L2CoeffCount = 9,
+            MaxCoeffCount = L2CoeffCount,   // Must match SH_MAX_COEFF_COUNT in LightFieldProbeSH.slang
+        };
+
+        /** Number of coefficients per probe, 0 for the octahedral encoding
+        */
+        static uint32_t getCoeffCount(IrradianceEncoding encoding);
+
+        static void evalBasis(const float3& d, float basis[MaxCoeffCount]);
+        static float getCosineLobe(uint32_t coeff);
+
+        /** Evaluate the irradiance of one probe in direction n
+        */
+        static float3 evalIrradiance(const float4* pCoeffs, uint32_t coeffCount, const float3& n);
+
+        /** Solid angle covered by each texel of a square octahedral map, row major. The sum is exactly 4 pi.
+        */
+        static std::vector<float> computeTexelSolidAngles(uint32_t resolution);
+
+        /** Create a projector for octahedral maps of the given resolution, which must be a multiple of 4
+        */
+        static SharedPtr create(uint32_t resolution, uint32_t coeffCount);
+
+        /** Project an octahedral radiance map.
+            \param[in] pRadiance resolution x resolution texels, row major
+            \param[out] pCoeffs coeffCount coefficients, rgb used and w set to 0
+        */
+        void project(const float3* pRadiance, float4* pCoeffs) const;
+
+        uint32_t getResolution() const { return mResolution; }
+        uint32_t getCoeffCount() const { return mCoeffCount; }
+
+    private:
+        LightFieldProbeSH(uint32_t resolution, uint32_t coeffCount);
+
+        uint32_t mResolution;
+        uint32_t mCoeffCount;
+        std::vector<float> mWeights;    // mCoeffCount rows of resolution^2 texels, basis * solid angle * cosine lobe
+    };
+}
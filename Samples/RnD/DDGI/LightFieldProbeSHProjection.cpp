@@ -0,0 +1,101 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "LightFieldProbeSHProjection.h"
+#include "LightFieldProbeSH.h"
+
+namespace
+{
+    const char kShaderFilename[] = "LightFieldProbeSHProjection.slang";
+}
+
+LightFieldProbeSHProjection::SharedPtr LightFieldProbeSHProjection::create(const Dictionary& dict)
+{
+    SharedPtr pPass = SharedPtr(new LightFieldProbeSHProjection);
+    return pPass;
+}
+
+LightFieldProbeSHProjection::LightFieldProbeSHProjection() : RenderPass("LightFieldProbeSHProjection")
+{
+    mpProgram = ComputeProgram::createFromFile(kShaderFilename, "main");
+    mpVars = ComputeVars::create(mpProgram->getReflector());
+    mpState = ComputeState::create();
+    mpState->setProgram(mpProgram);
+}
+
+void LightFieldProbeSHProjection::execute(RenderContext* pContext,
+                                          const Texture::SharedPtr& pRadianceTex,
+                                          int arrayIndex,
+                                          uint32_t coeffCount,
+                                          const TypedBuffer<float4>::SharedPtr& pCoeffBuffer,
+                                          float hysteresis)
+{
+    assert(pRadianceTex->getWidth() == pRadianceTex->getHeight());
+    assert(coeffCount > 0 && coeffCount <= LightFieldProbeSH::MaxCoeffCount);
+
+    // The solid angle table only depends on the resolution, build it on the CPU once
+    const uint32_t resolution = pRadianceTex->getWidth();
+    if (resolution != mSolidAngleResolution)
+    {
+        const std::vector<float> solidAngles = LightFieldProbeSH::computeTexelSolidAngles(resolution);
+        mpTexelSolidAngles = TypedBuffer<float>::create((uint32_t)solidAngles.size(), Resource::BindFlags::ShaderResource);
+        for (uint32_t i = 0; i < (uint32_t)solidAngles.size(); ++i)
+        {
+            mpTexelSolidAngles->setElement(i, solidAngles[i]);
+        }
+        mSolidAngleResolution = resolution;
+    }
+
+    mpVars->setTexture("gRadianceTex", pRadianceTex);
+    mpVars->setTypedBuffer("gTexelSolidAngles", mpTexelSolidAngles);
+    mpVars->setTypedBuffer("gCoeffs", pCoeffBuffer);
+    mpVars["PerPassCB"]["gArrayIndex"] = arrayIndex;
+    mpVars["PerPassCB"]["gCoeffCount"] = (int)coeffCount;
+    mpVars["PerPassCB"]["gResolution"] = (int)resolution;
+    mpVars["PerPassCB"]["gHysteresis"] = hysteresis;
+
+    pContext->pushComputeState(mpState);
+    pContext->pushComputeVars(mpVars);
+
+    // One group reduces the whole probe
+    pContext->dispatch(1, 1, 1);
+
+    pContext->popComputeVars();
+    pContext->popComputeState();
+}
+
+RenderPassReflection LightFieldProbeSHProjection::reflect() const
+{
+    should_not_get_here();
+    RenderPassReflection r;
+    return r;
+}
+
+void LightFieldProbeSHProjection::execute(RenderContext* pContext, const RenderData* pRenderData)
+{
+    should_not_get_here();
+}
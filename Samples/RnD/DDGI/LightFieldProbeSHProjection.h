@@ -0,0 +1,69 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include "Falcor.h"
+
+using namespace Falcor;
+
+/** Projects a probe's octahedral radiance map onto spherical harmonics with a single compute dispatch,
+    see LightFieldProbeSH for the coefficient layout.
+*/
+class LightFieldProbeSHProjection : public RenderPass, inherit_shared_from_this<RenderPass, LightFieldProbeSHProjection>
+{
+public:
+    using SharedPtr = std::shared_ptr<LightFieldProbeSHProjection>;
+
+    static SharedPtr create(const Dictionary& dict = {});
+
+    /** Project one slice of the radiance atlas.
+        \param[in] coeffCount Coefficients per probe, LightFieldProbeSH::L1CoeffCount or L2CoeffCount
+        \param[in] pCoeffBuffer Receives coeffCount coefficients at arrayIndex * coeffCount
+        \param[in] hysteresis Weight of the coefficients already in the buffer, 0 overwrites them
+    */
+    void execute(RenderContext* pContext,
+                 const Texture::SharedPtr& pRadianceTex,
+                 int arrayIndex,
+                 uint32_t coeffCount,
+                 const TypedBuffer<float4>::SharedPtr& pCoeffBuffer,
+                 float hysteresis = 0.0f);
+
+    RenderPassReflection reflect() const override;
+    void execute(RenderContext* pContext, const RenderData* pRenderData) override;
+
+    std::string getDesc(void) override { return "Light field probe SH projection"; }
+
+private:
+    LightFieldProbeSHProjection();
+
+    uint32_t mSolidAngleResolution = 0;
+    TypedBuffer<float>::SharedPtr mpTexelSolidAngles;
+
+    ComputeState::SharedPtr mpState;
+    ComputeProgram::SharedPtr mpProgram;
+    ComputeVars::SharedPtr mpVars;
+};
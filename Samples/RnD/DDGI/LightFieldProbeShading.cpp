@@ -59,21 +59,31 @@ bool LightFieldProbeShading::parseDictionary(const Dictionary& dict)
 
 LightFieldProbeShading::SharedPtr LightFieldProbeShading::create(const Dictionary& dict)
 {
-    SharedPtr pPass = SharedPtr(new LightFieldProbeShading);
+    SharedPtr pPass = SharedPtr(new LightFieldProbeShading(false));
     return pPass->parseDictionary(dict) ? pPass : nullptr;
 }
 
+LightFieldProbeShading::SharedPtr LightFieldProbeShading::create(bool layeredGBuffer)
+{
+    return SharedPtr(new LightFieldProbeShading(layeredGBuffer));
+}
+
 Dictionary LightFieldProbeShading::getScriptingDictionary() const
 {
     Dictionary dict;
     return dict;
 }
 
-LightFieldProbeShading::LightFieldProbeShading() : RenderPass("GBufferShading")
+LightFieldProbeShading::LightFieldProbeShading(bool layeredGBuffer) : RenderPass("GBufferShading"), mLayeredGBuffer(layeredGBuffer)
 {
     GraphicsProgram::Desc d;
     d.addShaderLibrary(kShaderFilename).vsEntry("VSMain").psEntry("PSMain");
-    mpProgram = GraphicsProgram::create(d);
+    Program::DefineList defines;
+    if (mLayeredGBuffer)
+    {
+        defines.add("_LAYERED_GBUFFER");
+    }
+    mpProgram = GraphicsProgram::create(d, defines);
 
     ProgramReflection::SharedConstPtr pReflector = mpProgram->getReflector();
     mpVars = GraphicsVars::create(pReflector);
@@ -126,9 +136,14 @@ void LightFieldProbeShading::renderUI(Gui* pGui, const char* uiGroup)
 {
 }
 
-void LightFieldProbeShading::execute(RenderContext* pContext, const Fbo::SharedPtr& pGBufferFbo, Texture::SharedPtr visibilityTexture, const Fbo::SharedPtr& pTargetFbo)
+void LightFieldProbeShading::execute(RenderContext* pContext, const Fbo::SharedPtr& pGBufferFbo, Texture::SharedPtr visibilityTexture, const Fbo::SharedPtr& pTargetFbo, uint32_t layer)
 {
     setVarsData(pGBufferFbo, visibilityTexture);
+    if (mLayeredGBuffer)
+    {
+        assert(layer < pGBufferFbo->getColorTexture(0)->getArraySize());
+        mpVars["PerPassCB"]["gLayerIndex"] = layer;
+    }
 
     mpState->pushFbo(pTargetFbo);
 
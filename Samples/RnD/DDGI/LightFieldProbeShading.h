@@ -37,9 +37,16 @@ public:
 
     static SharedPtr create(const Dictionary& dict = {});
 
+    /** Create a pass that shades one layer of a layered G-buffer, as written by GBufferRaster::executeCube()
+    */
+    static SharedPtr create(bool layeredGBuffer);
+
     void setCamera(Camera::SharedConstPtr pCamera) { mpCamera = pCamera; }
 
-    void execute(RenderContext* pContext, const Fbo::SharedPtr& pGBufferFbo, Texture::SharedPtr visibilityTexture, const Fbo::SharedPtr& pTargetFbo);
+    /** Shade the G-buffer.
+        \param[in] layer G-buffer layer to shade, only used by passes created for a layered G-buffer
+    */
+    void execute(RenderContext* pContext, const Fbo::SharedPtr& pGBufferFbo, Texture::SharedPtr visibilityTexture, const Fbo::SharedPtr& pTargetFbo, uint32_t layer = 0);
 
     RenderPassReflection reflect() const override;
     void execute(RenderContext* pContext, const RenderData* pRenderData) override;
@@ -49,11 +56,12 @@ public:
     void setScene(const Scene::SharedPtr& pScene) override;
     std::string getDesc(void) override { return "Light field probe shading"; }
 private:
-    LightFieldProbeShading();
+    LightFieldProbeShading(bool layeredGBuffer);
     bool parseDictionary(const Dictionary& dict);
 
     void setVarsData(const Fbo::SharedPtr& pGBufferFbo, Texture::SharedPtr visibilityTexture);
 
+    bool mLayeredGBuffer = false;
     Camera::SharedConstPtr mpCamera;
     Scene::SharedConstPtr mpScene;
     ConstantBuffer::SharedPtr mpInternalPerFrameCB;
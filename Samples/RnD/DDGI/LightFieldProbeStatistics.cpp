@@ -0,0 +1,345 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "LightFieldProbeStatistics.h"
+#include <fstream>
+#include <iomanip>
+
+namespace Falcor
+{
+    namespace
+    {
+        const char kShaderFilename[] = "LightFieldProbeStatistics.slang";
+        const float kMostlyMissFraction = 0.9f;      // Probes above this see almost no geometry
+        const float kMostlyBackfaceFraction = 0.25f; // Probes above this are most likely inside geometry
+    }
+
+    LightFieldProbeStatistics::SharedPtr LightFieldProbeStatistics::create()
+    {
+        return SharedPtr(new LightFieldProbeStatistics());
+    }
+
+    LightFieldProbeStatistics::LightFieldProbeStatistics()
+    {
+        mpProgram = ComputeProgram::createFromFile(kShaderFilename, "main");
+        mpVars = ComputeVars::create(mpProgram->getReflector());
+
+        Program::DefineList defines;
+        defines.add("_IRRADIANCE_SH");
+        mpSHProgram = ComputeProgram::createFromFile(kShaderFilename, "main", defines);
+        mpSHVars = ComputeVars::create(mpSHProgram->getReflector());
+
+        mpState = ComputeState::create();
+    }
+
+    void LightFieldProbeStatistics::reset(uint32_t probeCount, uint32_t sliceCount)
+    {
+        mRecords.assign(probeCount, ProbeRecord());
+        mFrameMeasurements.clear();
+        for (auto& t : mFrameTimers)
+        {
+            mFreeTimers.push_back(t.pTimer);
+        }
+        mFrameTimers.clear();
+
+        mpTexelStats = TypedBuffer<float4>::create(std::max(sliceCount, 1u), Resource::BindFlags::ShaderResource | Resource::BindFlags::UnorderedAccess);
+        for (auto& r : mReadbacks)
+        {
+            r.pStaging = Buffer::create(mpTexelStats->getSize(), Resource::BindFlags::None, Buffer::CpuAccess::Read, nullptr);
+            r.measurements.clear();
+            for (auto& t : r.timers)
+            {
+                mFreeTimers.push_back(t.pTimer);
+            }
+            r.timers.clear();
+        }
+        mReadbackIndex = 0;
+    }
+
+    void LightFieldProbeStatistics::beginProbe(uint32_t probe, uint64_t frameId)
+    {
+        if (!mEnabled) return;
+        assert(probe < mRecords.size());
+
+        ProbeRecord& r = mRecords[probe];
+        r.updateCount++;
+        r.lastUpdateFrame = frameId;
+
+        GpuTimer::SharedPtr pTimer;
+        if (mFreeTimers.empty())
+        {
+            pTimer = GpuTimer::create();
+        }
+        else
+        {
+            pTimer = mFreeTimers.back();
+            mFreeTimers.pop_back();
+        }
+        pTimer->begin();
+        mFrameTimers.push_back({ probe, pTimer });
+        mCpuStart = CpuTimer::getCurrentTimePoint();
+    }
+
+    void LightFieldProbeStatistics::endProbe(uint32_t probe)
+    {
+        if (!mEnabled) return;
+        assert(!mFrameTimers.empty() && mFrameTimers.back().probe == probe);
+
+        ProbeRecord& r = mRecords[probe];
+        r.lastCpuTime = (float)CpuTimer::calcDuration(mCpuStart, CpuTimer::getCurrentTimePoint());
+        r.totalCpuTime += r.lastCpuTime;
+        mFrameTimers.back().pTimer->end();
+    }
+
+    void LightFieldProbeStatistics::recordUpdate(uint32_t probe, uint64_t frameId, float cpuTime)
+    {
+        if (!mEnabled) return;
+        assert(probe < mRecords.size());
+
+        ProbeRecord& r = mRecords[probe];
+        r.updateCount++;
+        r.lastUpdateFrame = frameId;
+        r.lastCpuTime = cpuTime;
+        r.totalCpuTime += cpuTime;
+    }
+
+    void LightFieldProbeStatistics::measure(RenderContext* pContext, uint32_t probe, uint32_t sliceIdx, const Texture::SharedPtr& pDistanceTex, const Texture::SharedPtr& pNormalTex,
+                                            const Texture::SharedPtr& pIrradianceTex, const TypedBuffer<float4>::SharedPtr& pIrradianceSH, uint32_t shCoeffCount)
+    {
+        if (!mEnabled || !mpTexelStats) return;
+        assert(probe < mRecords.size() && sliceIdx < mpTexelStats->getElementCount());
+
+        const bool useSH = (pIrradianceTex == nullptr);
+        if (useSH && (!pIrradianceSH || shCoeffCount == 0)) return;
+
+        ComputeVars::SharedPtr pVars = useSH ? mpSHVars : mpVars;
+        mpState->setProgram(useSH ? mpSHProgram : mpProgram);
+        pVars->setTexture("gDistanceTex", pDistanceTex);
+        pVars->setTexture("gNormalTex", pNormalTex);
+        if (useSH)
+        {
+            pVars->setTypedBuffer("gIrradianceSH", pIrradianceSH);
+        }
+        else
+        {
+            pVars->setTexture("gIrradianceTex", pIrradianceTex);
+        }
+        pVars->setTypedBuffer("gStats", mpTexelStats);
+        pVars["PerPassCB"]["gArrayIndex"] = (int)sliceIdx;
+        pVars["PerPassCB"]["gIrradianceSHCoeffCount"] = (int)shCoeffCount;
+
+        pContext->pushComputeState(mpState);
+        pContext->pushComputeVars(pVars);
+
+        // One group reduces the whole probe
+        pContext->dispatch(1, 1, 1);
+
+        pContext->popComputeVars();
+        pContext->popComputeState();
+
+        mFrameMeasurements.push_back({ probe, sliceIdx });
+    }
+
+    void LightFieldProbeStatistics::readBack()
+    {
+        PendingReadback& r = mReadbacks[mReadbackIndex];
+
+        for (auto& t : r.timers)
+        {
+            ProbeRecord& record = mRecords[t.probe];
+            record.lastGpuTime = (float)t.pTimer->getElapsedTime();
+            record.totalGpuTime += record.lastGpuTime;
+            record.gpuTimedUpdates++;
+            mFreeTimers.push_back(t.pTimer);
+        }
+        r.timers.clear();
+
+        if (r.measurements.empty()) return;
+
+        const float4* pStats = (const float4*)r.pStaging->map(Buffer::MapType::Read);
+        for (const Measurement& m : r.measurements)
+        {
+            const float4& s = pStats[m.sliceIdx];
+            ProbeRecord& record = mRecords[m.probe];
+            record.missFraction = s.x;
+            record.backfaceFraction = s.y;
+            record.irradianceMean = s.z;
+            record.irradianceVariance = s.w;
+            record.hasTexelStats = true;
+        }
+        r.pStaging->unmap();
+        r.measurements.clear();
+    }
+
+    void LightFieldProbeStatistics::endFrame(RenderContext* pContext)
+    {
+        if (!mpTexelStats) return;
+
+        // The oldest readback is reused, its copy and timestamps have been submitted a few frames ago
+        readBack();
+
+        PendingReadback& r = mReadbacks[mReadbackIndex];
+        if (!mFrameMeasurements.empty())
+        {
+            pContext->copyBufferRegion(r.pStaging.get(), 0, mpTexelStats.get(), 0, mpTexelStats->getSize());
+            r.measurements.swap(mFrameMeasurements);
+            mFrameMeasurements.clear();
+        }
+        r.timers.swap(mFrameTimers);
+        mFrameTimers.clear();
+        mReadbackIndex = (mReadbackIndex + 1) % ReadbackCount;
+    }
+
+    LightFieldProbeStatistics::Summary LightFieldProbeStatistics::computeSummary() const
+    {
+        Summary summary;
+        float gpuTimeSum = 0.0f;
+        uint32_t gpuTimedCount = 0;
+        float mostExpensive = -1.0f;
+        for (uint32_t i = 0; i < (uint32_t)mRecords.size(); ++i)
+        {
+            const ProbeRecord& r = mRecords[i];
+            if (r.hasTexelStats)
+            {
+                summary.measuredCount++;
+                summary.averageMissFraction += r.missFraction;
+                summary.averageBackfaceFraction += r.backfaceFraction;
+            }
+            if (r.gpuTimedUpdates > 0)
+            {
+                gpuTimeSum += r.totalGpuTime;
+                gpuTimedCount += r.gpuTimedUpdates;
+                if (r.getAverageGpuTime() > mostExpensive)
+                {
+                    mostExpensive = r.getAverageGpuTime();
+                    summary.mostExpensiveProbe = i;
+                }
+            }
+        }
+        if (summary.measuredCount > 0)
+        {
+            summary.averageMissFraction /= summary.measuredCount;
+            summary.averageBackfaceFraction /= summary.measuredCount;
+        }
+        summary.averageGpuTime = gpuTimedCount ? gpuTimeSum / gpuTimedCount : 0.0f;
+        return summary;
+    }
+
+    bool LightFieldProbeStatistics::exportCsv(const std::string& filename, const std::vector<ProbeDesc>& probes) const
+    {
+        assert(probes.size() == mRecords.size());
+        std::ofstream file(filename, std::ios::trunc);
+        if (!file)
+        {
+            logError("LightFieldProbeStatistics: can't open '" + filename + "' for writing");
+            return false;
+        }
+
+        file << "probe,x,y,z,slice,active,updates,last_update_frame,last_cpu_ms,avg_cpu_ms,last_gpu_ms,avg_gpu_ms,measured,miss_fraction,backface_fraction,irradiance_mean,irradiance_variance\n";
+        file << std::setprecision(6);
+        for (uint32_t i = 0; i < (uint32_t)mRecords.size(); ++i)
+        {
+            const ProbeRecord& r = mRecords[i];
+            const ProbeDesc& p = probes[i];
+            file << i << ',' << p.position.x << ',' << p.position.y << ',' << p.position.z << ',' << p.sliceIdx << ',' << (p.active ? 1 : 0) << ','
+                 << r.updateCount << ',' << r.lastUpdateFrame << ',' << r.lastCpuTime << ',' << r.getAverageCpuTime() << ','
+                 << r.lastGpuTime << ',' << r.getAverageGpuTime() << ',' << (r.hasTexelStats ? 1 : 0) << ','
+                 << r.missFraction << ',' << r.backfaceFraction << ',' << r.irradianceMean << ',' << r.irradianceVariance << '\n';
+        }
+        return file.good();
+    }
+
+    bool LightFieldProbeStatistics::exportJson(const std::string& filename, const std::vector<ProbeDesc>& probes) const
+    {
+        assert(probes.size() == mRecords.size());
+        std::ofstream file(filename, std::ios::trunc);
+        if (!file)
+        {
+            logError("LightFieldProbeStatistics: can't open '" + filename + "' for writing");
+            return false;
+        }
+
+        const Summary summary = computeSummary();
+        file << std::setprecision(6);
+        file << "{\n";
+        file << "    \"probe_count\": " << mRecords.size() << ",\n";
+        file << "    \"measured_count\": " << summary.measuredCount << ",\n";
+        file << "    \"average_miss_fraction\": " << summary.averageMissFraction << ",\n";
+        file << "    \"average_backface_fraction\": " << summary.averageBackfaceFraction << ",\n";
+        file << "    \"average_gpu_ms\": " << summary.averageGpuTime << ",\n";
+        file << "    \"probes\": [";
+        for (uint32_t i = 0; i < (uint32_t)mRecords.size(); ++i)
+        {
+            const ProbeRecord& r = mRecords[i];
+            const ProbeDesc& p = probes[i];
+            file << (i ? ",\n" : "\n");
+            file << "        { \"probe\": " << i
+                 << ", \"position\": [" << p.position.x << ", " << p.position.y << ", " << p.position.z << "]"
+                 << ", \"slice\": " << p.sliceIdx
+                 << ", \"active\": " << (p.active ? "true" : "false")
+                 << ", \"updates\": " << r.updateCount
+                 << ", \"last_update_frame\": " << r.lastUpdateFrame
+                 << ", \"last_cpu_ms\": " << r.lastCpuTime
+                 << ", \"avg_cpu_ms\": " << r.getAverageCpuTime()
+                 << ", \"last_gpu_ms\": " << r.lastGpuTime
+                 << ", \"avg_gpu_ms\": " << r.getAverageGpuTime()
+                 << ", \"measured\": " << (r.hasTexelStats ? "true" : "false")
+                 << ", \"miss_fraction\": " << r.missFraction
+                 << ", \"backface_fraction\": " << r.backfaceFraction
+                 << ", \"irradiance_mean\": " << r.irradianceMean
+                 << ", \"irradiance_variance\": " << r.irradianceVariance << " }";
+        }
+        file << "\n    ]\n}\n";
+        return file.good();
+    }
+
+    void LightFieldProbeStatistics::renderUI(Gui* pGui, const char* group)
+    {
+        if (pGui->beginGroup(group))
+        {
+            pGui->addCheckBox("Record Statistics", mEnabled);
+
+            const Summary summary = computeSummary();
+            const uint32_t missCount = (uint32_t)std::count_if(mRecords.cbegin(), mRecords.cend(), [](const ProbeRecord& r) { return r.hasTexelStats && r.missFraction > kMostlyMissFraction; });
+            const uint32_t backfaceCount = (uint32_t)std::count_if(mRecords.cbegin(), mRecords.cend(), [](const ProbeRecord& r) { return r.hasTexelStats && r.backfaceFraction > kMostlyBackfaceFraction; });
+
+            std::string stats;
+            stats += "Measured: " + std::to_string(summary.measuredCount) + " / " + std::to_string(mRecords.size()) + "\n";
+            stats += "Average miss fraction: " + std::to_string(summary.averageMissFraction) + "\n";
+            stats += "Average backface fraction: " + std::to_string(summary.averageBackfaceFraction) + "\n";
+            stats += "Mostly missing: " + std::to_string(missCount) + ", inside geometry: " + std::to_string(backfaceCount) + "\n";
+            stats += "GPU time per update: " + std::to_string(summary.averageGpuTime) + " ms";
+            if (summary.mostExpensiveProbe != uint32_t(-1))
+            {
+                stats += "\nMost expensive: probe " + std::to_string(summary.mostExpensiveProbe) + ", " + std::to_string(mRecords[summary.mostExpensiveProbe].getAverageGpuTime()) + " ms";
+            }
+            pGui->addText(stats.c_str());
+
+            pGui->endGroup();
+        }
+    }
+}
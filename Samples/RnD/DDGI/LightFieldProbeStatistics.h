@@ -0,0 +1,165 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include "Falcor.h"
+
+namespace Falcor
+{
+    /** Per-probe instrumentation of a light field probe volume.
+        Records how often and when each probe was updated and what the update cost on the CPU and GPU. After a probe is
+        rendered its atlases are analyzed on the GPU: the fraction of distance texels that miss all geometry or hit back
+        faces, and the mean and variance of the irradiance luminance. Timestamps and measurements are read back a few
+        frames later so the instrumentation never stalls. A probe that mostly sees back faces is inside geometry, one that
+        mostly misses or has a nearly constant irradiance adds little and is a candidate for relocation or removal.
+    */
+    class LightFieldProbeStatistics
+    {
+    public:
+        using SharedPtr = std::shared_ptr<LightFieldProbeStatistics>;
+
+        struct ProbeRecord
+        {
+            uint32_t updateCount = 0;
+            uint64_t lastUpdateFrame = 0;
+            float lastCpuTime = 0.0f;           ///< In ms, time spent recording the last update
+            float totalCpuTime = 0.0f;          ///< In ms, over all updates
+            float lastGpuTime = 0.0f;           ///< In ms
+            float totalGpuTime = 0.0f;          ///< In ms, over the updates whose timestamps have been read back
+            uint32_t gpuTimedUpdates = 0;
+            bool hasTexelStats = false;         ///< The following values have been measured at least once
+            float missFraction = 0.0f;          ///< Distance texels that don't see any geometry
+            float backfaceFraction = 0.0f;      ///< Distance texels that see the back face of a surface
+            float irradianceMean = 0.0f;        ///< Mean luminance of the irradiance over the sphere
+            float irradianceVariance = 0.0f;    ///< Variance of the irradiance luminance over the sphere
+
+            float getAverageCpuTime() const { return updateCount ? totalCpuTime / updateCount : 0.0f; }
+            float getAverageGpuTime() const { return gpuTimedUpdates ? totalGpuTime / gpuTimedUpdates : 0.0f; }
+        };
+
+        /** Probe description written next to the records when exporting
+        */
+        struct ProbeDesc
+        {
+            float3 position;
+            uint32_t sliceIdx = 0;
+            bool active = true;
+        };
+
+        struct Summary
+        {
+            uint32_t measuredCount = 0;         ///< Probes with texel statistics
+            float averageMissFraction = 0.0f;
+            float averageBackfaceFraction = 0.0f;
+            float averageGpuTime = 0.0f;        ///< In ms, per update
+            uint32_t mostExpensiveProbe = uint32_t(-1);
+        };
+
+        static SharedPtr create();
+
+        /** Forget all records and size the statistics for a new probe allocation.
+            \param[in] probeCount Probes are identified by their index in the volume, in [0, probeCount)
+            \param[in] sliceCount Layers in the probe texture arrays
+        */
+        void reset(uint32_t probeCount, uint32_t sliceCount);
+
+        void setEnabled(bool enabled) { mEnabled = enabled; }
+        bool isEnabled() const { return mEnabled; }
+
+        /** Bracket the update of a single probe
+        */
+        void beginProbe(uint32_t probe, uint64_t frameId);
+        void endProbe(uint32_t probe);
+
+        /** Record an update that was not rendered on the GPU, e.g. a CPU bake
+        */
+        void recordUpdate(uint32_t probe, uint64_t frameId, float cpuTime);
+
+        /** Analyze the atlases of a probe that was just rendered.
+            \param[in] pIrradianceTex Octahedral irradiance, or nullptr if the irradiance is stored as spherical harmonics in pIrradianceSH
+        */
+        void measure(RenderContext* pContext, uint32_t probe, uint32_t sliceIdx, const Texture::SharedPtr& pDistanceTex, const Texture::SharedPtr& pNormalTex,
+                     const Texture::SharedPtr& pIrradianceTex, const TypedBuffer<float4>::SharedPtr& pIrradianceSH, uint32_t shCoeffCount);
+
+        /** Queue the readback of this frame's timestamps and measurements and process the oldest ones. Call once per frame after the updates.
+        */
+        void endFrame(RenderContext* pContext);
+
+        uint32_t getProbeCount() const { return (uint32_t)mRecords.size(); }
+        const ProbeRecord& getRecord(uint32_t probe) const { return mRecords[probe]; }
+        const std::vector<ProbeRecord>& getRecords() const { return mRecords; }
+        Summary computeSummary() const;
+
+        /** Write one row per probe. probes must have getProbeCount() entries.
+        */
+        bool exportCsv(const std::string& filename, const std::vector<ProbeDesc>& probes) const;
+        bool exportJson(const std::string& filename, const std::vector<ProbeDesc>& probes) const;
+
+        void renderUI(Gui* pGui, const char* group = nullptr);
+
+    private:
+        LightFieldProbeStatistics();
+
+        void readBack();
+
+        bool mEnabled = true;
+        std::vector<ProbeRecord> mRecords;
+
+        struct Measurement
+        {
+            uint32_t probe;
+            uint32_t sliceIdx;
+        };
+        std::vector<Measurement> mFrameMeasurements;
+
+        struct TimedUpdate
+        {
+            uint32_t probe;
+            GpuTimer::SharedPtr pTimer;
+        };
+        std::vector<TimedUpdate> mFrameTimers;
+        std::vector<GpuTimer::SharedPtr> mFreeTimers;
+        CpuTimer::TimePoint mCpuStart;
+
+        // Miss fraction, back face fraction, irradiance mean and variance per slice
+        TypedBuffer<float4>::SharedPtr mpTexelStats;
+        enum { ReadbackCount = 4 };
+        struct PendingReadback
+        {
+            Buffer::SharedPtr pStaging;
+            std::vector<Measurement> measurements;
+            std::vector<TimedUpdate> timers;
+        } mReadbacks[ReadbackCount];
+        uint32_t mReadbackIndex = 0;
+
+        ComputeState::SharedPtr mpState;
+        ComputeProgram::SharedPtr mpProgram;
+        ComputeProgram::SharedPtr mpSHProgram;
+        ComputeVars::SharedPtr mpVars;
+        ComputeVars::SharedPtr mpSHVars;
+    };
+}
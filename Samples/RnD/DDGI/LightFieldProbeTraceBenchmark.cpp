@@ -0,0 +1,257 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "LightFieldProbeTraceBenchmark.h"
+#include "LightFieldProbeMath.h"
+#include "CpuParallelFor.h"
+
+namespace Falcor
+{
+    namespace
+    {
+        const float kMaxDistance = 10000.0f;        // Same as LightFieldProbeRayTracing.slang
+        const float kRayBias = 0.02f;
+        const uint32_t kRaysPerTask = 256;
+        const uint32_t kMaxOriginAttempts = 16;
+
+        uint32_t pcgHash(uint32_t v)
+        {
+            uint32_t state = v * 747796405u + 2891336453u;
+            uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+            return (word >> 22u) ^ word;
+        }
+
+        float nextRandom(uint32_t& state)
+        {
+            state = pcgHash(state);
+            return float(state >> 8) * (1.0f / 16777216.0f);
+        }
+
+        float3 uniformSphereSample(uint32_t& state)
+        {
+            float z = 1.0f - 2.0f * nextRandom(state);
+            float r = std::sqrt(std::max(0.0f, 1.0f - z * z));
+            float phi = float(2.0 * M_PI) * nextRandom(state);
+            return float3(r * std::cos(phi), r * std::sin(phi), z);
+        }
+
+        /** Same as getCosHemisphereSample() in Helpers.slang
+        */
+        float3 cosHemisphereSample(uint32_t& state, const float3& N)
+        {
+            float3 T = LightFieldProbeMath::getPerpendicularStark(N);
+            float3 B = glm::normalize(glm::cross(N, T));
+
+            float u = nextRandom(state);
+            float r = std::sqrt(u);
+            float phi = float(2.0 * M_PI) * nextRandom(state);
+            float3 L = float3(r * std::cos(phi), r * std::sin(phi), std::sqrt(std::max(0.0f, 1.0f - u)));
+            return glm::normalize(T * L.x + B * L.y + N * L.z);
+        }
+
+        /** Pick a visible surface point inside the region by casting a random ray from a random point, then leave it in
+            a cosine-distributed direction. Falls back to the random ray itself when nothing is found.
+        */
+        void generateRay(const CpuSceneBvh& bvh, const BoundingBox& region, uint32_t seed, uint32_t rayIndex, float3& origin, float3& direction)
+        {
+            uint32_t state = pcgHash(seed ^ pcgHash(rayIndex));
+            const float3 minPos = region.getMinPos();
+            const float3 maxPos = region.getMaxPos();
+
+            for (uint32_t attempt = 0; attempt < kMaxOriginAttempts; ++attempt)
+            {
+                origin = minPos + (maxPos - minPos) * float3(nextRandom(state), nextRandom(state), nextRandom(state));
+                direction = uniformSphereSample(state);
+
+                CpuSceneBvh::Hit hit;
+                if (!bvh.intersect(origin, direction, 0.0f, kMaxDistance, hit)) continue;
+
+                const float3 surface = origin + direction * hit.t;
+                if (glm::any(glm::lessThan(surface, minPos)) || glm::any(glm::greaterThan(surface, maxPos))) continue;
+
+                float3 n = bvh.getGeometricNormal(hit);
+                if (glm::dot(n, direction) > 0.0f) n = -n;
+
+                direction = cosHemisphereSample(state, n);
+                origin = surface + direction * kRayBias;
+                return;
+            }
+        }
+    }
+
+    void LightFieldProbeTraceBenchmark::Histogram::add(uint32_t value)
+    {
+        uint32_t bucket = 0;
+        while (value > 0)
+        {
+            value >>= 1;
+            ++bucket;
+        }
+        if (bucket >= buckets.size())
+        {
+            buckets.resize(bucket + 1, 0);
+        }
+        buckets[bucket]++;
+    }
+
+    std::string LightFieldProbeTraceBenchmark::Histogram::toString(const std::string& label) const
+    {
+        uint64_t total = 0;
+        for (uint64_t count : buckets) total += count;
+
+        std::string s = label + ":\n";
+        for (size_t i = 0; i < buckets.size(); ++i)
+        {
+            if (buckets[i] == 0) continue;
+            const std::string range = (i <= 1) ? std::to_string(i) : (std::to_string(1u << (i - 1)) + "-" + std::to_string((1u << i) - 1));
+            s += "    " + range + ": " + std::to_string(buckets[i]) + " (" + std::to_string(100.0 * double(buckets[i]) / double(std::max<uint64_t>(total, 1))) + "%)\n";
+        }
+        return s;
+    }
+
+    std::string LightFieldProbeTraceBenchmark::Report::toString() const
+    {
+        std::string s = "Light field probe CPU trace, " + std::to_string(rayCount) + " rays" + (simd ? " (SSE)" : " (scalar)") + "\n";
+        s += "  " + std::to_string(traceTimeMs) + " ms, " + std::to_string(raysPerSecond / 1e6) + " Mrays/s, " + std::to_string(probeHits) + " hits";
+        if (abortedRays > 0)
+        {
+            s += ", " + std::to_string(abortedRays) + " rays hit the iteration limit";
+        }
+        s += "\n";
+        s += probesTraced.toString("  Probes traced per ray");
+        s += lowResSteps.toString("  Low-res steps per ray");
+        s += highResSteps.toString("  High-res steps per ray");
+
+        if (compared)
+        {
+            const double invRays = 100.0 / double(std::max(rayCount, 1u));
+            s += "BVH reference: " + std::to_string(bvhTimeMs) + " ms, " + std::to_string(bvhRaysPerSecond / 1e6) + " Mrays/s\n";
+            s += "  Both hit: " + std::to_string(bothHit * invRays) + "%, both miss: " + std::to_string(bothMiss * invRays) + "%\n";
+            s += "  False hits: " + std::to_string(falseHits * invRays) + "%, false misses: " + std::to_string(falseMisses * invRays) + "%\n";
+            s += "  Matching hits: " + std::to_string(matchingHits * invRays) + "%, distance error mean " + std::to_string(meanDistanceError) +
+                 " m, 95th percentile " + std::to_string(p95DistanceError) + " m\n";
+        }
+        return s;
+    }
+
+    LightFieldProbeTraceBenchmark::Report LightFieldProbeTraceBenchmark::run(const LightFieldProbeTracer& tracer, const CpuSceneBvh& bvh, const BoundingBox& region, const Settings& settings)
+    {
+        Report report;
+        report.rayCount = settings.rayCount;
+        report.simd = tracer.getUseSimd();
+
+        const uint32_t rayCount = settings.rayCount;
+        const uint32_t threadCount = settings.threadCount ? settings.threadCount : getDefaultCpuThreadCount();
+        const uint32_t taskCount = (rayCount + kRaysPerTask - 1) / kRaysPerTask;
+        auto forEachRay = [&](const std::function<void(uint32_t)>& func)
+        {
+            parallelFor(taskCount, threadCount, [&](uint32_t task)
+            {
+                const uint32_t end = std::min(rayCount, (task + 1) * kRaysPerTask);
+                for (uint32_t i = task * kRaysPerTask; i < end; ++i)
+                {
+                    func(i);
+                }
+            });
+        };
+
+        std::vector<float3> origins(rayCount);
+        std::vector<float3> directions(rayCount);
+        forEachRay([&](uint32_t i) { generateRay(bvh, region, settings.seed, i, origins[i], directions[i]); });
+
+        // Probe trace. Negative distances mark misses.
+        std::vector<LightFieldProbeTracer::TraceStats> stats(rayCount);
+        std::vector<float> probeT(rayCount, -1.0f);
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+        forEachRay([&](uint32_t i)
+        {
+            LightFieldProbeTracer::Hit hit;
+            if (tracer.trace(origins[i], directions[i], kMaxDistance, settings.fillHoles, hit, &stats[i]))
+            {
+                probeT[i] = hit.t;
+            }
+        });
+        report.traceTimeMs = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+        report.raysPerSecond = double(rayCount) / std::max(report.traceTimeMs * 1e-3, 1e-9);
+
+        for (uint32_t i = 0; i < rayCount; ++i)
+        {
+            report.probesTraced.add(stats[i].probesTraced);
+            report.lowResSteps.add(stats[i].lowResSteps);
+            report.highResSteps.add(stats[i].highResSteps);
+            if (stats[i].aborted) report.abortedRays++;
+            if (probeT[i] >= 0.0f) report.probeHits++;
+        }
+
+        if (!settings.compareWithBvh)
+        {
+            return report;
+        }
+
+        std::vector<float> bvhT(rayCount, -1.0f);
+        start = CpuTimer::getCurrentTimePoint();
+        forEachRay([&](uint32_t i)
+        {
+            CpuSceneBvh::Hit hit;
+            if (bvh.intersect(origins[i], directions[i], 0.0f, kMaxDistance, hit))
+            {
+                bvhT[i] = hit.t;
+            }
+        });
+        report.bvhTimeMs = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+        report.bvhRaysPerSecond = double(rayCount) / std::max(report.bvhTimeMs * 1e-3, 1e-9);
+        report.compared = true;
+
+        std::vector<float> errors;
+        double errorSum = 0.0;
+        for (uint32_t i = 0; i < rayCount; ++i)
+        {
+            const bool probeHit = probeT[i] >= 0.0f;
+            const bool bvhHit = bvhT[i] >= 0.0f;
+            if (probeHit && bvhHit)
+            {
+                report.bothHit++;
+                const float error = std::abs(probeT[i] - bvhT[i]);
+                if (error <= settings.hitTolerance * bvhT[i]) report.matchingHits++;
+                errors.push_back(error);
+                errorSum += error;
+            }
+            else if (probeHit) report.falseHits++;
+            else if (bvhHit) report.falseMisses++;
+            else report.bothMiss++;
+        }
+
+        if (!errors.empty())
+        {
+            report.meanDistanceError = float(errorSum / double(errors.size()));
+            const size_t p95 = std::min(errors.size() - 1, errors.size() * 95 / 100);
+            std::nth_element(errors.begin(), errors.begin() + p95, errors.end());
+            report.p95DistanceError = errors[p95];
+        }
+        return report;
+    }
+}
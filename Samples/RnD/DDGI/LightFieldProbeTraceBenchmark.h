@@ -0,0 +1,95 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include "Falcor.h"
+#include "CpuSceneBvh.h"
+#include "LightFieldProbeTracer.h"
+
+namespace Falcor
+{
+    /** Measures the CPU light field probe trace.
+        Rays start on scene surfaces inside the probe grid and leave in cosine-distributed directions, like the indirect
+        diffuse rays of LightFieldProbeRayTracing. The report has the trace throughput and histograms of the work done per
+        ray. Optionally each ray is also cast against the scene BVH to measure how often the probe trace finds the right hit.
+    */
+    class LightFieldProbeTraceBenchmark
+    {
+    public:
+        struct Settings
+        {
+            uint32_t rayCount = 1 << 16;
+            uint32_t seed = 1;
+            bool fillHoles = false;
+            bool compareWithBvh = true;
+            float hitTolerance = 0.05f;     ///< Relative distance error under which a probe hit counts as matching the BVH hit
+            uint32_t threadCount = 0;       ///< 0 uses all hardware threads
+        };
+
+        /** Power of two buckets: 0, 1, 2-3, 4-7, ...
+        */
+        struct Histogram
+        {
+            std::vector<uint64_t> buckets;
+
+            void add(uint32_t value);
+            std::string toString(const std::string& label) const;
+        };
+
+        struct Report
+        {
+            uint32_t rayCount = 0;
+            bool simd = false;
+            double traceTimeMs = 0.0;
+            double raysPerSecond = 0.0;
+            uint32_t probeHits = 0;
+            uint32_t abortedRays = 0;       ///< Rays that hit the segment iteration limit
+            Histogram probesTraced;
+            Histogram lowResSteps;
+            Histogram highResSteps;
+
+            // BVH comparison
+            bool compared = false;
+            double bvhTimeMs = 0.0;
+            double bvhRaysPerSecond = 0.0;
+            uint32_t bothHit = 0;
+            uint32_t bothMiss = 0;
+            uint32_t falseHits = 0;         ///< The probes report a hit, the BVH doesn't
+            uint32_t falseMisses = 0;       ///< The BVH hits, the probes don't
+            uint32_t matchingHits = 0;      ///< Both hit, within the distance tolerance
+            float meanDistanceError = 0.0f; ///< Over rays where both hit, in meters
+            float p95DistanceError = 0.0f;
+
+            std::string toString() const;
+        };
+
+        /** Run the benchmark. The trace uses the tracer as configured, see LightFieldProbeTracer::setUseSimd().
+            \param[in] region Ray origins are picked on surfaces inside this box, usually the bounds of the probe grid
+        */
+        static Report run(const LightFieldProbeTracer& tracer, const CpuSceneBvh& bvh, const BoundingBox& region, const Settings& settings);
+    };
+}
@@ -0,0 +1,711 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "LightFieldProbeTracer.h"
+#include "LightFieldProbeMath.h"
+#include <xmmintrin.h>
+
+namespace Falcor
+{
+    using namespace LightFieldProbeMath;
+
+    namespace
+    {
+        // Same constants as LightFieldProbe.slang
+        const float kMinThickness = 0.03f;          // meters
+        const float kMaxThickness = 0.50f;          // meters
+        const float kRayBumpEpsilon = 0.001f;       // meters
+        const float kDegenerateEpsilon = 0.001f;    // meters
+        const int32_t kBrickSize = 4;               // PROBE_BRICK_SIZE
+
+        // The shader loops until the low-res trace runs off the segment. Bound it so a degenerate ray can't hang the CPU.
+        const uint32_t kMaxSegmentIterations = 4096;
+
+        /** HLSL sign(), 0 for 0
+        */
+        float signOf(float v)
+        {
+            return (v > 0.0f) ? 1.0f : ((v < 0.0f) ? -1.0f : 0.0f);
+        }
+
+        float2 signOf(float2 v)
+        {
+            return float2(signOf(v.x), signOf(v.y));
+        }
+
+        float2 frac(float2 v)
+        {
+            return v - glm::floor(v);
+        }
+
+        float2 swizzleYX(float2 v)
+        {
+            return float2(v.y, v.x);
+        }
+
+        /** Returns the distance along v from the probe to the intersection with the ray, see LightFieldProbe.slang
+        */
+        float distanceToIntersection(const float3& origin, const float3& direction, const float3& v)
+        {
+            float numer;
+            float denom = v.y * direction.z - v.z * direction.y;
+
+            if (std::abs(denom) > 0.1f)
+            {
+                numer = origin.y * direction.z - origin.z * direction.y;
+            }
+            else
+            {
+                // We're in the yz plane; use another one
+                numer = origin.x * direction.y - origin.y * direction.x;
+                denom = v.x * direction.y - v.y * direction.x;
+            }
+
+            return numer / denom;
+        }
+
+        /** GPU min/max return the other operand when one is NaN, which fminf/fmaxf also do
+        */
+        void minSwap(float& a, float& b)
+        {
+            float temp = fminf(a, b);
+            b = fmaxf(a, b);
+            a = temp;
+        }
+
+        float3 getGGXMicrofacet(const float2& u, const float3& N, float roughness)
+        {
+            float a2 = roughness * roughness;
+
+            float phi = float(2.0 * M_PI) * u.x;
+            float cosTheta = std::sqrt(std::max(0.0f, (1.0f - u.y)) / (1.0f + (a2 - 1.0f) * u.y));
+            float sinTheta = std::sqrt(std::max(0.0f, 1.0f - cosTheta * cosTheta));
+
+            float3 tH = float3(sinTheta * std::cos(phi), sinTheta * std::sin(phi), cosTheta);
+
+            float3 T = getPerpendicularStark(N);
+            float3 B = glm::normalize(glm::cross(N, T));
+            return glm::normalize(T * tH.x + B * tH.y + N * tH.z);
+        }
+
+        inline __m128 select(__m128 mask, __m128 a, __m128 b)
+        {
+            return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+        }
+
+        inline __m128 abs4(__m128 v)
+        {
+            return _mm_andnot_ps(_mm_set1_ps(-0.0f), v);
+        }
+
+        /** octDecode() on four octahedral vectors at once
+        */
+        inline void octDecode4(__m128 ox, __m128 oy, __m128& vx, __m128& vy, __m128& vz)
+        {
+            const __m128 one = _mm_set1_ps(1.0f);
+            const __m128 minusOne = _mm_set1_ps(-1.0f);
+            const __m128 zero = _mm_setzero_ps();
+
+            __m128 absX = abs4(ox);
+            __m128 absY = abs4(oy);
+            vz = _mm_sub_ps(_mm_sub_ps(one, absX), absY);
+
+            __m128 lowerHemisphere = _mm_cmplt_ps(vz, zero);
+            __m128 foldedX = _mm_mul_ps(_mm_sub_ps(one, absY), select(_mm_cmpge_ps(ox, zero), one, minusOne));
+            __m128 foldedY = _mm_mul_ps(_mm_sub_ps(one, absX), select(_mm_cmpge_ps(oy, zero), one, minusOne));
+            vx = select(lowerHemisphere, foldedX, ox);
+            vy = select(lowerHemisphere, foldedY, oy);
+
+            __m128 lengthSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz));
+            __m128 invLength = _mm_div_ps(one, _mm_sqrt_ps(lengthSq));
+            vx = _mm_mul_ps(vx, invLength);
+            vy = _mm_mul_ps(vy, invLength);
+            vz = _mm_mul_ps(vz, invLength);
+        }
+    }
+
+    LightFieldProbeTracer::SharedPtr LightFieldProbeTracer::create(const LightFieldProbeAtlas& atlas, const LightFieldProbeCache::GridDesc& grid, const int3& gridScrollOffset)
+    {
+        const int3 brickCounts = (grid.probesCount + kBrickSize - 1) / kBrickSize;
+        const size_t brickCount = size_t(brickCounts.x) * brickCounts.y * brickCounts.z;
+        if (grid.brickTable.size() != brickCount)
+        {
+            logError("LightFieldProbeTracer: the brick table doesn't match the probe grid");
+            return nullptr;
+        }
+        if (atlas.probeCount < grid.probeSliceCount || atlas.octResolution == 0 || atlas.lowResResolution == 0 ||
+            atlas.radiance.size() != atlas.getOctSliceSize() * atlas.probeCount ||
+            atlas.normal.size() != atlas.getOctSliceSize() * atlas.probeCount ||
+            atlas.distance.size() != atlas.getOctSliceSize() * atlas.probeCount ||
+            atlas.lowResDistance.size() != atlas.getLowResSliceSize() * atlas.probeCount)
+        {
+            logError("LightFieldProbeTracer: the atlas doesn't hold the high-res and low-res data of every probe slice");
+            return nullptr;
+        }
+        if (!grid.probeOffsets.empty() && grid.probeOffsets.size() < grid.probeSliceCount)
+        {
+            logError("LightFieldProbeTracer: expected one probe offset per slice");
+            return nullptr;
+        }
+        return SharedPtr(new LightFieldProbeTracer(atlas, grid, gridScrollOffset));
+    }
+
+    LightFieldProbeTracer::LightFieldProbeTracer(const LightFieldProbeAtlas& atlas, const LightFieldProbeCache::GridDesc& grid, const int3& gridScrollOffset)
+        : mAtlas(atlas)
+    {
+        mProbesCount = grid.probesCount;
+        mProbeStep = grid.probeStep;
+        mProbeStartPosition = grid.probeStartPosition;
+        mGridScrollOffset = gridScrollOffset;
+        mBrickCounts = (mProbesCount + kBrickSize - 1) / kBrickSize;
+        mBrickTable = grid.brickTable;
+        mProbeOffsets = grid.probeOffsets;
+
+        mSizeHighRes = float2(float(atlas.octResolution));
+        mInvSizeHighRes = 1.0f / mSizeHighRes;
+        mSizeLowRes = float2(float(atlas.lowResResolution));
+        mInvSizeLowRes = 1.0f / mSizeLowRes;
+
+        mHalfToFloat.resize(1 << 16);
+        for (uint32_t i = 0; i < (uint32_t)mHalfToFloat.size(); ++i)
+        {
+            mHalfToFloat[i] = unpackR16F(uint16_t(i));
+        }
+    }
+
+    int3 LightFieldProbeTracer::probeIndexToGridCoord(int32_t index) const
+    {
+        return int3(index % mProbesCount.x, (index / mProbesCount.x) % mProbesCount.y, index / (mProbesCount.x * mProbesCount.y));
+    }
+
+    int32_t LightFieldProbeTracer::gridCoordToProbeIndex(const int3& coord) const
+    {
+        return coord.x + coord.y * mProbesCount.x + coord.z * mProbesCount.x * mProbesCount.y;
+    }
+
+    int32_t LightFieldProbeTracer::probeSliceIndex(const int3& coord) const
+    {
+        const int3 c = (coord + mGridScrollOffset) % mProbesCount;
+        const int3 brick = c / kBrickSize;
+        const int32_t brickSlot = mBrickTable[brick.x + brick.y * mBrickCounts.x + brick.z * mBrickCounts.x * mBrickCounts.y];
+        if (brickSlot < 0)
+        {
+            return -1;
+        }
+
+        const int3 local = c - brick * kBrickSize;
+        return brickSlot * kBrickSize * kBrickSize * kBrickSize + local.x + (local.y + local.z * kBrickSize) * kBrickSize;
+    }
+
+    bool LightFieldProbeTracer::isProbeActive(int32_t probeIndex) const
+    {
+        const int32_t slice = probeSliceIndex(probeIndexToGridCoord(probeIndex));
+        return (slice >= 0) && (mProbeOffsets.empty() || mProbeOffsets[slice].w > 0.5f);
+    }
+
+    float3 LightFieldProbeTracer::getProbeLocation(int32_t probeIndex) const
+    {
+        const int3 coord = probeIndexToGridCoord(probeIndex);
+        const int32_t slice = probeSliceIndex(coord);
+        const float3 offset = (slice >= 0 && !mProbeOffsets.empty()) ? float3(mProbeOffsets[slice]) : float3(0.0f);
+        return mProbeStep * float3(coord) + mProbeStartPosition + offset;
+    }
+
+    int32_t LightFieldProbeTracer::nearestProbeIndex(const float3& p) const
+    {
+        // HLSL round() rounds halfway cases to even
+        const float3 probeCoords = glm::clamp(glm::roundEven((p - mProbeStartPosition) / mProbeStep), float3(0.0f), float3(mProbesCount - 1));
+        return gridCoordToProbeIndex(int3(probeCoords));
+    }
+
+    int32_t LightFieldProbeTracer::nearestProbeIndices(const float3& p) const
+    {
+        const float3 maxProbeCoords = float3(mProbesCount - 1);
+        const float3 floatProbeCoords = (p - mProbeStartPosition) / mProbeStep;
+        const float3 baseProbeCoords = glm::clamp(glm::floor(floatProbeCoords), float3(0.0f), maxProbeCoords);
+
+        float minDist = 10.0f;
+        int32_t nearestIndex = -1;
+        for (int32_t i = 0; i < 8; ++i)
+        {
+            float3 newProbeCoords = glm::min(baseProbeCoords + float3(i & 1, (i >> 1) & 1, (i >> 2) & 1), maxProbeCoords);
+            float d = glm::length(newProbeCoords - floatProbeCoords);
+            if (d < minDist)
+            {
+                minDist = d;
+                nearestIndex = i;
+            }
+        }
+        return nearestIndex;
+    }
+
+    int32_t LightFieldProbeTracer::relativeProbeIndex(int32_t baseIndex, int32_t relativeIndex) const
+    {
+        const int3 offset = int3(relativeIndex & 1, (relativeIndex >> 1) & 1, (relativeIndex >> 2) & 1);
+        const int3 coord = glm::min(probeIndexToGridCoord(baseIndex) + offset, mProbesCount - 1);
+        return gridCoordToProbeIndex(coord);
+    }
+
+    float LightFieldProbeTracer::fetchDistance(int32_t slice, const float2& texCoord) const
+    {
+        // texelFetch() in the shader point samples at the texel corner with clamp addressing
+        const int32_t res = (int32_t)mAtlas.octResolution;
+        const int32_t x = glm::clamp(int32_t(mSizeHighRes.x * texCoord.x), 0, res - 1);
+        const int32_t y = glm::clamp(int32_t(mSizeHighRes.y * texCoord.y), 0, res - 1);
+        return mHalfToFloat[mAtlas.distance[size_t(slice) * mAtlas.getOctSliceSize() + y * res + x]];
+    }
+
+    float LightFieldProbeTracer::fetchLowResDistance(int32_t slice, const float2& pixel) const
+    {
+        const int32_t res = (int32_t)mAtlas.lowResResolution;
+        const int32_t x = glm::clamp(int32_t(pixel.x), 0, res - 1);
+        const int32_t y = glm::clamp(int32_t(pixel.y), 0, res - 1);
+        return mHalfToFloat[mAtlas.lowResDistance[size_t(slice) * mAtlas.getLowResSliceSize() + y * res + x]];
+    }
+
+    float3 LightFieldProbeTracer::fetchNormal(int32_t slice, const float2& texCoord) const
+    {
+        const int32_t res = (int32_t)mAtlas.octResolution;
+        const int32_t x = glm::clamp(int32_t(mSizeHighRes.x * texCoord.x), 0, res - 1);
+        const int32_t y = glm::clamp(int32_t(mSizeHighRes.y * texCoord.y), 0, res - 1);
+        const float4 texel = unpackRGBA8(mAtlas.normal[size_t(slice) * mAtlas.getOctSliceSize() + y * res + x]);
+
+        // The atlas stores an octahedral vector in xy so it can be BC5 compressed, decoded like decodeUnitVector() in the shader
+        return octDecode(float2(texel.x, texel.y) * 2.0f - 1.0f);
+    }
+
+    float3 LightFieldProbeTracer::sampleRadiance(const Hit& hit) const
+    {
+        if (hit.slice < 0) return float3(0.0f);
+
+        // Bilinear filtering with clamp addressing
+        const int32_t res = (int32_t)mAtlas.octResolution;
+        const uint32_t* pSlice = mAtlas.radiance.data() + size_t(hit.slice) * mAtlas.getOctSliceSize();
+        const float2 pos = hit.texCoord * mSizeHighRes - 0.5f;
+        const float2 base = glm::floor(pos);
+        const float2 f = pos - base;
+
+        auto fetch = [&](int32_t x, int32_t y)
+        {
+            x = glm::clamp(x, 0, res - 1);
+            y = glm::clamp(y, 0, res - 1);
+            return unpackR11G11B10(pSlice[y * res + x]);
+        };
+
+        const int32_t x0 = (int32_t)base.x;
+        const int32_t y0 = (int32_t)base.y;
+        const float3 top = glm::mix(fetch(x0, y0), fetch(x0 + 1, y0), f.x);
+        const float3 bottom = glm::mix(fetch(x0, y0 + 1), fetch(x0 + 1, y0 + 1), f.x);
+        return glm::mix(top, bottom, f.y);
+    }
+
+    LightFieldProbeTracer::TraceResult LightFieldProbeTracer::resolveHighResHit(const ProbeRay& ray, const float2& texCoord, int32_t slice, float distanceFromProbeToSurface,
+                                                                                float distanceFromProbeToRayBefore, float distanceFromProbeToRayAfter, const float3& directionFromProbeBefore,
+                                                                                float& tMin, float& tMax, float2& hitTexCoord) const
+    {
+        // At least a one-sided hit; see if the ray actually passed through the surface, or was behind it
+        const float3 directionFromProbe = octDecode(texCoord * 2.0f - 1.0f);
+        const float minDistFromProbeToRay = fminf(distanceFromProbeToRayBefore, distanceFromProbeToRayAfter);
+
+        const float3 probeSpaceHitPoint = distanceFromProbeToSurface * directionFromProbe;
+        const float distAlongRay = glm::dot(probeSpaceHitPoint - ray.origin, ray.direction);
+
+        const float3 normal = fetchNormal(slice, texCoord);
+
+        // Only extrude towards and away from the view ray, glancing surfaces are assumed to be thicker
+        const float surfaceThickness = kMinThickness
+            + (kMaxThickness - kMinThickness) *
+            fmaxf(glm::dot(ray.direction, directionFromProbe), 0.0f) *
+            (2.0f - std::abs(glm::dot(ray.direction, normal))) *
+            glm::clamp(distAlongRay * 0.1f, 0.05f, 1.0f);
+
+        if ((minDistFromProbeToRay < distanceFromProbeToSurface + surfaceThickness) && (glm::dot(normal, ray.direction) < 0.0f))
+        {
+            // Two-sided hit, the probe's distance is more accurate than the march
+            tMax = distAlongRay;
+            hitTexCoord = texCoord;
+            return TraceResult::Hit;
+        }
+
+        // The ray passed completely behind a surface. Back up conservatively so that we don't set tMin too large.
+        const float3 probeSpaceHitPointBefore = distanceFromProbeToRayBefore * directionFromProbeBefore;
+        const float distAlongRayBefore = glm::dot(probeSpaceHitPointBefore - ray.origin, ray.direction);
+        tMin = fmaxf(tMin, fminf(distAlongRay, distAlongRayBefore));
+        return TraceResult::Unknown;
+    }
+
+    LightFieldProbeTracer::TraceResult LightFieldProbeTracer::highResolutionTraceOneRaySegment(const ProbeRay& ray, const float2& startTexCoord, const float2& endTexCoord, int32_t slice,
+                                                                                               float& tMin, float& tMax, float2& hitTexCoord, TraceStats& stats) const
+    {
+        const float2 texCoordDelta = endTexCoord - startTexCoord;
+        const float texCoordDistance = glm::length(texCoordDelta);
+        const float2 texCoordDirection = texCoordDelta * (1.0f / texCoordDistance);
+        const float texCoordStep = mInvSizeHighRes.x * (texCoordDistance / std::max(std::abs(texCoordDelta.x), std::abs(texCoordDelta.y)));
+
+        const float3 directionFromProbeBefore = octDecode(startTexCoord * 2.0f - 1.0f);
+        float distanceFromProbeToRayBefore = fmaxf(0.0f, distanceToIntersection(ray.origin, ray.direction, directionFromProbeBefore));
+
+        for (float d = 0.0f; d <= texCoordDistance; d += texCoordStep)
+        {
+            stats.highResSteps++;
+            const float2 texCoord = (texCoordDirection * fminf(d + texCoordStep * 0.5f, texCoordDistance)) + startTexCoord;
+            const float distanceFromProbeToSurface = fetchDistance(slice, texCoord);
+
+            const float2 texCoordAfter = (texCoordDirection * fminf(d + texCoordStep, texCoordDistance)) + startTexCoord;
+            const float3 directionFromProbeAfter = octDecode(texCoordAfter * 2.0f - 1.0f);
+            const float distanceFromProbeToRayAfter = fmaxf(0.0f, distanceToIntersection(ray.origin, ray.direction, directionFromProbeAfter));
+
+            if (fmaxf(distanceFromProbeToRayBefore, distanceFromProbeToRayAfter) >= distanceFromProbeToSurface)
+            {
+                return resolveHighResHit(ray, texCoord, slice, distanceFromProbeToSurface, distanceFromProbeToRayBefore, distanceFromProbeToRayAfter,
+                                         directionFromProbeBefore, tMin, tMax, hitTexCoord);
+            }
+            distanceFromProbeToRayBefore = distanceFromProbeToRayAfter;
+        }
+
+        return TraceResult::Miss;
+    }
+
+    LightFieldProbeTracer::TraceResult LightFieldProbeTracer::highResolutionTraceOneRaySegmentSimd(const ProbeRay& ray, const float2& startTexCoord, const float2& endTexCoord, int32_t slice,
+                                                                                                   float& tMin, float& tMax, float2& hitTexCoord, TraceStats& stats) const
+    {
+        const float2 texCoordDelta = endTexCoord - startTexCoord;
+        const float texCoordDistance = glm::length(texCoordDelta);
+        const float2 texCoordDirection = texCoordDelta * (1.0f / texCoordDistance);
+        const float texCoordStep = mInvSizeHighRes.x * (texCoordDistance / std::max(std::abs(texCoordDelta.x), std::abs(texCoordDelta.y)));
+
+        const float3 directionFromProbeBefore = octDecode(startTexCoord * 2.0f - 1.0f);
+        float distanceFromProbeToRayBefore = fmaxf(0.0f, distanceToIntersection(ray.origin, ray.direction, directionFromProbeBefore));
+
+        const __m128 originX = _mm_set1_ps(ray.origin.x);
+        const __m128 originY = _mm_set1_ps(ray.origin.y);
+        const __m128 originZ = _mm_set1_ps(ray.origin.z);
+        const __m128 dirX = _mm_set1_ps(ray.direction.x);
+        const __m128 dirY = _mm_set1_ps(ray.direction.y);
+        const __m128 dirZ = _mm_set1_ps(ray.direction.z);
+        const __m128 yzNumer = _mm_sub_ps(_mm_mul_ps(originY, dirZ), _mm_mul_ps(originZ, dirY));
+        const __m128 xyNumer = _mm_sub_ps(_mm_mul_ps(originX, dirY), _mm_mul_ps(originY, dirX));
+        const __m128 planeThreshold = _mm_set1_ps(0.1f);
+
+        // Same march as the scalar version, the ray distances of four consecutive steps are evaluated together and
+        // the steps are then tested in order so the first hit is the same
+        float d = 0.0f;
+        while (d <= texCoordDistance)
+        {
+            int32_t laneCount = 0;
+            float stepD[4];
+            for (; laneCount < 4 && d <= texCoordDistance; ++laneCount, d += texCoordStep)
+            {
+                stepD[laneCount] = d;
+            }
+
+            alignas(16) float afterU[4];
+            alignas(16) float afterV[4];
+            float2 texCoords[4];
+            for (int32_t k = 0; k < 4; ++k)
+            {
+                const float dk = stepD[std::min(k, laneCount - 1)];
+                texCoords[k] = (texCoordDirection * fminf(dk + texCoordStep * 0.5f, texCoordDistance)) + startTexCoord;
+                const float2 texCoordAfter = (texCoordDirection * fminf(dk + texCoordStep, texCoordDistance)) + startTexCoord;
+                afterU[k] = texCoordAfter.x * 2.0f - 1.0f;
+                afterV[k] = texCoordAfter.y * 2.0f - 1.0f;
+            }
+
+            __m128 vx, vy, vz;
+            octDecode4(_mm_load_ps(afterU), _mm_load_ps(afterV), vx, vy, vz);
+
+            // distanceToIntersection(), picking the plane per lane
+            __m128 yzDenom = _mm_sub_ps(_mm_mul_ps(vy, dirZ), _mm_mul_ps(vz, dirY));
+            __m128 xyDenom = _mm_sub_ps(_mm_mul_ps(vx, dirY), _mm_mul_ps(vy, dirX));
+            __m128 useYZ = _mm_cmpgt_ps(abs4(yzDenom), planeThreshold);
+            __m128 distance = _mm_div_ps(select(useYZ, yzNumer, xyNumer), select(useYZ, yzDenom, xyDenom));
+
+            // _mm_max_ps returns the second operand for NaN, like max(0.0, x) on the GPU
+            alignas(16) float distanceAfter[4];
+            _mm_store_ps(distanceAfter, _mm_max_ps(distance, _mm_setzero_ps()));
+
+            for (int32_t k = 0; k < laneCount; ++k)
+            {
+                stats.highResSteps++;
+                const float distanceFromProbeToSurface = fetchDistance(slice, texCoords[k]);
+                if (fmaxf(distanceFromProbeToRayBefore, distanceAfter[k]) >= distanceFromProbeToSurface)
+                {
+                    return resolveHighResHit(ray, texCoords[k], slice, distanceFromProbeToSurface, distanceFromProbeToRayBefore, distanceAfter[k],
+                                             directionFromProbeBefore, tMin, tMax, hitTexCoord);
+                }
+                distanceFromProbeToRayBefore = distanceAfter[k];
+            }
+        }
+
+        return TraceResult::Miss;
+    }
+
+    bool LightFieldProbeTracer::lowResolutionTraceOneSegment(const ProbeRay& ray, int32_t slice, float2& texCoord, const float2& segmentEndTexCoord, float2& endHighResTexCoord, TraceStats& stats) const
+    {
+        // Convert the texels to pixel coordinates
+        float2 P0 = texCoord * mSizeLowRes;
+        float2 P1 = segmentEndTexCoord * mSizeLowRes;
+
+        // If the line is degenerate, make it cover at least one pixel
+        const float2 p0ToP1 = P1 - P0;
+        P1 += float2((glm::dot(p0ToP1, p0ToP1) < 0.0001f) ? 0.01f : 0.0f);
+        float2 delta = P1 - P0;
+
+        // Permute so that the primary iteration is in x
+        bool permute = false;
+        if (std::abs(delta.x) < std::abs(delta.y))
+        {
+            permute = true;
+            delta = swizzleYX(delta);
+            P0 = swizzleYX(P0);
+            P1 = swizzleYX(P1);
+        }
+
+        const float stepDir = signOf(delta.x);
+        const float invdx = stepDir / delta.x;
+        const float2 dP = float2(stepDir, delta.y * invdx);
+
+        const float3 initialDirectionFromProbe = octDecode(texCoord * 2.0f - 1.0f);
+        float prevRadialDistMaxEstimate = fmaxf(0.0f, distanceToIntersection(ray.origin, ray.direction, initialDirectionFromProbe));
+        const float end = P1.x * stepDir;
+        const float absInvdPY = 1.0f / std::abs(dP.y);
+
+        // Don't ever move farther from texCoord than this distance in texture space, past it the ray bends
+        const float2 segment = segmentEndTexCoord - texCoord;
+        const float maxTexCoordDistance = glm::dot(segment, segment);
+
+        const float2 deltaSign = signOf(delta);
+        for (float2 P = P0; (P.x * deltaSign.x) <= end; )
+        {
+            stats.lowResSteps++;
+            const float2 hitPixel = permute ? swizzleYX(P) : P;
+            const float sceneRadialDistMin = fetchLowResDistance(slice, hitPixel);
+
+            // Distance along each axis to the edge of the low-res texel
+            const float2 intersectionPixelDistance = (deltaSign * 0.5f + 0.5f) - deltaSign * frac(P);
+            const float rayDistanceToNextPixelEdge = fminf(intersectionPixelDistance.x, intersectionPixelDistance.y * absInvdPY);
+
+            endHighResTexCoord = (P + dP * rayDistanceToNextPixelEdge) * mInvSizeLowRes;
+            endHighResTexCoord = permute ? swizzleYX(endHighResTexCoord) : endHighResTexCoord;
+
+            const float2 travelled = endHighResTexCoord - texCoord;
+            if (glm::dot(travelled, travelled) > maxTexCoordDistance)
+            {
+                // Clamp the ray to the segment
+                endHighResTexCoord = segmentEndTexCoord;
+            }
+
+            const float3 directionFromProbe = octDecode(endHighResTexCoord * 2.0f - 1.0f);
+            const float distanceFromProbeToRay = fmaxf(0.0f, distanceToIntersection(ray.origin, ray.direction, directionFromProbe));
+
+            const float maxRadialRayDistance = fmaxf(distanceFromProbeToRay, prevRadialDistMaxEstimate);
+            prevRadialDistMaxEstimate = distanceFromProbeToRay;
+
+            if (sceneRadialDistMin < maxRadialRayDistance)
+            {
+                // A conservative hit, texCoord is where the ray entered the texel
+                texCoord = (permute ? swizzleYX(P) : P) * mInvSizeLowRes;
+                return true;
+            }
+
+            // Step just past the boundary so we're slightly inside the next texel
+            const float epsilon = 0.001f; // pixels
+            P += dP * (rayDistanceToNextPixelEdge + epsilon);
+        }
+
+        texCoord = segmentEndTexCoord;
+        return false;
+    }
+
+    LightFieldProbeTracer::TraceResult LightFieldProbeTracer::traceOneRaySegment(const ProbeRay& ray, float t0, float t1, int32_t slice, float& tMin, float& tMax, float2& hitTexCoord, TraceStats& stats) const
+    {
+        stats.segments++;
+
+        // Euclidean probe-space line segment
+        float3 probeSpaceStartPoint = ray.origin + ray.direction * (t0 + kRayBumpEpsilon);
+        const float3 probeSpaceEndPoint = ray.origin + ray.direction * (t1 - kRayBumpEpsilon);
+
+        // Only the direction to the start point matters, avoid normalizing a zero vector when the ray starts at the probe
+        if (glm::dot(probeSpaceStartPoint, probeSpaceStartPoint) < 0.001f)
+        {
+            probeSpaceStartPoint = ray.direction;
+        }
+
+        float2 texCoord = octEncode(glm::normalize(probeSpaceStartPoint)) * 0.5f + 0.5f;
+        const float2 segmentEndTexCoord = octEncode(glm::normalize(probeSpaceEndPoint)) * 0.5f + 0.5f;
+
+        for (uint32_t iteration = 0; iteration < kMaxSegmentIterations; ++iteration)
+        {
+            float2 endTexCoord = texCoord;
+            if (!lowResolutionTraceOneSegment(ray, slice, texCoord, segmentEndTexCoord, endTexCoord, stats))
+            {
+                // The whole segment missed
+                return TraceResult::Miss;
+            }
+
+            // Refine the conservative low-res hit
+            TraceResult result = mUseSimd ?
+                highResolutionTraceOneRaySegmentSimd(ray, texCoord, endTexCoord, slice, tMin, tMax, hitTexCoord, stats) :
+                highResolutionTraceOneRaySegment(ray, texCoord, endTexCoord, slice, tMin, tMax, hitTexCoord, stats);
+            if (result != TraceResult::Miss)
+            {
+                return result;
+            }
+
+            const float2 texCoordRayDirection = glm::normalize(segmentEndTexCoord - texCoord);
+            if (glm::dot(texCoordRayDirection, segmentEndTexCoord - endTexCoord) <= mInvSizeHighRes.x)
+            {
+                // The high-res trace reached the end of the segment
+                return TraceResult::Miss;
+            }
+
+            // Resume the low-res trace just past the texel that was verified
+            texCoord = endTexCoord + texCoordRayDirection * mInvSizeHighRes.x * 0.1f;
+        }
+
+        stats.aborted = true;
+        return TraceResult::Unknown;
+    }
+
+    LightFieldProbeTracer::TraceResult LightFieldProbeTracer::traceOneProbeOct(int32_t probeIndex, const float3& origin, const float3& direction, float& tMin, float& tMax, float2& hitTexCoord, TraceStats* pStats) const
+    {
+        TraceStats localStats;
+        TraceStats& stats = pStats ? *pStats : localStats;
+        stats.probesTraced++;
+
+        if (!isProbeActive(probeIndex))
+        {
+            return TraceResult::Unknown;
+        }
+        const int32_t slice = probeSliceIndex(probeIndexToGridCoord(probeIndex));
+
+        ProbeRay probeSpaceRay;
+        probeSpaceRay.origin = origin - getProbeLocation(probeIndex);
+        probeSpaceRay.direction = direction;
+
+        // Up to five boundary points: ray origin, ray end and the intersections with the XYZ planes
+        float3 t = probeSpaceRay.origin * -(1.0f / probeSpaceRay.direction);
+        minSwap(t.x, t.y);
+        minSwap(t.y, t.z);
+        minSwap(t.x, t.y);
+
+        const float boundaryTs[5] =
+        {
+            tMin,
+            fminf(fmaxf(t.x, tMin), tMax),
+            fminf(fmaxf(t.y, tMin), tMax),
+            fminf(fmaxf(t.z, tMin), tMax),
+            tMax,
+        };
+
+        for (int32_t i = 0; i < 4; ++i)
+        {
+            if (std::abs(boundaryTs[i] - boundaryTs[i + 1]) >= kDegenerateEpsilon)
+            {
+                TraceResult result = traceOneRaySegment(probeSpaceRay, boundaryTs[i], boundaryTs[i + 1], slice, tMin, tMax, hitTexCoord, stats);
+                if (result != TraceResult::Miss)
+                {
+                    return result;
+                }
+            }
+        }
+
+        return TraceResult::Miss;
+    }
+
+    bool LightFieldProbeTracer::trace(const float3& origin, const float3& direction, float tMax, bool fillHoles, Hit& hit, TraceStats* pStats) const
+    {
+        int32_t hitProbeIndex = -1;
+        hit.slice = -1;
+
+        const int32_t baseIndex = nearestProbeIndex(origin);
+        int32_t i = nearestProbeIndices(origin);
+        int32_t probesLeft = 8;
+        float tMin = 0.0f;
+        float2 hitTexCoord = float2(0.0f);
+        while (probesLeft > 0)
+        {
+            TraceResult result = traceOneProbeOct(relativeProbeIndex(baseIndex, i), origin, direction, tMin, tMax, hitTexCoord, pStats);
+            if (result == TraceResult::Unknown)
+            {
+                // nextCycleIndex()
+                i = (i + 3) & 7;
+                --probesLeft;
+            }
+            else
+            {
+                if (result == TraceResult::Hit)
+                {
+                    hitProbeIndex = relativeProbeIndex(baseIndex, i);
+                    hit.slice = probeSliceIndex(probeIndexToGridCoord(hitProbeIndex));
+                }
+                break;
+            }
+        }
+
+        if ((hitProbeIndex == -1) && fillHoles)
+        {
+            // No probe found a solution, fall back to the distance seen by the nearest probe
+            const int32_t nearestIndex = nearestProbeIndex(origin);
+            if (isProbeActive(nearestIndex))
+            {
+                hitProbeIndex = nearestIndex;
+                hit.slice = probeSliceIndex(probeIndexToGridCoord(hitProbeIndex));
+                hitTexCoord = octEncode(direction) * 0.5f + 0.5f;
+
+                const float probeDistance = fetchDistance(hit.slice, hitTexCoord);
+                if (probeDistance < 10000.0f)
+                {
+                    const float3 hitLocation = getProbeLocation(hitProbeIndex) + direction * probeDistance;
+                    tMax = glm::length(origin - hitLocation);
+                }
+            }
+        }
+
+        hit.t = tMax;
+        hit.texCoord = hitTexCoord;
+        return hitProbeIndex != -1;
+    }
+
+    float3 LightFieldProbeTracer::computeGlossyRay(const float3& position, const float3& wo, const float3& n, float linearRoughness, const float2& u, TraceStats* pStats) const
+    {
+        const float3 wh = getGGXMicrofacet(u, n, linearRoughness * linearRoughness);
+        const float3 wi = glm::reflect(-wo, wh);
+        if (glm::dot(wi, n) <= 0.0f)
+        {
+            return float3(0.0f);
+        }
+
+        // Same bias as LightFieldProbeRayTracing.slang
+        Hit hit;
+        if (!trace(position + wi * 0.02f, wi, 10000.0f, false, hit, pStats))
+        {
+            return float3(0.0f);
+        }
+        return sampleRadiance(hit);
+    }
+}
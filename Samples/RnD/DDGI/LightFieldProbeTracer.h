@@ -0,0 +1,155 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include "Falcor.h"
+#include "LightFieldProbeBaker.h"
+#include "LightFieldProbeCache.h"
+
+namespace Falcor
+{
+    /** CPU port of the light field probe trace in LightFieldProbe.slang (trace(), traceOneProbeOct() and the
+        low/high resolution octahedral marches they use), operating on a LightFieldProbeAtlas.
+        Texel fetches, clamping and the order of operations follow the shader so results can be compared to the
+        GPU path. The high-res march evaluates four steps at a time with SSE, setUseSimd(false) runs the scalar loop.
+        Tracing is const and can be called from several threads at once.
+    */
+    class LightFieldProbeTracer
+    {
+    public:
+        using SharedPtr = std::shared_ptr<LightFieldProbeTracer>;
+        using SharedConstPtr = std::shared_ptr<const LightFieldProbeTracer>;
+
+        /** Same values as TRACE_RESULT_* in LightFieldProbe.slang
+        */
+        enum class TraceResult
+        {
+            Miss = 0,
+            Hit = 1,
+            Unknown = 2,
+        };
+
+        /** Work done for one ray
+        */
+        struct TraceStats
+        {
+            uint32_t probesTraced = 0;      ///< traceOneProbeOct() calls
+            uint32_t segments = 0;          ///< Octant segments traced
+            uint32_t lowResSteps = 0;       ///< Low-res texels visited
+            uint32_t highResSteps = 0;      ///< High-res texels visited
+            bool aborted = false;           ///< A segment hit the iteration limit, the shader would have kept looping
+        };
+
+        struct Hit
+        {
+            float t = 0.0f;
+            float2 texCoord;                ///< On [0, 1] in the octahedral map of the probe that was hit
+            int32_t slice = -1;             ///< Texture array layer of that probe
+        };
+
+        /** Create a tracer. The atlas is referenced, not copied, and must outlive the tracer.
+            \param[in] atlas Probe atlases, the high-res radiance, normal and distance must be present
+            \param[in] grid Probe grid layout. An empty probeOffsets array means no probe was relocated and all are active.
+            \param[in] gridScrollOffset Toroidal offset of a scrolling volume, see LightFieldProbeVolume::getGridScrollOffset()
+            \return nullptr if the atlas doesn't match the grid
+        */
+        static SharedPtr create(const LightFieldProbeAtlas& atlas, const LightFieldProbeCache::GridDesc& grid, const int3& gridScrollOffset = int3(0));
+
+        /** Trace a ray against the whole light field, see trace() in LightFieldProbe.slang.
+            \param[in] fillHoles If nothing conclusive is found, fall back to the distance stored by the nearest probe
+            \return true on a hit
+        */
+        bool trace(const float3& origin, const float3& direction, float tMax, bool fillHoles, Hit& hit, TraceStats* pStats = nullptr) const;
+
+        /** Trace a ray against a single probe. tMin and tMax are updated like in the shader.
+        */
+        TraceResult traceOneProbeOct(int32_t probeIndex, const float3& origin, const float3& direction, float& tMin, float& tMax, float2& hitTexCoord, TraceStats* pStats = nullptr) const;
+
+        /** Sample one GGX reflection ray at a surface and return the radiance it finds in the probes, like the _SPECULAR path
+            of LightFieldProbeRayTracing.slang. Misses return zero, there is no environment map on the CPU.
+            \param[in] u Uniform random numbers used to sample the microfacet normal
+        */
+        float3 computeGlossyRay(const float3& position, const float3& wo, const float3& n, float linearRoughness, const float2& u, TraceStats* pStats = nullptr) const;
+
+        /** Bilinear radiance lookup at a trace hit
+        */
+        float3 sampleRadiance(const Hit& hit) const;
+
+        void setUseSimd(bool useSimd) { mUseSimd = useSimd; }
+        bool getUseSimd() const { return mUseSimd; }
+
+        float3 getProbeLocation(int32_t probeIndex) const;
+
+    private:
+        LightFieldProbeTracer(const LightFieldProbeAtlas& atlas, const LightFieldProbeCache::GridDesc& grid, const int3& gridScrollOffset);
+
+        struct ProbeRay
+        {
+            float3 origin;
+            float3 direction;
+        };
+
+        int3 probeIndexToGridCoord(int32_t index) const;
+        int32_t gridCoordToProbeIndex(const int3& coord) const;
+        int32_t probeSliceIndex(const int3& coord) const;
+        bool isProbeActive(int32_t probeIndex) const;
+        int32_t nearestProbeIndex(const float3& p) const;
+        int32_t nearestProbeIndices(const float3& p) const;
+        int32_t relativeProbeIndex(int32_t baseIndex, int32_t relativeIndex) const;
+
+        float fetchDistance(int32_t slice, const float2& texCoord) const;
+        float fetchLowResDistance(int32_t slice, const float2& pixel) const;
+        float3 fetchNormal(int32_t slice, const float2& texCoord) const;
+
+        TraceResult traceOneRaySegment(const ProbeRay& ray, float t0, float t1, int32_t slice, float& tMin, float& tMax, float2& hitTexCoord, TraceStats& stats) const;
+        bool lowResolutionTraceOneSegment(const ProbeRay& ray, int32_t slice, float2& texCoord, const float2& segmentEndTexCoord, float2& endHighResTexCoord, TraceStats& stats) const;
+        TraceResult highResolutionTraceOneRaySegment(const ProbeRay& ray, const float2& startTexCoord, const float2& endTexCoord, int32_t slice, float& tMin, float& tMax, float2& hitTexCoord, TraceStats& stats) const;
+        TraceResult highResolutionTraceOneRaySegmentSimd(const ProbeRay& ray, const float2& startTexCoord, const float2& endTexCoord, int32_t slice, float& tMin, float& tMax, float2& hitTexCoord, TraceStats& stats) const;
+        TraceResult resolveHighResHit(const ProbeRay& ray, const float2& texCoord, int32_t slice, float distanceFromProbeToSurface,
+                                      float distanceFromProbeToRayBefore, float distanceFromProbeToRayAfter, const float3& directionFromProbeBefore,
+                                      float& tMin, float& tMax, float2& hitTexCoord) const;
+
+        const LightFieldProbeAtlas& mAtlas;
+        int3 mProbesCount;
+        float3 mProbeStep;
+        float3 mProbeStartPosition;
+        int3 mGridScrollOffset;
+        int3 mBrickCounts;
+        std::vector<int32_t> mBrickTable;
+        std::vector<float4> mProbeOffsets;
+
+        float2 mSizeHighRes;
+        float2 mInvSizeHighRes;
+        float2 mSizeLowRes;
+        float2 mInvSizeLowRes;
+
+        // The atlases store distances as halfs, a lookup table is cheaper than converting on every fetch
+        std::vector<float> mHalfToFloat;
+
+        bool mUseSimd = true;
+    };
+}
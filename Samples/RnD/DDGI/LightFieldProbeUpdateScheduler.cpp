@@ -0,0 +1,186 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "LightFieldProbeUpdateScheduler.h"
+#include <queue>
+
+namespace Falcor
+{
+    namespace
+    {
+        // Weight of the newest sample in the per-probe cost averages
+        const float kCostSmoothing = 0.1f;
+
+        void updateAverage(float& average, bool& valid, float sample)
+        {
+            average = valid ? glm::mix(average, sample, kCostSmoothing) : sample;
+            valid = true;
+        }
+    }
+
+    LightFieldProbeUpdateScheduler::SharedPtr LightFieldProbeUpdateScheduler::create(const Settings& settings)
+    {
+        return SharedPtr(new LightFieldProbeUpdateScheduler(settings));
+    }
+
+    LightFieldProbeUpdateScheduler::LightFieldProbeUpdateScheduler(const Settings& settings) : mSettings(settings)
+    {
+        for (auto& t : mGpuTimers)
+        {
+            t.pTimer = GpuTimer::create();
+        }
+    }
+
+    float LightFieldProbeUpdateScheduler::computePriority(const ProbeInfo& probe, const Camera* pCamera, const float3& cellExtent, uint64_t frameId) const
+    {
+        float priority = 0.0f;
+
+        float age = float(frameId - std::min(frameId, probe.lastUpdateFrame));
+        priority += mSettings.stalenessWeight * age / 100.0f;
+
+        if (!probe.hasValidData) priority += mSettings.neverUpdatedWeight;
+        if (probe.updateEveryFrame) priority += mSettings.updateEveryFrameWeight;
+
+        if (pCamera)
+        {
+            float spacing = std::max(glm::length(cellExtent) * 2.0f, 1e-4f);
+            float distance = glm::length(probe.position - pCamera->getPosition()) / spacing;
+            priority += mSettings.proximityWeight / (1.0f + distance);
+
+            BoundingBox cell;
+            cell.center = probe.position;
+            cell.extent = cellExtent;
+            if (!pCamera->isObjectCulled(cell)) priority += mSettings.visibilityWeight;
+        }
+        return priority;
+    }
+
+    const std::vector<uint32_t>& LightFieldProbeUpdateScheduler::schedule(const std::vector<ProbeInfo>& probes, const Camera* pCamera, const float3& cellExtent, uint64_t frameId)
+    {
+        using QueueEntry = std::pair<float, uint32_t>;
+        std::priority_queue<QueueEntry> queue;
+
+        double ageSum = 0.0;
+        for (uint32_t i = 0; i < (uint32_t)probes.size(); ++i)
+        {
+            const ProbeInfo& probe = probes[i];
+            ageSum += double(frameId - std::min(frameId, probe.lastUpdateFrame));
+            if (probe.needsUpdate || probe.updateEveryFrame)
+            {
+                queue.push({ computePriority(probe, pCamera, cellExtent, frameId), i });
+            }
+        }
+
+        // Predict how many probes fit into the budget. Without measurements yet, fall back to the minimum.
+        uint32_t maxCount = mSettings.minProbesPerFrame;
+        if (mCpuTimeValid || mGpuTimeValid)
+        {
+            float cpuCount = (mCpuTimeValid && mStats.cpuTimePerProbe > 0.0f) ? mSettings.cpuBudgetMs / mStats.cpuTimePerProbe : float(mSettings.maxProbesPerFrame);
+            float gpuCount = (mGpuTimeValid && mStats.gpuTimePerProbe > 0.0f) ? mSettings.gpuBudgetMs / mStats.gpuTimePerProbe : float(mSettings.maxProbesPerFrame);
+            maxCount = (uint32_t)std::floor(std::min(cpuCount, gpuCount));
+        }
+        maxCount = glm::clamp(maxCount, mSettings.minProbesPerFrame, std::max(mSettings.minProbesPerFrame, mSettings.maxProbesPerFrame));
+
+        mSelectedProbes.clear();
+        while (!queue.empty() && mSelectedProbes.size() < maxCount)
+        {
+            mSelectedProbes.push_back(queue.top().second);
+            queue.pop();
+        }
+
+        mStats.probesUpdated = (uint32_t)mSelectedProbes.size();
+        mStats.backlog = (uint32_t)queue.size();
+        mStats.averageAge = probes.empty() ? 0.0f : float(ageSum / probes.size());
+        mStats.totalProbesUpdated += mSelectedProbes.size();
+        return mSelectedProbes;
+    }
+
+    void LightFieldProbeUpdateScheduler::readGpuTimers()
+    {
+        PendingGpuTimer& t = mGpuTimers[mGpuTimerIndex];
+        if (t.probeCount > 0)
+        {
+            updateAverage(mStats.gpuTimePerProbe, mGpuTimeValid, float(t.pTimer->getElapsedTime()) / t.probeCount);
+            t.probeCount = 0;
+        }
+    }
+
+    void LightFieldProbeUpdateScheduler::beginUpdates(RenderContext* pContext)
+    {
+        if (mSelectedProbes.empty()) return;
+
+        // The oldest timer is reused, its result has been available for a few frames
+        readGpuTimers();
+        mGpuTimers[mGpuTimerIndex].pTimer->begin();
+        mCpuStart = CpuTimer::getCurrentTimePoint();
+    }
+
+    void LightFieldProbeUpdateScheduler::endUpdates(RenderContext* pContext)
+    {
+        if (mSelectedProbes.empty()) return;
+
+        const uint32_t count = (uint32_t)mSelectedProbes.size();
+        updateAverage(mStats.cpuTimePerProbe, mCpuTimeValid, CpuTimer::calcDuration(mCpuStart, CpuTimer::getCurrentTimePoint()) / count);
+
+        PendingGpuTimer& t = mGpuTimers[mGpuTimerIndex];
+        t.pTimer->end();
+        t.probeCount = count;
+        mGpuTimerIndex = (mGpuTimerIndex + 1) % GpuTimerCount;
+    }
+
+    void LightFieldProbeUpdateScheduler::renderUI(Gui* pGui, const char* group)
+    {
+        if (pGui->beginGroup(group))
+        {
+            pGui->addFloatVar("CPU Budget (ms)", mSettings.cpuBudgetMs, 0.0f, 100.0f);
+            pGui->addFloatVar("GPU Budget (ms)", mSettings.gpuBudgetMs, 0.0f, 100.0f);
+            pGui->addIntVar("Min Probes Per Frame", (int&)mSettings.minProbesPerFrame, 0, 1024);
+            pGui->addIntVar("Max Probes Per Frame", (int&)mSettings.maxProbesPerFrame, 1, 1024);
+
+            if (pGui->beginGroup("Priority Weights"))
+            {
+                pGui->addFloatVar("Staleness", mSettings.stalenessWeight, 0.0f, 100.0f);
+                pGui->addFloatVar("Camera Proximity", mSettings.proximityWeight, 0.0f, 100.0f);
+                pGui->addFloatVar("Frustum Visibility", mSettings.visibilityWeight, 0.0f, 100.0f);
+                pGui->addFloatVar("Update Every Frame", mSettings.updateEveryFrameWeight, 0.0f, 100.0f);
+                pGui->addFloatVar("Never Updated", mSettings.neverUpdatedWeight, 0.0f, 100.0f);
+                pGui->endGroup();
+            }
+
+            std::string stats;
+            stats += "Probes updated: " + std::to_string(mStats.probesUpdated) + "\n";
+            stats += "Backlog: " + std::to_string(mStats.backlog) + "\n";
+            stats += "Average age: " + std::to_string(mStats.averageAge) + " frames\n";
+            stats += "CPU per probe: " + std::to_string(mStats.cpuTimePerProbe) + " ms\n";
+            stats += "GPU per probe: " + std::to_string(mStats.gpuTimePerProbe) + " ms\n";
+            stats += "Total updated: " + std::to_string(mStats.totalProbesUpdated);
+            pGui->addText(stats.c_str());
+
+            pGui->endGroup();
+        }
+    }
+}
@@ -0,0 +1,122 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include "Falcor.h"
+
+namespace Falcor
+{
+    /** Decides which light field probes are re-rendered each frame.
+        Probes that need an update are ranked by staleness, distance to the camera, frustum visibility and whether they
+        are flagged to update every frame. Probes are taken from the top of the queue until the predicted CPU or GPU cost
+        exceeds the per-frame budget. Costs are predicted from a running average of the measured per-probe times.
+    */
+    class LightFieldProbeUpdateScheduler
+    {
+    public:
+        using SharedPtr = std::shared_ptr<LightFieldProbeUpdateScheduler>;
+
+        struct Settings
+        {
+            float cpuBudgetMs = 2.0f;
+            float gpuBudgetMs = 2.0f;
+            uint32_t minProbesPerFrame = 1;     ///< Guarantees progress even if a single probe exceeds the budget
+            uint32_t maxProbesPerFrame = 64;
+
+            // Priority weights
+            float stalenessWeight = 1.0f;       ///< Per 100 frames since the last update
+            float proximityWeight = 2.0f;       ///< 1 at the camera, falls off with distance in units of probe spacing
+            float visibilityWeight = 1.0f;      ///< Probes whose cell intersects the view frustum
+            float updateEveryFrameWeight = 4.0f;
+            float neverUpdatedWeight = 8.0f;    ///< Probes with no valid data at all
+        };
+
+        /** Per-probe input to the scheduler
+        */
+        struct ProbeInfo
+        {
+            float3 position;
+            uint64_t lastUpdateFrame = 0;
+            bool needsUpdate = false;
+            bool hasValidData = false;
+            bool updateEveryFrame = false;
+        };
+
+        struct Stats
+        {
+            uint32_t probesUpdated = 0;         ///< Last frame
+            uint32_t backlog = 0;               ///< Probes still waiting after the last frame
+            float averageAge = 0.0f;            ///< Average number of frames since each probe was last updated
+            float cpuTimePerProbe = 0.0f;       ///< Running average, in ms
+            float gpuTimePerProbe = 0.0f;       ///< Running average, in ms
+            uint64_t totalProbesUpdated = 0;
+        };
+
+        static SharedPtr create(const Settings& settings = Settings());
+
+        /** Select the probes to update this frame, highest priority first.
+            \param[in] probes All probes of the volume
+            \param[in] pCamera Camera used for the proximity and visibility terms, may be null
+            \param[in] cellExtent Half size of a probe cell
+            \param[in] frameId Current frame index
+        */
+        const std::vector<uint32_t>& schedule(const std::vector<ProbeInfo>& probes, const Camera* pCamera, const float3& cellExtent, uint64_t frameId);
+
+        /** Bracket the rendering of the probes returned by schedule(), used to measure the per-probe costs
+        */
+        void beginUpdates(RenderContext* pContext);
+        void endUpdates(RenderContext* pContext);
+
+        const Stats& getStats() const { return mStats; }
+        const Settings& getSettings() const { return mSettings; }
+        void setSettings(const Settings& settings) { mSettings = settings; }
+
+        void renderUI(Gui* pGui, const char* group = nullptr);
+
+    private:
+        LightFieldProbeUpdateScheduler(const Settings& settings);
+
+        float computePriority(const ProbeInfo& probe, const Camera* pCamera, const float3& cellExtent, uint64_t frameId) const;
+        void readGpuTimers();
+
+        Settings mSettings;
+        Stats mStats;
+        std::vector<uint32_t> mSelectedProbes;
+
+        // GPU timestamps are read back a few frames later to avoid stalling
+        enum { GpuTimerCount = 4 };
+        struct PendingGpuTimer
+        {
+            GpuTimer::SharedPtr pTimer;
+            uint32_t probeCount = 0;
+        } mGpuTimers[GpuTimerCount];
+        uint32_t mGpuTimerIndex = 0;
+        bool mCpuTimeValid = false;
+        bool mGpuTimeValid = false;
+        CpuTimer::TimePoint mCpuStart;
+    };
+}
@@ -38,6 +38,23 @@ namespace Falcor
         { LightFieldDebugDisplay::ProbeColor, "Probe Color" }
     };
 
+    const Gui::DropdownList LightFieldProbeVolume::sIrradianceEncodingList =
+    {
+        { (uint32_t)IrradianceEncoding::Octahedral, "Octahedral Map" },
+        { (uint32_t)IrradianceEncoding::SHL1, "SH L1" },
+        { (uint32_t)IrradianceEncoding::SHL2, "SH L2" }
+    };
+
+    namespace
+    {
+        // Reading back and rewriting the whole volume is expensive, an animated instance would trigger it every frame
+        const uint32_t kPersistQuietFrames = 60;
+
+        // Shadow map of a single probe face. The cached one fitted to the whole volume grows with it, up to the max size.
+        const uint32_t kFaceShadowMapSize = 512;
+        const uint32_t kMaxCachedShadowMapSize = 4096;
+    }
+
     class ProbesRenderer : public SceneRenderer
     {
     public:
@@ -58,10 +75,33 @@ namespace Falcor
     LightFieldProbeVolume::LightFieldProbeVolume()
     {
         mpRaster = GBufferRaster::create(RasterizerState::CullMode::None);
-        mpShading = LightFieldProbeShading::create();
+        mpShading = LightFieldProbeShading::create(true);
         mpOctMapping = OctahedralMapping::create();
         mpFiltering = LightFieldProbeFiltering::create();
+        mpSHProjection = LightFieldProbeSHProjection::create();
         mpDownscalePass = DownscalePass::create();
+        mpScheduler = LightFieldProbeUpdateScheduler::create();
+        mpConvergence = LightFieldProbeConvergence::create();
+        mpStatistics = LightFieldProbeStatistics::create();
+
+        const glm::vec3 upVec[GBufferRaster::kCubeFaceCount] = {
+            glm::vec3(0, 1, 0),
+            glm::vec3(0, 1, 0),
+            glm::vec3(0, 0, 1),
+            glm::vec3(0, 0, -1),
+            glm::vec3(0, 1, 0),
+            glm::vec3(0, 1, 0),
+        };
+        for (uint32_t i = 0; i < GBufferRaster::kCubeFaceCount; ++i)
+        {
+            mFaceCameras[i] = Camera::create();
+            mFaceCameras[i]->setUpVector(upVec[i]);
+            mFaceCameras[i]->setAspectRatio(1.0);
+            mFaceCameras[i]->setDepthRange(0.01f, 10);
+            mFaceCameras[i]->setFocalLength(fovYToFocalLength((float)M_PI_2, Camera::kDefaultFrameHeight));
+        }
+        mpClassifier = LightFieldProbeClassifier::create();
+        mpChangeTracker = SceneChangeTracker::create();
 
         loadDebugResources();
 
@@ -110,13 +150,15 @@ namespace Falcor
         }
         else if (mDebugger.debugDisplayMode == Radiance)
         {
-            mDebugger.pProgVars->setTexture("gColorTex", mpRadianceFbo->getColorTexture(0));
+            mDebugger.pProgVars->setTexture("gColorTex", getRadianceTexture());
         }
         else if (mDebugger.debugDisplayMode == Irradiance)
         {
-            mDebugger.pProgVars->setTexture("gColorTex", mpFilteredFbo->getColorTexture(0));
+            mDebugger.pProgVars->setTexture("gColorTex", getIrradianceTexture());
+            mDebugger.pProgVars->setTypedBuffer("gIrradianceSH", mpIrradianceSH);
         }
         mDebugger.pProgVars["PerInstanceData"]["gProbeCounts"] = mProbesCount;
+        mDebugger.pProgVars["PerInstanceData"]["gIrradianceSHCoeffCount"] = (mDebugger.debugDisplayMode == Irradiance) ? (int)mIrradianceSHCoeffCount : 0;
 
         mDebugger.pPipelineState->setProgram(mDebugger.pProgram);
         mDebugger.pPipelineState->setFbo(pTargetFbo);
@@ -139,18 +181,111 @@ namespace Falcor
 
     void LightFieldProbeVolume::setScene(const Scene::SharedPtr& pScene)
     {
+        // Brick allocation looks at the scene geometry, set the scene first
+        mpScene = pScene;
+        mpSceneBvh = nullptr;
+        mpChangeTracker->reset(pScene.get());
+
         mSceneBounds = pScene->getBoundingBox();
         onSceneBoundsChanged();
 
-        mpScene = pScene;
         mpRaster->setScene(pScene);
         mpShading->setScene(pScene);
 
         if (!mpShadowPass)
         {
-            mpShadowPass = CascadedShadowMaps::create(pScene->getLight(0), 512, 512, CubemapResolution, CubemapResolution, pScene);
+            mpShadowPass = CascadedShadowMaps::create(pScene->getLight(0), mShadowMapSize, mShadowMapSize, mActiveResolutions.cubemap, mActiveResolutions.cubemap, pScene);
             mpShadowPass->setFilterMode(CsmFilterPoint);
             mpShadowPass->toggleMinMaxSdsm(false);
+            // Every face camera shares the fitted shadow map, splitting it into cascades doesn't buy anything
+            mpShadowPass->setCascadeCount(1);
+        }
+        else
+        {
+            mpShadowPass->setLight(pScene->getLight(0));
+            mpShadowPass->setScene(pScene);
+            mpShadowPass->invalidateCachedShadowMap();
+        }
+
+        mCacheLoadPending = mUseProbeCache;
+    }
+
+    void LightFieldProbeVolume::setResolutions(const LightFieldProbeMemoryPlanner::Resolutions& resolutions)
+    {
+        mResolutions = LightFieldProbeMemoryPlanner::validate(resolutions);
+        onProbesCountChanged();
+    }
+
+    void LightFieldProbeVolume::setMemoryBudget(uint64_t budgetBytes)
+    {
+        mMemoryBudget = budgetBytes;
+        onProbesCountChanged();
+    }
+
+    void LightFieldProbeVolume::setIrradianceEncoding(IrradianceEncoding encoding)
+    {
+        mIrradianceEncoding = encoding;
+        onProbesCountChanged();
+    }
+
+    void LightFieldProbeVolume::renderMemoryUI(Gui* pGui)
+    {
+        using Planner = LightFieldProbeMemoryPlanner;
+
+        if (pGui->beginGroup("Resolutions And Memory"))
+        {
+            bool changed = false;
+            changed |= pGui->addIntVar("Cubemap Resolution", (int&)mResolutions.cubemap, Planner::MinOctahedralResolution, Planner::MaxOctahedralResolution);
+            changed |= pGui->addIntVar("Octahedral Resolution", (int&)mResolutions.octahedral, Planner::MinOctahedralResolution, Planner::MaxOctahedralResolution);
+            changed |= pGui->addIntVar("Low-Res Resolution", (int&)mResolutions.lowRes, Planner::MinLowResResolution, Planner::MaxOctahedralResolution);
+            changed |= pGui->addIntVar("Filtered Resolution", (int&)mResolutions.filtered, Planner::MinFilteredResolution, Planner::MaxFilteredResolution);
+
+            float budgetMB = float(mMemoryBudget / (1024.0 * 1024.0));
+            if (pGui->addFloatVar("Memory Budget (MB, 0 = none)", budgetMB, 0.0f, 65536.0f))
+            {
+                mMemoryBudget = uint64_t(double(budgetMB) * 1024.0 * 1024.0);
+                changed = true;
+            }
+
+            if (changed)
+            {
+                setResolutions(mResolutions);
+            }
+
+            if (pGui->addDropdown("Irradiance Encoding", sIrradianceEncodingList, (uint32_t&)mIrradianceEncoding))
+            {
+                setIrradianceEncoding(mIrradianceEncoding);
+            }
+
+            const Planner::Footprint footprint = Planner::computeFootprint(mActiveResolutions, mProbeSliceCount, mIrradianceSHCoeffCount, isAtlasCompressed());
+            std::string text;
+            text += "Active: cubemap " + std::to_string(mActiveResolutions.cubemap) + ", octahedral " + std::to_string(mActiveResolutions.octahedral) +
+                    ", low-res " + std::to_string(mActiveResolutions.lowRes) + ", filtered " + std::to_string(mActiveResolutions.filtered) + "\n";
+            for (uint32_t i = 0; i < (uint32_t)Planner::Atlas::Count; ++i)
+            {
+                text += std::string(Planner::getAtlasName(Planner::Atlas(i))) + ": " + Planner::formatBytes(footprint.atlasBytes[i]);
+                if (Planner::Atlas(i) == Planner::Atlas::Irradiance && mIrradianceSHCoeffCount > 0)
+                {
+                    text += " (" + std::to_string(mIrradianceSHCoeffCount) + " SH coefficients)";
+                }
+                text += "\n";
+            }
+            text += "Atlases total: " + Planner::formatBytes(footprint.getTotal()) + " for " + std::to_string(mProbeSliceCount) + " slices\n";
+
+            uint64_t scratchBytes = Planner::getTextureBytes(mpTempGBufferFbo->getDepthStencilTexture().get()) + Planner::getTextureBytes(mpFaceDepthTexture.get());
+            for (uint32_t i = 0; i < Fbo::getMaxColorTargetCount(); ++i)
+            {
+                scratchBytes += Planner::getTextureBytes(mpTempGBufferFbo->getColorTexture(i).get());
+                scratchBytes += Planner::getTextureBytes(mpTempLightFieldFbo->getColorTexture(i).get());
+            }
+            text += "Scratch targets: " + Planner::formatBytes(scratchBytes);
+            if (!mMemoryBudgetMet)
+            {
+                text += "\nBudget can't be met at the lowest resolutions";
+            }
+            pGui->addText(text.c_str());
+
+            pGui->endGroup();
         }
     }
 
@@ -163,12 +298,101 @@ namespace Falcor
                 onProbesCountChanged();
             }
 
+            if (pGui->addButton("Bake All Probes On CPU", true))
+            {
+                mBakeOnCpuRequested = true;
+            }
+            if (pGui->addCheckBox("Relocate Probes", mRelocateProbes))
+            {
+                if (mRelocateProbes)
+                {
+                    mClassifyPending = true;
+                }
+                else
+                {
+                    for (auto& p : mProbes)
+                    {
+                        p.mOffset = float3(0.0f);
+                        p.mActive = true;
+                    }
+                    updateProbeOffsets();
+                    setProbesNeedToUpdate();
+                }
+            }
+            if (mRelocateProbes)
+            {
+                if (pGui->addButton("Classify Probes", true))
+                {
+                    mClassifyPending = true;
+                }
+                if (mpClassifier->renderUI(pGui, "Probe Classification"))
+                {
+                    mClassifyPending = true;
+                }
+                size_t activeCount = std::count_if(mProbes.cbegin(), mProbes.cend(), [](const LightFieldProbe& p) { return p.mActive; });
+                pGui->addText(("Active probes: " + std::to_string(activeCount) + " / " + std::to_string(mProbes.size())).c_str());
+            }
+
+            pGui->addCheckBox("Track Scene Changes", mTrackSceneChanges);
+            if (mTrackSceneChanges)
+            {
+                pGui->addFloatVar("Invalidation Radius (steps)", mInvalidationRadius, 0.0f, 16.0f);
+                pGui->addText(("Probes invalidated by the last change: " + std::to_string(mLastInvalidatedCount)).c_str());
+            }
+            mpConvergence->renderUI(pGui, "Convergence");
+            if (pGui->beginGroup("Probe Statistics"))
+            {
+                mpStatistics->renderUI(pGui);
+                std::string filename;
+                if (pGui->addButton("Export CSV") && saveFileDialog({ { "csv", "CSV Files" } }, filename))
+                {
+                    exportStatistics(filename);
+                }
+                if (pGui->addButton("Export JSON", true) && saveFileDialog({ { "json", "JSON Files" } }, filename))
+                {
+                    exportStatistics(filename);
+                }
+                pGui->endGroup();
+            }
+
+            pGui->addCheckBox("Cache Probe Shadow Map", mCacheShadowMap);
+            if (mCacheShadowMap)
+            {
+                pGui->addIntVar("Shadow Texels Per Probe Step", (int&)mShadowTexelsPerProbeStep, 1, 256);
+            }
+            if (mpShadowPass && mpShadowPass->isShadowMapCached())
+            {
+                pGui->addText(("Shadow map size: " + std::to_string(mShadowMapSize)).c_str());
+                pGui->addText(("Shadow map renders: " + std::to_string(mpShadowPass->getCachedShadowMapRenderCount())).c_str());
+            }
+
+            pGui->addCheckBox("Use Probe Cache", mUseProbeCache);
+            if (mUseProbeCache && pGui->addButton("Save Probe Cache", true))
+            {
+                mPersistRequested = true;
+            }
+            pGui->addCheckBox("Cache High-Res Atlases", mCacheHighResAtlases, true);
+            if (pGui->addCheckBox("Compress Static Atlases", mCompressAtlases))
+            {
+                mCompressionTogglePending = true;
+            }
+            if (isAtlasCompressed())
+            {
+                pGui->addText("Radiance and normal atlases are BC6H/BC5 compressed");
+            }
+
+            if (mpCpuBaker && mpCpuBaker->getLastRayCount() > 0)
+            {
+                pGui->addText(("Last CPU bake: " + std::to_string(mpCpuBaker->getLastBakeTime()) + " ms, " + std::to_string(mpCpuBaker->getLastRayCount()) + " rays").c_str());
+            }
+            renderTraceBenchmarkUI(pGui);
+
             if (pGui->addCheckBox("Visualize All Probes", mVisualizeProbes))
             {
                 for (auto& p: mProbes)
                 {
                     p.mVisible = mVisualizeProbes;
-                    mDebugger.pScene->getModelInstance(0, p.mProbeIdx)->setVisible(p.mVisible);
+                    mDebugger.pScene->getModelInstance(0, p.mSliceIdx)->setVisible(p.mVisible);
                 }
             }
 
@@ -184,35 +408,44 @@ namespace Falcor
                 }
             }
 
-            if (pGui->addInt3Var("Probes Count", mProbesCount, 1, 1024))
+            pGui->addInt3Var("Probes Count", mProbesCount, 1, 1024);
+            if (pGui->addCheckBox("Sparse Volume", mSparseVolume))
             {
-                mProbesCount.x = getNextPowerOf2(mProbesCount.x);
-                mProbesCount.y = getNextPowerOf2(mProbesCount.y);
-                mProbesCount.z = getNextPowerOf2(mProbesCount.z);
+                onProbesCountChanged();
             }
+            pGui->addText(("Allocated bricks: " + std::to_string(mProbeSliceCount / (BrickSize * BrickSize * BrickSize)) + " / " + std::to_string(mBrickTable.size()) +
+                           ", probes: " + std::to_string(mProbes.size())).c_str());
+            renderMemoryUI(pGui);
 
             if (pGui->addFloatSlider("Probe Size", mProbeSize, 0.01f, 1.0f))
             {
                 float scaling = mProbeSize*0.5f/mDebugger.pScene->getModel(0)->getRadius();
                 for (const auto& p : mProbes)    
                 {
-                    mDebugger.pScene->getModelInstance(0, p.mProbeIdx)->setScaling(float3(scaling));
+                    mDebugger.pScene->getModelInstance(0, p.mSliceIdx)->setScaling(float3(scaling));
                 }
             }
 
+            mpScheduler->renderUI(pGui, "Update Scheduler");
+
             if (pGui->beginGroup("Light Field Probes"))
             {
-                for (auto& p : mProbes)
+                for (uint32_t i = 0; i < (uint32_t)mProbes.size(); ++i)
                 {
+                    LightFieldProbe& p = mProbes[i];
                     if (pGui->beginGroup(std::string("Probe Index ") + std::to_string(p.mProbeIdx), true))
                     {
                         float3 tmpPos = p.mProbePosition;
                         pGui->addFloat3Var("Position", tmpPos);
+                        float3 tmpOffset = p.mOffset;
+                        pGui->addFloat3Var("Offset", tmpOffset);
+                        pGui->addText(p.mActive ? "Active" : "Inactive (inside geometry)");
                         if (pGui->addCheckBox("Visible", p.mVisible))
                         {
-                            mDebugger.pScene->getModelInstance(0, p.mProbeIdx)->setVisible(p.mVisible);
+                            mDebugger.pScene->getModelInstance(0, p.mSliceIdx)->setVisible(p.mVisible);
                         }
                         pGui->addCheckBox("Update Every Frame", p.mUpdateEveryFrame);
+                        pGui->addText((std::string(mpConvergence->isConverged(i) ? "Converged" : "Converging") + ", last change " + std::to_string(mpConvergence->getDelta(i))).c_str());
                         pGui->endGroup();
                     }
                 }
@@ -224,11 +457,37 @@ namespace Falcor
         }
     }
 
+    void LightFieldProbeVolume::renderTraceBenchmarkUI(Gui* pGui)
+    {
+        if (pGui->beginGroup("CPU Trace Benchmark"))
+        {
+            int rayCount = (int)mTraceBenchmarkSettings.rayCount;
+            if (pGui->addIntVar("Ray Count", rayCount, 1, 1 << 24))
+            {
+                mTraceBenchmarkSettings.rayCount = (uint32_t)rayCount;
+            }
+            pGui->addCheckBox("SIMD High-Res March", mTraceBenchmarkSimd);
+            pGui->addCheckBox("Fill Holes", mTraceBenchmarkSettings.fillHoles);
+            pGui->addCheckBox("Compare With BVH", mTraceBenchmarkSettings.compareWithBvh);
+            pGui->addFloatVar("Hit Tolerance", mTraceBenchmarkSettings.hitTolerance, 0.0f, 1.0f);
+            if (pGui->addButton("Run"))
+            {
+                mTraceBenchmarkRequested = true;
+            }
+            if (mTraceBenchmarkReport.rayCount > 0)
+            {
+                pGui->addText(mTraceBenchmarkReport.toString().c_str());
+            }
+            pGui->endGroup();
+        }
+    }
+
     void LightFieldProbeVolume::onProbesCountChanged()
     {
-        createFBOs();
         updateProbesAllocation();
         setProbesNeedToUpdate();
+
+        mCacheLoadPending = mUseProbeCache && mpScene;
     }
 
     void LightFieldProbeVolume::onSceneBoundsChanged()
@@ -237,67 +496,437 @@ namespace Falcor
         setProbesNeedToUpdate();
     }
 
+    void LightFieldProbeVolume::markAllProbesUpdated()
+    {
+        for (auto& p : mProbes)
+        {
+            p.mUpdated = true;
+            p.mHasValidData = true;
+            p.mLastUpdateFrame = mFrameCount;
+        }
+        if (mScrolling)
+        {
+            updateProbeOffsets();
+        }
+        // Callers either loaded the probes from the cache or persist them themselves
+        mFullBakePending = false;
+        mPersistPending = false;
+    }
+
     void LightFieldProbeVolume::setProbesNeedToUpdate()
     {
         for (auto& p : mProbes)
         {
             p.mUpdated = false;
         }
+        mpConvergence->reactivateAll();
+        mFullBakePending = true;
+    }
+
+    std::string LightFieldProbeVolume::getProbeCacheFilename() const
+    {
+        // The content of a scrolling volume depends on where the camera was
+        if (!mpScene || mScrolling) return "";
+
+        std::string sceneFile = mpScene->getFilename();
+        if (sceneFile.empty() && mpScene->getModelCount() > 0)
+        {
+            sceneFile = mpScene->getModel(0)->getFilename();
+        }
+        if (sceneFile.empty()) return "";
+
+        std::string fullPath;
+        if (!findFileInDataDirectories(sceneFile, fullPath))
+        {
+            fullPath = sceneFile;
+        }
+        return fullPath + ".probecache";
+    }
+
+    LightFieldProbeCache::GridDesc LightFieldProbeVolume::getGridDesc() const
+    {
+        LightFieldProbeCache::GridDesc grid;
+        grid.probesCount = mProbesCount;
+        grid.probeStep = mProbeStep;
+        grid.probeStartPosition = mProbeStartPosition;
+        grid.octResolution = mActiveResolutions.octahedral;
+        grid.lowResResolution = mActiveResolutions.lowRes;
+        grid.filteredResolution = mActiveResolutions.filtered;
+        grid.probeSliceCount = mProbeSliceCount;
+        grid.shCoeffCount = mIrradianceSHCoeffCount;
+        grid.brickTable = mBrickTable;
+        if (mRelocateProbes)
+        {
+            grid.probeOffsets.resize(mProbeSliceCount);
+            for (const auto& p : mProbes)
+            {
+                grid.probeOffsets[p.mSliceIdx] = float4(p.mOffset, p.mActive ? 1.0f : 0.0f);
+            }
+        }
+        return grid;
+    }
+
+    bool LightFieldProbeVolume::loadProbeCache(RenderContext* pContext)
+    {
+        const std::string filename = getProbeCacheFilename();
+        if (filename.empty()) return false;
+
+        const uint64_t hash = LightFieldProbeCache::computeSceneHash(mpScene.get(), mSceneBounds, getGridDesc());
+        LightFieldProbeCache::SharedPtr pCache = LightFieldProbeCache::load(filename, hash);
+        if (!pCache) return false;
+
+        // A compressed cache is uploaded as is, the render targets are only needed once a probe gets rendered again
+        if (pCache->hasCompressedHighRes())
+        {
+            createCompressedAtlases();
+        }
+        else
+        {
+            decompressAtlases(pContext, false);
+        }
+
+        if (!pCache->upload(pContext, getRadianceTexture(), getNormalTexture(), getDistanceTexture(),
+                            getLowResDistanceTexture(), getIrradianceTexture(), getDistanceMomentsTexture(), mpIrradianceSH))
+        {
+            return false;
+        }
+
+        // The ray trace marches the high-res atlases. Without them the filtered data only serves the shading until every probe is rendered again.
+        if (pCache->hasHighRes())
+        {
+            markAllProbesUpdated();
+            logInfo("Loaded light field probes from '" + filename + "'");
+        }
+        else
+        {
+            // The high-res atlases hold whatever was rendered before, there is no history to blend with
+            for (auto& p : mProbes)
+            {
+                p.mHasValidData = false;
+            }
+            setProbesNeedToUpdate();
+            logInfo("Loaded filtered light field probe data from '" + filename + "', the probes will be rendered again");
+        }
+        return true;
+    }
+
+    void LightFieldProbeVolume::writeProbeCache(const LightFieldProbeAtlas& atlas)
+    {
+        const std::string filename = getProbeCacheFilename();
+        if (filename.empty()) return;
+
+        const LightFieldProbeCache::GridDesc grid = getGridDesc();
+        const uint64_t hash = LightFieldProbeCache::computeSceneHash(mpScene.get(), mSceneBounds, grid);
+        if (LightFieldProbeCache::write(filename, hash, grid, atlas, mCacheHighResAtlases))
+        {
+            logInfo("Wrote light field probe cache '" + filename + "'");
+        }
+    }
+
+    bool LightFieldProbeVolume::areProbesStatic() const
+    {
+        return std::all_of(mProbes.cbegin(), mProbes.cend(), [](const LightFieldProbe& p) { return !p.mActive || (p.mUpdated && !p.mUpdateEveryFrame); });
+    }
+
+    void LightFieldProbeVolume::persistProbes(RenderContext* pContext, LightFieldProbeAtlas* pAtlas)
+    {
+        if (!mUseProbeCache && !mCompressAtlases) return;
+
+        // Probes rendered on the GPU need to be read back first
+        LightFieldProbeAtlas readbackAtlas;
+        if (pAtlas == nullptr)
+        {
+            readbackAtlas.download(pContext, getRadianceTexture(), getNormalTexture(), getDistanceTexture(),
+                                   getLowResDistanceTexture(), getIrradianceTexture(), getDistanceMomentsTexture(), mpIrradianceSH);
+            pAtlas = &readbackAtlas;
+        }
+
+        // Scrolling volumes keep re-rendering probes, every scroll step would have to decompress the atlases again
+        if (mCompressAtlases && !mScrolling)
+        {
+            compressAtlases(pContext, *pAtlas);
+        }
+
+        if (mUseProbeCache)
+        {
+            writeProbeCache(*pAtlas);
+        }
+    }
+
+    void LightFieldProbeVolume::compressAtlases(RenderContext* pContext, LightFieldProbeAtlas& atlas)
+    {
+        if (!atlas.isCompressed())
+        {
+            CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+            atlas.compress();
+            const double time = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+            logInfo("LightFieldProbeVolume: compressed " + std::to_string(atlas.probeCount) + " probe atlases in " + std::to_string(time) + " ms");
+        }
+
+        createCompressedAtlases();
+        LightFieldProbeAtlas::uploadSlices(pContext, mpCompressedRadianceTex, atlas.octResolution, atlas.probeCount, atlas.radianceBC6H.data());
+        LightFieldProbeAtlas::uploadSlices(pContext, mpCompressedNormalTex, atlas.octResolution, atlas.probeCount, atlas.normalBC5.data());
+    }
+
+    void LightFieldProbeVolume::createCompressedAtlases()
+    {
+        using Atlas = LightFieldProbeMemoryPlanner::Atlas;
+        const uint32_t res = mActiveResolutions.octahedral;
+        if (!isAtlasCompressed())
+        {
+            mpCompressedRadianceTex = Texture::create2D(res, res, LightFieldProbeMemoryPlanner::getCompressedAtlasFormat(Atlas::Radiance), mProbeSliceCount, 1, nullptr, Resource::BindFlags::ShaderResource);
+            mpCompressedNormalTex = Texture::create2D(res, res, LightFieldProbeMemoryPlanner::getCompressedAtlasFormat(Atlas::Normal), mProbeSliceCount, 1, nullptr, Resource::BindFlags::ShaderResource);
+        }
+
+        // The compressed atlases replace the render targets, that's where the memory saving comes from
+        mpRadianceFbo = nullptr;
+        mpNormalFbo = nullptr;
+    }
+
+    void LightFieldProbeVolume::decompressAtlases(RenderContext* pContext, bool preserveContent)
+    {
+        if (!isAtlasCompressed()) return;
+
+        // Reads the whole volume back. This only happens when probes of a compressed volume have to be rendered again.
+        LightFieldProbeAtlas atlas;
+        if (preserveContent)
+        {
+            atlas.download(pContext, getRadianceTexture(), getNormalTexture(), getDistanceTexture(),
+                           getLowResDistanceTexture(), getIrradianceTexture(), getDistanceMomentsTexture(), mpIrradianceSH);
+        }
+
+        mpCompressedRadianceTex = nullptr;
+        mpCompressedNormalTex = nullptr;
+        createRadianceNormalFbos();
+
+        if (preserveContent)
+        {
+            LightFieldProbeAtlas::uploadSlices(pContext, getRadianceTexture(), atlas.octResolution, atlas.probeCount, atlas.radiance.data());
+            LightFieldProbeAtlas::uploadSlices(pContext, getNormalTexture(), atlas.octResolution, atlas.probeCount, atlas.normal.data());
+        }
+    }
+
+    void LightFieldProbeVolume::createRadianceNormalFbos()
+    {
+        using Atlas = LightFieldProbeMemoryPlanner::Atlas;
+        const uint32_t res = mActiveResolutions.octahedral;
+        Fbo::Desc fboDesc;
+        fboDesc.setColorTarget(0, LightFieldProbeMemoryPlanner::getAtlasFormat(Atlas::Radiance));
+        mpRadianceFbo = FboHelper::create2D(res, res, fboDesc, mProbeSliceCount);
+        fboDesc.setColorTarget(0, LightFieldProbeMemoryPlanner::getAtlasFormat(Atlas::Normal));
+        mpNormalFbo = FboHelper::create2D(res, res, fboDesc, mProbeSliceCount);
     }
 
     void LightFieldProbeVolume::createFBOs()
     {
-        uint32_t numProbes = mProbesCount.x*mProbesCount.y*mProbesCount.z;
+        using Atlas = LightFieldProbeMemoryPlanner::Atlas;
+        const LightFieldProbeMemoryPlanner::Resolutions& res = mActiveResolutions;
+
+        uint32_t numProbes = mProbeSliceCount;
+        mpCompressedRadianceTex = nullptr;
+        mpCompressedNormalTex = nullptr;
+        createRadianceNormalFbos();
         Fbo::Desc fboDesc;
-        fboDesc.setColorTarget(0, ResourceFormat::R11G11B10Float);
-        mpRadianceFbo = FboHelper::create2D(OctahedralResolution, OctahedralResolution, fboDesc, numProbes);
-        fboDesc.setColorTarget(0, ResourceFormat::RGBA8Unorm);
-        mpNormalFbo = FboHelper::create2D(OctahedralResolution, OctahedralResolution, fboDesc, numProbes);
-        fboDesc.setColorTarget(0, ResourceFormat::R16Float);
-        mpDistanceFbo = FboHelper::create2D(OctahedralResolution, OctahedralResolution, fboDesc, numProbes);
-        mpLowResDistanceFbo = FboHelper::create2D(OctahedralResolutionLowRes, OctahedralResolutionLowRes, fboDesc, numProbes);
+        fboDesc.setColorTarget(0, LightFieldProbeMemoryPlanner::getAtlasFormat(Atlas::Distance));
+        mpDistanceFbo = FboHelper::create2D(res.octahedral, res.octahedral, fboDesc, numProbes);
+        fboDesc.setColorTarget(0, LightFieldProbeMemoryPlanner::getAtlasFormat(Atlas::LowResDistance));
+        mpLowResDistanceFbo = FboHelper::create2D(res.lowRes, res.lowRes, fboDesc, numProbes);
 
+        // With spherical harmonics the irradiance lives in a buffer and the filtered atlas only holds the distance moments
+        mIrradianceSHCoeffCount = LightFieldProbeSH::getCoeffCount(mIrradianceEncoding);
         Fbo::Desc filterredFboDesc;
-        filterredFboDesc.setColorTarget(0, ResourceFormat::R11G11B10Float);
-        filterredFboDesc.setColorTarget(1, ResourceFormat::RG16Float);
-        mpFilteredFbo = FboHelper::create2D(FilteredFboResolution, FilteredFboResolution, filterredFboDesc, numProbes);
+        if (mIrradianceSHCoeffCount > 0)
+        {
+            filterredFboDesc.setColorTarget(0, LightFieldProbeMemoryPlanner::getAtlasFormat(Atlas::DistanceMoments));
+            mpIrradianceSH = TypedBuffer<float4>::create(numProbes * mIrradianceSHCoeffCount);
+        }
+        else
+        {
+            filterredFboDesc.setColorTarget(0, LightFieldProbeMemoryPlanner::getAtlasFormat(Atlas::Irradiance));
+            filterredFboDesc.setColorTarget(1, LightFieldProbeMemoryPlanner::getAtlasFormat(Atlas::DistanceMoments));
+            mpIrradianceSH = nullptr;
+        }
+        mpFilteredFbo = FboHelper::create2D(res.filtered, res.filtered, filterredFboDesc, numProbes);
+        mpFiltering->setDistanceOnly(mIrradianceSHCoeffCount > 0);
 
-        mpTempGBufferFbo = GBufferRaster::createGBufferFbo(CubemapResolution, CubemapResolution, true);;
+        mpTempGBufferFbo = GBufferRaster::createGBufferFbo(res.cubemap, res.cubemap, true, GBufferRaster::kCubeFaceCount);
+        mpFaceDepthTexture = Texture::create2D(res.cubemap, res.cubemap, mpTempGBufferFbo->getDepthStencilTexture()->getFormat(), 1, 1, nullptr,
+                                               Resource::BindFlags::ShaderResource | Resource::BindFlags::DepthStencil);
         Fbo::Desc lfFboDesc;
         lfFboDesc.setColorTarget(0, ResourceFormat::RGBA16Float);
         lfFboDesc.setColorTarget(1, ResourceFormat::RGBA16Float);
         lfFboDesc.setColorTarget(2, ResourceFormat::R32Float);
-        mpTempLightFieldFbo = FboHelper::createCubemap(CubemapResolution, CubemapResolution, lfFboDesc);
+        mpTempLightFieldFbo = FboHelper::createCubemap(res.cubemap, res.cubemap, lfFboDesc);
+        for (uint32_t i = 0; i < GBufferRaster::kCubeFaceCount; ++i)
+        {
+            mpFaceLightFieldFbos[i] = Fbo::create();
+            for (uint32_t rt = 0; rt < 3; ++rt)
+            {
+                mpFaceLightFieldFbos[i]->attachColorTarget(mpTempLightFieldFbo->getColorTexture(rt), rt, 0, i);
+            }
+        }
+
+        if (mpShadowPass)
+        {
+            mpShadowPass->onResize(res.cubemap, res.cubemap);
+        }
+    }
+
+    std::vector<bool> LightFieldProbeVolume::computeOccupiedBricks() const
+    {
+        const uint32_t brickCount = mBrickCounts.x * mBrickCounts.y * mBrickCounts.z;
+        // Bricks of a scrolling volume cover different cells as it moves, they all stay allocated
+        if (!mSparseVolume || mScrolling || !mpScene)
+        {
+            return std::vector<bool>(brickCount, true);
+        }
+
+        // A probe is needed if it is within one grid step of geometry, otherwise it can't be part of the
+        // trilinear cage of any shaded point. Mesh instance bounds are conservative, which is what we want here.
+        std::vector<bool> occupied(brickCount, false);
+        auto markBounds = [&](const BoundingBox& bounds)
+        {
+            // Test against the grid before clamping, otherwise bounds outside the grid collapse onto the edge probes.
+            // The range stays in floats until then, so far away bounds can't overflow the int conversion.
+            const float3 gridMax = float3(mProbesCount - 1);
+            const float3 firstPos = glm::ceil((bounds.getMinPos() - mProbeStartPosition) / mProbeStep - 1.0f);
+            const float3 lastPos = glm::floor((bounds.getMaxPos() - mProbeStartPosition) / mProbeStep + 1.0f);
+            if (glm::any(glm::lessThan(lastPos, firstPos)) || glm::any(glm::lessThan(lastPos, float3(0.0f))) || glm::any(glm::greaterThan(firstPos, gridMax))) return;
+
+            const int3 first = int3(glm::max(firstPos, float3(0.0f)));
+            const int3 last = int3(glm::min(lastPos, gridMax));
+
+            const int3 firstBrick = first / int(BrickSize);
+            const int3 lastBrick = last / int(BrickSize);
+            for (int z = firstBrick.z; z <= lastBrick.z; ++z)
+            {
+                for (int y = firstBrick.y; y <= lastBrick.y; ++y)
+                {
+                    for (int x = firstBrick.x; x <= lastBrick.x; ++x)
+                    {
+                        occupied[x + (y + z * mBrickCounts.y) * mBrickCounts.x] = true;
+                    }
+                }
+            }
+        };
+
+        for (uint32_t modelId = 0; modelId < mpScene->getModelCount(); ++modelId)
+        {
+            const Model* pModel = mpScene->getModel(modelId).get();
+            for (uint32_t modelInstanceId = 0; modelInstanceId < mpScene->getModelInstanceCount(modelId); ++modelInstanceId)
+            {
+                const auto& pModelInstance = mpScene->getModelInstance(modelId, modelInstanceId);
+                if (!pModelInstance->isVisible()) continue;
+
+                const glm::mat4& transform = pModelInstance->getTransformMatrix();
+                for (uint32_t meshId = 0; meshId < pModel->getMeshCount(); ++meshId)
+                {
+                    for (uint32_t meshInstanceId = 0; meshInstanceId < pModel->getMeshInstanceCount(meshId); ++meshInstanceId)
+                    {
+                        markBounds(pModel->getMeshInstance(meshId, meshInstanceId)->getBoundingBox().transform(transform));
+                    }
+                }
+            }
+        }
+        return occupied;
     }
 
     void LightFieldProbeVolume::updateProbesAllocation()
     {
-        const BoundingBox& bbox = mSceneBounds;
-        const float3 minPos = bbox.getMinPos();
-        const float3 maxPos = bbox.getMaxPos();
+        if (mScrolling)
+        {
+            // Storage and grid coordinates match until the volume scrolls
+            mScrollOrigin = int3(glm::round(mScrollCenter / mProbeStep)) - (mProbesCount - 1) / 2;
+            mScrollOffset = int3(0);
+            mProbeStartPosition = mProbeStep * float3(mScrollOrigin);
+        }
+        else
+        {
+            const BoundingBox& bbox = mSceneBounds;
+            const float3 minPos = bbox.getMinPos();
+            const float3 maxPos = bbox.getMaxPos();
+
+            mProbeStep = (maxPos - minPos) / float3(mProbesCount + 1);
+            mProbeStartPosition = minPos + mProbeStep;
+            mScrollOffset = int3(0);
+        }
+
+        // Bricks are allocated in the texture arrays in the order they are found, the indirection table maps
+        // a brick to its first slice divided by the brick size
+        mBrickCounts = (mProbesCount + int(BrickSize) - 1) / int(BrickSize);
+        const std::vector<bool> occupied = computeOccupiedBricks();
+
+        mBrickTable.assign(occupied.size(), -1);
+        int32_t allocatedBricks = 0;
+        for (size_t i = 0; i < occupied.size(); ++i)
+        {
+            if (occupied[i]) mBrickTable[i] = allocatedBricks++;
+        }
+
+        const uint32_t sliceCount = std::max(1, allocatedBricks) * BrickSize * BrickSize * BrickSize;
 
-        mProbeStep = (maxPos - minPos) / float3(mProbesCount + 1);
-        mProbeStartPosition = minPos + mProbeStep;
+        const uint32_t shCoeffCount = LightFieldProbeSH::getCoeffCount(mIrradianceEncoding);
+        LightFieldProbeMemoryPlanner::Resolutions resolutions = LightFieldProbeMemoryPlanner::validate(mResolutions);
+        mMemoryBudgetMet = true;
+        if (mMemoryBudget > 0)
+        {
+            resolutions = LightFieldProbeMemoryPlanner::fitToBudget(mMemoryBudget, sliceCount, shCoeffCount, resolutions, &mMemoryBudgetMet);
+            if (!mMemoryBudgetMet)
+            {
+                logWarning("LightFieldProbeVolume: the probe atlases don't fit into " + LightFieldProbeMemoryPlanner::formatBytes(mMemoryBudget) + " even at the lowest resolutions");
+            }
+        }
+
+        if (sliceCount != mProbeSliceCount || resolutions != mActiveResolutions || shCoeffCount != mIrradianceSHCoeffCount || (!mpRadianceFbo && !isAtlasCompressed()))
+        {
+            mProbeSliceCount = sliceCount;
+            mActiveResolutions = resolutions;
+            createFBOs();
+        }
+
+        mpBrickTable = TypedBuffer<int32_t>::create((uint32_t)mBrickTable.size(), Resource::BindFlags::ShaderResource);
+        for (uint32_t i = 0; i < (uint32_t)mBrickTable.size(); ++i)
+        {
+            mpBrickTable->setElement(i, mBrickTable[i]);
+        }
 
         mProbes.clear();
-        mProbes.reserve(mProbesCount.x*mProbesCount.y*mProbesCount.z);
-        for (int iy = 0; iy < mProbesCount.y; ++iy)
+        for (int bz = 0; bz < mBrickCounts.z; ++bz)
         {
-            for (int iz = 0; iz < mProbesCount.z; ++iz)
+            for (int by = 0; by < mBrickCounts.y; ++by)
             {
-                for (int ix = 0; ix < mProbesCount.x; ++ix)
+                for (int bx = 0; bx < mBrickCounts.x; ++bx)
                 {
-                    LightFieldProbe p;
-                    p.mUpdated = false;
-                    p.mVisible = mVisualizeProbes;
-                    p.mProbeIdx = ix + iy * mProbesCount.x + iz * mProbesCount.x * mProbesCount.y;
-                    p.mProbePosition = mProbeStartPosition + mProbeStep * float3(ix, iy, iz);
-                    mProbes.push_back(p);
+                    const int32_t brickSlot = mBrickTable[bx + (by + bz * mBrickCounts.y) * mBrickCounts.x];
+                    if (brickSlot < 0) continue;
+
+                    for (int lz = 0; lz < BrickSize; ++lz)
+                    {
+                        for (int ly = 0; ly < BrickSize; ++ly)
+                        {
+                            for (int lx = 0; lx < BrickSize; ++lx)
+                            {
+                                // Bricks on the grid boundary may be partially outside of it
+                                const int3 coord = int3(bx, by, bz) * int(BrickSize) + int3(lx, ly, lz);
+                                if (glm::any(glm::greaterThanEqual(coord, mProbesCount))) continue;
+
+                                LightFieldProbe p;
+                                p.mUpdated = false;
+                                p.mVisible = mVisualizeProbes;
+                                p.mLastUpdateFrame = mFrameCount;
+                                p.mProbeIdx = coord.x + coord.y * mProbesCount.x + coord.z * mProbesCount.x * mProbesCount.y;
+                                p.mSliceIdx = brickSlot * BrickSize * BrickSize * BrickSize + lx + (ly + lz * BrickSize) * BrickSize;
+                                p.mStorageCoord = coord;
+                                p.mProbePosition = mScrolling ? mProbeStep * float3(mScrollOrigin + coord) : mProbeStartPosition + mProbeStep * float3(coord);
+                                mProbes.push_back(p);
+                            }
+                        }
+                    }
                 }
             }
         }
 
-        // Add sphere to the scene
+        // Add sphere to the scene, one per slice so the instance ID is the slice index. Spheres of unused slices stay hidden.
         int sphereModelId = 0;
         Model::SharedPtr pModel = nullptr;
         if (mDebugger.pScene->getModelCount() > 0)
@@ -309,101 +938,566 @@ namespace Falcor
             pModel = Model::createFromFile("UnitSphere.fbx");
         }
 
-        int numProbes = (int)mProbes.size();
+        int numSlices = (int)mProbeSliceCount;
         int numSpheres = (mDebugger.pScene->getModelCount() > 0) ? mDebugger.pScene->getModelInstanceCount(sphereModelId) : 0;
-        for (int i = numSpheres; i < numProbes; ++i)
+        for (int i = numSpheres; i < numSlices; ++i)
         {
             mDebugger.pScene->addModelInstance(pModel, "");
         }
-        for (int i = numSpheres-1; i > numProbes-1; --i)
+        for (int i = numSpheres-1; i > numSlices-1; --i)
         {
             mDebugger.pScene->deleteModelInstance(sphereModelId, i);
         }
-        assert(mProbes.size() == mDebugger.pScene->getModelInstanceCount(sphereModelId));
+        assert(mProbeSliceCount == mDebugger.pScene->getModelInstanceCount(sphereModelId));
 
+        for (int i = 0; i < numSlices; ++i)
+        {
+            mDebugger.pScene->getModelInstance(0, i)->setVisible(false);
+        }
         for (const auto& p : mProbes) {
-            mDebugger.pScene->getModelInstance(0, p.mProbeIdx)->setTranslation(p.mProbePosition, false);
-            mDebugger.pScene->getModelInstance(0, p.mProbeIdx)->setVisible(p.mVisible);
-            mDebugger.pScene->getModelInstance(0, p.mProbeIdx)->setScaling(vec3(mProbeSize*0.5f/pModel->getRadius()));
+            mDebugger.pScene->getModelInstance(0, p.mSliceIdx)->setVisible(p.mVisible);
+            mDebugger.pScene->getModelInstance(0, p.mSliceIdx)->setScaling(vec3(mProbeSize*0.5f/pModel->getRadius()));
         }
+
+        mpProbeOffsets = TypedBuffer<float4>::create(mProbeSliceCount, Resource::BindFlags::ShaderResource);
+        updateProbeOffsets();
+        mpConvergence->reset((uint32_t)mProbes.size(), mProbeSliceCount);
+        mpStatistics->reset((uint32_t)mProbes.size(), mProbeSliceCount);
+        mClassifyPending = mRelocateProbes;
     }
 
-    void LightFieldProbeVolume::update(RenderContext* pContext)
+    void LightFieldProbeVolume::updateProbeOffsets()
     {
-        int cnt = NumProbesUpdatePerFrame;
-        for (auto& probe : mProbes)
+        for (const auto& p : mProbes)
         {
-            bool updateProbe = probe.mUpdateEveryFrame || !probe.mUpdated;
-            updateProbe = updateProbe && cnt > 0;
-            if (!updateProbe) { continue; }
+            mpProbeOffsets->setElement(p.mSliceIdx, getProbeOffsetData(p));
+            mDebugger.pScene->getModelInstance(0, p.mSliceIdx)->setTranslation(p.getPosition(), false);
+        }
+    }
 
-            GPU_EVENT(pContext, "UpdateProbe");
-            probe.mUpdated = true;
-            --cnt;
+    float4 LightFieldProbeVolume::getProbeOffsetData(const LightFieldProbe& probe) const
+    {
+        // A probe that wrapped around still holds the cell on the other side of the volume, hide it until it's rendered
+        const bool active = probe.mActive && (probe.mHasValidData || !mScrolling);
+        return float4(probe.mOffset, active ? 1.0f : 0.0f);
+    }
 
-            glm::vec3 targetVec[6] = {
-                glm::vec3(1, 0, 0),
-                glm::vec3(-1, 0, 0),
-                glm::vec3(0, 1, 0),
-                glm::vec3(0, -1, 0),
-                glm::vec3(0, 0, -1),
-                glm::vec3(0, 0, 1),
-            };
+    void LightFieldProbeVolume::setScrollingProbeStep(const float3& probeStep)
+    {
+        mScrolling = glm::all(glm::greaterThan(probeStep, float3(0.0f)));
+        if (mScrolling)
+        {
+            mProbeStep = probeStep;
+        }
+        onProbesCountChanged();
+    }
+
+    uint32_t LightFieldProbeVolume::scrollTo(RenderContext* pContext, const float3& center)
+    {
+        mScrollCenter = center;
+        if (!mScrolling) return 0;
+
+        const int3 origin = int3(glm::round(center / mProbeStep)) - (mProbesCount - 1) / 2;
+        if (origin == mScrollOrigin) return 0;
+
+        auto wrap = [this](const int3& c) { return ((c % mProbesCount) + mProbesCount) % mProbesCount; };
+        const int3 oldOrigin = mScrollOrigin;
+        const int3 oldOffset = mScrollOffset;
+        mScrollOrigin = origin;
+        mScrollOffset = wrap(mScrollOffset + origin - oldOrigin);
+        mProbeStartPosition = mProbeStep * float3(mScrollOrigin);
 
-            glm::vec3 upVec[6] = {
-                glm::vec3(0, 1, 0),
-                glm::vec3(0, 1, 0),
-                glm::vec3(0, 0, 1),
-                glm::vec3(0, 0, -1),
-                glm::vec3(0, 1, 0),
-                glm::vec3(0, 1, 0),
-            };
+        // A probe keeps its slice, only the ones whose world cell changed have to be rendered again
+        std::vector<uint32_t> wrapped;
+        for (uint32_t i = 0; i < (uint32_t)mProbes.size(); ++i)
+        {
+            LightFieldProbe& p = mProbes[i];
+            const int3 coord = wrap(p.mStorageCoord - mScrollOffset);
+            p.mProbeIdx = coord.x + coord.y * mProbesCount.x + coord.z * mProbesCount.x * mProbesCount.y;
+            if (oldOrigin + wrap(p.mStorageCoord - oldOffset) == mScrollOrigin + coord) continue;
+
+            p.mProbePosition = mProbeStep * float3(mScrollOrigin + coord);
+            p.mOffset = float3(0.0f);
+            p.mActive = true;
+            p.mUpdated = false;
+            p.mHasValidData = false;
+            p.mLastUpdateFrame = mFrameCount;
+            mpConvergence->reactivate(i);
+            wrapped.push_back(i);
+        }
 
-            for (int i = 0; i < ARRAYSIZE(targetVec); ++i)
+        if (mRelocateProbes && mpScene && !wrapped.empty())
+        {
+            classifyProbes(pContext, wrapped);
+        }
+        updateProbeOffsets();
+        return (uint32_t)wrapped.size();
+    }
+
+    CpuSceneBvh::SharedPtr LightFieldProbeVolume::getSceneBvh(RenderContext* pContext)
+    {
+        if (!mpSceneBvh && mpScene)
+        {
+            mpSceneBvh = CpuSceneBvh::create(mpScene.get(), pContext);
+        }
+        return mpSceneBvh;
+    }
+
+    void LightFieldProbeVolume::classifyProbes(RenderContext* pContext)
+    {
+        std::vector<uint32_t> probeIndices(mProbes.size());
+        for (uint32_t i = 0; i < (uint32_t)mProbes.size(); ++i)
+        {
+            probeIndices[i] = i;
+        }
+
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+        if (!classifyProbes(pContext, probeIndices)) return;
+        updateProbeOffsets();
+
+        uint32_t movedCount = 0;
+        uint32_t inactiveCount = 0;
+        for (const auto& p : mProbes)
+        {
+            if (!p.mActive) inactiveCount++;
+            else if (p.mOffset != float3(0.0f)) movedCount++;
+        }
+        logInfo("Classified " + std::to_string(mProbes.size()) + " light field probes in " + std::to_string(CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint())) +
+                " ms: " + std::to_string(movedCount) + " relocated, " + std::to_string(inactiveCount) + " inactive");
+    }
+
+    bool LightFieldProbeVolume::classifyProbes(RenderContext* pContext, const std::vector<uint32_t>& probeIndices)
+    {
+        CpuSceneBvh::SharedPtr pBvh = getSceneBvh(pContext);
+        if (!pBvh)
+        {
+            logWarning("LightFieldProbeVolume::classifyProbes() - no scene is set");
+            return false;
+        }
+
+        std::vector<float3> positions(probeIndices.size());
+        for (size_t i = 0; i < probeIndices.size(); ++i)
+        {
+            positions[i] = mProbes[probeIndices[i]].mProbePosition;
+        }
+
+        std::vector<LightFieldProbeClassifier::ProbeResult> results = mpClassifier->classify(*pBvh, positions, mProbeStep);
+
+        for (size_t i = 0; i < probeIndices.size(); ++i)
+        {
+            LightFieldProbe& p = mProbes[probeIndices[i]];
+            const bool active = results[i].state == LightFieldProbeClassifier::ProbeState::Active;
+            if (p.mOffset != results[i].offset || p.mActive != active)
+            {
+                p.mOffset = results[i].offset;
+                p.mActive = active;
+                p.mUpdated = false;
+                mpConvergence->reactivate(probeIndices[i]);
+            }
+        }
+        return true;
+    }
+
+    uint32_t LightFieldProbeVolume::invalidateProbes(const std::vector<BoundingBox>& regions)
+    {
+        const float3 influence = mProbeStep * mInvalidationRadius;
+        uint32_t count = 0;
+        for (uint32_t i = 0; i < (uint32_t)mProbes.size(); ++i)
+        {
+            LightFieldProbe& p = mProbes[i];
+            const float3 minPos = p.getPosition() - influence;
+            const float3 maxPos = p.getPosition() + influence;
+            for (const BoundingBox& region : regions)
             {
-                pContext->clearFbo(mpTempGBufferFbo.get(), vec4(0), 1.f, 0, FboAttachmentType::All);
+                if (glm::all(glm::lessThanEqual(minPos, region.getMaxPos())) && glm::all(glm::greaterThanEqual(maxPos, region.getMinPos())))
+                {
+                    if (p.mUpdated) count++;
+                    p.mUpdated = false;
+                    mpConvergence->reactivate(i);
+                    break;
+                }
+            }
+        }
+        return count;
+    }
 
-                Camera::SharedPtr pCamera = Camera::create();
-                pCamera->setPosition(probe.mProbePosition);
-                pCamera->setUpVector(upVec[i]);
-                pCamera->setTarget(probe.mProbePosition + targetVec[i]);
-                pCamera->setAspectRatio(1.0);
-                pCamera->setDepthRange(0.01f, 10);
-                pCamera->setFocalLength(fovYToFocalLength((float)M_PI_2, Camera::kDefaultFrameHeight));
+    void LightFieldProbeVolume::updateShadowMapBounds()
+    {
+        if (!mCacheShadowMap)
+        {
+            setShadowMapSize(kFaceShadowMapSize);
+            mpShadowPass->setCachedShadowBounds(BoundingBox());
+            return;
+        }
 
-                mpRaster->execute(pContext, mpTempGBufferFbo, pCamera);
+        // Faces of the outer probes see geometry past the last probe, pad the region by one grid step.
+        // Scrolling moves the region, which re-renders the shadow map once per scroll step.
+        const float3 minPos = mProbeStartPosition - mProbeStep;
+        const float3 maxPos = mProbeStartPosition + mProbeStep * float3(mProbesCount);
 
-                mpShadowPass->generateVisibilityBuffer(pContext, pCamera.get(), mpTempGBufferFbo->getDepthStencilTexture());
+        // The shadow map covers the bounding sphere of the region, keep the texel density tied to the probe spacing
+        const float diagonalInSteps = glm::length(float3(mProbesCount) + 1.0f);
+        const uint32_t size = (uint32_t)std::ceil(diagonalInSteps * mShadowTexelsPerProbeStep);
+        setShadowMapSize(glm::clamp(size, kFaceShadowMapSize, kMaxCachedShadowMapSize));
+        mpShadowPass->setCachedShadowBounds(BoundingBox::fromMinMax(minPos, maxPos));
+    }
 
-                Fbo::SharedPtr tmpTempLightFieldFbo = Fbo::create();
-                tmpTempLightFieldFbo->attachColorTarget(mpTempLightFieldFbo->getColorTexture(0), 0, 0, i);
-                tmpTempLightFieldFbo->attachColorTarget(mpTempLightFieldFbo->getColorTexture(1), 1, 0, i);
-                tmpTempLightFieldFbo->attachColorTarget(mpTempLightFieldFbo->getColorTexture(2), 2, 0, i);
-                mpShading->setCamera(pCamera);
-                mpShading->execute(pContext, mpTempGBufferFbo, mpShadowPass->getVisibilityBuffer(), tmpTempLightFieldFbo);
+    void LightFieldProbeVolume::setShadowMapSize(uint32_t size)
+    {
+        if (size == mShadowMapSize) return;
+        mShadowMapSize = size;
+        // Recreating the shadow map also invalidates the cached one
+        mpShadowPass->resizeShadowMap(size, size);
+    }
+
+    void LightFieldProbeVolume::invalidateMovedGeometry()
+    {
+        std::vector<BoundingBox> regions;
+        if (!mpChangeTracker->update(mpScene.get(), regions))
+        {
+            logInfo("LightFieldProbeVolume: scene instances were added or removed, updating all probes");
+            mpSceneBvh = nullptr;
+            mpShadowPass->invalidateCachedShadowMap();
+            setProbesNeedToUpdate();
+            mLastInvalidatedCount = (uint32_t)mProbes.size();
+            return;
+        }
+        if (regions.empty()) return;
+
+        // The CPU BVH is rebuilt from the new transforms the next time it is needed
+        mpSceneBvh = nullptr;
+        mQuietFrameCount = 0;
+        mpShadowPass->invalidateCachedShadowMap();
+        mLastInvalidatedCount = invalidateProbes(regions);
+    }
+
+    LightFieldProbeTraceBenchmark::Report LightFieldProbeVolume::runTraceBenchmark(RenderContext* pContext, const LightFieldProbeTraceBenchmark::Settings& settings, bool useSimd)
+    {
+        CpuSceneBvh::SharedPtr pBvh = getSceneBvh(pContext);
+        if (!pBvh)
+        {
+            logWarning("LightFieldProbeVolume::runTraceBenchmark() - no scene is set");
+            return LightFieldProbeTraceBenchmark::Report();
+        }
+
+        LightFieldProbeAtlas atlas;
+        atlas.download(pContext, getRadianceTexture(), getNormalTexture(), getDistanceTexture(),
+                       getLowResDistanceTexture(), getIrradianceTexture(), getDistanceMomentsTexture(), mpIrradianceSH);
+
+        // Use the exact state the shader sees, including probes hidden until their first update
+        LightFieldProbeCache::GridDesc grid = getGridDesc();
+        grid.probeOffsets.assign(mProbeSliceCount, float4(0.0f));
+        for (const auto& p : mProbes)
+        {
+            grid.probeOffsets[p.mSliceIdx] = getProbeOffsetData(p);
+        }
+
+        LightFieldProbeTracer::SharedPtr pTracer = LightFieldProbeTracer::create(atlas, grid, mScrollOffset);
+        if (!pTracer)
+        {
+            return LightFieldProbeTraceBenchmark::Report();
+        }
+        pTracer->setUseSimd(useSimd);
+
+        const BoundingBox region = BoundingBox::fromMinMax(mProbeStartPosition, mProbeStartPosition + mProbeStep * float3(mProbesCount - 1));
+        LightFieldProbeTraceBenchmark::Report report = LightFieldProbeTraceBenchmark::run(*pTracer, *pBvh, region, settings);
+        logInfo(report.toString());
+        return report;
+    }
+
+    bool LightFieldProbeVolume::exportStatistics(const std::string& filename) const
+    {
+        std::vector<LightFieldProbeStatistics::ProbeDesc> probes(mProbes.size());
+        for (size_t i = 0; i < mProbes.size(); ++i)
+        {
+            probes[i].position = mProbes[i].getPosition();
+            probes[i].sliceIdx = mProbes[i].mSliceIdx;
+            probes[i].active = mProbes[i].mActive;
+        }
+        return hasSuffix(filename, ".json", false) ? mpStatistics->exportJson(filename, probes) : mpStatistics->exportCsv(filename, probes);
+    }
+
+    void LightFieldProbeVolume::bakeOnCpu(RenderContext* pContext)
+    {
+        if (!mpScene)
+        {
+            logWarning("LightFieldProbeVolume::bakeOnCpu() - no scene is set");
+            return;
+        }
+
+        CpuSceneBvh::SharedPtr pBvh = getSceneBvh(pContext);
+
+        std::vector<LightData> lights;
+        for (uint32_t i = 0; i < mpScene->getLightCount(); ++i)
+        {
+            lights.push_back(mpScene->getLight(i)->getData());
+        }
+
+        std::vector<float3> probePositions(mProbeSliceCount);
+        std::vector<uint32_t> activeProbes;
+        for (const auto& p : mProbes)
+        {
+            probePositions[p.mSliceIdx] = p.getPosition();
+            if (p.mActive) activeProbes.push_back(p.mSliceIdx);
+        }
+
+        LightFieldProbeBaker::Settings settings = mpCpuBaker ? mpCpuBaker->getSettings() : LightFieldProbeBaker::Settings();
+        settings.octResolution = mActiveResolutions.octahedral;
+        settings.lowResResolution = mActiveResolutions.lowRes;
+        settings.filteredResolution = mActiveResolutions.filtered;
+        settings.shCoeffCount = mIrradianceSHCoeffCount;
+        if (!mpCpuBaker)
+        {
+            mpCpuBaker = LightFieldProbeBaker::create(settings);
+        }
+        else
+        {
+            mpCpuBaker->setSettings(settings);
+        }
+        // Inactive probes and unused slices of bricks on the grid boundary are never sampled, they are left cleared
+        mCpuAtlas.allocate(mProbeSliceCount, settings.octResolution, settings.lowResResolution, settings.filteredResolution, settings.shCoeffCount);
+        const CpuTimer::TimePoint bakeStart = CpuTimer::getCurrentTimePoint();
+        mpCpuBaker->bakeProbes(*pBvh, lights, probePositions, activeProbes, mCpuAtlas);
+        const float bakeTime = (float)CpuTimer::calcDuration(bakeStart, CpuTimer::getCurrentTimePoint());
+
+        // Every probe is overwritten, the render targets don't need the old content
+        decompressAtlases(pContext, false);
+        mCpuAtlas.upload(pContext, getRadianceTexture(), getNormalTexture(), getDistanceTexture(),
+                         getLowResDistanceTexture(), getIrradianceTexture(), getDistanceMomentsTexture(), mpIrradianceSH);
+
+        // The bake runs all probes in parallel, the CPU time is split evenly
+        for (uint32_t i = 0; i < (uint32_t)mProbes.size(); ++i)
+        {
+            const LightFieldProbe& p = mProbes[i];
+            if (!p.mActive) continue;
+            mpStatistics->recordUpdate(i, mFrameCount, bakeTime / activeProbes.size());
+            mpStatistics->measure(pContext, i, p.mSliceIdx, getDistanceTexture(), getNormalTexture(), getIrradianceTexture(), mpIrradianceSH, mIrradianceSHCoeffCount);
+        }
+
+        markAllProbesUpdated();
+        persistProbes(pContext, &mCpuAtlas);
+    }
+
+    void LightFieldProbeVolume::update(RenderContext* pContext, const Camera* pCamera)
+    {
+        if (mClassifyPending && mpScene)
+        {
+            mClassifyPending = false;
+            classifyProbes(pContext);
+        }
+
+        if (mCacheLoadPending)
+        {
+            mCacheLoadPending = false;
+            loadProbeCache(pContext);
+        }
+
+        if (mTrackSceneChanges && mpScene)
+        {
+            invalidateMovedGeometry();
+
+            // Lights affect every probe, converged probes have to pick up the new lighting
+            if (mpChangeTracker->updateLights(mpScene.get()))
+            {
+                mpConvergence->reactivateAll();
+                mQuietFrameCount = 0;
+            }
+        }
+
+        if (mBakeOnCpuRequested)
+        {
+            mBakeOnCpuRequested = false;
+            bakeOnCpu(pContext);
+        }
+
+        if (mTraceBenchmarkRequested)
+        {
+            mTraceBenchmarkRequested = false;
+            mTraceBenchmarkReport = runTraceBenchmark(pContext, mTraceBenchmarkSettings, mTraceBenchmarkSimd);
+        }
+
+        std::vector<LightFieldProbeUpdateScheduler::ProbeInfo> probeInfos(mProbes.size());
+        for (size_t i = 0; i < mProbes.size(); ++i)
+        {
+            const LightFieldProbe& p = mProbes[i];
+            probeInfos[i].position = p.getPosition();
+            probeInfos[i].lastUpdateFrame = p.mLastUpdateFrame;
+            probeInfos[i].needsUpdate = !p.mUpdated && p.mActive;
+            probeInfos[i].hasValidData = p.mHasValidData;
+            probeInfos[i].updateEveryFrame = p.mUpdateEveryFrame && p.mActive && !mpConvergence->isRetired((uint32_t)i);
+        }
+
+        const std::vector<uint32_t>& selected = mpScheduler->schedule(probeInfos, pCamera, mProbeStep * 0.5f, mFrameCount);
+        const bool probesUpdated = !selected.empty();
+
+        if (probesUpdated && mpShadowPass)
+        {
+            updateShadowMapBounds();
+        }
+
+        if (mCompressionTogglePending)
+        {
+            mCompressionTogglePending = false;
+            if (!mCompressAtlases)
+            {
+                decompressAtlases(pContext, true);
+            }
+            else if (!probesUpdated && !mScrolling && areProbesStatic())
+            {
+                LightFieldProbeAtlas atlas;
+                atlas.download(pContext, getRadianceTexture(), getNormalTexture(), getDistanceTexture(),
+                               getLowResDistanceTexture(), getIrradianceTexture(), getDistanceMomentsTexture(), mpIrradianceSH);
+                compressAtlases(pContext, atlas);
+            }
+        }
+
+        // Compressed atlases can't be rendered to
+        if (probesUpdated)
+        {
+            decompressAtlases(pContext, true);
+        }
+
+        mpScheduler->beginUpdates(pContext);
+        for (uint32_t i : selected)
+        {
+            LightFieldProbe& probe = mProbes[i];
+            // Probes without valid data have no history to blend with
+            const float hysteresis = probe.mHasValidData ? mpConvergence->getSettings().hysteresis : 0.0f;
+            probe.mUpdated = true;
+            probe.mHasValidData = true;
+            probe.mLastUpdateFrame = mFrameCount;
+            mpStatistics->beginProbe(i, mFrameCount);
+            updateProbe(pContext, probe, hysteresis);
+            mpStatistics->endProbe(i);
+            mpConvergence->measure(pContext, getRadianceTexture(), i, probe.mSliceIdx, hysteresis);
+            mpStatistics->measure(pContext, i, probe.mSliceIdx, getDistanceTexture(), getNormalTexture(), getIrradianceTexture(), mpIrradianceSH, mIrradianceSHCoeffCount);
+            if (mScrolling)
+            {
+                mpProbeOffsets->setElement(probe.mSliceIdx, getProbeOffsetData(probe));
+            }
+        }
+        mpScheduler->endUpdates(pContext);
+        mpConvergence->endFrame(pContext);
+        mpStatistics->endFrame(pContext);
+        ++mFrameCount;
+
+        updatePersistence(pContext, probesUpdated);
+    }
+
+    void LightFieldProbeVolume::updatePersistence(RenderContext* pContext, bool probesUpdated)
+    {
+        if (probesUpdated)
+        {
+            mQuietFrameCount = 0;
+        }
+        else if (mQuietFrameCount < kPersistQuietFrames)
+        {
+            ++mQuietFrameCount;
+        }
+
+        const bool probesStatic = areProbesStatic();
+        if (mPersistRequested)
+        {
+            mPersistRequested = false;
+            if (probesStatic)
+            {
+                mFullBakePending = false;
+                mPersistPending = false;
+                persistProbes(pContext, nullptr);
             }
+            else
+            {
+                logWarning("LightFieldProbeVolume: can't save the probe cache while probes are still being rendered");
+            }
+            return;
+        }
 
-            Fbo::SharedPtr tmpRadianceFbo = Fbo::create();
-            Fbo::SharedPtr tmpNormalFbo = Fbo::create();
-            Fbo::SharedPtr tmpDistanceFbo = Fbo::create();
-            Fbo::SharedPtr tmpLowResDistanceFbo = Fbo::create();
-            tmpRadianceFbo->attachColorTarget(mpRadianceFbo->getColorTexture(0), 0, 0, probe.mProbeIdx);
-            tmpNormalFbo->attachColorTarget(mpNormalFbo->getColorTexture(0), 0, 0, probe.mProbeIdx);
-            tmpDistanceFbo->attachColorTarget(mpDistanceFbo->getColorTexture(0), 0, 0, probe.mProbeIdx);
-            tmpLowResDistanceFbo->attachColorTarget(mpLowResDistanceFbo->getColorTexture(0), 0, 0, probe.mProbeIdx);
+        if (!probesStatic) return;
 
-            Fbo::SharedPtr pTargetFbos[3] = {tmpRadianceFbo, tmpNormalFbo, tmpDistanceFbo};
-            for (int i = 0; i < 3; ++i)
+        if (probesUpdated)
+        {
+            // Persist a complete bake once the last static probe has been rendered. Probes re-rendered after an
+            // invalidation are only persisted after the scene settled, a moving instance invalidates a few probes every frame.
+            if (mFullBakePending)
+            {
+                mFullBakePending = false;
+                mPersistPending = false;
+                persistProbes(pContext, nullptr);
+            }
+            else
             {
-                mpOctMapping->execute(pContext, mpTempLightFieldFbo->getColorTexture(i), pTargetFbos[i]);
+                mPersistPending = true;
             }
+        }
+        else if (mPersistPending && mQuietFrameCount >= kPersistQuietFrames)
+        {
+            mPersistPending = false;
+            persistProbes(pContext, nullptr);
+        }
+    }
 
-            Fbo::SharedPtr tmpFilteredFbo = Fbo::create();
-            tmpFilteredFbo->attachColorTarget(mpFilteredFbo->getColorTexture(0), 0, 0, probe.mProbeIdx);
-            tmpFilteredFbo->attachColorTarget(mpFilteredFbo->getColorTexture(1), 1, 0, probe.mProbeIdx);
-            mpFiltering->execute(pContext, tmpRadianceFbo->getColorTexture(0), tmpDistanceFbo->getColorTexture(0), probe.mProbeIdx, tmpFilteredFbo);
+    void LightFieldProbeVolume::updateProbe(RenderContext* pContext, const LightFieldProbe& probe, float hysteresis)
+    {
+        GPU_EVENT(pContext, "UpdateProbe");
 
-            mpDownscalePass->execute(pContext, tmpDistanceFbo->getColorTexture(0), probe.mProbeIdx, tmpLowResDistanceFbo);
+        const glm::vec3 targetVec[GBufferRaster::kCubeFaceCount] = {
+            glm::vec3(1, 0, 0),
+            glm::vec3(-1, 0, 0),
+            glm::vec3(0, 1, 0),
+            glm::vec3(0, -1, 0),
+            glm::vec3(0, 0, -1),
+            glm::vec3(0, 0, 1),
+        };
+
+        for (uint32_t i = 0; i < GBufferRaster::kCubeFaceCount; ++i)
+        {
+            mFaceCameras[i]->setPosition(probe.getPosition());
+            mFaceCameras[i]->setTarget(probe.getPosition() + targetVec[i]);
         }
+
+        // A single scene traversal fills the G-buffer of all faces
+        pContext->clearFbo(mpTempGBufferFbo.get(), vec4(0), 1.f, 0, FboAttachmentType::All);
+        mpRaster->executeCube(pContext, mpTempGBufferFbo, mFaceCameras);
+
+        const Texture* pLayeredDepth = mpTempGBufferFbo->getDepthStencilTexture().get();
+        for (uint32_t i = 0; i < GBufferRaster::kCubeFaceCount; ++i)
+        {
+            pContext->copySubresource(mpFaceDepthTexture.get(), 0, pLayeredDepth, pLayeredDepth->getSubresourceIndex(i, 0));
+            mpShadowPass->generateVisibilityBuffer(pContext, mFaceCameras[i].get(), mpFaceDepthTexture);
+
+            mpShading->setCamera(mFaceCameras[i]);
+            mpShading->execute(pContext, mpTempGBufferFbo, mpShadowPass->getVisibilityBuffer(), mpFaceLightFieldFbos[i], i);
+        }
+
+        Fbo::SharedPtr tmpRadianceFbo = Fbo::create();
+        Fbo::SharedPtr tmpNormalFbo = Fbo::create();
+        Fbo::SharedPtr tmpDistanceFbo = Fbo::create();
+        Fbo::SharedPtr tmpLowResDistanceFbo = Fbo::create();
+        tmpRadianceFbo->attachColorTarget(mpRadianceFbo->getColorTexture(0), 0, 0, probe.mSliceIdx);
+        tmpNormalFbo->attachColorTarget(mpNormalFbo->getColorTexture(0), 0, 0, probe.mSliceIdx);
+        tmpDistanceFbo->attachColorTarget(mpDistanceFbo->getColorTexture(0), 0, 0, probe.mSliceIdx);
+        tmpLowResDistanceFbo->attachColorTarget(mpLowResDistanceFbo->getColorTexture(0), 0, 0, probe.mSliceIdx);
+
+        Fbo::SharedPtr pTargetFbos[3] = {tmpRadianceFbo, tmpNormalFbo, tmpDistanceFbo};
+        for (int i = 0; i < 3; ++i)
+        {
+            mpOctMapping->execute(pContext, mpTempLightFieldFbo->getColorTexture(i), pTargetFbos[i]);
+        }
+
+        Fbo::SharedPtr tmpFilteredFbo = Fbo::create();
+        if (mIrradianceSHCoeffCount > 0)
+        {
+            // A single projection of the radiance replaces the per-texel hemisphere integration
+            mpSHProjection->execute(pContext, tmpRadianceFbo->getColorTexture(0), probe.mSliceIdx, mIrradianceSHCoeffCount, mpIrradianceSH, hysteresis);
+            tmpFilteredFbo->attachColorTarget(mpFilteredFbo->getColorTexture(0), 0, 0, probe.mSliceIdx);
+        }
+        else
+        {
+            tmpFilteredFbo->attachColorTarget(mpFilteredFbo->getColorTexture(0), 0, 0, probe.mSliceIdx);
+            tmpFilteredFbo->attachColorTarget(mpFilteredFbo->getColorTexture(1), 1, 0, probe.mSliceIdx);
+        }
+        mpFiltering->execute(pContext, tmpRadianceFbo->getColorTexture(0), tmpDistanceFbo->getColorTexture(0), probe.mSliceIdx, tmpFilteredFbo, hysteresis);
+
+        mpDownscalePass->execute(pContext, tmpDistanceFbo->getColorTexture(0), probe.mSliceIdx, tmpLowResDistanceFbo);
     }
 }
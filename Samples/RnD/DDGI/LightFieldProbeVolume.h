@@ -30,8 +30,19 @@
 #include "Experimental/RenderPasses/GBufferRaster.h"
 #include "LightFieldProbeShading.h"
 #include "LightFieldProbeFiltering.h"
+#include "LightFieldProbeSHProjection.h"
+#include "LightFieldProbeSH.h"
 #include "OctahedralMapping.h"
 #include "DownscalePass.h"
+#include "LightFieldProbeBaker.h"
+#include "LightFieldProbeCache.h"
+#include "LightFieldProbeUpdateScheduler.h"
+#include "LightFieldProbeConvergence.h"
+#include "LightFieldProbeStatistics.h"
+#include "LightFieldProbeClassifier.h"
+#include "LightFieldProbeMemoryPlanner.h"
+#include "SceneChangeTracker.h"
+#include "LightFieldProbeTraceBenchmark.h"
 
 namespace Falcor
 {
@@ -59,14 +70,101 @@ namespace Falcor
         float3 getProbeStep() const { return mProbeStep; }
         float3 getProbeStartPosition() const { return mProbeStartPosition; }
 
-        void update(RenderContext* pContext);
+        /** Keep the grid centered on a moving point with a fixed probe spacing instead of fitting it to the scene bounds.
+            The grid moves by whole cells and is addressed toroidally, so only the probes that wrap around are updated.
+            Scrolling volumes are dense and don't use the probe cache.
+            \param[in] probeStep Spacing between probes, float3(0) fits the grid to the scene bounds again
+        */
+        void setScrollingProbeStep(const float3& probeStep);
+        bool isScrolling() const { return mScrolling; }
 
-        Texture::SharedPtr getRadianceTexture() const { return mpRadianceFbo->getColorTexture(0); }
-        Texture::SharedPtr getNormalTexture() const { return mpNormalFbo->getColorTexture(0); }
+        /** Move a scrolling volume so it's centered on the probe cell closest to the given position.
+            \return Number of probes that wrapped around and need to be rendered again
+        */
+        uint32_t scrollTo(RenderContext* pContext, const float3& center);
+
+        /** Toroidal offset from grid coordinates to storage coordinates, each component in [0, getProbesCount())
+        */
+        int3 getGridScrollOffset() const { return mScrollOffset; }
+
+        /** Set the requested atlas resolutions. With a memory budget the resolutions actually used may be lower.
+        */
+        void setResolutions(const LightFieldProbeMemoryPlanner::Resolutions& resolutions);
+        const LightFieldProbeMemoryPlanner::Resolutions& getResolutions() const { return mResolutions; }
+        const LightFieldProbeMemoryPlanner::Resolutions& getActiveResolutions() const { return mActiveResolutions; }
+
+        /** Limit the memory used by the probe atlases. Resolutions are lowered until the atlases fit. 0 disables the limit.
+        */
+        void setMemoryBudget(uint64_t budgetBytes);
+        uint64_t getMemoryBudget() const { return mMemoryBudget; }
+
+        /** Select how the filtered irradiance is stored. Changing the encoding reallocates the atlases and updates all probes.
+        */
+        void setIrradianceEncoding(IrradianceEncoding encoding);
+        IrradianceEncoding getIrradianceEncoding() const { return mIrradianceEncoding; }
+
+        /** Spherical harmonics coefficients per probe slice, 0 when the irradiance is stored in getIrradianceTexture()
+        */
+        uint32_t getIrradianceSHCoeffCount() const { return mIrradianceSHCoeffCount; }
+        TypedBuffer<float4>::SharedPtr getIrradianceSHBuffer() const { return mpIrradianceSH; }
+
+        /** Re-render the probes picked by the update scheduler for this frame.
+            \param[in] pCamera Main camera, used to prioritize nearby and visible probes. May be null.
+        */
+        void update(RenderContext* pContext, const Camera* pCamera = nullptr);
+
+        const LightFieldProbeUpdateScheduler::Stats& getUpdateStats() const { return mpScheduler->getStats(); }
+        const LightFieldProbeConvergence::Stats& getConvergenceStats() const { return mpConvergence->getStats(); }
+        const LightFieldProbeStatistics::SharedPtr& getStatistics() const { return mpStatistics; }
+
+        /** Write the per-probe statistics as CSV, or as JSON when the extension is .json
+        */
+        bool exportStatistics(const std::string& filename) const;
+
+        /** Bake all probes with the CPU reference baker and upload the result. Blocks until the bake is done.
+        */
+        void bakeOnCpu(RenderContext* pContext);
+
+        /** Trace rays from every probe to move it out of geometry and disable the ones that are fully enclosed.
+            Probes that moved or changed state are flagged for update.
+        */
+        void classifyProbes(RenderContext* pContext);
+
+        /** Flag the probes whose influence region intersects any of the given world space boxes for update.
+            A probe influences the grid cells around it, its region extends mInvalidationRadius probe steps from its position.
+            \return Number of probes flagged
+        */
+        uint32_t invalidateProbes(const std::vector<BoundingBox>& regions);
+
+        /** Fit the probe shadow map to the volume, or let it follow the face cameras when shadow caching is disabled
+        */
+        void updateShadowMapBounds();
+
+        /** Read the probes back and measure the CPU port of the probe trace against them. Blocks until the benchmark is done.
+        */
+        LightFieldProbeTraceBenchmark::Report runTraceBenchmark(RenderContext* pContext, const LightFieldProbeTraceBenchmark::Settings& settings, bool useSimd = true);
+
+        /** Per-probe relocation offset in xyz and state in w (1 active, 0 inactive), indexed by probe index
+        */
+        TypedBuffer<float4>::SharedPtr getProbeOffsetsBuffer() const { return mpProbeOffsets; }
+
+        /** Brick indirection table, the first texture array slice of each brick divided by BrickSize^3, or -1 if the brick is not allocated
+        */
+        TypedBuffer<int32_t>::SharedPtr getBrickTableBuffer() const { return mpBrickTable; }
+
+        /** Number of layers in the probe texture arrays
+        */
+        uint32_t getProbeSliceCount() const { return mProbeSliceCount; }
+
+        /** Radiance and normal atlases. Once a static volume has been compressed these are the BC6H and BC5 copies.
+        */
+        Texture::SharedPtr getRadianceTexture() const { return mpCompressedRadianceTex ? mpCompressedRadianceTex : mpRadianceFbo->getColorTexture(0); }
+        Texture::SharedPtr getNormalTexture() const { return mpCompressedNormalTex ? mpCompressedNormalTex : mpNormalFbo->getColorTexture(0); }
+        bool isAtlasCompressed() const { return mpCompressedRadianceTex != nullptr; }
         Texture::SharedPtr getDistanceTexture() const { return mpDistanceFbo->getColorTexture(0); }
         Texture::SharedPtr getLowResDistanceTexture() const { return mpLowResDistanceFbo->getColorTexture(0); }
-        Texture::SharedPtr getIrradianceTexture() const { return mpFilteredFbo->getColorTexture(0); }
-        Texture::SharedPtr getDistanceMomentsTexture() const { return mpFilteredFbo->getColorTexture(1); }
+        Texture::SharedPtr getIrradianceTexture() const { return (mIrradianceSHCoeffCount > 0) ? nullptr : mpFilteredFbo->getColorTexture(0); }
+        Texture::SharedPtr getDistanceMomentsTexture() const { return mpFilteredFbo->getColorTexture((mIrradianceSHCoeffCount > 0) ? 0 : 1); }
 
         void debugDraw(RenderContext* pContext, Camera::SharedConstPtr pCamera, Fbo::SharedPtr pTargetFbo);
 
@@ -77,9 +175,43 @@ namespace Falcor
         void onSceneBoundsChanged();
 
         void setProbesNeedToUpdate();
+        void invalidateMovedGeometry();
+        void setShadowMapSize(uint32_t size);
+
+        std::string getProbeCacheFilename() const;
+        LightFieldProbeCache::GridDesc getGridDesc() const;
+        bool loadProbeCache(RenderContext* pContext);
+        void writeProbeCache(const LightFieldProbeAtlas& atlas);
+
+        /** Called once all static probes have been rendered. Compresses the atlases and writes the cache if enabled.
+            \param[in] pAtlas CPU copy of the probes, or nullptr to read them back from the GPU
+        */
+        void persistProbes(RenderContext* pContext, LightFieldProbeAtlas* pAtlas);
+        bool areProbesStatic() const;
+
+        /** Decide whether the volume should be persisted at the end of the frame.
+            A complete bake is persisted right away, probes re-rendered after an invalidation only once the scene stayed unchanged for kPersistQuietFrames frames.
+            \param[in] probesUpdated Whether probes were rendered this frame
+        */
+        void updatePersistence(RenderContext* pContext, bool probesUpdated);
+
+        /** Replace the radiance and normal render targets with BC6H and BC5 textures holding the compressed atlas
+        */
+        void compressAtlases(RenderContext* pContext, LightFieldProbeAtlas& atlas);
+        void createCompressedAtlases();
+
+        /** Bring the radiance and normal render targets back so probes can be rendered again
+            \param[in] preserveContent Decode the compressed atlases into the render targets, not needed if every probe is about to be overwritten
+        */
+        void decompressAtlases(RenderContext* pContext, bool preserveContent);
+        void createRadianceNormalFbos();
 
         void createFBOs();
         void updateProbesAllocation();
+        void updateProbeOffsets();
+        std::vector<bool> computeOccupiedBricks() const;
+
+        CpuSceneBvh::SharedPtr getSceneBvh(RenderContext* pContext);
 
         void loadDebugResources();
         void unloadDebugResources();
@@ -91,6 +223,7 @@ namespace Falcor
             ProbeColor,
         };
         static const Gui::DropdownList sLightFieldDebugDisplayModeList;
+        static const Gui::DropdownList sIrradianceEncodingList;
 
         struct
         {
@@ -112,17 +245,40 @@ namespace Falcor
         float3 mProbeStep;
         float3 mProbeStartPosition;
 
+        // Probes are allocated in bricks of BrickSize^3, only where there is geometry when the volume is sparse
+        bool mSparseVolume = true;
+        int3 mBrickCounts;
+        std::vector<int32_t> mBrickTable;
+        uint32_t mProbeSliceCount = 0;
+        TypedBuffer<int32_t>::SharedPtr mpBrickTable;
+
+        // Scrolling volumes keep mProbeStep and follow mScrollCenter. Storage coordinate = (grid coordinate + mScrollOffset) mod mProbesCount
+        bool mScrolling = false;
+        float3 mScrollCenter = float3(0.0f);
+        int3 mScrollOrigin = int3(0);       // World cell of grid coordinate 0
+        int3 mScrollOffset = int3(0);
+
         enum 
         {
-            CubemapResolution = 1024,
-            OctahedralResolution = 1024,
-            OctahedralResolutionLowRes = 1024/32,
-            FilteredFboResolution = 128,
-            NumProbesUpdatePerFrame = 1,
+            BrickSize = 4,              // Probes per brick along each axis, must match PROBE_BRICK_SIZE in LightFieldProbe.slang
         };
 
+        LightFieldProbeMemoryPlanner::Resolutions mResolutions;
+        LightFieldProbeMemoryPlanner::Resolutions mActiveResolutions;
+        uint64_t mMemoryBudget = 0;
+        bool mMemoryBudgetMet = true;
+        void renderMemoryUI(Gui* pGui);
+
+        IrradianceEncoding mIrradianceEncoding = IrradianceEncoding::Octahedral;
+        uint32_t mIrradianceSHCoeffCount = 0;       // Coefficient count the atlases were allocated for
+        TypedBuffer<float4>::SharedPtr mpIrradianceSH;
+
+        // Probes are rendered to a layered G-buffer, one array slice per cube face
         Fbo::SharedPtr mpTempGBufferFbo;
         Fbo::SharedPtr mpTempLightFieldFbo;
+        Fbo::SharedPtr mpFaceLightFieldFbos[GBufferRaster::kCubeFaceCount];
+        Texture::SharedPtr mpFaceDepthTexture;      // Depth of the face being shaded, the shadow pass reads a 2D texture
+        GBufferRaster::CubeFaceCameras mFaceCameras;
 
         Fbo::SharedPtr mpRadianceFbo;
         Fbo::SharedPtr mpNormalFbo;
@@ -131,21 +287,75 @@ namespace Falcor
         Fbo::SharedPtr mpFilteredFbo;
 
         CascadedShadowMaps::SharedPtr mpShadowPass;
+        bool mCacheShadowMap = true;            // Render one shadow map fitted to the volume and share it between all probe faces
+        uint32_t mShadowTexelsPerProbeStep = 32;    // Resolution of the cached shadow map, relative to the probe spacing
+        uint32_t mShadowMapSize = 512;
         GBufferRaster::SharedPtr mpRaster;
         LightFieldProbeShading::SharedPtr mpShading;
         OctahedralMapping::SharedPtr mpOctMapping;
         LightFieldProbeFiltering::SharedPtr mpFiltering;
+        LightFieldProbeSHProjection::SharedPtr mpSHProjection;
         DownscalePass::SharedPtr mpDownscalePass;
+        LightFieldProbeUpdateScheduler::SharedPtr mpScheduler;
+        LightFieldProbeConvergence::SharedPtr mpConvergence;
+        LightFieldProbeStatistics::SharedPtr mpStatistics;
+        uint64_t mFrameCount = 0;
+
+        LightFieldProbeBaker::SharedPtr mpCpuBaker;
+        LightFieldProbeAtlas mCpuAtlas;
+        bool mBakeOnCpuRequested = false;
+
+        bool mUseProbeCache = true;
+        bool mCompressAtlases = false;          // Store the radiance and normal atlases of static volumes block compressed
+        bool mCompressionTogglePending = false;
+        Texture::SharedPtr mpCompressedRadianceTex;
+        Texture::SharedPtr mpCompressedNormalTex;
+        bool mCacheHighResAtlases = true;
+        bool mCacheLoadPending = false;
+        bool mFullBakePending = false;          // Every probe was invalidated, persist as soon as they are all rendered
+        bool mPersistPending = false;           // Probes were re-rendered after an invalidation, persist once the scene settles
+        bool mPersistRequested = false;
+        uint32_t mQuietFrameCount = 0;          // Frames without invalidated or rendered probes
+
+        CpuSceneBvh::SharedPtr mpSceneBvh;
+        LightFieldProbeClassifier::SharedPtr mpClassifier;
+        TypedBuffer<float4>::SharedPtr mpProbeOffsets;
+        bool mRelocateProbes = true;
+        bool mClassifyPending = false;
+
+        SceneChangeTracker::SharedPtr mpChangeTracker;
+        bool mTrackSceneChanges = true;
+        float mInvalidationRadius = 1.0f;       // In probe steps
+        uint32_t mLastInvalidatedCount = 0;
+
+        LightFieldProbeTraceBenchmark::Settings mTraceBenchmarkSettings;
+        LightFieldProbeTraceBenchmark::Report mTraceBenchmarkReport;
+        bool mTraceBenchmarkSimd = true;
+        bool mTraceBenchmarkRequested = false;
+        void renderTraceBenchmarkUI(Gui* pGui);
 
         struct LightFieldProbe
         {
             bool mUpdated = false;
             bool mVisible = false;
             bool mUpdateEveryFrame = false;
-            int mProbeIdx;
+            bool mHasValidData = false;
+            uint64_t mLastUpdateFrame = 0;
+            bool mActive = true;
+            int mProbeIdx;          // Linear index on the full grid
+            int mSliceIdx;          // Layer in the probe texture arrays
+            int3 mStorageCoord;     // Grid coordinate the slice was allocated for, differs from the current one once the grid scrolled
             float3 mProbePosition;
+            float3 mOffset = float3(0.0f);
+
+            float3 getPosition() const { return mProbePosition + mOffset; }
         };
         std::vector<LightFieldProbe> mProbes;
+
+        void updateProbe(RenderContext* pContext, const LightFieldProbe& probe, float hysteresis);
+        float4 getProbeOffsetData(const LightFieldProbe& probe) const;
+        bool classifyProbes(RenderContext* pContext, const std::vector<uint32_t>& probeIndices);
+        void markAllProbesUpdated();
         float mProbeSize = 1.0;
     };
 }
@@ -2,6 +2,12 @@
 
 using namespace Falcor;
 
+namespace
+{
+    const uint32_t kTileSize = 16;          // Matches TILE_SIZE in the tiled shaders
+    const uint32_t kMaxAtrousIterations = 5;
+}
+
 SVGFPass::SharedPtr SVGFPass::create(uint32_t width, uint32_t height)
 {
     return std::make_shared<SVGFPass>(width, height);
@@ -16,7 +22,11 @@ SVGFPass::SVGFPass(uint32_t width, uint32_t height)
       mPhiColor(10.0f),
       mPhiNormal(128.0f),
       mEnableTemporalReprojection(true),
-      mEnableSpatialVarianceEstimation(true)
+      mEnableSpatialVarianceEstimation(true),
+      mAdaptiveAtrous(false),
+      mConvergedIterations(1),
+      mConvergedVariance(0.05f),
+      mConvergedHistoryLength(8.0f)
 {
     Fbo::Desc reprojFboDesc;
     reprojFboDesc.setColorTarget(0, ResourceFormat::RGBA16Float); // Input signal, variance
@@ -27,7 +37,7 @@ SVGFPass::SVGFPass(uint32_t width, uint32_t height)
     mPrevReprojFbo = FboHelper::create2D(width, height, reprojFboDesc);
 
     Fbo::Desc atrousFboDesc;
-    atrousFboDesc.setColorTarget(0, ResourceFormat::RGBA16Float); // Input signal, variance
+    atrousFboDesc.setColorTarget(0, ResourceFormat::RGBA16Float, true); // Input signal, variance. Written as UAV by the adaptive a-trous filter
 
     mOutputFbo = FboHelper::create2D(width, height, atrousFboDesc);
     mLastFilteredFbo = FboHelper::create2D(width, height, atrousFboDesc);
@@ -48,6 +58,32 @@ SVGFPass::SVGFPass(uint32_t width, uint32_t height)
     mAtrousPass->getProgram()->addDefine("ATROUS_RADIUS", std::to_string(mAtrousRadius));
     mAtrousVars = GraphicsVars::create(mAtrousPass->getProgram()->getReflector());
     mAtrousState = GraphicsState::create();
+
+    mTileClassifyProgram = ComputeProgram::createFromFile("SVGF_TileClassify.slang", "main");
+    mTileClassifyVars = ComputeVars::create(mTileClassifyProgram->getReflector());
+    mTileClassifyState = ComputeState::create();
+    mTileClassifyState->setProgram(mTileClassifyProgram);
+
+    Program::DefineList tiledDefines;
+    tiledDefines.add("_TILED");
+    tiledDefines.add("ATROUS_RADIUS", std::to_string(mAtrousRadius));
+    mTiledAtrousProgram = ComputeProgram::createFromFile("SVGF_Atrous.slang", "tiledMain", tiledDefines);
+    mTiledAtrousVars = ComputeVars::create(mTiledAtrousProgram->getReflector());
+    mTiledAtrousState = ComputeState::create();
+    mTiledAtrousState->setProgram(mTiledAtrousProgram);
+
+    mTileCountX = (width + kTileSize - 1) / kTileSize;
+    mTileCountY = (height + kTileSize - 1) / kTileSize;
+    const uint32_t listCount = kMaxAtrousIterations * 2;
+    mTileArgsInit.resize(listCount * 3);
+    for (uint32_t i = 0; i < listCount; ++i)
+    {
+        mTileArgsInit[i * 3 + 0] = 0;
+        mTileArgsInit[i * 3 + 1] = 1;
+        mTileArgsInit[i * 3 + 2] = 1;
+    }
+    mTileArgs = Buffer::create(mTileArgsInit.size() * sizeof(uint32_t), Resource::BindFlags::IndirectArg | Resource::BindFlags::UnorderedAccess, Buffer::CpuAccess::None, mTileArgsInit.data());
+    mTileLists = Buffer::create(listCount * mTileCountX * mTileCountY * sizeof(uint32_t), Resource::BindFlags::ShaderResource | Resource::BindFlags::UnorderedAccess, Buffer::CpuAccess::None, nullptr);
 }
 
 SVGFPass::~SVGFPass()
@@ -68,13 +104,36 @@ Texture::SharedPtr SVGFPass::Execute(
     mGBufferInput.motionVec = motionVec;
     mGBufferInput.compactNormalDepth = normalDepth;
 
+    if (!mCaptureFilename.empty())
+    {
+        CpuSVGF::Frame frame;
+        if (CpuSVGF::Frame::capture(renderContext, inputSignal, motionVec, linearZ, normalDepth, frame))
+        {
+            frame.save(mCaptureFilename);
+        }
+        mCaptureFilename.clear();
+    }
+
     TemporalReprojection(renderContext);
     SpatialVarianceEstimation(renderContext);
 
+    const bool adaptive = mAdaptiveAtrous && mAtrousIterations <= kMaxAtrousIterations;
+    if (adaptive)
+    {
+        ClassifyTiles(renderContext);
+    }
+
     for (uint32_t i = 0; i < mAtrousIterations; ++i)
     {
         Fbo::SharedPtr output = (i == mAtrousIterations - 1) ? mOutputFbo : mAtrousPongFbo;
-        AtrousFilter(renderContext, i, mAtrousPingFbo, output);
+        if (adaptive)
+        {
+            AtrousFilterTiled(renderContext, i, mAtrousPingFbo, output);
+        }
+        else
+        {
+            AtrousFilter(renderContext, i, mAtrousPingFbo, output);
+        }
 
         if (i == std::min(mFeedbackTap, mAtrousIterations-1))
         {
@@ -158,6 +217,74 @@ void SVGFPass::AtrousFilter(RenderContext* renderContext, uint32_t iteration, Fb
     renderContext->popGraphicsState();
 }
 
+CpuSVGF::Settings SVGFPass::GetCpuSettings() const
+{
+    CpuSVGF::Settings settings;
+    settings.atrousIterations = mAtrousIterations;
+    settings.feedbackTap = mFeedbackTap;
+    settings.atrousRadius = mAtrousRadius;
+    settings.alpha = mAlpha;
+    settings.momentsAlpha = mMomentsAlpha;
+    settings.phiColor = mPhiColor;
+    settings.phiNormal = mPhiNormal;
+    settings.enableTemporalReprojection = mEnableTemporalReprojection;
+    settings.enableSpatialVarianceEstimation = mEnableSpatialVarianceEstimation;
+    return settings;
+}
+
+void SVGFPass::ClassifyTiles(RenderContext* renderContext)
+{
+    GPU_EVENT(renderContext, "ClassifyTiles");
+
+    renderContext->updateBuffer(mTileArgs.get(), mTileArgsInit.data());
+
+    mTileClassifyVars->setTexture("gInputSignal", mAtrousPingFbo->getColorTexture(0));
+    mTileClassifyVars->setTexture("gHistoryLength", mCurrReprojFbo->getColorTexture(2));
+    mTileClassifyVars->setTexture("gCompactNormDepth", mGBufferInput.compactNormalDepth);
+    mTileClassifyVars->setRawBuffer("gTileArgs", mTileArgs);
+    mTileClassifyVars->setRawBuffer("gTileLists", mTileLists);
+
+    mTileClassifyVars["PerPassCB"]["gIterations"] = mAtrousIterations;
+    mTileClassifyVars["PerPassCB"]["gConvergedIterations"] = mConvergedIterations;
+    mTileClassifyVars["PerPassCB"]["gTileCount"] = mTileCountX * mTileCountY;
+    mTileClassifyVars["PerPassCB"]["gVarianceThreshold"] = mConvergedVariance;
+    mTileClassifyVars["PerPassCB"]["gMinHistoryLength"] = mConvergedHistoryLength;
+
+    renderContext->pushComputeState(mTileClassifyState);
+    renderContext->pushComputeVars(mTileClassifyVars);
+    renderContext->dispatch(mTileCountX, mTileCountY, 1);
+    renderContext->popComputeVars();
+    renderContext->popComputeState();
+}
+
+void SVGFPass::AtrousFilterTiled(RenderContext* renderContext, uint32_t iteration, Fbo::SharedPtr input, Fbo::SharedPtr output)
+{
+    GPU_EVENT(renderContext, "AtrousFilterTiled");
+
+    mTiledAtrousVars->setTexture("gCompactNormDepth", mGBufferInput.compactNormalDepth);
+    mTiledAtrousVars->setTexture("gInputSignal", input->getColorTexture(0));
+    mTiledAtrousVars->setTexture("gOutput", output->getColorTexture(0));
+    mTiledAtrousVars->setRawBuffer("gTileList", mTileLists);
+
+    mTiledAtrousVars["PerPassCB"]["gStepSize"] = 1u << iteration;
+    mTiledAtrousVars["PerPassCB"]["gPhiColor"] = mPhiColor;
+    mTiledAtrousVars["PerPassCB"]["gPhiNormal"] = mPhiNormal;
+
+    const uint32_t tileCount = mTileCountX * mTileCountY;
+    renderContext->pushComputeState(mTiledAtrousState);
+    for (uint32_t copyOnly = 0; copyOnly < 2; ++copyOnly)
+    {
+        const uint32_t list = iteration * 2 + copyOnly;
+        mTiledAtrousVars["TiledCB"]["gTileListOffset"] = list * tileCount;
+        mTiledAtrousVars["TiledCB"]["gCopyOnly"] = copyOnly != 0;
+
+        renderContext->pushComputeVars(mTiledAtrousVars);
+        renderContext->dispatchIndirect(mTileArgs.get(), list * 3 * sizeof(uint32_t));
+        renderContext->popComputeVars();
+    }
+    renderContext->popComputeState();
+}
+
 void SVGFPass::RenderGui(Gui* gui, const char* group)
 {
     if (gui->beginGroup(group))
@@ -173,6 +300,21 @@ void SVGFPass::RenderGui(Gui* gui, const char* group)
         if (gui->addIntSlider("Atrous Radius", *reinterpret_cast<int32_t*>(&mAtrousRadius), 1, 2))
         {
             mAtrousPass->getProgram()->addDefine("ATROUS_RADIUS", std::to_string(mAtrousRadius));
+            mTiledAtrousProgram->addDefine("ATROUS_RADIUS", std::to_string(mAtrousRadius));
+        }
+
+        gui->addCheckBox("Adaptive Atrous", mAdaptiveAtrous);
+        if (mAdaptiveAtrous)
+        {
+            gui->addIntSlider("Converged Iterations", *reinterpret_cast<int32_t*>(&mConvergedIterations), 0, 5);
+            gui->addFloatVar("Converged Variance", mConvergedVariance, 0.0f, 10.0f);
+            gui->addFloatVar("Converged History", mConvergedHistoryLength, 1.0f, 32.0f);
+        }
+
+        std::string filename;
+        if (gui->addButton("Capture Frame") && saveFileDialog({ { "svgf", "SVGF Frame Capture" } }, filename))
+        {
+            CaptureNextFrame(filename);
         }
 
         gui->endGroup();
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Falcor.h"
+#include "CpuSVGF.h"
 
 // Take from https://github.com/philcn/RaysRenderer
 class SVGFPass
@@ -21,11 +22,21 @@ public:
 
     void RenderGui(Falcor::Gui* gui, const char* group = "");
 
+    // Current parameters, to reproduce the output with Falcor::CpuSVGF
+    Falcor::CpuSVGF::Settings GetCpuSettings() const;
+
+    // Save the inputs of the next Execute() call, see Falcor::CpuSVGF::Frame
+    void CaptureNextFrame(const std::string& filename) { mCaptureFilename = filename; }
+
 private:
     void TemporalReprojection(Falcor::RenderContext* renderContext);
     void SpatialVarianceEstimation(Falcor::RenderContext* renderContext);
     void AtrousFilter(Falcor::RenderContext* renderContext, uint32_t iteration, Falcor::Fbo::SharedPtr input, Falcor::Fbo::SharedPtr output);
 
+    // Adaptive mode: classify tiles after the variance estimation, then filter only the tiles that haven't converged
+    void ClassifyTiles(Falcor::RenderContext* renderContext);
+    void AtrousFilterTiled(Falcor::RenderContext* renderContext, uint32_t iteration, Falcor::Fbo::SharedPtr input, Falcor::Fbo::SharedPtr output);
+
     Falcor::FullScreenPass::UniquePtr mReprojectionPass;
     Falcor::GraphicsVars::SharedPtr mReprojectionVars;
     Falcor::GraphicsState::SharedPtr mReprojectionState;
@@ -38,6 +49,21 @@ private:
     Falcor::GraphicsVars::SharedPtr mAtrousVars;
     Falcor::GraphicsState::SharedPtr mAtrousState;
 
+    Falcor::ComputeProgram::SharedPtr mTileClassifyProgram;
+    Falcor::ComputeVars::SharedPtr mTileClassifyVars;
+    Falcor::ComputeState::SharedPtr mTileClassifyState;
+
+    Falcor::ComputeProgram::SharedPtr mTiledAtrousProgram;
+    Falcor::ComputeVars::SharedPtr mTiledAtrousVars;
+    Falcor::ComputeState::SharedPtr mTiledAtrousState;
+
+    // Dispatch arguments and tile lists, two per iteration: tiles to filter and converged tiles to copy
+    Falcor::Buffer::SharedPtr mTileArgs;
+    Falcor::Buffer::SharedPtr mTileLists;
+    std::vector<uint32_t> mTileArgsInit;
+    uint32_t mTileCountX;
+    uint32_t mTileCountY;
+
     Falcor::Fbo::SharedPtr mAtrousPingFbo;
     Falcor::Fbo::SharedPtr mAtrousPongFbo;
 
@@ -60,6 +86,13 @@ private:
     bool mEnableTemporalReprojection;
     bool mEnableSpatialVarianceEstimation;
 
+    bool mAdaptiveAtrous;
+    uint32_t mConvergedIterations;
+    float mConvergedVariance;
+    float mConvergedHistoryLength;
+
+    std::string mCaptureFilename;
+
     struct
     {
         Falcor::Texture::SharedPtr inputSignal;
@@ -0,0 +1,151 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "SceneChangeTracker.h"
+
+namespace Falcor
+{
+    SceneChangeTracker::SharedPtr SceneChangeTracker::create()
+    {
+        return SharedPtr(new SceneChangeTracker());
+    }
+
+    uint64_t SceneChangeTracker::hashPose(const Model* pModel)
+    {
+        const mat4* pBones = pModel->getBoneMatrices();
+        if (pBones == nullptr) return 0;
+
+        // 64-bit FNV-1a over the bone matrices
+        uint64_t hash = 14695981039346656037ull;
+        const uint8_t* pBytes = (const uint8_t*)pBones;
+        const size_t size = pModel->getBoneCount() * sizeof(mat4);
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash = (hash ^ pBytes[i]) * 1099511628211ull;
+        }
+        return hash;
+    }
+
+    uint64_t SceneChangeTracker::hashLights(const Scene* pScene)
+    {
+        if (!pScene) return 0;
+
+        // 64-bit FNV-1a over the light count and the shader data of every light
+        uint64_t hash = 14695981039346656037ull;
+        auto hashBytes = [&hash](const void* pData, size_t size)
+        {
+            const uint8_t* pBytes = (const uint8_t*)pData;
+            for (size_t i = 0; i < size; ++i)
+            {
+                hash = (hash ^ pBytes[i]) * 1099511628211ull;
+            }
+        };
+
+        const uint32_t lightCount = pScene->getLightCount();
+        hashBytes(&lightCount, sizeof(lightCount));
+        for (uint32_t i = 0; i < lightCount; ++i)
+        {
+            hashBytes(&pScene->getLight(i)->getData(), sizeof(LightData));
+        }
+        return hash;
+    }
+
+    SceneChangeTracker::ModelState SceneChangeTracker::captureModel(const Scene* pScene, uint32_t modelId)
+    {
+        ModelState state;
+        state.pModel = pScene->getModel(modelId).get();
+        state.poseHash = hashPose(state.pModel);
+        state.instances.resize(pScene->getModelInstanceCount(modelId));
+        for (uint32_t i = 0; i < (uint32_t)state.instances.size(); ++i)
+        {
+            const auto& pInstance = pScene->getModelInstance(modelId, i);
+            state.instances[i].transform = pInstance->getTransformMatrix();
+            state.instances[i].bounds = pInstance->getBoundingBox();
+            state.instances[i].visible = pInstance->isVisible();
+        }
+        return state;
+    }
+
+    void SceneChangeTracker::reset(const Scene* pScene)
+    {
+        mModels.clear();
+        mLightsHash = hashLights(pScene);
+        if (!pScene) return;
+
+        for (uint32_t modelId = 0; modelId < pScene->getModelCount(); ++modelId)
+        {
+            mModels.push_back(captureModel(pScene, modelId));
+        }
+    }
+
+    bool SceneChangeTracker::update(const Scene* pScene, std::vector<BoundingBox>& changedRegions)
+    {
+        changedRegions.clear();
+
+        bool sameStructure = pScene && pScene->getModelCount() == mModels.size();
+        for (uint32_t modelId = 0; sameStructure && modelId < (uint32_t)mModels.size(); ++modelId)
+        {
+            sameStructure = pScene->getModel(modelId).get() == mModels[modelId].pModel &&
+                            pScene->getModelInstanceCount(modelId) == mModels[modelId].instances.size();
+        }
+        if (!sameStructure)
+        {
+            reset(pScene);
+            return false;
+        }
+
+        for (uint32_t modelId = 0; modelId < (uint32_t)mModels.size(); ++modelId)
+        {
+            ModelState current = captureModel(pScene, modelId);
+            ModelState& previous = mModels[modelId];
+
+            // A new pose may move any vertex within the instance bounds
+            const bool poseChanged = current.poseHash != previous.poseHash;
+            for (size_t i = 0; i < current.instances.size(); ++i)
+            {
+                const InstanceState& before = previous.instances[i];
+                const InstanceState& after = current.instances[i];
+                if (!before.visible && !after.visible) continue;
+
+                if (poseChanged || before.visible != after.visible || before.transform != after.transform)
+                {
+                    changedRegions.push_back(BoundingBox::fromUnion(before.bounds, after.bounds));
+                }
+            }
+            previous = std::move(current);
+        }
+        return true;
+    }
+
+    bool SceneChangeTracker::updateLights(const Scene* pScene)
+    {
+        const uint64_t hash = hashLights(pScene);
+        const bool changed = hash != mLightsHash;
+        mLightsHash = hash;
+        return changed;
+    }
+}
@@ -0,0 +1,84 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include "Falcor.h"
+
+namespace Falcor
+{
+    /** Detects geometry that moved between two frames.
+        Falcor has no change notifications, so the tracker keeps the transform, visibility and bounds of every model
+        instance and compares them each time update() is called. Instance changes come from ObjectInstance setters and
+        from paths moving the instance, skinned models are compared by their current bone matrices.
+    */
+    class SceneChangeTracker
+    {
+    public:
+        using SharedPtr = std::shared_ptr<SceneChangeTracker>;
+
+        static SharedPtr create();
+
+        /** Take a new snapshot of the scene. Nothing is reported as changed for the snapshot itself.
+        */
+        void reset(const Scene* pScene);
+
+        /** Compare the scene with the last snapshot, then update the snapshot.
+            \param[out] changedRegions World space regions affected by the changes, the union of the old and new bounds of each changed instance
+            \return false if models or instances were added or removed. Regions can't be computed then, the caller should treat the whole scene as changed.
+        */
+        bool update(const Scene* pScene, std::vector<BoundingBox>& changedRegions);
+
+        /** Compare the scene lights with the last snapshot, then update the snapshot.
+            \return true if a light was added, removed or any of its parameters changed
+        */
+        bool updateLights(const Scene* pScene);
+
+    private:
+        SceneChangeTracker() = default;
+
+        struct InstanceState
+        {
+            glm::mat4 transform;
+            BoundingBox bounds;
+            bool visible = true;
+        };
+
+        struct ModelState
+        {
+            const Model* pModel = nullptr;
+            uint64_t poseHash = 0;
+            std::vector<InstanceState> instances;
+        };
+
+        static uint64_t hashPose(const Model* pModel);
+        static ModelState captureModel(const Scene* pScene, uint32_t modelId);
+        static uint64_t hashLights(const Scene* pScene);
+
+        std::vector<ModelState> mModels;
+        uint64_t mLightsHash = 0;
+    };
+}
@@ -0,0 +1,92 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "UnitTest.h"
+#include "Utils/MemoryMappedStream.h"
+#include <Windows.h>
+#include <cstdio>
+
+namespace Falcor
+{
+    namespace
+    {
+        /** Create a sparse file with a marker at the given offset. Only the marker's cluster is allocated, so multi-GB files are cheap.
+        */
+        bool createSparseFile(const std::string& filename, uint64_t size, uint64_t markerOffset, uint32_t marker)
+        {
+            HANDLE hFile = CreateFileA(filename.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (hFile == INVALID_HANDLE_VALUE) return false;
+
+            DWORD bytes = 0;
+            LARGE_INTEGER offset;
+            offset.QuadPart = (LONGLONG)markerOffset;
+            bool result = DeviceIoControl(hFile, FSCTL_SET_SPARSE, nullptr, 0, nullptr, 0, &bytes, nullptr) != 0;
+            result = result && SetFilePointerEx(hFile, offset, nullptr, FILE_BEGIN) && WriteFile(hFile, &marker, sizeof(marker), &bytes, nullptr);
+            offset.QuadPart = (LONGLONG)size;
+            result = result && SetFilePointerEx(hFile, offset, nullptr, FILE_BEGIN) && SetEndOfFile(hFile);
+            CloseHandle(hFile);
+            return result;
+        }
+    }
+
+    CPU_TEST(MemoryMappedStreamLargeFile)
+    {
+        // The sizes and offsets don't fit in 32 bits
+        const uint64_t kFileSize = 5ull << 30;
+        const uint64_t kMarkerOffset = (4ull << 30) + 4096;
+        const uint32_t kMarker = 0x12345678;
+
+        const std::string filename = getTempFilename();
+        if (createSparseFile(filename, kFileSize, kMarkerOffset, kMarker) == false)
+        {
+            logWarning("MemoryMappedStreamLargeFile: Can't create a sparse file in " + filename + ", skipping");
+            std::remove(filename.c_str());
+            return;
+        }
+
+        {
+            MemoryMappedStream stream(filename);
+            EXPECT(stream.isOpen());
+            EXPECT_EQ(stream.getRemainingStreamSize(), (size_t)kFileSize);
+
+            stream.skip((size_t)kMarkerOffset);
+            EXPECT_EQ(stream.getPosition(), (size_t)kMarkerOffset);
+            uint32_t marker = 0;
+            stream >> marker;
+            EXPECT_EQ(marker, kMarker);
+            EXPECT(stream.isGood());
+            EXPECT_EQ(stream.getRemainingStreamSize(), (size_t)(kFileSize - kMarkerOffset - sizeof(marker)));
+
+            // Reads past the real end of the mapping still fail
+            EXPECT(stream.view((size_t)kFileSize) == nullptr);
+            EXPECT(stream.isFail());
+            EXPECT_EQ(stream.getRemainingStreamSize(), 0);
+        }
+        std::remove(filename.c_str());
+    }
+
+}  // namespace Falcor
@@ -0,0 +1,256 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "UnitTest.h"
+#include "Graphics/Model/MeshOptimizer.h"
+#include "assimp/Importer.hpp"
+#include "assimp/postprocess.h"
+#include "assimp/scene.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <random>
+#include <tuple>
+
+namespace Falcor
+{
+    namespace
+    {
+        /** Triangle soup of a (size x size) quad grid: every triangle has its own 3 vertices, and triangles are in random order.
+            The worst case input for all the optimizations.
+        */
+        struct TestMesh
+        {
+            std::vector<uint8_t> positions;
+            std::vector<uint8_t> texCoords;
+            std::vector<uint32_t> indices;
+            uint32_t vertexCount = 0;
+
+            std::vector<MeshOptimizer::VertexStream> getStreams()
+            {
+                return { { &positions, sizeof(glm::vec3) }, { &texCoords, sizeof(glm::vec2) } };
+            }
+
+            glm::vec3 getPosition(uint32_t index) const
+            {
+                glm::vec3 p;
+                std::memcpy(&p, positions.data() + index * sizeof(glm::vec3), sizeof(p));
+                return p;
+            }
+        };
+
+        TestMesh createShuffledGrid(uint32_t size, uint32_t seed)
+        {
+            std::vector<std::array<glm::uvec2, 3>> triangles;
+            for (uint32_t y = 0; y < size; y++)
+            {
+                for (uint32_t x = 0; x < size; x++)
+                {
+                    triangles.push_back({ glm::uvec2(x, y), glm::uvec2(x + 1, y), glm::uvec2(x, y + 1) });
+                    triangles.push_back({ glm::uvec2(x + 1, y), glm::uvec2(x + 1, y + 1), glm::uvec2(x, y + 1) });
+                }
+            }
+            std::mt19937 rng(seed);
+            std::shuffle(triangles.begin(), triangles.end(), rng);
+
+            TestMesh mesh;
+            for (const auto& tri : triangles)
+            {
+                for (const glm::uvec2& corner : tri)
+                {
+                    glm::vec3 p(float(corner.x), float(corner.y), 0.0f);
+                    glm::vec2 uv = glm::vec2(corner) / float(size);
+                    mesh.positions.insert(mesh.positions.end(), (const uint8_t*)&p, (const uint8_t*)(&p + 1));
+                    mesh.texCoords.insert(mesh.texCoords.end(), (const uint8_t*)&uv, (const uint8_t*)(&uv + 1));
+                    mesh.indices.push_back(mesh.vertexCount++);
+                }
+            }
+            return mesh;
+        }
+
+        /** Triangles as sorted lists of corner positions, to compare meshes regardless of the vertex and triangle order
+        */
+        using TriangleKey = std::array<float, 9>;
+        std::vector<TriangleKey> getTriangleKeys(const TestMesh& mesh, uint32_t offset, uint32_t count)
+        {
+            std::vector<TriangleKey> keys;
+            for (uint32_t i = offset; i < offset + count; i += 3)
+            {
+                std::array<glm::vec3, 3> p = { mesh.getPosition(mesh.indices[i]), mesh.getPosition(mesh.indices[i + 1]), mesh.getPosition(mesh.indices[i + 2]) };
+                // Rotate the smallest corner first, keeping the winding
+                auto less = [](const glm::vec3& a, const glm::vec3& b) { return std::make_tuple(a.x, a.y, a.z) < std::make_tuple(b.x, b.y, b.z); };
+                std::rotate(p.begin(), std::min_element(p.begin(), p.end(), less), p.end());
+                keys.push_back({ p[0].x, p[0].y, p[0].z, p[1].x, p[1].y, p[1].z, p[2].x, p[2].y, p[2].z });
+            }
+            std::sort(keys.begin(), keys.end());
+            return keys;
+        }
+    }
+
+    CPU_TEST(MeshOptimizerWeldVertices)
+    {
+        TestMesh mesh = createShuffledGrid(16, 1);
+        auto streams = mesh.getStreams();
+        uint32_t vertexCount = MeshOptimizer::weldVertices(streams, mesh.vertexCount, mesh.indices);
+        EXPECT_EQ(vertexCount, 17 * 17);
+        EXPECT_EQ(mesh.positions.size(), vertexCount * sizeof(glm::vec3));
+        EXPECT_EQ(mesh.texCoords.size(), vertexCount * sizeof(glm::vec2));
+
+        // Vertices are only merged if all the streams match. Give one corner a different texture coordinate, like a UV seam.
+        mesh = createShuffledGrid(16, 1);
+        streams = mesh.getStreams();
+        glm::vec2* pTexCoords = (glm::vec2*)mesh.texCoords.data();
+        uint32_t seamCount = 0;
+        for (uint32_t v = 0; v < mesh.vertexCount; v++)
+        {
+            if (mesh.getPosition(v) == glm::vec3(8, 8, 0) && (seamCount++ % 2) == 0) pTexCoords[v].x += 1.0f;
+        }
+        vertexCount = MeshOptimizer::weldVertices(streams, mesh.vertexCount, mesh.indices);
+        EXPECT_EQ(vertexCount, 17 * 17 + 1);
+    }
+
+    CPU_TEST(MeshOptimizerPreservesTriangles)
+    {
+        TestMesh mesh = createShuffledGrid(32, 2);
+        const uint32_t half = uint32_t(mesh.indices.size() / 6) * 3;
+        const std::vector<MeshOptimizer::IndexRange> ranges = { { 0, half }, { half, uint32_t(mesh.indices.size()) - half } };
+        const auto keys0 = getTriangleKeys(mesh, ranges[0].offset, ranges[0].count);
+        const auto keys1 = getTriangleKeys(mesh, ranges[1].offset, ranges[1].count);
+
+        auto streams = mesh.getStreams();
+        MeshOptimizer::optimize(streams, mesh.vertexCount, mesh.indices, ranges, 0);
+
+        uint32_t outOfRange = 0;
+        for (uint32_t i : mesh.indices) outOfRange += (i >= mesh.vertexCount) ? 1 : 0;
+        EXPECT_EQ(outOfRange, 0);
+        EXPECT_EQ(mesh.vertexCount, 33 * 33);
+
+        // Triangles don't move between ranges, and keep their winding
+        EXPECT(getTriangleKeys(mesh, ranges[0].offset, ranges[0].count) == keys0);
+        EXPECT(getTriangleKeys(mesh, ranges[1].offset, ranges[1].count) == keys1);
+
+        // Vertices are numbered in the order they are first used
+        uint32_t nextVertex = 0;
+        uint32_t outOfOrder = 0;
+        for (uint32_t i : mesh.indices)
+        {
+            if (i == nextVertex) nextVertex++;
+            else if (i > nextVertex) outOfOrder++;
+        }
+        EXPECT_EQ(outOfOrder, 0);
+    }
+
+    CPU_TEST(MeshOptimizerVertexCache)
+    {
+        TestMesh mesh = createShuffledGrid(64, 3);
+        auto streams = mesh.getStreams();
+        MeshOptimizer::Report report = MeshOptimizer::optimize(streams, mesh.vertexCount, mesh.indices, {}, 0);
+
+        EXPECT_EQ(report.before.getAcmr(), 3.0f);
+        // A regular grid can't go below 0.5, a good ordering is within 50% of it with a 16 entry FIFO
+        EXPECT_LE(report.after.getAcmr(), 0.75f);
+        EXPECT_GE(report.after.getAcmr(), 0.5f);
+        EXPECT_LE(report.after.getAtvr(), 1.5f);
+        EXPECT_EQ(report.vertexBufferSizeAfter, 65 * 65);
+
+        // Running again on an optimized mesh doesn't make it worse
+        MeshOptimizer::Stats stats = MeshOptimizer::analyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertexCount);
+        MeshOptimizer::optimizeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertexCount);
+        EXPECT_LE(MeshOptimizer::analyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertexCount).getAcmr(), stats.getAcmr() * 1.05f);
+    }
+
+    /** Optimizes the framework's models the way the Assimp importer sees them, plus a few large synthetic meshes. The numbers go to the log.
+    */
+    CPU_TEST(MeshOptimizerBenchmark)
+    {
+        const std::vector<std::string> corpus = { "Framework/Models/Camera.obj", "Framework/Models/LightBulb.obj", "Framework/Models/RotateGizmo.obj",
+            "Framework/Models/ScaleGizmo.obj", "Framework/Models/TranslateGizmo.obj", "Effects/cube.obj" };
+
+        MeshOptimizer::Report total;
+        for (const auto& filename : corpus)
+        {
+            std::string fullpath;
+            if (findFileInDataDirectories(filename, fullpath) == false)
+            {
+                logWarning("MeshOptimizerBenchmark: Can't find " + filename);
+                continue;
+            }
+
+            // Same post-processing as AssimpModelImporter, which already joins identical vertices and runs Assimp's own cache optimization
+            Assimp::Importer importer;
+            const aiScene* pScene = importer.ReadFile(fullpath, (aiProcessPreset_TargetRealtime_MaxQuality | aiProcess_OptimizeGraph) & ~aiProcess_CalcTangentSpace);
+            if (pScene == nullptr)
+            {
+                logWarning("MeshOptimizerBenchmark: Can't load " + filename);
+                continue;
+            }
+
+            MeshOptimizer::Report modelReport;
+            for (uint32_t m = 0; m < pScene->mNumMeshes; m++)
+            {
+                const aiMesh* pAiMesh = pScene->mMeshes[m];
+                if (pAiMesh->mPrimitiveTypes != aiPrimitiveType_TRIANGLE) continue;
+
+                auto toBytes = [pAiMesh](const auto* pData) { return std::vector<uint8_t>((const uint8_t*)pData, (const uint8_t*)(pData + pAiMesh->mNumVertices)); };
+                std::vector<std::vector<uint8_t>> data;
+                data.reserve(3);
+                data.push_back(toBytes(pAiMesh->mVertices));
+                if (pAiMesh->HasNormals()) data.push_back(toBytes(pAiMesh->mNormals));
+                if (pAiMesh->HasTextureCoords(0)) data.push_back(toBytes(pAiMesh->mTextureCoords[0]));
+
+                std::vector<MeshOptimizer::VertexStream> streams;
+                for (auto& d : data) streams.push_back({ &d, sizeof(aiVector3D) });
+
+                std::vector<uint32_t> indices;
+                for (uint32_t f = 0; f < pAiMesh->mNumFaces; f++)
+                {
+                    indices.insert(indices.end(), pAiMesh->mFaces[f].mIndices, pAiMesh->mFaces[f].mIndices + 3);
+                }
+
+                uint32_t vertexCount = pAiMesh->mNumVertices;
+                modelReport += MeshOptimizer::optimize(streams, vertexCount, indices, {}, 0);
+            }
+
+            EXPECT_LE(modelReport.after.transformedVertexCount, modelReport.before.transformedVertexCount) << filename;
+            logInfo("MeshOptimizerBenchmark: " + filename + ": " + to_string(modelReport));
+            total += modelReport;
+        }
+
+        for (uint32_t size : { 128u, 512u })
+        {
+            TestMesh mesh = createShuffledGrid(size, size);
+            auto streams = mesh.getStreams();
+            MeshOptimizer::Report report = MeshOptimizer::optimize(streams, mesh.vertexCount, mesh.indices, {}, 0);
+            logInfo("MeshOptimizerBenchmark: shuffled " + std::to_string(size) + "x" + std::to_string(size) + " grid: " + to_string(report) + ", " +
+                std::to_string(uint32_t(report.before.triangleCount / (report.timeInMs * 1e-3f))) + " triangles/s");
+            total += report;
+        }
+
+        logInfo("MeshOptimizerBenchmark: total: " + to_string(total));
+    }
+
+}  // namespace Falcor
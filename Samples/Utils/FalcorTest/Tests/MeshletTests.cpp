@@ -0,0 +1,401 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "UnitTest.h"
+#include "Graphics/Model/Meshlets.h"
+#include "Utils/CpuTimer.h"
+#include "glm/gtc/matrix_transform.hpp"
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <random>
+#include <tuple>
+
+namespace Falcor
+{
+    namespace
+    {
+        struct TestMesh
+        {
+            std::vector<glm::vec3> positions;
+            std::vector<uint32_t> indices;
+
+            std::vector<MeshletData> buildMeshlets()
+            {
+                return MeshletBuilder::build((const uint8_t*)positions.data(), sizeof(glm::vec3), (uint32_t)positions.size(), indices.data(), (uint32_t)indices.size());
+            }
+        };
+
+        /** UV sphere of radius 1, counter-clockwise when seen from outside
+        */
+        TestMesh createSphere(uint32_t rings, uint32_t segments)
+        {
+            TestMesh mesh;
+            for (uint32_t r = 0; r <= rings; r++)
+            {
+                for (uint32_t s = 0; s <= segments; s++)
+                {
+                    float theta = float(M_PI) * r / rings;
+                    float phi = 2.0f * float(M_PI) * s / segments;
+                    mesh.positions.push_back(glm::vec3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)));
+                }
+            }
+            for (uint32_t r = 0; r < rings; r++)
+            {
+                for (uint32_t s = 0; s < segments; s++)
+                {
+                    uint32_t i0 = r * (segments + 1) + s;
+                    uint32_t i1 = i0 + segments + 1;
+                    mesh.indices.insert(mesh.indices.end(), { i0, i1, i0 + 1, i0 + 1, i1, i1 + 1 });
+                }
+            }
+            return mesh;
+        }
+
+        /** Heightfield on the XZ plane, facing +Y
+        */
+        TestMesh createTerrain(uint32_t size, uint32_t seed)
+        {
+            std::mt19937 rng(seed);
+            std::uniform_real_distribution<float> height(0.0f, 0.5f);
+            TestMesh mesh;
+            for (uint32_t z = 0; z <= size; z++)
+            {
+                for (uint32_t x = 0; x <= size; x++)
+                {
+                    mesh.positions.push_back(glm::vec3(float(x), height(rng), float(z)));
+                }
+            }
+            for (uint32_t z = 0; z < size; z++)
+            {
+                for (uint32_t x = 0; x < size; x++)
+                {
+                    uint32_t i0 = z * (size + 1) + x;
+                    uint32_t i1 = i0 + size + 1;
+                    mesh.indices.insert(mesh.indices.end(), { i0, i1, i0 + 1, i0 + 1, i1, i1 + 1 });
+                }
+            }
+            return mesh;
+        }
+
+        /** Disconnected triangles in random order
+        */
+        TestMesh createSoup(uint32_t triangleCount, uint32_t seed)
+        {
+            std::mt19937 rng(seed);
+            std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+            TestMesh mesh;
+            for (uint32_t t = 0; t < triangleCount; t++)
+            {
+                glm::vec3 center(u(rng) * 20.0f, u(rng) * 20.0f, u(rng) * 20.0f);
+                for (uint32_t k = 0; k < 3; k++)
+                {
+                    mesh.indices.push_back((uint32_t)mesh.positions.size());
+                    mesh.positions.push_back(center + glm::vec3(u(rng), u(rng), u(rng)) * 0.2f);
+                }
+            }
+            return mesh;
+        }
+
+        /** Triangles with their corners rotated so the smallest index comes first, to compare triangle lists regardless of order
+        */
+        std::vector<std::array<uint32_t, 3>> getSortedTriangles(const std::vector<uint32_t>& indices)
+        {
+            std::vector<std::array<uint32_t, 3>> triangles;
+            for (size_t i = 0; i + 2 < indices.size(); i += 3)
+            {
+                std::array<uint32_t, 3> t = { indices[i], indices[i + 1], indices[i + 2] };
+                std::rotate(t.begin(), std::min_element(t.begin(), t.end()), t.end());
+                triangles.push_back(t);
+            }
+            std::sort(triangles.begin(), triangles.end());
+            return triangles;
+        }
+
+        glm::mat4 createViewProj(const glm::vec3& eye, const glm::vec3& target, float farZ = 100.0f)
+        {
+            return glm::perspective(1.0f, 16.0f / 9.0f, 0.1f, farZ) * glm::lookAt(eye, target, glm::vec3(0, 1, 0));
+        }
+
+        /** Brute force check that a triangle can't produce pixels: either all its corners are outside the same clip plane, or it's back-facing
+        */
+        bool isTriangleInvisible(const glm::mat4& viewProj, const glm::mat4& world, const glm::vec3& eye, const glm::vec3 p[3])
+        {
+            glm::vec3 w[3];
+            glm::vec4 clip[3];
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                w[k] = glm::vec3(world * glm::vec4(p[k], 1));
+                clip[k] = viewProj * glm::vec4(w[k], 1);
+            }
+
+            auto allOutside = [&clip](auto isOutside) { return isOutside(clip[0]) && isOutside(clip[1]) && isOutside(clip[2]); };
+            if (allOutside([](const glm::vec4& c) { return c.x > c.w; }) || allOutside([](const glm::vec4& c) { return c.x < -c.w; })) return true;
+            if (allOutside([](const glm::vec4& c) { return c.y > c.w; }) || allOutside([](const glm::vec4& c) { return c.y < -c.w; })) return true;
+            if (allOutside([](const glm::vec4& c) { return c.z > c.w; }) || allOutside([](const glm::vec4& c) { return c.z < 0; })) return true;
+
+            glm::vec3 normal = glm::cross(w[1] - w[0], w[2] - w[0]);
+            return glm::dot(normal, eye - w[0]) <= 1e-5f * glm::length(normal);
+        }
+    }
+
+    CPU_TEST(MeshletLimits)
+    {
+        const std::vector<std::pair<TestMesh, bool>> meshes = { { createSphere(64, 128), true }, { createTerrain(100, 1), true }, { createSoup(5000, 2), false } };
+        for (auto entry : meshes)
+        {
+            TestMesh& mesh = entry.first;
+            const auto triangles = getSortedTriangles(mesh.indices);
+            std::vector<MeshletData> meshlets = mesh.buildMeshlets();
+
+            // The meshlets cover the index buffer in order, and the triangles are only reordered
+            uint32_t nextIndex = 0;
+            uint32_t overLimit = 0;
+            for (const MeshletData& meshlet : meshlets)
+            {
+                EXPECT_EQ(meshlet.indexOffset, nextIndex);
+                nextIndex += meshlet.triangleCount * 3;
+
+                std::vector<uint32_t> vertices(mesh.indices.begin() + meshlet.indexOffset, mesh.indices.begin() + nextIndex);
+                std::sort(vertices.begin(), vertices.end());
+                uint32_t vertexCount = uint32_t(std::unique(vertices.begin(), vertices.end()) - vertices.begin());
+                EXPECT_EQ(meshlet.vertexCount, vertexCount);
+                if (meshlet.triangleCount == 0 || meshlet.triangleCount > MeshletBuilder::kMaxTriangles || vertexCount > MeshletBuilder::kMaxVertices) overLimit++;
+            }
+            EXPECT_EQ(nextIndex, (uint32_t)mesh.indices.size());
+            EXPECT_EQ(overLimit, 0);
+            EXPECT(getSortedTriangles(mesh.indices) == triangles);
+
+            // Connected meshes fill the meshlets reasonably well. Soups are limited by the vertex count.
+            const uint32_t minTriangles = entry.second ? 48 : MeshletBuilder::kMaxVertices / 3;
+            EXPECT_LE(meshlets.size(), triangles.size() / minTriangles + 1);
+        }
+    }
+
+    CPU_TEST(MeshletCullingIsConservative)
+    {
+        std::mt19937 rng(3);
+        std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+
+        TestMesh sphere = createSphere(48, 96);
+        std::vector<MeshletData> meshlets = sphere.buildMeshlets();
+
+        uint32_t culledMeshlets = 0;
+        uint32_t visibleCulled = 0;
+        for (uint32_t view = 0; view < 200; view++)
+        {
+            // Rotated, scaled and translated instance, seen from outside
+            glm::vec3 translation(u(rng) * 3.0f, u(rng) * 3.0f, u(rng) * 3.0f);
+            glm::mat4 world = glm::translate(glm::mat4(), translation) * glm::rotate(glm::mat4(), u(rng) * 3.0f, glm::normalize(glm::vec3(u(rng), u(rng), 1.0f))) * glm::scale(glm::mat4(), glm::vec3(1.5f));
+            glm::vec3 eye;
+            do
+            {
+                eye = glm::vec3(u(rng), u(rng), u(rng)) * 8.0f;
+            } while (glm::length(eye - translation) < 2.0f);
+            glm::mat4 viewProj = createViewProj(eye, translation + glm::vec3(u(rng), u(rng), u(rng)) * 2.0f);
+
+            MeshletCuller culler;
+            culler.setView(viewProj, world, true);
+            for (const MeshletData& meshlet : meshlets)
+            {
+                if (culler.isCulled(meshlet) == false) continue;
+                culledMeshlets++;
+                for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+                {
+                    const uint32_t* pTriangle = sphere.indices.data() + meshlet.indexOffset + t * 3;
+                    glm::vec3 p[3] = { sphere.positions[pTriangle[0]], sphere.positions[pTriangle[1]], sphere.positions[pTriangle[2]] };
+                    if (isTriangleInvisible(viewProj, world, eye, p) == false)
+                    {
+                        visibleCulled++;
+                        break;
+                    }
+                }
+            }
+        }
+        EXPECT_EQ(visibleCulled, 0);
+        EXPECT_GT(culledMeshlets, 0);
+
+        // Without back-face culling, a sphere in the middle of the frustum is fully visible
+        MeshletCuller culler;
+        culler.setView(createViewProj(glm::vec3(0, 0, 5), glm::vec3(0)), glm::mat4(), false);
+        std::vector<uint8_t> visibility(meshlets.size(), 0);
+        EXPECT_EQ(culler.cull(meshlets, visibility), 0);
+    }
+
+    CPU_TEST(MeshletDrawRanges)
+    {
+        TestMesh terrain = createTerrain(64, 4);
+        std::vector<MeshletData> meshlets = terrain.buildMeshlets();
+        std::vector<uint8_t> visibility(meshlets.size());
+        for (size_t i = 0; i < visibility.size(); i++) visibility[i] = (i % 3) != 0;
+
+        for (uint32_t maxRangeCount : { 1u, 4u, 1000u })
+        {
+            std::vector<MeshletCuller::DrawRange> ranges;
+            uint32_t drawnTriangles = MeshletCuller::buildDrawRanges(meshlets, visibility, maxRangeCount, ranges);
+            EXPECT_LE(ranges.size(), maxRangeCount);
+
+            uint32_t rangeTriangles = 0;
+            for (const auto& range : ranges) rangeTriangles += range.indexCount / 3;
+            EXPECT_EQ(rangeTriangles, drawnTriangles);
+
+            // Every visible meshlet is drawn
+            uint32_t missing = 0;
+            for (size_t i = 0; i < meshlets.size(); i++)
+            {
+                if (visibility[i] == 0) continue;
+                auto contains = [&meshlets, i](const MeshletCuller::DrawRange& r) { return meshlets[i].indexOffset >= r.indexOffset && meshlets[i].indexOffset + meshlets[i].triangleCount * 3 <= r.indexOffset + r.indexCount; };
+                if (std::none_of(ranges.begin(), ranges.end(), contains)) missing++;
+            }
+            EXPECT_EQ(missing, 0);
+        }
+    }
+
+    /** With Model::LoadFlags::OptimizeMeshes, the meshlets are built first and the vertex cache order is optimized inside each of them.
+        The meshlets survive unchanged, the ACMR pays for the cache misses at the meshlet boundaries.
+    */
+    CPU_TEST(MeshletOptimizeInsideMeshlets)
+    {
+        const TestMesh sphere = createSphere(64, 128);
+        auto getAcmr = [](const TestMesh& mesh) { return MeshOptimizer::analyzeVertexCache(mesh.indices.data(), mesh.indices.size(), (uint32_t)mesh.positions.size()).getAcmr(); };
+
+        TestMesh meshletOrder = sphere;
+        meshletOrder.buildMeshlets();
+
+        TestMesh wholeOptimized = sphere;
+        std::vector<uint8_t> wholeData((const uint8_t*)sphere.positions.data(), (const uint8_t*)(sphere.positions.data() + sphere.positions.size()));
+        std::vector<MeshOptimizer::VertexStream> wholeStreams = { { &wholeData, sizeof(glm::vec3) } };
+        uint32_t wholeVertexCount = (uint32_t)sphere.positions.size();
+        MeshOptimizer::optimize(wholeStreams, wholeVertexCount, wholeOptimized.indices, {}, 0);
+
+        TestMesh mesh = sphere;
+        std::vector<uint8_t> data((const uint8_t*)sphere.positions.data(), (const uint8_t*)(sphere.positions.data() + sphere.positions.size()));
+        std::vector<MeshOptimizer::VertexStream> streams = { { &data, sizeof(glm::vec3) } };
+        uint32_t vertexCount = (uint32_t)sphere.positions.size();
+        MeshOptimizer::Report report;
+        std::vector<std::vector<MeshletData>> meshlets = MeshletBuilder::buildOptimized(streams, vertexCount, mesh.indices, {}, 0, report);
+        mesh.positions.assign((const glm::vec3*)data.data(), (const glm::vec3*)data.data() + vertexCount);
+
+        EXPECT_EQ(meshlets.size(), 1);
+        EXPECT_EQ(meshlets[0].size(), meshletOrder.buildMeshlets().size());
+
+        // The report describes the index buffer which is uploaded
+        EXPECT_EQ(report.after.getAcmr(), getAcmr(mesh));
+        EXPECT_EQ(report.before.getAcmr(), getAcmr(sphere));
+
+        // The meshlets still cover the index buffer in order and hold the same geometry, so their bounds are valid
+        uint32_t nextIndex = 0;
+        uint32_t mismatches = 0;
+        for (const MeshletData& meshlet : meshlets[0])
+        {
+            EXPECT_EQ(meshlet.indexOffset, nextIndex);
+            nextIndex += meshlet.triangleCount * 3;
+
+            std::vector<uint32_t> vertices(mesh.indices.begin() + meshlet.indexOffset, mesh.indices.begin() + nextIndex);
+            std::sort(vertices.begin(), vertices.end());
+            EXPECT_EQ(meshlet.vertexCount, uint32_t(std::unique(vertices.begin(), vertices.end()) - vertices.begin()));
+
+            // The normal cone sums the triangles in a different order, allow for rounding
+            MeshletData bounds = MeshletBuilder::computeBounds((const uint8_t*)mesh.positions.data(), sizeof(glm::vec3), mesh.indices.data(), meshlet.indexOffset, meshlet.triangleCount);
+            if (bounds.center != meshlet.center || bounds.radius != meshlet.radius || std::abs(bounds.coneCutoff - meshlet.coneCutoff) > 1e-4f) mismatches++;
+        }
+        EXPECT_EQ(nextIndex, (uint32_t)mesh.indices.size());
+        EXPECT_EQ(mismatches, 0);
+
+        // The trade-off: better than the meshlet order alone, slightly worse than optimizing the whole mesh
+        logInfo("MeshletOptimizeInsideMeshlets: ACMR meshlets " + std::to_string(getAcmr(meshletOrder)) + ", meshlets + optimizer " + std::to_string(getAcmr(mesh)) +
+            ", optimizer " + std::to_string(getAcmr(wholeOptimized)));
+        EXPECT_LT(getAcmr(mesh), getAcmr(meshletOrder));
+        EXPECT_LE(getAcmr(mesh), getAcmr(wholeOptimized) * 1.25f);
+    }
+
+    /** Culls a few meshes against many views. The rejection rate and the CPU cost go to the log.
+    */
+    CPU_TEST(MeshletCullingBenchmark)
+    {
+        const std::vector<std::pair<std::string, TestMesh>> meshes = { { "sphere", createSphere(256, 512) }, { "terrain", createTerrain(362, 5) } };
+        const uint32_t kViewCount = 1000;
+
+        for (auto entry : meshes)
+        {
+            TestMesh& mesh = entry.second;
+            const uint32_t triangleCount = (uint32_t)mesh.indices.size() / 3;
+
+            auto buildStart = CpuTimer::getCurrentTimePoint();
+            std::vector<MeshletData> meshlets = mesh.buildMeshlets();
+            float buildTime = CpuTimer::calcDuration(buildStart, CpuTimer::getCurrentTimePoint());
+
+            // Cameras around the mesh's bounding sphere, looking at random points of it
+            glm::vec3 boxMin(FLT_MAX), boxMax(-FLT_MAX);
+            for (const glm::vec3& p : mesh.positions)
+            {
+                boxMin = glm::min(boxMin, p);
+                boxMax = glm::max(boxMax, p);
+            }
+            const glm::vec3 center = (boxMin + boxMax) * 0.5f;
+            const float radius = glm::length(boxMax - boxMin) * 0.5f;
+
+            std::mt19937 rng(6);
+            std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+            std::vector<glm::mat4> views(kViewCount);
+            for (auto& viewProj : views)
+            {
+                glm::vec3 dir = glm::normalize(glm::vec3(u(rng), std::abs(u(rng)) + 0.1f, u(rng)));
+                glm::vec3 eye = center + dir * radius * (0.5f + std::abs(u(rng)) * 1.5f);
+                viewProj = createViewProj(eye, center + glm::vec3(u(rng), u(rng), u(rng)) * radius * 0.5f, radius * 4.0f);
+            }
+
+            uint64_t culledTriangles = 0;
+            uint64_t frustumCulledTriangles = 0;
+            std::vector<uint8_t> visibility(meshlets.size());
+            MeshletCuller culler;
+            auto cullStart = CpuTimer::getCurrentTimePoint();
+            for (const auto& viewProj : views)
+            {
+                std::fill(visibility.begin(), visibility.end(), 0);
+                culler.setView(viewProj, glm::mat4(), true);
+                culledTriangles += culler.cull(meshlets, visibility);
+            }
+            float cullTime = CpuTimer::calcDuration(cullStart, CpuTimer::getCurrentTimePoint());
+
+            for (const auto& viewProj : views)
+            {
+                std::fill(visibility.begin(), visibility.end(), 0);
+                culler.setView(viewProj, glm::mat4(), false);
+                frustumCulledTriangles += culler.cull(meshlets, visibility);
+            }
+
+            const double totalTriangles = double(triangleCount) * kViewCount;
+            logInfo("MeshletCullingBenchmark: " + entry.first + ": " + std::to_string(triangleCount) + " triangles, " + std::to_string(meshlets.size()) + " meshlets built in " +
+                std::to_string(buildTime) + " ms. Culled " + std::to_string(100.0 * culledTriangles / totalTriangles) + "% of the triangles (" +
+                std::to_string(100.0 * frustumCulledTriangles / totalTriangles) + "% by the frustum alone), " +
+                std::to_string(uint64_t(culledTriangles / std::max(cullTime, 1e-3f))) + " triangles rejected/ms, " + std::to_string(cullTime * 1000.0f / kViewCount) + " us per view");
+            EXPECT_GE(culledTriangles, frustumCulledTriangles);
+        }
+    }
+
+}  // namespace Falcor
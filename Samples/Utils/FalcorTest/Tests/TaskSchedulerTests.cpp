@@ -0,0 +1,212 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "UnitTest.h"
+#include <atomic>
+#include <thread>
+
+namespace Falcor
+{
+    namespace
+    {
+        // More workers than most test machines have cores, so stealing and oversubscription get exercised everywhere
+        std::unique_ptr<TaskScheduler> createTestScheduler(uint32_t workerCount = 7)
+        {
+            TaskScheduler::Desc desc;
+            desc.workerCount = workerCount;
+            return TaskScheduler::create(desc);
+        }
+
+        void spawnTree(TaskGroup& group, std::atomic<uint32_t>& leaves, uint32_t depth)
+        {
+            if (depth == 0)
+            {
+                leaves++;
+                return;
+            }
+            group.run([&group, &leaves, depth]() { spawnTree(group, leaves, depth - 1); });
+            group.run([&group, &leaves, depth]() { spawnTree(group, leaves, depth - 1); });
+        }
+    }
+
+    CPU_TEST(TaskSchedulerParallelFor)
+    {
+        auto pScheduler = createTestScheduler();
+        const uint32_t n = 100003;
+        std::vector<std::atomic<uint32_t>> hits(n);
+
+        for (uint32_t grainSize : { 0u, 1u, 7u, 1024u, n })
+        {
+            for (auto& h : hits) h = 0;
+            std::atomic<uint32_t> oversized(0);
+            pScheduler->parallelFor(0, n, grainSize, [&](uint32_t first, uint32_t last)
+            {
+                if (grainSize && last - first > grainSize) oversized++;
+                for (uint32_t i = first; i < last; i++) hits[i]++;
+            });
+
+            uint32_t wrong = 0;
+            for (auto& h : hits) wrong += (h != 1) ? 1 : 0;
+            EXPECT_EQ(wrong, 0) << "grainSize = " << grainSize;
+            EXPECT_EQ(oversized.load(), 0) << "grainSize = " << grainSize;
+        }
+    }
+
+    CPU_TEST(TaskSchedulerParallelReduce)
+    {
+        auto pScheduler = createTestScheduler();
+        auto sum = [](uint32_t first, uint32_t last)
+        {
+            uint64_t s = 0;
+            for (uint32_t i = first; i < last; i++) s += i;
+            return s;
+        };
+        auto add = [](uint64_t a, uint64_t b) { return a + b; };
+
+        const uint32_t n = 1000000;
+        EXPECT_EQ(pScheduler->parallelReduce(0u, n, 0u, uint64_t(0), sum, add), uint64_t(n - 1) * n / 2);
+        EXPECT_EQ(pScheduler->parallelReduce(10u, 10u, 0u, uint64_t(42), sum, add), 42);
+
+        // Partial results are combined in range order, floating point sums don't depend on the worker count
+        auto sumFloat = [](uint32_t first, uint32_t last)
+        {
+            float s = 0;
+            for (uint32_t i = first; i < last; i++) s += 1.0f / float(i + 1);
+            return s;
+        };
+        auto addFloat = [](float a, float b) { return a + b; };
+        auto pSingle = createTestScheduler(1);
+        EXPECT_EQ(pScheduler->parallelReduce(0u, n, 1000u, 0.0f, sumFloat, addFloat), pSingle->parallelReduce(0u, n, 1000u, 0.0f, sumFloat, addFloat));
+    }
+
+    CPU_TEST(TaskSchedulerContinuation)
+    {
+        auto pScheduler = createTestScheduler();
+        for (uint32_t iteration = 0; iteration < 100; iteration++)
+        {
+            std::atomic<uint32_t> count(0);
+            std::atomic<uint32_t> seenByContinuation(0);
+            std::atomic<uint32_t> seenBySecond(0);
+            {
+                TaskGroup group(*pScheduler);
+                for (uint32_t i = 0; i < 64; i++)
+                {
+                    group.run([&]() { count++; });
+                }
+                group.then([&]()
+                {
+                    seenByContinuation = count.load();
+                    // A continuation may add work, the group stays busy until it finished too
+                    group.run([&]() { count++; });
+                });
+                group.wait();
+                EXPECT_EQ(seenByContinuation.load(), 64);
+                EXPECT_EQ(count.load(), 65);
+
+                // An idle group runs the continuation right away
+                group.then([&]() { seenBySecond = count.load(); });
+                group.wait();
+                EXPECT_EQ(seenBySecond.load(), 65);
+            }
+        }
+    }
+
+    CPU_TEST(TaskSchedulerNestedStress)
+    {
+        auto pScheduler = createTestScheduler();
+        for (uint32_t iteration = 0; iteration < 20; iteration++)
+        {
+            std::atomic<uint32_t> leaves(0);
+            {
+                TaskGroup group(*pScheduler);
+                spawnTree(group, leaves, 14);
+            }
+            EXPECT_EQ(leaves.load(), 1u << 14);
+
+            // parallelFor inside parallelFor, the inner waits run tasks instead of blocking workers
+            std::atomic<uint32_t> items(0);
+            pScheduler->parallelFor(0, 64, 1, [&](uint32_t first, uint32_t last)
+            {
+                for (uint32_t i = first; i < last; i++)
+                {
+                    pScheduler->parallelFor(0, 256, 16, [&](uint32_t a, uint32_t b) { items += b - a; });
+                }
+            });
+            EXPECT_EQ(items.load(), 64 * 256);
+        }
+
+        // Fire-and-forget tasks finish before the scheduler goes away
+        std::atomic<uint32_t> done(0);
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            pScheduler->spawn([&]() { std::this_thread::yield(); done++; });
+        }
+        pScheduler.reset();
+        EXPECT_EQ(done.load(), 256);
+    }
+
+    /** Throughput numbers go to the log, the test only fails if work went missing
+    */
+    CPU_TEST(TaskSchedulerThroughput)
+    {
+        TaskScheduler& scheduler = TaskScheduler::instance();
+        scheduler.resetStats();
+
+        // Empty tasks measure pure scheduling overhead
+        const uint32_t taskCount = 1 << 20;
+        std::atomic<uint32_t> executed(0);
+        auto start = CpuTimer::getCurrentTimePoint();
+        {
+            TaskGroup group(scheduler);
+            for (uint32_t i = 0; i < taskCount; i++)
+            {
+                group.run([&]() { executed++; });
+            }
+        }
+        float spawnMs = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+        EXPECT_EQ(executed.load(), taskCount);
+
+        // Recursive splitting, what parallelFor does for a large range of small items
+        const uint32_t itemCount = 1 << 24;
+        start = CpuTimer::getCurrentTimePoint();
+        uint64_t sum = scheduler.parallelReduce(0u, itemCount, 0u, uint64_t(0), [](uint32_t first, uint32_t last)
+        {
+            uint64_t s = 0;
+            for (uint32_t i = first; i < last; i++) s += i & 0xff;
+            return s;
+        }, [](uint64_t a, uint64_t b) { return a + b; });
+        float reduceMs = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+        EXPECT_EQ(sum, uint64_t(itemCount / 256) * (255 * 256 / 2));
+
+        TaskScheduler::Stats stats = scheduler.getStats();
+        logInfo("TaskScheduler throughput with " + std::to_string(scheduler.getConcurrency()) + " threads: " +
+            std::to_string(uint32_t(taskCount / (spawnMs * 1e-3f))) + " empty tasks/s, " +
+            std::to_string(uint32_t(itemCount / (reduceMs * 1e-3f))) + " reduced items/s, " +
+            std::to_string(stats.tasksStolen) + " of " + std::to_string(stats.tasksExecuted) + " tasks stolen");
+    }
+
+}  // namespace Falcor